@@ -0,0 +1,900 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+// Headless benchmarks of the Recast build and of the Detour queries.
+//
+// Builds a solo navmesh from each of the bundled meshes, using the default
+// settings of the demo, and times every build stage. The navmesh is then used
+// to measure the throughput of the most common queries and the cost of a
+// crowd update with a varying number of agents. The results are written as
+// JSON, so that they can be compared between runs.
+//
+// Usage: RecastBenchmarks [-m <mesh dir>] [-o <output file>] [-i <iterations>] [mesh.obj ...]
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCrowd.h"
+#include "MeshLoaderObj.h"
+#include "PerfTimer.h"
+
+static const char* DEFAULT_MESHES[] = { "dungeon.obj", "nav_test.obj", "undulating.obj" };
+static const int DEFAULT_MESH_COUNT = sizeof(DEFAULT_MESHES) / sizeof(DEFAULT_MESHES[0]);
+
+static const int QUERY_COUNT = 1000;
+static const int MAX_PATH = 256;
+static const int MAX_NODES = 2048;
+
+static const int CROWD_SIZES[] = { 10, 100, 500 };
+static const int CROWD_SIZE_COUNT = sizeof(CROWD_SIZES) / sizeof(CROWD_SIZES[0]);
+static const int CROWD_UPDATES = 100;
+static const float CROWD_DT = 0.1f;
+
+/// Build context which accumulates the time spent in each build stage.
+class BenchmarkContext : public rcContext
+{
+	TimeVal m_startTime[RC_MAX_TIMERS];
+	TimeVal m_accTime[RC_MAX_TIMERS];
+
+public:
+	BenchmarkContext()
+	{
+		resetTimers();
+	}
+
+	/// Returns true if the timer was started since the last reset.
+	bool isTimerUsed(const rcTimerLabel label) const { return m_accTime[label] >= 0; }
+
+protected:
+	virtual void doLog(const rcLogCategory category, const char* msg, const int /*len*/)
+	{
+		if (category == RC_LOG_ERROR)
+			fprintf(stderr, "%s\n", msg);
+	}
+
+	virtual void doResetTimers()
+	{
+		for (int i = 0; i < RC_MAX_TIMERS; ++i)
+			m_accTime[i] = -1;
+	}
+
+	virtual void doStartTimer(const rcTimerLabel label)
+	{
+		m_startTime[label] = getPerfTime();
+	}
+
+	virtual void doStopTimer(const rcTimerLabel label)
+	{
+		const TimeVal deltaTime = getPerfTime() - m_startTime[label];
+		if (m_accTime[label] == -1)
+			m_accTime[label] = deltaTime;
+		else
+			m_accTime[label] += deltaTime;
+	}
+
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const
+	{
+		return m_accTime[label] >= 0 ? getPerfTimeUsec(m_accTime[label]) : -1;
+	}
+
+	virtual void doAddAccumulatedTime(const rcTimerLabel label, const int time)
+	{
+		const TimeVal deltaTime = getPerfTimeFromUsec(time);
+		if (m_accTime[label] == -1)
+			m_accTime[label] = deltaTime;
+		else
+			m_accTime[label] += deltaTime;
+	}
+};
+
+static const char* getTimerName(const rcTimerLabel label)
+{
+	switch (label)
+	{
+	case RC_TIMER_TOTAL: return "total";
+	case RC_TIMER_TEMP: return "temp";
+	case RC_TIMER_RASTERIZE_TRIANGLES: return "rasterize_triangles";
+	case RC_TIMER_BUILD_COMPACTHEIGHTFIELD: return "build_compactheightfield";
+	case RC_TIMER_BUILD_CONTOURS: return "build_contours";
+	case RC_TIMER_BUILD_CONTOURS_TRACE: return "build_contours_trace";
+	case RC_TIMER_BUILD_CONTOURS_SIMPLIFY: return "build_contours_simplify";
+	case RC_TIMER_FILTER_BORDER: return "filter_border";
+	case RC_TIMER_FILTER_WALKABLE: return "filter_walkable";
+	case RC_TIMER_MEDIAN_AREA: return "median_area";
+	case RC_TIMER_FILTER_LOW_OBSTACLES: return "filter_low_obstacles";
+	case RC_TIMER_BUILD_POLYMESH: return "build_polymesh";
+	case RC_TIMER_MERGE_POLYMESH: return "merge_polymesh";
+	case RC_TIMER_ERODE_AREA: return "erode_area";
+	case RC_TIMER_MARK_BOX_AREA: return "mark_box_area";
+	case RC_TIMER_MARK_CYLINDER_AREA: return "mark_cylinder_area";
+	case RC_TIMER_MARK_CONVEXPOLY_AREA: return "mark_convexpoly_area";
+	case RC_TIMER_BUILD_DISTANCEFIELD: return "build_distancefield";
+	case RC_TIMER_BUILD_DISTANCEFIELD_DIST: return "build_distancefield_dist";
+	case RC_TIMER_BUILD_DISTANCEFIELD_BLUR: return "build_distancefield_blur";
+	case RC_TIMER_BUILD_REGIONS: return "build_regions";
+	case RC_TIMER_BUILD_REGIONS_WATERSHED: return "build_regions_watershed";
+	case RC_TIMER_BUILD_REGIONS_EXPAND: return "build_regions_expand";
+	case RC_TIMER_BUILD_REGIONS_FLOOD: return "build_regions_flood";
+	case RC_TIMER_BUILD_REGIONS_FILTER: return "build_regions_filter";
+	case RC_TIMER_BUILD_LAYERS: return "build_layers";
+	case RC_TIMER_BUILD_POLYMESHDETAIL: return "build_polymeshdetail";
+	case RC_TIMER_MERGE_POLYMESHDETAIL: return "merge_polymeshdetail";
+	case RC_TIMER_FILTER_HEIGHTFIELD: return "filter_heightfield";
+	case RC_MAX_TIMERS: break;
+	}
+	return "unknown";
+}
+
+// Deterministic random numbers, so that every run measures the same queries.
+static unsigned int s_randSeed = 1;
+
+static void seedRand(unsigned int seed)
+{
+	s_randSeed = seed;
+}
+
+static float frand()
+{
+	s_randSeed = s_randSeed * 1103515245 + 12345;
+	return (float)((s_randSeed >> 16) & 0x7fff) / 32768.0f;
+}
+
+/// The build settings, matching the defaults of the demo.
+struct BuildSettings
+{
+	float cellSize;
+	float cellHeight;
+	float agentHeight;
+	float agentRadius;
+	float agentMaxClimb;
+	float agentMaxSlope;
+	float regionMinSize;
+	float regionMergeSize;
+	float edgeMaxLen;
+	float edgeMaxError;
+	float vertsPerPoly;
+	float detailSampleDist;
+	float detailSampleMaxError;
+};
+
+static void resetBuildSettings(BuildSettings& settings)
+{
+	settings.cellSize = 0.3f;
+	settings.cellHeight = 0.2f;
+	settings.agentHeight = 2.0f;
+	settings.agentRadius = 0.6f;
+	settings.agentMaxClimb = 0.9f;
+	settings.agentMaxSlope = 45.0f;
+	settings.regionMinSize = 8;
+	settings.regionMergeSize = 20;
+	settings.edgeMaxLen = 12.0f;
+	settings.edgeMaxError = 1.3f;
+	settings.vertsPerPoly = 6.0f;
+	settings.detailSampleDist = 6.0f;
+	settings.detailSampleMaxError = 1.0f;
+}
+
+/// Statistics of a built navmesh.
+struct BuildStats
+{
+	int polyCount;
+	int vertCount;
+	int detailTriCount;
+	int dataSize;
+};
+
+/// Builds a solo navmesh, following the steps of Sample_SoloMesh.
+/// Returns the Detour navmesh data, or null if the build failed.
+static unsigned char* buildSoloMesh(BenchmarkContext* ctx, const rcMeshLoaderObj& mesh, const BuildSettings& settings,
+									const bool wideBvTree, int* dataSize, BuildStats* stats)
+{
+	const float* verts = mesh.getVerts();
+	const int nverts = mesh.getVertCount();
+	const int* tris = mesh.getTris();
+	const int ntris = mesh.getTriCount();
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = settings.cellSize;
+	cfg.ch = settings.cellHeight;
+	cfg.walkableSlopeAngle = settings.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(settings.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(settings.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(settings.agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(settings.edgeMaxLen / settings.cellSize);
+	cfg.maxSimplificationError = settings.edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(settings.regionMinSize);
+	cfg.mergeRegionArea = (int)rcSqr(settings.regionMergeSize);
+	cfg.maxVertsPerPoly = (int)settings.vertsPerPoly;
+	cfg.detailSampleDist = settings.detailSampleDist < 0.9f ? 0 : settings.cellSize * settings.detailSampleDist;
+	cfg.detailSampleMaxError = settings.cellHeight * settings.detailSampleMaxError;
+	rcCalcBounds(verts, nverts, cfg.bmin, cfg.bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+
+	unsigned char* navData = 0;
+	unsigned char* triareas = 0;
+	rcHeightfield* solid = 0;
+	rcCompactHeightfield* chf = 0;
+	rcContourSet* cset = 0;
+	rcPolyMesh* pmesh = 0;
+	rcPolyMeshDetail* dmesh = 0;
+	bool ok = false;
+
+	ctx->resetTimers();
+	ctx->startTimer(RC_TIMER_TOTAL);
+
+	do
+	{
+		solid = rcAllocHeightfield();
+		if (!solid || !rcCreateHeightfield(ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+			break;
+
+		triareas = new unsigned char[ntris];
+		memset(triareas, 0, ntris*sizeof(unsigned char));
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, verts, nverts, tris, ntris, triareas);
+		if (!rcRasterizeTriangles(ctx, verts, nverts, tris, triareas, ntris, *solid, cfg.walkableClimb))
+			break;
+
+		rcFilterHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
+
+		chf = rcAllocCompactHeightfield();
+		if (!chf || !rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf))
+			break;
+		if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *chf))
+			break;
+		if (!rcBuildDistanceField(ctx, *chf))
+			break;
+		if (!rcBuildRegions(ctx, *chf, 0, cfg.minRegionArea, cfg.mergeRegionArea))
+			break;
+
+		cset = rcAllocContourSet();
+		if (!cset || !rcBuildContours(ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset))
+			break;
+
+		pmesh = rcAllocPolyMesh();
+		if (!pmesh || !rcBuildPolyMesh(ctx, *cset, cfg.maxVertsPerPoly, *pmesh))
+			break;
+
+		dmesh = rcAllocPolyMeshDetail();
+		if (!dmesh || !rcBuildPolyMeshDetail(ctx, *pmesh, *chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh))
+			break;
+
+		ok = true;
+	}
+	while (false);
+
+	ctx->stopTimer(RC_TIMER_TOTAL);
+
+	if (ok)
+	{
+		// All walkable polygons pass the default query filter.
+		for (int i = 0; i < pmesh->npolys; ++i)
+		{
+			if (pmesh->areas[i] == RC_WALKABLE_AREA)
+				pmesh->flags[i] = 1;
+		}
+
+		dtNavMeshCreateParams params;
+		memset(&params, 0, sizeof(params));
+		params.verts = pmesh->verts;
+		params.vertCount = pmesh->nverts;
+		params.polys = pmesh->polys;
+		params.polyAreas = pmesh->areas;
+		params.polyFlags = pmesh->flags;
+		params.polyCount = pmesh->npolys;
+		params.nvp = pmesh->nvp;
+		params.detailMeshes = dmesh->meshes;
+		params.detailVerts = dmesh->verts;
+		params.detailVertsCount = dmesh->nverts;
+		params.detailTris = dmesh->tris;
+		params.detailTriCount = dmesh->ntris;
+		params.walkableHeight = settings.agentHeight;
+		params.walkableRadius = settings.agentRadius;
+		params.walkableClimb = settings.agentMaxClimb;
+		rcVcopy(params.bmin, pmesh->bmin);
+		rcVcopy(params.bmax, pmesh->bmax);
+		params.cs = cfg.cs;
+		params.ch = cfg.ch;
+		params.buildBvTree = true;
+		params.buildWideBvTree = wideBvTree;
+
+		if (dtCreateNavMeshData(&params, &navData, dataSize))
+		{
+			stats->polyCount = pmesh->npolys;
+			stats->vertCount = pmesh->nverts;
+			stats->detailTriCount = dmesh->ntris;
+			stats->dataSize = *dataSize;
+		}
+		else
+		{
+			ctx->log(RC_LOG_ERROR, "Could not build Detour navmesh.");
+		}
+	}
+
+	delete [] triareas;
+	rcFreeHeightField(solid);
+	rcFreeCompactHeightfield(chf);
+	rcFreeContourSet(cset);
+	rcFreePolyMesh(pmesh);
+	rcFreePolyMeshDetail(dmesh);
+
+	return navData;
+}
+
+/// Result of a query benchmark, the time is the best of all iterations.
+struct QueryResult
+{
+	int usec;
+	int result;		///< A sum over the query results, which only changes if the queries change behavior.
+};
+
+/// Random locations on the navmesh, used as query inputs.
+struct QueryPoints
+{
+	dtPolyRef startRefs[QUERY_COUNT];
+	dtPolyRef endRefs[QUERY_COUNT];
+	float startPos[QUERY_COUNT*3];
+	float endPos[QUERY_COUNT*3];
+};
+
+static bool initQueryPoints(dtNavMeshQuery* navquery, const dtQueryFilter* filter, QueryPoints* points)
+{
+	seedRand(1);
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		if (dtStatusFailed(navquery->findRandomPoint(filter, frand, &points->startRefs[i], &points->startPos[i*3])))
+			return false;
+		if (dtStatusFailed(navquery->findRandomPoint(filter, frand, &points->endRefs[i], &points->endPos[i*3])))
+			return false;
+	}
+	return true;
+}
+
+static void benchmarkFindNearestPoly(dtNavMeshQuery* navquery, const dtQueryFilter* filter, const QueryPoints* points,
+									 const int iterations, QueryResult* res)
+{
+	const float halfExtents[3] = { 2, 4, 2 };
+	res->usec = INT_MAX;
+	res->result = 0;
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		int found = 0;
+		const TimeVal startTime = getPerfTime();
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			// Search slightly above the surface, like when snapping an agent to the navmesh.
+			float pos[3];
+			dtVcopy(pos, &points->startPos[i*3]);
+			pos[1] += 1.0f;
+			dtPolyRef ref = 0;
+			float nearest[3];
+			navquery->findNearestPoly(pos, halfExtents, filter, &ref, nearest);
+			if (ref)
+				found++;
+		}
+		const int usec = getPerfTimeUsec(getPerfTime() - startTime);
+		res->usec = dtMin(res->usec, usec);
+		res->result = found;
+	}
+}
+
+/// Times findNearestPolys with the same points as benchmarkFindNearestPoly, as a single batch.
+static bool benchmarkFindNearestPolys(dtNavMeshQuery* navquery, const dtQueryFilter* filter, const QueryPoints* points,
+									  const int iterations, QueryResult* res)
+{
+	res->usec = INT_MAX;
+	res->result = 0;
+	dtNearestPolyRequest* requests = (dtNearestPolyRequest*)dtAlloc(sizeof(dtNearestPolyRequest)*QUERY_COUNT, DT_ALLOC_TEMP);
+	if (!requests)
+		return false;
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		dtVcopy(requests[i].center, &points->startPos[i*3]);
+		requests[i].center[1] += 1.0f;
+	}
+
+	const float halfExtents[3] = { 2, 4, 2 };
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		const TimeVal startTime = getPerfTime();
+		navquery->findNearestPolys(requests, QUERY_COUNT, halfExtents, filter);
+		const int usec = getPerfTimeUsec(getPerfTime() - startTime);
+		res->usec = dtMin(res->usec, usec);
+
+		int found = 0;
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			if (requests[i].nearestRef)
+				found++;
+		}
+		res->result = found;
+	}
+
+	dtFree(requests);
+	return true;
+}
+
+/// Times findNearestPoly on the navmesh built again with a four-wide bounding volume tree.
+static bool benchmarkWideBvTree(BenchmarkContext* ctx, const rcMeshLoaderObj& mesh, const BuildSettings& settings,
+								const QueryPoints* points, const int iterations, QueryResult* res)
+{
+	BuildStats stats;
+	int navDataSize = 0;
+	unsigned char* navData = buildSoloMesh(ctx, mesh, settings, true, &navDataSize, &stats);
+	if (!navData)
+		return false;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(navData, navDataSize, DT_TILE_FREE_DATA)))
+	{
+		dtFree(navData);
+		dtFreeNavMesh(nav);
+		return false;
+	}
+
+	dtNavMeshQuery* navquery = dtAllocNavMeshQuery();
+	dtQueryFilter filter;
+	const bool ok = navquery && dtStatusSucceed(navquery->init(nav, MAX_NODES));
+	if (ok)
+		benchmarkFindNearestPoly(navquery, &filter, points, iterations, res);
+
+	dtFreeNavMeshQuery(navquery);
+	dtFreeNavMesh(nav);
+	return ok;
+}
+
+/// The logic of the default filter in a class of its own, which the templated queries call without dynamic dispatch.
+struct InlineAreaFilter
+{
+	float areaCost[DT_MAX_AREAS];
+	unsigned short includeFlags;
+	unsigned short excludeFlags;
+
+	explicit InlineAreaFilter(const dtQueryFilter& filter)
+	{
+		for (int i = 0; i < DT_MAX_AREAS; ++i)
+			areaCost[i] = filter.getAreaCost(i);
+		includeFlags = filter.getIncludeFlags();
+		excludeFlags = filter.getExcludeFlags();
+	}
+
+	bool passFilter(const dtPolyRef /*ref*/, const dtMeshTile* /*tile*/, const dtPoly* poly) const
+	{
+		return (poly->flags & includeFlags) != 0 && (poly->flags & excludeFlags) == 0;
+	}
+
+	float getCost(const float* pa, const float* pb,
+				  const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
+				  const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+				  const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
+	{
+		return dtVdist(pa, pb) * areaCost[curPoly->getArea()];
+	}
+};
+
+template <class TFilter>
+static void benchmarkFindPath(dtNavMeshQuery* navquery, const TFilter* filter, const QueryPoints* points,
+							  const unsigned int options, const int iterations, QueryResult* res)
+{
+	dtPolyRef path[MAX_PATH];
+	res->usec = INT_MAX;
+	res->result = 0;
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		int pathPolys = 0;
+		const TimeVal startTime = getPerfTime();
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			int pathCount = 0;
+			navquery->findPath(points->startRefs[i], points->endRefs[i], &points->startPos[i*3], &points->endPos[i*3],
+							   filter, path, &pathCount, MAX_PATH, options);
+			pathPolys += pathCount;
+		}
+		const int usec = getPerfTimeUsec(getPerfTime() - startTime);
+		res->usec = dtMin(res->usec, usec);
+		res->result = pathPolys;
+	}
+}
+
+static void benchmarkRaycast(dtNavMeshQuery* navquery, const dtQueryFilter* filter, const QueryPoints* points,
+							 const int iterations, QueryResult* res)
+{
+	dtPolyRef path[MAX_PATH];
+	res->usec = INT_MAX;
+	res->result = 0;
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		int hits = 0;
+		const TimeVal startTime = getPerfTime();
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			float t = 0;
+			float hitNormal[3];
+			int pathCount = 0;
+			navquery->raycast(points->startRefs[i], &points->startPos[i*3], &points->endPos[i*3], filter,
+							  &t, hitNormal, path, &pathCount, MAX_PATH);
+			if (t < FLT_MAX)
+				hits++;
+		}
+		const int usec = getPerfTimeUsec(getPerfTime() - startTime);
+		res->usec = dtMin(res->usec, usec);
+		res->result = hits;
+	}
+}
+
+/// Times raycasts with the same rays as benchmarkRaycast, as a single batch.
+static bool benchmarkRaycasts(dtNavMeshQuery* navquery, const dtQueryFilter* filter, const QueryPoints* points,
+							  const int iterations, QueryResult* res)
+{
+	res->usec = INT_MAX;
+	res->result = 0;
+	dtRaycastRequest* requests = (dtRaycastRequest*)dtAlloc(sizeof(dtRaycastRequest)*QUERY_COUNT, DT_ALLOC_TEMP);
+	dtPolyRef* paths = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*QUERY_COUNT*MAX_PATH, DT_ALLOC_TEMP);
+	if (!requests || !paths)
+	{
+		dtFree(requests);
+		dtFree(paths);
+		return false;
+	}
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		memset(&requests[i], 0, sizeof(dtRaycastRequest));
+		requests[i].startRef = points->startRefs[i];
+		dtVcopy(requests[i].startPos, &points->startPos[i*3]);
+		dtVcopy(requests[i].endPos, &points->endPos[i*3]);
+		requests[i].hit.path = &paths[i*MAX_PATH];
+		requests[i].hit.maxPath = MAX_PATH;
+	}
+
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		const TimeVal startTime = getPerfTime();
+		navquery->raycasts(requests, QUERY_COUNT, filter, 0);
+		const int usec = getPerfTimeUsec(getPerfTime() - startTime);
+		res->usec = dtMin(res->usec, usec);
+
+		int hits = 0;
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			if (requests[i].hit.t < FLT_MAX)
+				hits++;
+		}
+		res->result = hits;
+	}
+
+	dtFree(requests);
+	dtFree(paths);
+	return true;
+}
+
+/// Result of a crowd benchmark.
+struct CrowdResult
+{
+	int agentCount;
+	int avgUsec;
+	int maxUsec;
+};
+
+static bool benchmarkCrowd(dtNavMesh* nav, dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+						   const BuildSettings& settings, const int maxAgents, CrowdResult* res)
+{
+	dtCrowd* crowd = dtAllocCrowd();
+	if (!crowd || !crowd->init(maxAgents, settings.agentRadius, nav))
+	{
+		dtFreeCrowd(crowd);
+		return false;
+	}
+
+	dtCrowdAgentParams ap;
+	memset(&ap, 0, sizeof(ap));
+	ap.radius = settings.agentRadius;
+	ap.height = settings.agentHeight;
+	ap.maxAcceleration = 8.0f;
+	ap.maxSpeed = 3.5f;
+	ap.collisionQueryRange = ap.radius * 12.0f;
+	ap.pathOptimizationRange = ap.radius * 30.0f;
+	ap.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO |
+		DT_CROWD_OBSTACLE_AVOIDANCE | DT_CROWD_SEPARATION;
+	ap.obstacleAvoidanceType = 3;
+	ap.separationWeight = 2.0f;
+
+	seedRand(2);
+	res->agentCount = 0;
+	for (int i = 0; i < maxAgents; ++i)
+	{
+		dtPolyRef ref = 0;
+		float pos[3];
+		if (dtStatusFailed(navquery->findRandomPoint(filter, frand, &ref, pos)))
+			break;
+		const int idx = crowd->addAgent(pos, &ap);
+		if (idx == -1)
+			continue;
+		res->agentCount++;
+		if (dtStatusSucceed(navquery->findRandomPoint(filter, frand, &ref, pos)))
+			crowd->requestMoveTarget(idx, ref, pos);
+	}
+
+	res->maxUsec = 0;
+	TimeVal totalTime = 0;
+	for (int i = 0; i < CROWD_UPDATES; ++i)
+	{
+		const TimeVal startTime = getPerfTime();
+		crowd->update(CROWD_DT, 0);
+		const TimeVal deltaTime = getPerfTime() - startTime;
+		totalTime += deltaTime;
+		res->maxUsec = dtMax(res->maxUsec, getPerfTimeUsec(deltaTime));
+	}
+	res->avgUsec = getPerfTimeUsec(totalTime) / CROWD_UPDATES;
+
+	dtFreeCrowd(crowd);
+	return true;
+}
+
+static int getPerSecond(const int count, const int usec)
+{
+	return (int)((double)count * 1000000.0 / (double)dtMax(usec, 1));
+}
+
+static void writeQueryResult(FILE* fp, const char* name, const char* resultName, const QueryResult& res, const bool last)
+{
+	fprintf(fp, "        \"%s\": { \"queries\": %d, \"usec\": %d, \"per_second\": %d, \"%s\": %d }%s\n",
+			name, QUERY_COUNT, res.usec, getPerSecond(QUERY_COUNT, res.usec), resultName, res.result, last ? "" : ",");
+}
+
+/// Runs all benchmarks on a single mesh and writes the results as a JSON object.
+/// Nothing is written if the benchmarks fail.
+static bool benchmarkMesh(FILE* fp, const char* meshDir, const char* meshName, const int iterations, const bool first)
+{
+	rcMeshLoaderObj mesh;
+	const std::string path = std::string(meshDir) + "/" + meshName;
+	if (!mesh.load(path))
+	{
+		fprintf(stderr, "Could not load mesh '%s'.\n", path.c_str());
+		return false;
+	}
+
+	BuildSettings settings;
+	resetBuildSettings(settings);
+
+	// Build times are the best of all iterations.
+	// Temporary build memory comes from an arena, so its peak size can be reported.
+	BenchmarkContext ctx;
+	rcTempArena tempArena;
+	ctx.setTempArena(&tempArena);
+	int buildTimes[RC_MAX_TIMERS];
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		buildTimes[i] = -1;
+
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	BuildStats stats;
+	memset(&stats, 0, sizeof(stats));
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		dtFree(navData);
+		navData = buildSoloMesh(&ctx, mesh, settings, false, &navDataSize, &stats);
+		if (!navData)
+		{
+			fprintf(stderr, "Could not build navmesh for '%s'.\n", meshName);
+			return false;
+		}
+		for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		{
+			const rcTimerLabel label = (rcTimerLabel)i;
+			if (!ctx.isTimerUsed(label))
+				continue;
+			const int usec = ctx.getAccumulatedTime(label);
+			buildTimes[i] = buildTimes[i] == -1 ? usec : rcMin(buildTimes[i], usec);
+		}
+	}
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(navData, navDataSize, DT_TILE_FREE_DATA)))
+	{
+		fprintf(stderr, "Could not init Detour navmesh for '%s'.\n", meshName);
+		dtFree(navData);
+		dtFreeNavMesh(nav);
+		return false;
+	}
+
+	dtNavMeshQuery* navquery = dtAllocNavMeshQuery();
+	QueryPoints* points = (QueryPoints*)dtAlloc(sizeof(QueryPoints), DT_ALLOC_TEMP);
+	dtQueryFilter filter;
+	if (!navquery || !points || dtStatusFailed(navquery->init(nav, MAX_NODES)) ||
+		!initQueryPoints(navquery, &filter, points))
+	{
+		fprintf(stderr, "Could not init queries for '%s'.\n", meshName);
+		dtFree(points);
+		dtFreeNavMeshQuery(navquery);
+		dtFreeNavMesh(nav);
+		return false;
+	}
+
+	QueryResult nearestResult, pathResult, raycastResult;
+	benchmarkFindNearestPoly(navquery, &filter, points, iterations, &nearestResult);
+	QueryResult nearestBatchResult;
+	const bool nearestBatch = benchmarkFindNearestPolys(navquery, &filter, points, iterations, &nearestBatchResult);
+	benchmarkFindPath(navquery, &filter, points, 0, iterations, &pathResult);
+	QueryResult pathInlineResult;
+	const InlineAreaFilter inlineFilter(filter);
+	benchmarkFindPath(navquery, &inlineFilter, points, 0, iterations, &pathInlineResult);
+	QueryResult pathBidirResult;
+	benchmarkFindPath(navquery, &filter, points, DT_FINDPATH_BIDIRECTIONAL, iterations, &pathBidirResult);
+	// Area costs above one make the distance heuristic a weak estimate, which is where searching from both ends pays off.
+	dtQueryFilter costlyFilter;
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+		costlyFilter.setAreaCost(i, 4.0f);
+	QueryResult pathCostlyResult;
+	benchmarkFindPath(navquery, &costlyFilter, points, 0, iterations, &pathCostlyResult);
+	QueryResult pathCostlyBidirResult;
+	benchmarkFindPath(navquery, &costlyFilter, points, DT_FINDPATH_BIDIRECTIONAL, iterations, &pathCostlyBidirResult);
+	benchmarkRaycast(navquery, &filter, points, iterations, &raycastResult);
+	QueryResult raycastBatchResult;
+	const bool raycastBatch = benchmarkRaycasts(navquery, &filter, points, iterations, &raycastBatchResult);
+
+	QueryResult nearestWideResult;
+	const bool wideBvTree = benchmarkWideBvTree(&ctx, mesh, settings, points, iterations, &nearestWideResult);
+
+	CrowdResult crowdResults[CROWD_SIZE_COUNT];
+	int crowdResultCount = 0;
+	for (int i = 0; i < CROWD_SIZE_COUNT; ++i)
+	{
+		if (benchmarkCrowd(nav, navquery, &filter, settings, CROWD_SIZES[i], &crowdResults[crowdResultCount]))
+			crowdResultCount++;
+	}
+
+	fprintf(fp, "%s    {\n", first ? "" : ",\n");
+	fprintf(fp, "      \"name\": \"%s\",\n", meshName);
+	fprintf(fp, "      \"verts\": %d,\n", mesh.getVertCount());
+	fprintf(fp, "      \"tris\": %d,\n", mesh.getTriCount());
+
+	// Build stages in microseconds, only the stages used by the build are listed.
+	fprintf(fp, "      \"build\": {\n");
+	bool firstTimer = true;
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		if (buildTimes[i] == -1)
+			continue;
+		fprintf(fp, "%s        \"%s\": %d", firstTimer ? "" : ",\n", getTimerName((rcTimerLabel)i), buildTimes[i]);
+		firstTimer = false;
+	}
+	fprintf(fp, "\n      },\n");
+
+	fprintf(fp, "      \"temp_peak_bytes\": %d,\n", (int)tempArena.getPeakSize());
+
+	fprintf(fp, "      \"navmesh\": { \"polys\": %d, \"verts\": %d, \"detail_tris\": %d, \"data_size\": %d },\n",
+			stats.polyCount, stats.vertCount, stats.detailTriCount, stats.dataSize);
+
+	fprintf(fp, "      \"queries\": {\n");
+	writeQueryResult(fp, "find_nearest_poly", "found", nearestResult, false);
+	if (nearestBatch)
+		writeQueryResult(fp, "find_nearest_polys", "found", nearestBatchResult, false);
+	if (wideBvTree)
+		writeQueryResult(fp, "find_nearest_poly_wide_bvtree", "found", nearestWideResult, false);
+	writeQueryResult(fp, "find_path", "path_polys", pathResult, false);
+	writeQueryResult(fp, "find_path_inline_filter", "path_polys", pathInlineResult, false);
+	writeQueryResult(fp, "find_path_bidirectional", "path_polys", pathBidirResult, false);
+	writeQueryResult(fp, "find_path_area_cost", "path_polys", pathCostlyResult, false);
+	writeQueryResult(fp, "find_path_area_cost_bidirectional", "path_polys", pathCostlyBidirResult, false);
+	writeQueryResult(fp, "raycast", "hits", raycastResult, !raycastBatch);
+	if (raycastBatch)
+		writeQueryResult(fp, "raycasts", "hits", raycastBatchResult, true);
+	fprintf(fp, "      },\n");
+
+	fprintf(fp, "      \"crowd\": [\n");
+	for (int i = 0; i < crowdResultCount; ++i)
+	{
+		fprintf(fp, "        { \"agents\": %d, \"updates\": %d, \"avg_usec\": %d, \"max_usec\": %d }%s\n",
+				crowdResults[i].agentCount, CROWD_UPDATES, crowdResults[i].avgUsec, crowdResults[i].maxUsec,
+				i+1 < crowdResultCount ? "," : "");
+	}
+	fprintf(fp, "      ]\n");
+	fprintf(fp, "    }");
+
+	dtFree(points);
+	dtFreeNavMeshQuery(navquery);
+	dtFreeNavMesh(nav);
+	return true;
+}
+
+static void printUsage(const char* exe)
+{
+	fprintf(stderr, "Usage: %s [-m <mesh dir>] [-o <output file>] [-i <iterations>] [mesh.obj ...]\n", exe);
+}
+
+int main(int argc, char** argv)
+{
+	const char* meshDir = "Meshes";
+	const char* outputPath = 0;
+	int iterations = 3;
+	const char** meshes = DEFAULT_MESHES;
+	int meshCount = DEFAULT_MESH_COUNT;
+
+	int argi = 1;
+	for (; argi < argc && argv[argi][0] == '-'; ++argi)
+	{
+		const char* arg = argv[argi];
+		if (argi+1 >= argc)
+		{
+			printUsage(argv[0]);
+			return 1;
+		}
+		if (strcmp(arg, "-m") == 0)
+			meshDir = argv[++argi];
+		else if (strcmp(arg, "-o") == 0)
+			outputPath = argv[++argi];
+		else if (strcmp(arg, "-i") == 0)
+			iterations = atoi(argv[++argi]);
+		else
+		{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (argi < argc)
+	{
+		meshes = (const char**)&argv[argi];
+		meshCount = argc - argi;
+	}
+
+	FILE* fp = stdout;
+	if (outputPath)
+	{
+		fp = fopen(outputPath, "w");
+		if (!fp)
+		{
+			fprintf(stderr, "Could not open '%s' for writing.\n", outputPath);
+			return 1;
+		}
+	}
+
+	bool ok = true;
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"iterations\": %d,\n", iterations);
+	fprintf(fp, "  \"meshes\": [\n");
+	int written = 0;
+	for (int i = 0; i < meshCount; ++i)
+	{
+		if (benchmarkMesh(fp, meshDir, meshes[i], iterations, written == 0))
+			written++;
+		else
+			ok = false;
+	}
+	fprintf(fp, "\n  ]\n");
+	fprintf(fp, "}\n");
+
+	if (fp != stdout)
+		fclose(fp);
+
+	return ok ? 0 : 1;
+}
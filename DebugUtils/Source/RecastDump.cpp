@@ -207,15 +207,30 @@ bool duReadContourSet(struct rcContourSet& cset, duFileIO* io)
 		return false;
 	}
 	
-	io->read(&cset.nconts, sizeof(cset.nconts));
+	// Free the contours of a previous build, including the ones kept for reuse past nconts.
+	const int oldCount = rcMax(cset.nconts, cset.maxconts);
+	for (int i = 0; i < oldCount; ++i)
+	{
+		rcFree(cset.conts[i].verts);
+		rcFree(cset.conts[i].rverts);
+	}
+	rcFree(cset.conts);
+	cset.conts = 0;
+	cset.nconts = 0;
+	cset.maxconts = 0;
+	
+	int nconts = 0;
+	io->read(&nconts, sizeof(nconts));
 
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*cset.nconts, RC_ALLOC_PERM);
+	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*nconts, RC_ALLOC_PERM);
 	if (!cset.conts)
 	{
-		printf("duReadContourSet: Could not alloc contours (%d)\n", cset.nconts);
+		printf("duReadContourSet: Could not alloc contours (%d)\n", nconts);
 		return false;
 	}
-	memset(cset.conts, 0, sizeof(rcContour)*cset.nconts);
+	memset(cset.conts, 0, sizeof(rcContour)*nconts);
+	cset.nconts = nconts;
+	cset.maxconts = nconts;
 	
 	io->read(cset.bmin, sizeof(cset.bmin));
 	io->read(cset.bmax, sizeof(cset.bmax));
@@ -241,12 +256,14 @@ bool duReadContourSet(struct rcContourSet& cset, duFileIO* io)
 			printf("duReadContourSet: Could not alloc contour verts (%d)\n", cont.nverts);
 			return false;
 		}
+		cont.maxverts = cont.nverts;
 		cont.rverts = (int*)rcAlloc(sizeof(int)*4*cont.nrverts, RC_ALLOC_PERM);
 		if (!cont.rverts)
 		{
 			printf("duReadContourSet: Could not alloc contour rverts (%d)\n", cont.nrverts);
 			return false;
 		}
+		cont.maxrverts = cont.nrverts;
 		
 		io->read(cont.verts, sizeof(int)*4*cont.nverts);
 		io->read(cont.rverts, sizeof(int)*4*cont.nrverts);
@@ -359,6 +376,18 @@ bool duReadCompactHeightfield(struct rcCompactHeightfield& chf, duFileIO* io)
 	io->read(&chf.cs, sizeof(chf.cs));
 	io->read(&chf.ch, sizeof(chf.ch));
 	
+	// Free the arrays of a previous build, the capacity is set to the sizes read below.
+	rcFree(chf.cells);
+	rcFree(chf.spans);
+	rcFree(chf.dist);
+	rcFree(chf.areas);
+	chf.cells = 0;
+	chf.spans = 0;
+	chf.dist = 0;
+	chf.areas = 0;
+	chf.maxCells = 0;
+	chf.maxSpans = 0;
+	
 	int tmp = 0;
 	io->read(&tmp, sizeof(tmp));
 	
@@ -403,6 +432,10 @@ bool duReadCompactHeightfield(struct rcCompactHeightfield& chf, duFileIO* io)
 		io->read(chf.areas, sizeof(unsigned char)*chf.spanCount);
 	}
 	
+	// A later build reuses the arrays only when all of those it writes have been read.
+	chf.maxCells = chf.cells ? chf.width*chf.height : 0;
+	chf.maxSpans = chf.spans && chf.areas ? chf.spanCount : 0;
+	
 	return true;
 }
 
@@ -423,6 +456,7 @@ void duLogBuildTimes(rcContext& ctx, const int totalTimeUsec)
 	logLine(ctx, RC_TIMER_BUILD_COMPACTHEIGHTFIELD,	"- Build Compact", pc);
 	logLine(ctx, RC_TIMER_FILTER_BORDER,				"- Filter Border", pc);
 	logLine(ctx, RC_TIMER_FILTER_WALKABLE,			"- Filter Walkable", pc);
+	logLine(ctx, RC_TIMER_FILTER_HEIGHTFIELD,		"- Filter Heightfield", pc);
 	logLine(ctx, RC_TIMER_ERODE_AREA,				"- Erode Area", pc);
 	logLine(ctx, RC_TIMER_MEDIAN_AREA,				"- Median Area", pc);
 	logLine(ctx, RC_TIMER_MARK_BOX_AREA,				"- Mark Box Area", pc);
@@ -361,6 +361,16 @@ inline bool dtOverlapQuantBounds(const unsigned short amin[3], const unsigned sh
 	return overlap;
 }
 
+/// Determines which of four axis-aligned bounding boxes overlap another box.
+///  @param[in]		amin	Minimum bounds of box A. [(x, y, z)]
+///  @param[in]		amax	Maximum bounds of box A. [(x, y, z)]
+///  @param[in]		bmin	Minimum bounds of the four boxes, stored per axis. [(x, y, z) * 4]
+///  @param[in]		bmax	Maximum bounds of the four boxes, stored per axis. [(x, y, z) * 4]
+/// @return A mask with bit @p i set if box @p i overlaps box A.
+/// @see dtOverlapQuantBounds
+unsigned int dtOverlapQuantBounds4(const unsigned short amin[3], const unsigned short amax[3],
+								   const unsigned short bmin[3][4], const unsigned short bmax[3][4]);
+
 /// Determines if two axis-aligned bounding boxes overlap.
 ///  @param[in]		amin	Minimum bounds of box A. [(x, y, z)]
 ///  @param[in]		amax	Maximum bounds of box A. [(x, y, z)]
@@ -395,11 +405,43 @@ void dtClosestPtPointTriangle(float* closest, const float* p,
 ///  @param[out]	h		The resulting height.
 bool dtClosestHeightPointTriangle(const float* p, const float* a, const float* b, const float* c, float& h);
 
+/// Derives the y-axis heights of four points on a triangle.
+///  @param[in]		px		The x-coordinates of the points.
+///  @param[in]		pz		The z-coordinates of the points.
+///  @param[in]		a		Vertex A of triangle ABC. [(x, y, z)]
+///  @param[in]		b		Vertex B of triangle ABC. [(x, y, z)]
+///  @param[in]		c		Vertex C of triangle ABC. [(x, y, z)]
+///  @param[out]	h		The resulting heights, only set for the points inside the triangle.
+/// @return A mask with bit @p i set if point @p i lies inside the triangle on the xz-plane.
+/// @see dtClosestHeightPointTriangle
+unsigned int dtClosestHeightPointTriangle4(const float px[4], const float pz[4],
+										   const float* a, const float* b, const float* c, float h[4]);
+
 bool dtIntersectSegmentPoly2D(const float* p0, const float* p1,
 							  const float* verts, int nverts,
 							  float& tmin, float& tmax,
 							  int& segMin, int& segMax);
 
+/// Intersects four segments with a convex polygon on the xz-plane.
+///  @param[in]		p0x		The x-coordinates of the segment start points.
+///  @param[in]		p0z		The z-coordinates of the segment start points.
+///  @param[in]		p1x		The x-coordinates of the segment end points.
+///  @param[in]		p1z		The z-coordinates of the segment end points.
+///  @param[in]		verts	The polygon vertices. [(x, y, z) * @p nverts]
+///  @param[in]		nverts	The number of vertices.
+///  @param[out]	tmin	The parameters where the segments enter the polygon.
+///  @param[out]	tmax	The parameters where the segments leave the polygon.
+///  @param[out]	segMin	The edges where the segments enter the polygon, or -1.
+///  @param[out]	segMax	The edges where the segments leave the polygon, or -1.
+/// @return A mask with bit @p i set if segment @p i intersects the polygon, the results
+/// of the other segments are undefined.
+/// @see dtIntersectSegmentPoly2D
+unsigned int dtIntersectSegmentPoly2D4(const float p0x[4], const float p0z[4],
+									   const float p1x[4], const float p1z[4],
+									   const float* verts, int nverts,
+									   float tmin[4], float tmax[4],
+									   int segMin[4], int segMax[4]);
+
 bool dtIntersectSegSeg2D(const float* ap, const float* aq,
 						 const float* bp, const float* bq,
 						 float& s, float& t);
@@ -411,11 +453,31 @@ bool dtIntersectSegSeg2D(const float* ap, const float* aq,
 /// @return True if the point is inside the polygon.
 bool dtPointInPolygon(const float* pt, const float* verts, const int nverts);
 
+/// Determines which of four points are inside the convex polygon on the xz-plane.
+///  @param[in]		px		The x-coordinates of the points.
+///  @param[in]		pz		The z-coordinates of the points.
+///  @param[in]		verts	The polygon vertices. [(x, y, z) * @p nverts]
+///  @param[in]		nverts	The number of vertices. [Limit: >= 3]
+/// @return A mask with bit @p i set if point @p i is inside the polygon.
+/// @see dtPointInPolygon
+unsigned int dtPointInPolygon4(const float px[4], const float pz[4], const float* verts, const int nverts);
+
 bool dtDistancePtPolyEdgesSqr(const float* pt, const float* verts, const int nverts,
 							float* ed, float* et);
 
 float dtDistancePtSegSqr2D(const float* pt, const float* p, const float* q, float& t);
 
+/// Derives the squared distances of four points to a segment on the xz-plane.
+///  @param[in]		px		The x-coordinates of the points.
+///  @param[in]		pz		The z-coordinates of the points.
+///  @param[in]		p		The start of the segment. [(x, y, z)]
+///  @param[in]		q		The end of the segment. [(x, y, z)]
+///  @param[out]	dist	The squared distances of the points to the segment.
+///  @param[out]	t		The parameters of the closest points along the segment.
+/// @see dtDistancePtSegSqr2D
+void dtDistancePtSegSqr2D4(const float px[4], const float pz[4], const float* p, const float* q,
+						   float dist[4], float t[4]);
+
 /// Derives the centroid of a convex polygon.
 ///  @param[out]	tc		The centroid of the polgyon. [(x, y, z)]
 ///  @param[in]		idx		The polygon indices. [(vertIndex) * @p nidx]
@@ -70,7 +70,7 @@ static const int DT_VERTS_PER_POLYGON = 6;
 static const int DT_NAVMESH_MAGIC = 'D'<<24 | 'N'<<16 | 'A'<<8 | 'V';
 
 /// A version number used to detect compatibility of navigation tile data.
-static const int DT_NAVMESH_VERSION = 7;
+static const int DT_NAVMESH_VERSION = 8;
 
 /// A magic number used to detect the compatibility of navigation tile states.
 static const int DT_NAVMESH_STATE_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'S';
@@ -102,6 +102,14 @@ enum dtTileFlags
 	DT_TILE_FREE_DATA = 0x01
 };
 
+/// Flags describing the layout of navigation tile data.
+/// @see dtMeshHeader::flags
+enum dtMeshHeaderFlags
+{
+	/// The bounding volume tree is stored as four-wide nodes. (See: #dtBVWideNode)
+	DT_MESH_HEADER_WIDE_BVTREE = 0x01
+};
+
 /// Vertex flags returned by dtNavMeshQuery::findStraightPath.
 enum dtStraightPathFlags
 {
@@ -118,10 +126,11 @@ enum dtStraightPathOptions
 };
 
 
-/// Options for dtNavMeshQuery::initSlicedFindPath and updateSlicedFindPath
+/// Options for dtNavMeshQuery::findPath, initSlicedFindPath and updateSlicedFindPath
 enum dtFindPathOptions
 {
-	DT_FINDPATH_ANY_ANGLE	= 0x02		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_ANY_ANGLE	= 0x02,		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_BIDIRECTIONAL = 0x04		///< search from both the start and the end polygon, see dtNavMeshQuery::findPath
 };
 
 /// Options for dtNavMeshQuery::raycast
@@ -219,6 +228,24 @@ struct dtBVNode
 	int i;							///< The node's index. (Negative for escape sequence.)
 };
 
+/// Four-wide bounding volume node.
+/// The bounds of the children are stored per axis, so that all four children can be tested at once.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtBVWideNode
+{
+	unsigned short bmin[3][4];		///< Minimum bounds of the children's AABBs. [(x, y, z) * 4]
+	unsigned short bmax[3][4];		///< Maximum bounds of the children's AABBs. [(x, y, z) * 4]
+
+	/// The index of each child node, or the negated polygon index minus one for leaves.
+	/// Unused children have empty bounds and index zero, which is the root and never a child.
+	int child[4];
+};
+
+/// The maximum number of entries on the stack when traversing a four-wide bounding volume tree.
+/// The trees are at most 31 levels deep, and every level adds at most three entries.
+static const int DT_BVWIDE_STACK_SIZE = 96;
+
 /// Defines an navigation mesh off-mesh connection within a dtMeshTile object.
 /// An off-mesh connection is a user defined traversable connection made up to two vertices.
 struct dtOffMeshConnection
@@ -274,6 +301,8 @@ struct dtMeshHeader
 	
 	/// The bounding volume quantization factor. 
 	float bvQuantFactor;
+
+	int flags;					///< Tile data layout flags. (See: #dtMeshHeaderFlags)
 };
 
 /// Defines a navigation mesh tile.
@@ -300,6 +329,10 @@ struct dtMeshTile
 	/// (Will be null if bounding volumes are disabled.)
 	dtBVNode* bvTree;
 
+	/// The tile's four-wide bounding volume nodes, used instead of #bvTree if the tile was built with them.
+	/// [Size: dtMeshHeader::bvNodeCount] (Will be null if the tile has no wide bounding volume tree.)
+	dtBVWideNode* bvWideTree;
+
 	dtOffMeshConnection* offMeshCons;		///< The tile off-mesh connections. [Size: dtMeshHeader::offMeshConCount]
 		
 	unsigned char* data;					///< The tile data. (Not directly accessed under normal situations.)
@@ -378,6 +411,31 @@ public:
 
 	/// @}
 
+	/// @{
+	/// @name Concurrent Access
+
+	/// Enables queries on other threads while tiles are added and removed.
+	///  @param[in]	maxReaders	The maximum number of threads reading the navigation mesh concurrently. [Limit: > 0]
+	/// @return The status flags for the operation.
+	dtStatus initConcurrentReads(const int maxReaders);
+
+	/// The maximum number of concurrent readers, or zero if concurrent reads are not enabled.
+	int getMaxReaders() const { return m_maxReaders; }
+
+	/// Marks the start of a read section, for example a batch of queries.
+	///  @param[in]	reader	The index of the calling reader. [Limits: 0 <= value < #getMaxReaders]
+	void beginRead(const int reader);
+
+	/// Marks the end of a read section started with #beginRead.
+	///  @param[in]	reader	The index of the calling reader. [Limits: 0 <= value < #getMaxReaders]
+	void endRead(const int reader);
+
+	/// Releases the removed tiles which are not accessed by any reader anymore.
+	/// @return The number of removed tiles and links which are still waiting for readers to finish.
+	int reclaimRemovedTiles();
+
+	/// @}
+
 	/// @{
 	/// @name Query Functions
 
@@ -641,6 +699,15 @@ private:
 	
 	/// Removes external links at specified side.
 	void unconnectLinks(dtMeshTile* tile, dtMeshTile* target);
+
+	/// Releases the tile data and returns the tile to the freelist.
+	void resetTile(dtMeshTile* tile);
+
+	/// Invalidates the references to the tile.
+	void incrementTileSalt(dtMeshTile* tile);
+
+	/// Adds a tile or a link to the list of items to be released once no reader can access them.
+	bool retire(dtMeshTile* tile, unsigned int link);
 	
 
 	// TODO: These methods are duplicates from dtNavMeshQuery, but are needed for off-mesh connection finding.
@@ -666,6 +733,13 @@ private:
 	dtMeshTile** m_posLookup;			///< Tile hash lookup.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+
+	struct dtNavMeshReader* m_readers;	///< Read sections of the concurrent readers. [Size: #m_maxReaders]
+	int m_maxReaders;					///< Max number of concurrent readers.
+	volatile unsigned int m_epoch;		///< Current reclamation epoch.
+	struct dtRetiredItem* m_retired;	///< Removed tiles and links waiting for readers to finish.
+	int m_retiredCount;					///< Number of items in the retired list.
+	int m_retiredCapacity;				///< Capacity of the retired list.
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
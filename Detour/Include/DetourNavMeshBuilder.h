@@ -101,6 +101,10 @@ struct dtNavMeshCreateParams
 	/// @note The BVTree is not normally needed for layered navigation meshes.
 	bool buildBvTree;
 
+	/// True if the bounding volume tree should be stored as four-wide nodes, which are faster to query.
+	/// (Only used if #buildBvTree is set.)
+	bool buildWideBvTree;
+
 	/// @}
 };
 
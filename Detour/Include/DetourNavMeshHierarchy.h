@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHHIERARCHY_H
+#define DETOURNAVMESHHIERARCHY_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+class dtNodePool;
+class dtNodeQueue;
+
+/// A connected stretch of tile border through which a path can leave a tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtNavMeshHierarchy
+struct dtHierarchyPortal
+{
+	dtPolyRef ref;		///< The polygon inside the tile representing the portal.
+	dtPolyRef neiRef;	///< The polygon in the neighbour tile @p ref is linked to.
+	float pos[3];		///< The middle of the link between @p ref and @p neiRef.
+	float bmin;			///< The start of the border stretch along the tile side.
+	float bmax;			///< The end of the border stretch along the tile side.
+	unsigned char side;	///< The side of the tile the portal is on. (See dtLink::side)
+};
+
+/// A cluster of the abstract graph, covering a single tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtNavMeshHierarchy
+struct dtHierarchyCluster
+{
+	dtTileRef ref;					///< The tile the cluster was built for, or zero if the cluster is empty.
+	int x;							///< The x-position of the tile within the tile grid.
+	int y;							///< The y-position of the tile within the tile grid.
+	dtHierarchyPortal* portals;		///< The portals of the tile. [Size: #portalCount]
+	float* costs;					///< The costs to move between the portals, FLT_MAX if unreachable. [Size: #portalCount * #portalCount]
+	int portalCount;				///< The number of portals.
+};
+
+/// An abstract graph over the tiles of a navigation mesh, used to find long paths.
+///
+/// Each tile is a cluster. The links leaving a tile are grouped into portals,
+/// and the costs of moving between the portals of a tile are precomputed.
+/// A path is first planned over the portals, and then refined by searching
+/// the polygons from portal to portal.
+/// @ingroup detour
+class dtNavMeshHierarchy
+{
+public:
+	dtNavMeshHierarchy();
+	~dtNavMeshHierarchy();
+
+	/// Initializes the hierarchy and builds the clusters of the tiles already in the navigation mesh.
+	///  @param[in]		nav			Pointer to the dtNavMesh object to use for all queries.
+	///  @param[in]		filter		The polygon filter used to calculate the portal costs and to refine the paths.
+	///  @param[in]		maxNodes	Maximum number of portals the abstract search can visit. [Limits: 0 < value <= #DT_MAX_POOL_NODES]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const dtQueryFilter* filter, const int maxNodes);
+
+	/// Builds the cluster of a tile added to the navigation mesh, and updates its neighbours.
+	///  @param[in]		ref		The reference of the tile that was added.
+	/// @returns The status flags for the operation.
+	dtStatus addTile(dtTileRef ref);
+
+	/// Removes the cluster of a tile removed from the navigation mesh, and updates its neighbours.
+	///  @param[in]		ref		The reference the tile had before it was removed.
+	/// @returns The status flags for the operation.
+	dtStatus removeTile(dtTileRef ref);
+
+	/// Finds a path from the start polygon to the end polygon.
+	/// The path is first found over the portals of the tiles, and then refined using @p query.
+	///  @param[in]		query		The query object used to refine the path. Must use the same navigation mesh.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.)
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	dtStatus findPath(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  dtPolyRef* path, int* pathCount, const int maxPath) const;
+
+	/// Gets the cluster of the specified tile.
+	///  @param[in]		ref		The reference of the tile.
+	/// @returns The cluster, or null if the tile has no cluster.
+	const dtHierarchyCluster* getCluster(dtTileRef ref) const;
+
+	/// Gets the navigation mesh the hierarchy is using.
+	/// @return The navigation mesh the hierarchy is using.
+	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshHierarchy(const dtNavMeshHierarchy&);
+	dtNavMeshHierarchy& operator=(const dtNavMeshHierarchy&);
+
+	/// Frees the cluster data and marks the cluster empty.
+	void clearCluster(dtHierarchyCluster* cluster);
+
+	/// Rebuilds the cluster of the specified tile.
+	dtStatus buildCluster(const dtMeshTile* tile);
+
+	/// Rebuilds the clusters of all tiles at the specified grid location.
+	dtStatus buildClustersAt(const int x, const int y);
+
+	/// Calculates the costs from a polygon of the tile to the portals of the cluster.
+	void calcPortalCosts(const dtMeshTile* tile, dtPolyRef startRef, const float* startPos,
+						 const dtHierarchyPortal* portals, const int portalCount, float* costs) const;
+
+	/// Finds the portal on the other side of the specified portal.
+	const dtHierarchyPortal* findOppositePortal(const dtHierarchyPortal* portal, const dtHierarchyCluster** cluster) const;
+
+	/// Finds the portals to pass through, returns the number of portals or -1 if the end cannot be reached.
+	int findPortalPath(dtPolyRef startRef, dtPolyRef endRef, const float* startPos, const float* endPos,
+					   dtStatus* status) const;
+
+	dtPolyRef encodeNodeId(unsigned int tileIndex, unsigned int portalIndex) const;
+	const dtHierarchyPortal* decodeNodeId(dtPolyRef id) const;
+
+	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
+	const dtQueryFilter* m_filter;		///< The filter used for the portal costs.
+
+	dtHierarchyCluster* m_clusters;		///< The clusters, indexed like the tiles of the navmesh.
+	int m_maxClusters;					///< Max number of clusters.
+	int m_portalBits;					///< Number of bits for the portal index in the abstract node ids.
+
+	dtNodePool* m_tileNodePool;			///< Pointer to the node pool for searches within a tile.
+	dtNodeQueue* m_tileOpenList;		///< Pointer to the open list for searches within a tile.
+	dtNodePool* m_nodePool;				///< Pointer to the node pool for the abstract search.
+	dtNodeQueue* m_openList;			///< Pointer to the open list for the abstract search.
+	float* m_startCosts;				///< Costs from the start polygon to the portals of its tile.
+	float* m_endCosts;					///< Costs from the portals of the end tile to the end polygon.
+	int m_maxPortals;					///< Size of the start and end cost arrays, the most portals of a cluster so far.
+	const dtHierarchyPortal** m_portalPath;	///< The portals found by the last abstract search.
+};
+
+/// Allocates a hierarchy object using the Detour allocator.
+/// @return An allocated hierarchy object, or null on failure.
+/// @ingroup detour
+dtNavMeshHierarchy* dtAllocNavMeshHierarchy();
+
+/// Frees the specified hierarchy object using the Detour allocator.
+///  @param[in]		hierarchy		A hierarchy object allocated using #dtAllocNavMeshHierarchy
+/// @ingroup detour
+void dtFreeNavMeshHierarchy(dtNavMeshHierarchy* hierarchy);
+
+#endif // DETOURNAVMESHHIERARCHY_H
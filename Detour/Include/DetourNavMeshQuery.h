@@ -19,7 +19,13 @@
 #ifndef DETOURNAVMESHQUERY_H
 #define DETOURNAVMESHQUERY_H
 
+#include <float.h>
+#include <limits.h>
+#include <string.h>
 #include "DetourNavMesh.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
 #include "DetourStatus.h"
 
 
@@ -29,6 +35,16 @@
 // are declared as inline for maximum speed. 
 
 //#define DT_VIRTUAL_QUERYFILTER 1
+//
+// Without it, a custom filter can still be passed to the templated versions of
+// dtNavMeshQuery::findPath, findPolysAroundCircle and raycast. They take the filter
+// type as a template parameter, so its functions are inlined into the search.
+// The filter type must not derive from dtQueryFilter then, see dtHidesQueryFilter.
+
+/// The scale of the A* search heuristic.
+/// Slightly below one, so that the heuristic never overestimates the remaining cost.
+/// @ingroup detour
+static const float DT_HEURISTIC_SCALE = 0.999f;
 
 /// Defines polygon filtering and traversal costs for navigation mesh query operations.
 /// @ingroup detour
@@ -119,6 +135,44 @@ public:
 
 };
 
+/// Tells if the functions of a filter type only hide the ones of dtQueryFilter.
+/// Without DT_VIRTUAL_QUERYFILTER, this is the case for the classes derived from dtQueryFilter.
+/// The other queries call the functions of dtQueryFilter for them, so such filters take the
+/// dtQueryFilter overloads of the templated queries too, and all queries agree on the filter.
+/// @ingroup detour
+template <class TFilter>
+struct dtHidesQueryFilter
+{
+#ifdef DT_VIRTUAL_QUERYFILTER
+	enum { value = 0 };
+#else
+	static char test(const dtQueryFilter*);
+	static char (&test(...))[2];
+	enum { value = sizeof(test((const TFilter*)0)) == sizeof(char) };
+#endif
+};
+
+template <>
+struct dtHidesQueryFilter<dtQueryFilter>
+{
+	enum { value = 0 };
+};
+
+/// The result type of the templated queries, which are left out of overload resolution
+/// for the filters hiding dtQueryFilter. (See: #dtHidesQueryFilter)
+/// @ingroup detour
+template <class TFilter, class TResult, bool Hides = dtHidesQueryFilter<TFilter>::value>
+struct dtFilterQueryResult
+{
+	typedef TResult type;
+};
+
+template <class TFilter, class TResult>
+struct dtFilterQueryResult<TFilter, TResult, true>
+{
+};
+
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -146,6 +200,22 @@ struct dtRaycastHit
 	float pathCost;
 };
 
+/// A raycast request, used by dtNavMeshQuery::raycasts.
+/// @ingroup detour
+struct dtRaycastRequest
+{
+	dtPolyRef startRef;		///< The reference id of the start polygon.
+	float startPos[3];		///< A position within the start polygon representing the start of the ray. [(x, y, z)]
+	float endPos[3];		///< The position to cast the ray toward. [(x, y, z)]
+	dtPolyRef prevRef;		///< The parent of the start polygon, used for the cost calculation. [opt]
+
+	/// The results of the raycast. The path array and its size are inputs, the path is optional.
+	dtRaycastHit hit;
+
+	/// The status flags of the request, as returned by dtNavMeshQuery::raycast. [out]
+	dtStatus status;
+};
+
 /// Provides custom polygon query behavior.
 /// Used by dtNavMeshQuery::queryPolygons.
 /// @ingroup detour
@@ -159,6 +229,63 @@ public:
 	virtual void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count) = 0;
 };
 
+/// A path request, used by dtNavMeshQuery::findPaths.
+/// @ingroup detour
+struct dtPathRequest
+{
+	dtPolyRef startRef;		///< The refrence id of the start polygon.
+	dtPolyRef endRef;		///< The reference id of the end polygon.
+	float startPos[3];		///< A position within the start polygon. [(x, y, z)]
+	float endPos[3];		///< A position within the end polygon. [(x, y, z)]
+
+	/// An ordered list of polygon references representing the path. (Start to end.) [(polyRef) * @p maxPath]
+	dtPolyRef* path;
+
+	/// The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	int maxPath;
+
+	/// The number of polygons returned in the @p path array. [out]
+	int pathCount;
+
+	/// The status flags of the request, as returned by dtNavMeshQuery::findPath. [out]
+	dtStatus status;
+};
+
+/// A nearest polygon request, used by dtNavMeshQuery::findNearestPolys.
+/// @ingroup detour
+struct dtNearestPolyRequest
+{
+	float center[3];		///< The center of the search box. [(x, y, z)]
+	dtPolyRef nearestRef;	///< The reference id of the nearest polygon. Set to 0 if no polygon is found. [out]
+	float nearestPt[3];		///< The nearest point on the polygon. Unchanged if no polygon is found. [out] [(x, y, z)]
+	bool isOverPoly;		///< Set to true if the center's X/Z coordinate lies inside the polygon. Unchanged if no polygon is found. [out]
+
+	/// The status flags of the request, as returned by dtNavMeshQuery::findNearestPoly. [out]
+	dtStatus status;
+};
+
+/// A task run by a dtTaskDispatcher.
+///  @param[in]		index		The index of the task.
+///  @param[in]		worker		The index of the worker running the task. [Limits: 0 <= value < dtTaskDispatcher::getWorkerCount()]
+///  @param[in]		userData	The user data passed to dtTaskDispatcher::parallelFor.
+typedef void (dtTaskFunc)(int index, int worker, void* userData);
+
+/// Runs independent tasks, for example on the threads of a job system.
+/// Used to spread batched queries over several query objects, one per worker.
+/// @ingroup detour
+class dtTaskDispatcher
+{
+public:
+	virtual ~dtTaskDispatcher();
+
+	/// The number of workers which can run tasks at the same time.
+	virtual int getWorkerCount() const = 0;
+
+	/// Calls @p func for every index in [0, @p count) and returns once all the tasks have completed.
+	/// The tasks of a worker must run one after the other, each receiving the index of the worker.
+	virtual void parallelFor(int count, dtTaskFunc* func, void* userData) = 0;
+};
+
 /// Provides the ability to perform pathfinding related queries against
 /// a navigation mesh.
 /// @ingroup detour
@@ -170,7 +297,7 @@ public:
 	
 	/// Initializes the query object.
 	///  @param[in]		nav			Pointer to the dtNavMesh object to use for all queries.
-	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= #DT_MAX_POOL_NODES]
 	/// @returns The status flags for the query.
 	dtStatus init(const dtNavMesh* nav, const int maxNodes);
 	
@@ -187,10 +314,30 @@ public:
 	///  							[(polyRef) * @p pathCount]
 	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
 	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options, only #DT_FINDPATH_BIDIRECTIONAL is supported. (see: #dtFindPathOptions)
 	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
 					  const float* startPos, const float* endPos,
 					  const dtQueryFilter* filter,
-					  dtPolyRef* path, int* pathCount, const int maxPath) const;
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options = 0) const;
+
+	/// Finds a path from the start polygon to the end polygon, calling the filter without dynamic dispatch.
+	/// The filter type must provide passFilter() and getCost() with the signatures of dtQueryFilter.
+	/// Without #DT_VIRTUAL_QUERYFILTER, filters derived from dtQueryFilter take the dtQueryFilter overload
+	/// instead. (See: #dtHidesQueryFilter) See findPath() for the parameters.
+	template <class TFilter>
+	typename dtFilterQueryResult<TFilter, dtStatus>::type findPath(dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  const TFilter* filter,
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options = 0) const;
+
+	/// Finds the paths of a batch of requests.
+	///  @param[in,out]	requests		The path requests. Receive the paths and the status of each request.
+	///  @param[in]		requestCount	The number of requests.
+	///  @param[in]		filter			The polygon filter to apply to the queries.
+	/// @returns The status flags for the query.
+	dtStatus findPaths(dtPathRequest* requests, const int requestCount, const dtQueryFilter* filter) const;
 
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
@@ -275,6 +422,15 @@ public:
 								   const dtQueryFilter* filter,
 								   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 								   int* resultCount, const int maxResult) const;
+
+	/// Finds the polygons along the navigation graph that touch the specified circle, calling the filter
+	/// without dynamic dispatch. See findPath() for the requirements on the filter type and
+	/// findPolysAroundCircle() for the parameters.
+	template <class TFilter>
+	typename dtFilterQueryResult<TFilter, dtStatus>::type findPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
+								   const TFilter* filter,
+								   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+								   int* resultCount, const int maxResult) const;
 	
 	/// Finds the polygons along the naviation graph that touch the specified convex polygon.
 	///  @param[in]		startRef		The reference id of the polygon where the search starts.
@@ -338,6 +494,15 @@ public:
 	dtStatus findNearestPoly(const float* center, const float* halfExtents,
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
+
+	/// Finds the polygons nearest to the center points of a batch of requests.
+	///  @param[in,out]	requests		The requests. Receive the nearest polygons and the status of each request.
+	///  @param[in]		requestCount	The number of requests.
+	///  @param[in]		halfExtents		The search distance along each axis, shared by all the requests. [(x, y, z)]
+	///  @param[in]		filter			The polygon filter to apply to the queries.
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolys(dtNearestPolyRequest* requests, const int requestCount,
+							  const float* halfExtents, const dtQueryFilter* filter) const;
 	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
@@ -422,6 +587,23 @@ public:
 					 const dtQueryFilter* filter, const unsigned int options,
 					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
 
+	/// Casts a 'walkability' ray along the surface of the navigation mesh, calling the filter
+	/// without dynamic dispatch. See findPath() for the requirements on the filter type and
+	/// raycast() for the parameters.
+	template <class TFilter>
+	typename dtFilterQueryResult<TFilter, dtStatus>::type raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
+					 const TFilter* filter, const unsigned int options,
+					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
+
+	/// Casts the rays of a batch of requests.
+	///  @param[in,out]	requests		The raycast requests. Receive the hits and the status of each request.
+	///  @param[in]		requestCount	The number of requests.
+	///  @param[in]		filter			The polygon filter to apply to the queries.
+	///  @param[in]		options			govern how the raycasts behave. See dtRaycastOptions
+	/// @returns The status flags for the query.
+	dtStatus raycasts(dtRaycastRequest* requests, const int requestCount,
+					  const dtQueryFilter* filter, const unsigned int options) const;
+
 
 	/// Finds the distance from the specified position to the nearest polygon wall.
 	///  @param[in]		startRef		The reference id of the polygon containing @p centerPos.
@@ -556,6 +738,57 @@ private:
 
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	struct dtQueryData;
+
+	// Starts a bidirectional search from the start and the end polygon of the query.
+	template <class TFilter>
+	void initBidirectionalSearch(dtQueryData& query, const TFilter* filter) const;
+
+	// Runs up to maxIter iterations of a bidirectional search. Updates and returns the status of the query.
+	template <class TFilter>
+	dtStatus updateBidirectionalSearch(dtQueryData& query, const TFilter* filter, const int maxIter, int* doneIters) const;
+
+	// Updates the best connection of the searches if the path through the forward and backward node of a polygon is cheaper.
+	template <class TFilter>
+	void connectBidirectionalSearch(dtQueryData& query, const TFilter* filter, struct dtNode* node, struct dtNode* backNode) const;
+
+	// Finds the one-way off-mesh connections ending at the polygon, which are not linked from it.
+	// Skips the first @p skip connections, so that more than @p maxRefs connections can be found in several calls.
+	// Sets @p nearby if there are any one-way connections in the tile or its neighbours.
+	int findIncomingOffMeshConnections(dtPolyRef ref, const dtMeshTile* tile, const int skip,
+									   dtPolyRef* refs, const int maxRefs, bool* nearby) const;
+
+	// Gets the path of a bidirectional search, or the partial path toward the end if the searches did not connect.
+	dtStatus getBidirectionalPath(const dtQueryData& query, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	// A ray walking through the polygons in raycast.
+	struct dtRaycastState
+	{
+		const float* startPos;
+		const float* endPos;
+		float dir[3];
+		float curPos[3];
+		dtPolyRef prevRef, curRef;
+		const dtMeshTile* prevTile, *tile, *nextTile;
+		const dtPoly* prevPoly, *poly, *nextPoly;
+		int n;
+		dtRaycastHit* hit;
+		dtStatus status;
+	};
+
+	// Starts a ray at the start polygon.
+	void initRaycast(dtRaycastState& ray, dtPolyRef startRef, const float* startPos,
+					 const float* endPos, dtPolyRef prevRef, dtRaycastHit* hit) const;
+
+	// Moves the ray across the current polygon, given its intersection with the polygon.
+	// Returns false once the ray has ended, the results are stored in the hit.
+	template <class TFilter>
+	bool advanceRaycast(dtRaycastState& ray, const TFilter* filter, const unsigned int options,
+						const float* verts, const int nv, const bool intersects, const float tmax, const int segMax) const;
+
+	// Copies the vertices of the polygon and returns their count.
+	static int collectPolyVerts(const dtMeshTile* tile, const dtPoly* poly, float* verts);
 	
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
 
@@ -569,12 +802,16 @@ private:
 		const dtQueryFilter* filter;
 		unsigned int options;
 		float raycastLimitSqr;
+		struct dtNode* meetNode;		///< Forward node of the best connection of a bidirectional search.
+		struct dtNode* meetBackNode;	///< Backward node of the best connection of a bidirectional search.
+		float meetCost;					///< Cost of the path through the best connection.
 	};
 	dtQueryData m_query;				///< Sliced query state.
 
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+	class dtNodeQueue* m_backOpenList;	///< Pointer to the open list of the backward search of bidirectional queries.
 };
 
 /// Allocates a query object using the Detour allocator.
@@ -587,4 +824,903 @@ dtNavMeshQuery* dtAllocNavMeshQuery();
 /// @ingroup detour
 void dtFreeNavMeshQuery(dtNavMeshQuery* query);
 
+/// Finds the paths of a batch of requests, split over several query objects.
+///  @param[in]		queries			A query object per worker of the dispatcher. [Size: dispatcher->getWorkerCount()]
+///  @param[in]		dispatcher		Runs the batches of requests on the workers, or null to use only the first query object.
+///  @param[in,out]	requests		The path requests. Receive the paths and the status of each request.
+///  @param[in]		requestCount	The number of requests.
+///  @param[in]		filter			The polygon filter to apply to the queries.
+/// @returns The status flags for the query.
+/// @ingroup detour
+dtStatus dtFindPaths(dtNavMeshQuery** queries, dtTaskDispatcher* dispatcher,
+					 dtPathRequest* requests, const int requestCount, const dtQueryFilter* filter);
+
+// The templated queries are defined in the header, so that the filter calls can be inlined
+// into the search loops of the caller's filter type. The dtQueryFilter versions use them too.
+
+template <class TFilter>
+typename dtFilterQueryResult<TFilter, dtStatus>::type dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
+								  const float* startPos, const float* endPos,
+								  const TFilter* filter,
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !path || maxPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (startRef == endRef)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS;
+	}
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		dtQueryData query;
+		memset(&query, 0, sizeof(query));
+		query.startRef = startRef;
+		query.endRef = endRef;
+		dtVcopy(query.startPos, startPos);
+		dtVcopy(query.endPos, endPos);
+		initBidirectionalSearch(query, filter);
+		if (dtStatusFailed(updateBidirectionalSearch(query, filter, INT_MAX, 0)))
+			return query.status;
+		return getBidirectionalPath(query, path, pathCount, maxPath);
+	}
+	
+	m_nodePool->clear();
+	m_openList->clear();
+	
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+	
+	bool outOfNodes = false;
+	
+	while (!m_openList->empty())
+	{
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		
+		// Reached the goal, stop searching.
+		if (bestNode->id == endRef)
+		{
+			lastBestNode = bestNode;
+			break;
+		}
+		
+		// Get current poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+		
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			
+			// Get neighbour poly and tile.
+			// The API input has been cheked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
+			
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// deal explicitly with crossing tile boundaries
+			unsigned char crossSide = 0;
+			if (bestTile->links[i].side != 0xff)
+				crossSide = bestTile->links[i].side >> 1;
+
+			// get the node
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
+			if (!neighbourNode)
+			{
+				outOfNodes = true;
+				continue;
+			}
+			
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			// Calculate cost and heuristic.
+			float cost = 0;
+			float heuristic = 0;
+			
+			// Special case for last node.
+			if (neighbourRef == endRef)
+			{
+				// Cost
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				const float endCost = filter->getCost(neighbourNode->pos, endPos,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly,
+													  0, 0, 0);
+				
+				cost = bestNode->cost + curCost + endCost;
+				heuristic = 0;
+			}
+			else
+			{
+				// Cost
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = dtVdist(neighbourNode->pos, endPos)*DT_HEURISTIC_SCALE;
+			}
+
+			const float total = cost + heuristic;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+			
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+			
+			// Update nearest node to target so far.
+			if (heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+
+	if (lastBestNode->id != endRef)
+		status |= DT_PARTIAL_RESULT;
+
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+	
+	return status;
+}
+
+template <class TFilter>
+void dtNavMeshQuery::initBidirectionalSearch(dtQueryData& query, const TFilter* filter) const
+{
+	m_nodePool->clear();
+	m_openList->clear();
+	m_backOpenList->clear();
+
+	// The forward nodes use state 0 and the backward nodes state 1 in the node pool.
+	dtNode* startNode = m_nodePool->getNode(query.startRef, 0);
+	dtVcopy(startNode->pos, query.startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(query.startPos, query.endPos) * DT_HEURISTIC_SCALE * 0.5f;
+	startNode->id = query.startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	query.status = DT_IN_PROGRESS;
+	query.lastBestNode = startNode;
+	query.lastBestNodeCost = dtVdist(query.startPos, query.endPos) * DT_HEURISTIC_SCALE;
+	query.meetNode = 0;
+	query.meetBackNode = 0;
+	query.meetCost = FLT_MAX;
+
+	// The forward search cannot enter the end polygon if the filter excludes it,
+	// then only the forward search runs and returns a partial path.
+	const dtMeshTile* endTile = 0;
+	const dtPoly* endPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(query.endRef, &endTile, &endPoly);
+	if (!filter->passFilter(query.endRef, endTile, endPoly))
+		return;
+
+	// The backward search measures the cost from the exit of a polygon to the end position.
+	dtNode* endNode = m_nodePool->getNode(query.endRef, 1);
+	dtVcopy(endNode->pos, query.endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = dtVdist(query.endPos, query.startPos) * DT_HEURISTIC_SCALE * 0.5f;
+	endNode->id = query.endRef;
+	endNode->flags = DT_NODE_OPEN;
+	m_backOpenList->push(endNode);
+}
+
+template <class TFilter>
+void dtNavMeshQuery::connectBidirectionalSearch(dtQueryData& query, const TFilter* filter, dtNode* node, dtNode* backNode) const
+{
+	// The forward node is at the entry of the polygon and the backward node at its exit,
+	// the connection adds the cost of crossing the polygon.
+	dtPolyRef prevRef = 0, nextRef = 0;
+	const dtMeshTile* prevTile = 0, *curTile = 0, *nextTile = 0;
+	const dtPoly* prevPoly = 0, *curPoly = 0, *nextPoly = 0;
+	if (node->pidx)
+	{
+		prevRef = m_nodePool->getNodeAtIdx(node->pidx)->id;
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+	}
+	if (backNode->pidx)
+	{
+		nextRef = m_nodePool->getNodeAtIdx(backNode->pidx)->id;
+		m_nav->getTileAndPolyByRefUnsafe(nextRef, &nextTile, &nextPoly);
+	}
+	m_nav->getTileAndPolyByRefUnsafe(node->id, &curTile, &curPoly);
+
+	const float cost = node->cost + backNode->cost +
+		filter->getCost(node->pos, backNode->pos,
+						prevRef, prevTile, prevPoly,
+						node->id, curTile, curPoly,
+						nextRef, nextTile, nextPoly);
+	if (cost < query.meetCost)
+	{
+		query.meetCost = cost;
+		query.meetNode = node;
+		query.meetBackNode = backNode;
+	}
+}
+
+template <class TFilter>
+dtStatus dtNavMeshQuery::updateBidirectionalSearch(dtQueryData& query, const TFilter* filter, const int maxIter, int* doneIters) const
+{
+	int iter = 0;
+	bool done = false;
+	// The last tile without one-way off-mesh connections in or next to it, it does not need to be searched for them again.
+	const dtMeshTile* plainTile = 0;
+	while (!done && iter < maxIter)
+	{
+		// Both searches use the average of the distances to the end and from the start as heuristic,
+		// so that the estimates of the two searches cancel out. Any path not found yet then costs
+		// at least the sum of the lowest totals in the open lists. Once the best connection is
+		// not more expensive, it is the path. The search ends too when the forward search runs
+		// out of nodes, the backward search alone cannot reach the start if it is not connected.
+		if (m_openList->empty())
+		{
+			done = true;
+			break;
+		}
+		if (query.meetNode &&
+			(m_backOpenList->empty() || query.meetCost <= m_openList->top()->total + m_backOpenList->top()->total))
+		{
+			done = true;
+			break;
+		}
+
+		iter++;
+
+		// Expand the smaller of the two open lists.
+		const bool backward = !m_backOpenList->empty() && m_backOpenList->getSize() < m_openList->getSize();
+		const unsigned char state = backward ? 1 : 0;
+		dtNodeQueue* openList = backward ? m_backOpenList : m_openList;
+		const float heuristicSign = backward ? -1.0f : 1.0f;
+
+		dtNode* bestNode = openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Get current poly and tile. The polygons can disappear during a sliced query.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		dtNode* parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
+		if (parentNode)
+			parentRef = parentNode->id;
+		if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)) ||
+			(parentRef && dtStatusFailed(m_nav->getTileAndPolyByRef(parentRef, &parentTile, &parentPoly))))
+		{
+			query.status = DT_FAILURE;
+			if (doneIters)
+				*doneIters = iter;
+			return query.status;
+		}
+
+		// The backward search follows the links in reverse. One-way off-mesh connections are only linked
+		// from their start polygon, the connections ending at the best polygon are looked up separately,
+		// MAX_INCOMING at a time.
+		static const int MAX_INCOMING = 32;
+		dtPolyRef incomingRefs[MAX_INCOMING];
+		int incomingCount = 0;
+		int incomingSkip = 0;
+		const bool findIncoming = backward && bestTile != plainTile && bestPoly->getType() == DT_POLYTYPE_GROUND;
+		if (findIncoming)
+		{
+			bool nearby = false;
+			incomingCount = findIncomingOffMeshConnections(bestRef, bestTile, 0, incomingRefs, MAX_INCOMING, &nearby);
+			if (!nearby)
+				plainTile = bestTile;
+		}
+
+		unsigned int linkIndex = bestPoly->firstLink;
+		int incomingIndex = 0;
+		for (;;)
+		{
+			dtPolyRef neighbourRef = 0;
+			bool linked = false;
+			if (linkIndex != DT_NULL_LINK)
+			{
+				const dtLink* link = &bestTile->links[linkIndex];
+				linkIndex = link->next;
+				neighbourRef = link->ref;
+				linked = true;
+
+				// The end point of an off-mesh connection links back to it only if the connection is bidirectional.
+				if (backward && link->edge == 1 && bestPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				{
+					const dtOffMeshConnection* con = m_nav->getOffMeshConnectionByRef(bestRef);
+					if (!con || !(con->flags & DT_OFFMESH_CON_BIDIR))
+						continue;
+				}
+			}
+			else if (incomingIndex < incomingCount)
+			{
+				neighbourRef = incomingRefs[incomingIndex++];
+			}
+			else if (findIncoming && incomingCount == MAX_INCOMING)
+			{
+				bool nearby = false;
+				incomingSkip += incomingCount;
+				incomingCount = findIncomingOffMeshConnections(bestRef, bestTile, incomingSkip, incomingRefs, MAX_INCOMING, &nearby);
+				incomingIndex = 0;
+				continue;
+			}
+			else
+			{
+				break;
+			}
+
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// The API input has been checked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			// The start polygon of a one-way off-mesh connection links to it, but it cannot be travelled
+			// from the connection back to the start polygon.
+			if (backward && linked && neighbourPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			{
+				const dtOffMeshConnection* con = m_nav->getOffMeshConnectionByRef(neighbourRef);
+				if (!con || !(con->flags & DT_OFFMESH_CON_BIDIR))
+					continue;
+			}
+
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// Unlike findPath, the node position follows the parent when a node is updated. Otherwise the
+			// backward search keeps the exit the polygon was first reached from, which is often not the one
+			// the path takes, and the searches would stop at a more expensive connection.
+			// The positions are always taken from the portal in the forward direction, skip the neighbour
+			// if there is no portal in that direction.
+			float neighbourPos[3];
+			const dtStatus portalStatus = backward ?
+				getEdgeMidPoint(neighbourRef, neighbourPoly, neighbourTile, bestRef, bestPoly, bestTile, neighbourPos) :
+				getEdgeMidPoint(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, neighbourPos);
+			if (dtStatusFailed(portalStatus))
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, state);
+			if (!neighbourNode)
+			{
+				query.status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			// The segment between the nodes is within the best polygon.
+			const float curCost = backward ?
+				filter->getCost(neighbourPos, bestNode->pos,
+								neighbourRef, neighbourTile, neighbourPoly,
+								bestRef, bestTile, bestPoly,
+								parentRef, parentTile, parentPoly) :
+				filter->getCost(bestNode->pos, neighbourPos,
+								parentRef, parentTile, parentPoly,
+								bestRef, bestTile, bestPoly,
+								neighbourRef, neighbourTile, neighbourPoly);
+			const float cost = bestNode->cost + curCost;
+			const float heuristic = dtVdist(neighbourPos, query.endPos) * DT_HEURISTIC_SCALE;
+			const float backHeuristic = dtVdist(neighbourPos, query.startPos) * DT_HEURISTIC_SCALE;
+
+			// Skip the node if any path through it costs more than the best connection so far.
+			if (cost + (backward ? backHeuristic : heuristic) >= query.meetCost)
+				continue;
+
+			const float total = cost + heuristicSign * 0.5f * (heuristic - backHeuristic);
+
+			// The node is already visited and the new result is worse, skip.
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+				continue;
+
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			dtVcopy(neighbourNode->pos, neighbourPos);
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				openList->push(neighbourNode);
+			}
+
+			// Connect to the other search if it has reached the polygon.
+			dtNode* otherNode = m_nodePool->findNode(neighbourRef, (unsigned char)(1 - state));
+			if (otherNode && otherNode->flags)
+			{
+				if (backward)
+					connectBidirectionalSearch(query, filter, otherNode, neighbourNode);
+				else
+					connectBidirectionalSearch(query, filter, neighbourNode, otherNode);
+			}
+
+			// Update nearest node to target so far.
+			if (!backward && heuristic < query.lastBestNodeCost)
+			{
+				query.lastBestNodeCost = heuristic;
+				query.lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	if (done)
+	{
+		const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+		query.status = DT_SUCCESS | details;
+	}
+
+	if (doneIters)
+		*doneIters = iter;
+
+	return query.status;
+}
+
+template <class TFilter>
+typename dtFilterQueryResult<TFilter, dtStatus>::type dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
+											   const TFilter* filter,
+											   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+											   int* resultCount, const int maxResult) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!resultCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*resultCount = 0;
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!centerPos || !dtVisfinite(centerPos) ||
+		radius < 0 || !dtMathIsfinite(radius) ||
+		!filter || maxResult < 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	m_nodePool->clear();
+	m_openList->clear();
+	
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, centerPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	dtStatus status = DT_SUCCESS;
+	
+	int n = 0;
+	
+	const float radiusSqr = dtSqr(radius);
+	
+	while (!m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		
+		// Get poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+		
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		if (n < maxResult)
+		{
+			if (resultRef)
+				resultRef[n] = bestRef;
+			if (resultParent)
+				resultParent[n] = parentRef;
+			if (resultCost)
+				resultCost[n] = bestNode->total;
+			++n;
+		}
+		else
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+		}
+		
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtLink* link = &bestTile->links[i];
+			dtPolyRef neighbourRef = link->ref;
+			// Skip invalid neighbours and do not follow back to parent.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			
+			// Expand to neighbour
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+		
+			// Do not advance if the polygon is excluded by the filter.
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+			
+			// Find edge and calc distance to the edge.
+			float va[3], vb[3];
+			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+				continue;
+			
+			// If the circle is not touching the next polygon, skip it.
+			float tseg;
+			float distSqr = dtDistancePtSegSqr2D(centerPos, va, vb, tseg);
+			if (distSqr > radiusSqr)
+				continue;
+			
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+			{
+				status |= DT_OUT_OF_NODES;
+				continue;
+			}
+				
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+			
+			// Cost
+			if (neighbourNode->flags == 0)
+				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
+			
+			float cost = filter->getCost(
+				bestNode->pos, neighbourNode->pos,
+				parentRef, parentTile, parentPoly,
+				bestRef, bestTile, bestPoly,
+				neighbourRef, neighbourTile, neighbourPoly);
+
+			const float total = bestNode->total + cost;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+	
+	*resultCount = n;
+	
+	return status;
+}
+
+template <class TFilter>
+bool dtNavMeshQuery::advanceRaycast(dtRaycastState& ray, const TFilter* filter, const unsigned int options,
+									const float* verts, const int nv, const bool intersects, const float tmax, const int segMax) const
+{
+	const float* startPos = ray.startPos;
+	const float* endPos = ray.endPos;
+	dtRaycastHit* hit = ray.hit;
+	const dtPolyRef curRef = ray.curRef;
+	const dtMeshTile* tile = ray.tile;
+	const dtPoly* poly = ray.poly;
+
+	if (!intersects)
+	{
+		// Could not hit the polygon, keep the old t and report hit.
+		hit->pathCount = ray.n;
+		return false;
+	}
+
+	hit->hitEdgeIndex = segMax;
+
+	// Keep track of furthest t so far.
+	if (tmax > hit->t)
+		hit->t = tmax;
+	
+	// Store visited polygons.
+	if (ray.n < hit->maxPath)
+		hit->path[ray.n++] = curRef;
+	else
+		ray.status |= DT_BUFFER_TOO_SMALL;
+
+	// Ray end is completely inside the polygon.
+	if (segMax == -1)
+	{
+		hit->t = FLT_MAX;
+		hit->pathCount = ray.n;
+		
+		// add the cost
+		if (options & DT_RAYCAST_USE_COSTS)
+			hit->pathCost += filter->getCost(ray.curPos, endPos, ray.prevRef, ray.prevTile, ray.prevPoly, curRef, tile, poly, curRef, tile, poly);
+		return false;
+	}
+
+	// Follow neighbours.
+	dtPolyRef nextRef = 0;
+	
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtLink* link = &tile->links[i];
+		
+		// Find link which contains this edge.
+		if ((int)link->edge != segMax)
+			continue;
+		
+		// Get pointer to the next polygon.
+		ray.nextTile = 0;
+		ray.nextPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(link->ref, &ray.nextTile, &ray.nextPoly);
+		
+		// Skip off-mesh connections.
+		if (ray.nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		
+		// Skip links based on filter.
+		if (!filter->passFilter(link->ref, ray.nextTile, ray.nextPoly))
+			continue;
+		
+		// If the link is internal, just return the ref.
+		if (link->side == 0xff)
+		{
+			nextRef = link->ref;
+			break;
+		}
+		
+		// If the link is at tile boundary,
+		
+		// Check if the link spans the whole edge, and accept.
+		if (link->bmin == 0 && link->bmax == 255)
+		{
+			nextRef = link->ref;
+			break;
+		}
+		
+		// Check for partial edge links.
+		const int v0 = poly->verts[link->edge];
+		const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
+		const float* left = &tile->verts[v0*3];
+		const float* right = &tile->verts[v1*3];
+		
+		// Check that the intersection lies inside the link portal.
+		if (link->side == 0 || link->side == 4)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
+			float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+			
+			// Find Z intersection.
+			float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
+			if (z >= lmin && z <= lmax)
+			{
+				nextRef = link->ref;
+				break;
+			}
+		}
+		else if (link->side == 2 || link->side == 6)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
+			float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+			
+			// Find X intersection.
+			float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
+			if (x >= lmin && x <= lmax)
+			{
+				nextRef = link->ref;
+				break;
+			}
+		}
+	}
+	
+	// add the cost
+	if (options & DT_RAYCAST_USE_COSTS)
+	{
+		// compute the intersection point at the furthest end of the polygon
+		// and correct the height (since the raycast moves in 2d)
+		float lastPos[3];
+		dtVcopy(lastPos, ray.curPos);
+		dtVmad(ray.curPos, startPos, ray.dir, hit->t);
+		const float* e1 = &verts[segMax*3];
+		const float* e2 = &verts[((segMax+1)%nv)*3];
+		float eDir[3], diff[3];
+		dtVsub(eDir, e2, e1);
+		dtVsub(diff, ray.curPos, e1);
+		float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
+		ray.curPos[1] = e1[1] + eDir[1] * s;
+
+		hit->pathCost += filter->getCost(lastPos, ray.curPos, ray.prevRef, ray.prevTile, ray.prevPoly, curRef, tile, poly, nextRef, ray.nextTile, ray.nextPoly);
+	}
+
+	if (!nextRef)
+	{
+		// No neighbour, we hit a wall.
+		
+		// Calculate hit normal.
+		const int a = segMax;
+		const int b = segMax+1 < nv ? segMax+1 : 0;
+		const float* va = &verts[a*3];
+		const float* vb = &verts[b*3];
+		const float dx = vb[0] - va[0];
+		const float dz = vb[2] - va[2];
+		hit->hitNormal[0] = dz;
+		hit->hitNormal[1] = 0;
+		hit->hitNormal[2] = -dx;
+		dtVnormalize(hit->hitNormal);
+		
+		hit->pathCount = ray.n;
+		return false;
+	}
+
+	// No hit, advance to neighbour polygon.
+	ray.prevRef = curRef;
+	ray.curRef = nextRef;
+	ray.prevTile = tile;
+	ray.tile = ray.nextTile;
+	ray.prevPoly = poly;
+	ray.poly = ray.nextPoly;
+	return true;
+}
+
+inline int dtNavMeshQuery::collectPolyVerts(const dtMeshTile* tile, const dtPoly* poly, float* verts)
+{
+	const int nv = (int)poly->vertCount;
+	for (int i = 0; i < nv; ++i)
+		dtVcopy(&verts[i*3], &tile->verts[poly->verts[i]*3]);
+	return nv;
+}
+
+template <class TFilter>
+typename dtFilterQueryResult<TFilter, dtStatus>::type dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
+								 const TFilter* filter, const unsigned int options,
+								 dtRaycastHit* hit, dtPolyRef prevRef) const
+{
+	dtAssert(m_nav);
+
+	if (!hit)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	hit->t = 0;
+	hit->pathCount = 0;
+	hit->pathCost = 0;
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter ||
+		(prevRef && !m_nav->isValidPolyRef(prevRef)))
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	float verts[DT_VERTS_PER_POLYGON*3+3];	
+
+	dtRaycastState ray;
+	initRaycast(ray, startRef, startPos, endPos, prevRef, hit);
+
+	for (;;)
+	{
+		// Cast ray against current polygon.
+		const int nv = collectPolyVerts(ray.tile, ray.poly, verts);
+		
+		float tmin, tmax;
+		int segMin, segMax;
+		const bool intersects = dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax);
+		if (!advanceRaycast(ray, filter, options, verts, nv, intersects, tmax, segMax))
+			return ray.status;
+	}
+}
+
 #endif // DETOURNAVMESHQUERY_H
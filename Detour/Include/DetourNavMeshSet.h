@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHSET_H
+#define DETOURNAVMESHSET_H
+
+#include <stddef.h>
+#include "DetourNavMesh.h"
+
+/// A magic number used to detect compatibility of navigation mesh set data.
+static const int DT_NAVMESH_SET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T';
+
+/// A version number used to detect compatibility of navigation mesh set data.
+/// Version 1 was the unaligned format written by the demo, which streamed the tiles one by one.
+static const int DT_NAVMESH_SET_VERSION = 2;
+
+/// The default alignment of the tile data in a navigation mesh set, the size of a memory page.
+static const int DT_NAVMESH_SET_ALIGNMENT = 4096;
+
+/// The header of a navigation mesh set.
+/// @see dtStoreNavMeshSet, dtLoadNavMeshSet
+/// @ingroup detour
+struct dtNavMeshSetHeader
+{
+	int magic;					///< Set magic number. (Used to identify the data format.)
+	int version;				///< Set data format version number.
+	int alignment;				///< The alignment of the tile data within the set. [Unit: Bytes]
+	int tileCount;				///< The number of tiles in the set.
+	dtNavMeshParams params;		///< The parameters used to initialize the navigation mesh.
+};
+
+/// Locates the data of a tile within a navigation mesh set.
+/// The tile table follows the set header.
+/// @see dtNavMeshSetHeader
+/// @ingroup detour
+struct dtNavMeshSetTile
+{
+	dtTileRef tileRef;			///< The reference the tile had when the set was stored.
+	unsigned int dataPage;		///< The offset of the tile data from the start of the set. [Unit: dtNavMeshSetHeader::alignment]
+	int dataSize;				///< The size of the tile data. [Unit: Bytes]
+};
+
+/// Calculates the size needed to store all tiles of a navigation mesh as a set.
+/// @ingroup detour
+///  @param[in]		mesh		The navigation mesh to store.
+///  @param[in]		alignment	The alignment of the tile data. [Limit: power of two >= 16]
+/// @return The size of the set, or zero if the parameters are invalid. [Unit: Bytes]
+size_t dtGetNavMeshSetSize(const dtNavMesh* mesh, const int alignment);
+
+/// Stores all tiles of a navigation mesh as a set.
+/// @ingroup detour
+///  @param[in]		mesh		The navigation mesh to store.
+///  @param[in]		alignment	The alignment of the tile data. [Limit: power of two >= 16]
+///  @param[out]	data		The set data. [Size: @p dataSize]
+///  @param[in]		dataSize	The size of the data array, see #dtGetNavMeshSetSize.
+/// @returns The status flags for the operation.
+dtStatus dtStoreNavMeshSet(const dtNavMesh* mesh, const int alignment, unsigned char* data, const size_t dataSize);
+
+/// Initializes a navigation mesh and adds the tiles of a set to it, without copying the tile data.
+/// @ingroup detour
+///  @param[in,out]	mesh		The navigation mesh to initialize.
+///  @param[in]		data		The set data, aligned to dtNavMeshSetHeader::alignment. [Size: @p dataSize]
+///  @param[in]		dataSize	The size of the data array.
+/// @returns The status flags for the operation.
+dtStatus dtLoadNavMeshSet(dtNavMesh* mesh, unsigned char* data, const size_t dataSize);
+
+#endif // DETOURNAVMESHSET_H
@@ -28,11 +28,25 @@ enum dtNodeFlags
 	DT_NODE_PARENT_DETACHED = 0x04 // parent of the node is not adjacent. Found using raycast.
 };
 
+// Define DT_OPEN_ADDRESSING_NODE_POOL to look the nodes up from an open addressing hash table,
+// and to use 32-bit node indices, allowing searches over more than 65535 nodes.
+#ifdef DT_OPEN_ADDRESSING_NODE_POOL
+typedef unsigned int dtNodeIndex;
+#else
 typedef unsigned short dtNodeIndex;
+#endif
 static const dtNodeIndex DT_NULL_IDX = (dtNodeIndex)~0;
 
 static const int DT_NODE_PARENT_BITS = 24;
 static const int DT_NODE_STATE_BITS = 2;
+
+/// The maximum number of nodes in a node pool.
+/// pidx is special as 0 means "none" and 1 is the first node, so the parent bits can address one node less.
+#ifdef DT_OPEN_ADDRESSING_NODE_POOL
+static const int DT_MAX_POOL_NODES = (1 << DT_NODE_PARENT_BITS) - 1;
+#else
+static const int DT_MAX_POOL_NODES = DT_NULL_IDX;
+#endif
 struct dtNode
 {
 	float pos[3];								///< Position of the node.
@@ -77,6 +91,14 @@ public:
 		return &m_nodes[idx - 1];
 	}
 	
+#ifdef DT_OPEN_ADDRESSING_NODE_POOL
+	inline int getMemUsed() const
+	{
+		return sizeof(*this) +
+			sizeof(dtNode)*m_maxNodes +
+			sizeof(dtNodeSlot)*m_slotCount;
+	}
+#else
 	inline int getMemUsed() const
 	{
 		return sizeof(*this) +
@@ -84,12 +106,15 @@ public:
 			sizeof(dtNodeIndex)*m_maxNodes +
 			sizeof(dtNodeIndex)*m_hashSize;
 	}
+#endif
 	
 	inline int getMaxNodes() const { return m_maxNodes; }
 	
 	inline int getHashSize() const { return m_hashSize; }
+#ifndef DT_OPEN_ADDRESSING_NODE_POOL
 	inline dtNodeIndex getFirst(int bucket) const { return m_first[bucket]; }
 	inline dtNodeIndex getNext(int i) const { return m_next[i]; }
+#endif
 	inline int getNodeCount() const { return m_nodeCount; }
 	
 private:
@@ -98,8 +123,20 @@ private:
 	dtNodePool& operator=(const dtNodePool&);
 	
 	dtNode* m_nodes;
+#ifdef DT_OPEN_ADDRESSING_NODE_POOL
+	/// A slot of the hash table, keeping the lookup keys apart from the nodes.
+	struct dtNodeSlot
+	{
+		dtPolyRef id;		///< Polygon ref of the node.
+		unsigned int node;	///< Index of the node shifted by DT_NODE_STATE_BITS, ored with the state. DT_NULL_IDX if the slot is empty.
+	};
+	dtNodeSlot* findSlot(dtPolyRef id, unsigned char state);
+	dtNodeSlot* m_slots;
+	int m_slotCount;
+#else
 	dtNodeIndex* m_first;
 	dtNodeIndex* m_next;
+#endif
 	const int m_maxNodes;
 	const int m_hashSize;
 	int m_nodeCount;
@@ -142,6 +179,8 @@ public:
 	}
 	
 	inline bool empty() const { return m_size == 0; }
+
+	inline int getSize() const { return m_size; }
 	
 	inline int getMemUsed() const
 	{
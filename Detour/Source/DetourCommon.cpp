@@ -19,6 +19,19 @@
 #include "DetourCommon.h"
 #include "DetourMath.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DT_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef DT_HAS_SSE2
+// Picks the lanes of a where the mask is set, and the lanes of b elsewhere.
+static inline __m128 select4(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 void dtClosestPtPointTriangle(float* closest, const float* p,
@@ -167,6 +180,78 @@ bool dtIntersectSegmentPoly2D(const float* p0, const float* p1,
 	return true;
 }
 
+unsigned int dtIntersectSegmentPoly2D4(const float p0x[4], const float p0z[4],
+									   const float p1x[4], const float p1z[4],
+									   const float* verts, int nverts,
+									   float tmin[4], float tmax[4],
+									   int segMin[4], int segMax[4])
+{
+#ifdef DT_HAS_SSE2
+	// The edges are tested in the same order for all the segments. A segment which the scalar
+	// version rejects early keeps going, but is rejected in the end because the entering and
+	// leaving parameters only ever move closer to each other.
+	const __m128 eps = _mm_set1_ps(0.000001f);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 zero = _mm_setzero_ps();
+
+	const __m128 x0 = _mm_loadu_ps(p0x);
+	const __m128 z0 = _mm_loadu_ps(p0z);
+	const __m128 dirx = _mm_sub_ps(_mm_loadu_ps(p1x), x0);
+	const __m128 dirz = _mm_sub_ps(_mm_loadu_ps(p1z), z0);
+
+	__m128 t0 = zero;
+	__m128 t1 = _mm_set1_ps(1.0f);
+	__m128 s0 = _mm_set1_ps(-1.0f);
+	__m128 s1 = _mm_set1_ps(-1.0f);
+	__m128 fail = zero;
+
+	for (int i = 0, j = nverts-1; i < nverts; j=i++)
+	{
+		const float* vi = &verts[i*3];
+		const float* vj = &verts[j*3];
+		const __m128 ex = _mm_set1_ps(vi[0] - vj[0]);
+		const __m128 ez = _mm_set1_ps(vi[2] - vj[2]);
+		const __m128 dx = _mm_sub_ps(x0, _mm_set1_ps(vj[0]));
+		const __m128 dz = _mm_sub_ps(z0, _mm_set1_ps(vj[2]));
+		const __m128 n = _mm_sub_ps(_mm_mul_ps(ez, dx), _mm_mul_ps(ex, dz));
+		const __m128 d = _mm_sub_ps(_mm_mul_ps(dirz, ex), _mm_mul_ps(dirx, ez));
+
+		// S is nearly parallel to this edge.
+		const __m128 parallel = _mm_cmplt_ps(_mm_and_ps(d, absMask), eps);
+		fail = _mm_or_ps(fail, _mm_and_ps(parallel, _mm_cmplt_ps(n, zero)));
+
+		const __m128 t = _mm_div_ps(n, d);
+		const __m128 entering = _mm_cmplt_ps(d, zero);
+		const __m128 seg = _mm_set1_ps((float)j);
+
+		const __m128 enter = _mm_andnot_ps(parallel, _mm_and_ps(entering, _mm_cmpgt_ps(t, t0)));
+		t0 = select4(enter, t, t0);
+		s0 = select4(enter, seg, s0);
+
+		const __m128 leave = _mm_andnot_ps(parallel, _mm_andnot_ps(entering, _mm_cmplt_ps(t, t1)));
+		t1 = select4(leave, t, t1);
+		s1 = select4(leave, seg, s1);
+	}
+	fail = _mm_or_ps(fail, _mm_cmpgt_ps(t0, t1));
+
+	_mm_storeu_ps(tmin, t0);
+	_mm_storeu_ps(tmax, t1);
+	_mm_storeu_si128((__m128i*)segMin, _mm_cvttps_epi32(s0));
+	_mm_storeu_si128((__m128i*)segMax, _mm_cvttps_epi32(s1));
+	return ~(unsigned int)_mm_movemask_ps(fail) & 0xf;
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		const float p0[3] = { p0x[i], 0.0f, p0z[i] };
+		const float p1[3] = { p1x[i], 0.0f, p1z[i] };
+		if (dtIntersectSegmentPoly2D(p0, p1, verts, nverts, tmin[i], tmax[i], segMin[i], segMax[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
 float dtDistancePtSegSqr2D(const float* pt, const float* p, const float* q, float& t)
 {
 	float pqx = q[0] - p[0];
@@ -183,6 +268,37 @@ float dtDistancePtSegSqr2D(const float* pt, const float* p, const float* q, floa
 	return dx*dx + dz*dz;
 }
 
+// The vectorized versions of the point tests below evaluate the same expressions in
+// the same order as the scalar functions, so that they produce identical results.
+void dtDistancePtSegSqr2D4(const float px[4], const float pz[4], const float* p, const float* q,
+						   float dist[4], float t[4])
+{
+#ifdef DT_HAS_SSE2
+	const float pqx = q[0] - p[0];
+	const float pqz = q[2] - p[2];
+	const float d = pqx*pqx + pqz*pqz;
+	const __m128 x = _mm_loadu_ps(px);
+	const __m128 z = _mm_loadu_ps(pz);
+	const __m128 dx = _mm_sub_ps(x, _mm_set1_ps(p[0]));
+	const __m128 dz = _mm_sub_ps(z, _mm_set1_ps(p[2]));
+	__m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pqx), dx), _mm_mul_ps(_mm_set1_ps(pqz), dz));
+	if (d > 0) s = _mm_div_ps(s, _mm_set1_ps(d));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	s = select4(_mm_cmplt_ps(s, zero), zero, select4(_mm_cmpgt_ps(s, one), one, s));
+	const __m128 ex = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(p[0]), _mm_mul_ps(s, _mm_set1_ps(pqx))), x);
+	const __m128 ez = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(p[2]), _mm_mul_ps(s, _mm_set1_ps(pqz))), z);
+	_mm_storeu_ps(dist, _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ez, ez)));
+	_mm_storeu_ps(t, s);
+#else
+	for (int i = 0; i < 4; ++i)
+	{
+		const float pt[3] = { px[i], 0.0f, pz[i] };
+		dist[i] = dtDistancePtSegSqr2D(pt, p, q, t[i]);
+	}
+#endif
+}
+
 void dtCalcPolyCenter(float* tc, const unsigned short* idx, int nidx, const float* verts)
 {
 	tc[0] = 0.0f;
@@ -232,6 +348,63 @@ bool dtClosestHeightPointTriangle(const float* p, const float* a, const float* b
 	return false;
 }
 
+unsigned int dtClosestHeightPointTriangle4(const float px[4], const float pz[4],
+										   const float* a, const float* b, const float* c, float h[4])
+{
+#ifdef DT_HAS_SSE2
+	const float EPS = 1e-6f;
+	float v0[3], v1[3];
+
+	dtVsub(v0, c, a);
+	dtVsub(v1, b, a);
+
+	float denom = v0[0] * v1[2] - v0[2] * v1[0];
+	if (fabsf(denom) < EPS)
+		return 0;
+
+	const __m128 v2x = _mm_sub_ps(_mm_loadu_ps(px), _mm_set1_ps(a[0]));
+	const __m128 v2z = _mm_sub_ps(_mm_loadu_ps(pz), _mm_set1_ps(a[2]));
+	__m128 u = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(v1[2]), v2x), _mm_mul_ps(_mm_set1_ps(v1[0]), v2z));
+	__m128 v = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(v0[0]), v2z), _mm_mul_ps(_mm_set1_ps(v0[2]), v2x));
+
+	if (denom < 0)
+	{
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		denom = -denom;
+		u = _mm_xor_ps(u, sign);
+		v = _mm_xor_ps(v, sign);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 d = _mm_set1_ps(denom);
+	const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)),
+									 _mm_cmple_ps(_mm_add_ps(u, v), d));
+	const unsigned int mask = (unsigned int)_mm_movemask_ps(inside);
+	if (mask)
+	{
+		const __m128 dy = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v0[1]), u), _mm_mul_ps(_mm_set1_ps(v1[1]), v));
+		const __m128 y = _mm_add_ps(_mm_set1_ps(a[1]), _mm_div_ps(dy, d));
+		float heights[4];
+		_mm_storeu_ps(heights, y);
+		for (int i = 0; i < 4; ++i)
+		{
+			if (mask & (1u << i))
+				h[i] = heights[i];
+		}
+	}
+	return mask;
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		const float p[3] = { px[i], 0.0f, pz[i] };
+		if (dtClosestHeightPointTriangle(p, a, b, c, h[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
 /// @par
 ///
 /// All points are projected onto the xz-plane, so the y-values are ignored.
@@ -251,6 +424,36 @@ bool dtPointInPolygon(const float* pt, const float* verts, const int nverts)
 	return c;
 }
 
+unsigned int dtPointInPolygon4(const float px[4], const float pz[4], const float* verts, const int nverts)
+{
+#ifdef DT_HAS_SSE2
+	const __m128 x = _mm_loadu_ps(px);
+	const __m128 z = _mm_loadu_ps(pz);
+	__m128 c = _mm_setzero_ps();
+	for (int i = 0, j = nverts-1; i < nverts; j = i++)
+	{
+		const float* vi = &verts[i*3];
+		const float* vj = &verts[j*3];
+		// The crossing is computed for all the points, lanes which do not straddle the edge ignore it.
+		const __m128 straddle = _mm_xor_ps(_mm_cmpgt_ps(_mm_set1_ps(vi[2]), z), _mm_cmpgt_ps(_mm_set1_ps(vj[2]), z));
+		const __m128 cross = _mm_add_ps(_mm_div_ps(_mm_mul_ps(_mm_set1_ps(vj[0]-vi[0]), _mm_sub_ps(z, _mm_set1_ps(vi[2]))),
+												   _mm_set1_ps(vj[2]-vi[2])),
+										_mm_set1_ps(vi[0]));
+		c = _mm_xor_ps(c, _mm_and_ps(straddle, _mm_cmplt_ps(x, cross)));
+	}
+	return (unsigned int)_mm_movemask_ps(c);
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		const float pt[3] = { px[i], 0.0f, pz[i] };
+		if (dtPointInPolygon(pt, verts, nverts))
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
 bool dtDistancePtPolyEdgesSqr(const float* pt, const float* verts, const int nverts,
 							  float* ed, float* et)
 {
@@ -269,6 +472,36 @@ bool dtDistancePtPolyEdgesSqr(const float* pt, const float* verts, const int nve
 	return c;
 }
 
+unsigned int dtOverlapQuantBounds4(const unsigned short amin[3], const unsigned short amax[3],
+								   const unsigned short bmin[3][4], const unsigned short bmax[3][4])
+{
+#ifdef DT_HAS_SSE2
+	// The low four lanes compare the minimum bounds of the boxes to the maximum of box A,
+	// the high four lanes the minimum of box A to the maximum bounds of the boxes.
+	// A value is not greater than the other if their saturated difference is zero.
+	__m128i excess = _mm_setzero_si128();
+	for (int i = 0; i < 3; ++i)
+	{
+		const __m128i lo = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)bmin[i]), _mm_set1_epi16((short)amin[i]));
+		const __m128i hi = _mm_unpacklo_epi64(_mm_set1_epi16((short)amax[i]), _mm_loadl_epi64((const __m128i*)bmax[i]));
+		excess = _mm_or_si128(excess, _mm_subs_epu16(lo, hi));
+	}
+	excess = _mm_or_si128(excess, _mm_unpackhi_epi64(excess, excess));
+	const __m128i overlap = _mm_cmpeq_epi16(excess, _mm_setzero_si128());
+	return (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(overlap, overlap)) & 0xf;
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (amin[0] > bmax[0][i] || amax[0] < bmin[0][i]) continue;
+		if (amin[1] > bmax[1][i] || amax[1] < bmin[1][i]) continue;
+		if (amin[2] > bmax[2][i] || amax[2] < bmin[2][i]) continue;
+		mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
 static void projectPoly(const float* axis, const float* poly, const int npoly,
 						float& rmin, float& rmax)
 {
@@ -27,6 +27,10 @@
 #include "DetourAssert.h"
 #include <new>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 
 inline bool overlapSlabs(const float* amin, const float* amax,
 						 const float* bmin, const float* bmax,
@@ -134,6 +138,35 @@ inline void freeLink(dtMeshTile* tile, unsigned int link)
 	tile->linksFreeList = link;
 }
 
+// Full memory barrier, used to order the tile updates against the concurrent readers.
+inline void dtMemoryBarrier()
+{
+#if defined(_MSC_VER) && defined(_M_ARM64)
+	__dmb(_ARM64_BARRIER_ISH);
+#elif defined(_MSC_VER) && defined(_M_ARM)
+	__dmb(_ARM_BARRIER_ISH);
+#elif defined(_MSC_VER)
+	_mm_mfence();
+#else
+	__sync_synchronize();
+#endif
+}
+
+/// The read section state of a concurrent reader.
+struct dtNavMeshReader
+{
+	volatile unsigned int epoch;					///< The epoch at the start of the read section, or zero when not reading.
+	unsigned char pad[64 - sizeof(unsigned int)];	///< Keeps the readers on separate cache lines.
+};
+
+/// A removed tile or link waiting to be released.
+struct dtRetiredItem
+{
+	unsigned int epoch;		///< The epoch at which the item was removed.
+	int tileIndex;			///< The index of the tile.
+	unsigned int link;		///< The index of the link, or #DT_NULL_LINK for the whole tile.
+};
+
 
 dtNavMesh* dtAllocNavMesh()
 {
@@ -181,6 +214,8 @@ Notes:
   to have only a single tile.
 - This class does not implement any asynchronous methods. So the ::dtStatus result of all methods will 
   always contain either a success or failure flag.
+- Tiles can be added and removed while other threads are querying the navigation mesh when concurrent
+  reads are enabled. (See #initConcurrentReads.)
 
 @see dtNavMeshQuery, dtCreateNavMeshData, dtNavMeshCreateParams, #dtAllocNavMesh, #dtFreeNavMesh
 */
@@ -193,7 +228,13 @@ dtNavMesh::dtNavMesh() :
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_readers(0),
+	m_maxReaders(0),
+	m_epoch(1),
+	m_retired(0),
+	m_retiredCount(0),
+	m_retiredCapacity(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -219,6 +260,8 @@ dtNavMesh::~dtNavMesh()
 	}
 	dtFree(m_posLookup);
 	dtFree(m_tiles);
+	dtFree(m_readers);
+	dtFree(m_retired);
 }
 		
 dtStatus dtNavMesh::init(const dtNavMeshParams* params)
@@ -371,7 +414,12 @@ void dtNavMesh::unconnectLinks(dtMeshTile* tile, dtMeshTile* target)
 					poly->firstLink = nj;
 				else
 					tile->links[pj].next = nj;
-				freeLink(tile, j);
+				// Concurrent readers may still be following the link, so it is
+				// released later. If that fails, the link is lost until the tile is re-added.
+				if (m_readers)
+					retire(tile, j);
+				else
+					freeLink(tile, j);
 				j = nj;
 			}
 			else
@@ -422,9 +470,6 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 					link->ref = nei[k];
 					link->edge = (unsigned char)j;
 					link->side = (unsigned char)dir;
-					
-					link->next = poly->firstLink;
-					poly->firstLink = idx;
 
 					// Compress portal limits to a byte value.
 					if (dir == 0 || dir == 4)
@@ -445,6 +490,12 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 						link->bmin = (unsigned char)roundf(dtClamp(tmin, 0.0f, 1.0f)*255.0f);
 						link->bmax = (unsigned char)roundf(dtClamp(tmax, 0.0f, 1.0f)*255.0f);
 					}
+
+					// Add to linked list once the link is complete, concurrent readers may already see the tile.
+					link->next = poly->firstLink;
+					if (m_readers)
+						dtMemoryBarrier();
+					poly->firstLink = idx;
 				}
 			}
 		}
@@ -496,6 +547,8 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 			link->bmin = link->bmax = 0;
 			// Add to linked list.
 			link->next = targetPoly->firstLink;
+			if (m_readers)
+				dtMemoryBarrier();
 			targetPoly->firstLink = idx;
 		}
 		
@@ -514,6 +567,8 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 				link->bmin = link->bmax = 0;
 				// Add to linked list.
 				link->next = landPoly->firstLink;
+				if (m_readers)
+					dtMemoryBarrier();
 				landPoly->firstLink = tidx;
 			}
 		}
@@ -808,10 +863,8 @@ dtPolyRef dtNavMesh::findNearestPolyInTile(const dtMeshTile* tile,
 int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 								   dtPolyRef* polys, const int maxPolys) const
 {
-	if (tile->bvTree)
+	if (tile->bvTree || tile->bvWideTree)
 	{
-		const dtBVNode* node = &tile->bvTree[0];
-		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
 		const float* tbmin = tile->header->bmin;
 		const float* tbmax = tile->header->bmax;
 		const float qfac = tile->header->bvQuantFactor;
@@ -836,23 +889,52 @@ int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, co
 		// Traverse tree
 		dtPolyRef base = getPolyRefBase(tile);
 		int n = 0;
-		while (node < end)
+		if (tile->bvWideTree)
 		{
-			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
-			const bool isLeafNode = node->i >= 0;
-			
-			if (isLeafNode && overlap)
+			// The children are pushed in reverse, so that the polygons are found in the same order as in the binary tree.
+			int stack[DT_BVWIDE_STACK_SIZE];
+			int nstack = 0;
+			stack[nstack++] = 0;
+			while (nstack > 0)
 			{
-				if (n < maxPolys)
-					polys[n++] = base | (dtPolyRef)node->i;
+				const int index = stack[--nstack];
+				if (index < 0)
+				{
+					if (n < maxPolys)
+						polys[n++] = base | (dtPolyRef)(-1 - index);
+					continue;
+				}
+				const dtBVWideNode* node = &tile->bvWideTree[index];
+				const unsigned int overlap = dtOverlapQuantBounds4(bmin, bmax, node->bmin, node->bmax);
+				for (int i = 3; i >= 0; --i)
+				{
+					if ((overlap & (1u << i)) && node->child[i] != 0)
+						stack[nstack++] = node->child[i];
+				}
 			}
-			
-			if (overlap || isLeafNode)
-				node++;
-			else
+		}
+		else
+		{
+			const dtBVNode* node = &tile->bvTree[0];
+			const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+			while (node < end)
 			{
-				const int escapeIndex = -node->i;
-				node += escapeIndex;
+				const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+				const bool isLeafNode = node->i >= 0;
+			
+				if (isLeafNode && overlap)
+				{
+					if (n < maxPolys)
+						polys[n++] = base | (dtPolyRef)node->i;
+				}
+			
+				if (overlap || isLeafNode)
+					node++;
+				else
+				{
+					const int escapeIndex = -node->i;
+					node += escapeIndex;
+				}
 			}
 		}
 		
@@ -925,6 +1007,10 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	// Make sure the location is free.
 	if (getTileAt(header->x, header->y, header->layer))
 		return DT_FAILURE | DT_ALREADY_OCCUPIED;
+
+	// Recycle the tiles which are not used by concurrent readers anymore.
+	if (m_retiredCount)
+		reclaimRemovedTiles();
 		
 	// Allocate a tile.
 	dtMeshTile* tile = 0;
@@ -969,11 +1055,6 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	if (!tile)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
-	// Insert tile into the position lut.
-	int h = computeTileHash(header->x, header->y, m_tileLutMask);
-	tile->next = m_posLookup[h];
-	m_posLookup[h] = tile;
-	
 	// Patch header pointers.
 	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
 	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
@@ -982,7 +1063,8 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
 	const int detailVertsSize = dtAlign4(sizeof(float)*3*header->detailVertCount);
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
-	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
+	const bool wideBvTree = (header->flags & DT_MESH_HEADER_WIDE_BVTREE) != 0;
+	const int bvtreeSize = wideBvTree ? dtAlign4(sizeof(dtBVWideNode)*header->bvNodeCount) : dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
 	
 	unsigned char* d = data + headerSize;
@@ -992,12 +1074,12 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	tile->detailMeshes = dtGetThenAdvanceBufferPointer<dtPolyDetail>(d, detailMeshesSize);
 	tile->detailVerts = dtGetThenAdvanceBufferPointer<float>(d, detailVertsSize);
 	tile->detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
-	tile->bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
+	unsigned char* bvTree = dtGetThenAdvanceBufferPointer<unsigned char>(d, bvtreeSize);
 	tile->offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
 
-	// If there are no items in the bvtree, reset the tree pointer.
-	if (!bvtreeSize)
-		tile->bvTree = 0;
+	// Only the pointer of the stored tree type is set, and neither if there are no items in the bvtree.
+	tile->bvTree = bvtreeSize && !wideBvTree ? (dtBVNode*)bvTree : 0;
+	tile->bvWideTree = bvtreeSize && wideBvTree ? (dtBVWideNode*)bvTree : 0;
 
 	// Build links freelist
 	tile->linksFreeList = 0;
@@ -1047,6 +1129,14 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 			connectExtOffMeshLinks(neis[j], tile, dtOppositeTile(i));
 		}
 	}
+
+	// Insert tile into the position lut.
+	// This is done last, so that concurrent readers only find completely connected tiles.
+	int h = computeTileHash(header->x, header->y, m_tileLutMask);
+	tile->next = m_posLookup[h];
+	if (m_readers)
+		dtMemoryBarrier();
+	m_posLookup[h] = tile;
 	
 	if (result)
 		*result = getTileRef(tile);
@@ -1248,6 +1338,10 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	dtMeshTile* tile = &m_tiles[tileIndex];
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Make sure the tile can be released later before changing anything.
+	if (m_readers && !retire(tile, DT_NULL_LINK))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	// Remove tile from hash lookup.
 	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
@@ -1288,13 +1382,9 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 			unconnectLinks(neis[j], tile);
 	}
 		
-	// Reset tile.
 	if (tile->flags & DT_TILE_FREE_DATA)
 	{
 		// Owns data
-		dtFree(tile->data);
-		tile->data = 0;
-		tile->dataSize = 0;
 		if (data) *data = 0;
 		if (dataSize) *dataSize = 0;
 	}
@@ -1304,6 +1394,30 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 		if (dataSize) *dataSize = tile->dataSize;
 	}
 
+	if (m_readers)
+	{
+		// Concurrent readers may still be using the tile, it is reset once they are done.
+		// Invalidate the references to the tile right away, so that new read sections cannot find it.
+		incrementTileSalt(tile);
+
+		// Publish the changes before moving on to the next epoch.
+		dtMemoryBarrier();
+		m_epoch = (m_epoch + 1) ? (m_epoch + 1) : 1;
+		return DT_SUCCESS;
+	}
+
+	resetTile(tile);
+
+	return DT_SUCCESS;
+}
+
+void dtNavMesh::resetTile(dtMeshTile* tile)
+{
+	if (tile->flags & DT_TILE_FREE_DATA)
+		dtFree(tile->data);
+	tile->data = 0;
+	tile->dataSize = 0;
+
 	tile->header = 0;
 	tile->flags = 0;
 	tile->linksFreeList = 0;
@@ -1314,8 +1428,18 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	tile->detailVerts = 0;
 	tile->detailTris = 0;
 	tile->bvTree = 0;
+	tile->bvWideTree = 0;
 	tile->offMeshCons = 0;
 
+	incrementTileSalt(tile);
+
+	// Add to free list.
+	tile->next = m_nextFree;
+	m_nextFree = tile;
+}
+
+void dtNavMesh::incrementTileSalt(dtMeshTile* tile)
+{
 	// Update salt, salt should never be zero.
 #ifdef DT_POLYREF64
 	tile->salt = (tile->salt+1) & ((1<<DT_SALT_BITS)-1);
@@ -1324,14 +1448,143 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 #endif
 	if (tile->salt == 0)
 		tile->salt++;
+}
 
-	// Add to free list.
-	tile->next = m_nextFree;
-	m_nextFree = tile;
+/// @par
+///
+/// By default the navigation mesh must not be accessed while tiles are added or removed.
+/// Once concurrent reads are enabled, queries may run on up to @p maxReaders other threads
+/// while a single thread adds and removes tiles. Each reader wraps its queries in
+/// #beginRead and #endRead.
+///
+/// Tiles are connected to their neighbours before they become visible, and removed tiles
+/// are kept intact until all read sections which started before the removal have ended.
+/// The removed tiles and links are recycled by #reclaimRemovedTiles, which is also called
+/// by #addTile.
+///
+/// Must be called before any reader starts. Concurrent reads cannot be disabled again.
+///
+/// @see beginRead, endRead, reclaimRemovedTiles
+dtStatus dtNavMesh::initConcurrentReads(const int maxReaders)
+{
+	if (maxReaders <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtNavMeshReader* readers = (dtNavMeshReader*)dtAlloc(sizeof(dtNavMeshReader)*maxReaders, DT_ALLOC_PERM);
+	if (!readers)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(readers, 0, sizeof(dtNavMeshReader)*maxReaders);
+
+	dtFree(m_readers);
+	m_readers = readers;
+	m_maxReaders = maxReaders;
 
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// The tiles, polygons and links found during a read section stay valid until
+/// the section ends, even if the tile is removed in the meantime. Pointers must not be
+/// kept across read sections, and references from an earlier section should be
+/// validated again, e.g. with #isValidPolyRef.
+///
+/// Read sections of the same reader cannot be nested.
+///
+/// @see endRead
+void dtNavMesh::beginRead(const int reader)
+{
+	dtAssert(m_readers);
+	dtAssert(reader >= 0 && reader < m_maxReaders);
+	dtAssert(m_readers[reader].epoch == 0);
+
+	m_readers[reader].epoch = m_epoch;
+	// Make the reader visible before accessing any tiles.
+	dtMemoryBarrier();
+}
+
+void dtNavMesh::endRead(const int reader)
+{
+	dtAssert(m_readers);
+	dtAssert(reader >= 0 && reader < m_maxReaders);
+
+	// Finish all reads before leaving the section.
+	dtMemoryBarrier();
+	m_readers[reader].epoch = 0;
+}
+
+/// @par
+///
+/// Must be called from the thread adding and removing the tiles.
+///
+/// The data of a removed tile which is not owned by the navigation mesh (see #DT_TILE_FREE_DATA)
+/// must not be freed before the tile has been reclaimed, i.e. before this function returns zero.
+///
+/// @see initConcurrentReads
+int dtNavMesh::reclaimRemovedTiles()
+{
+	if (!m_retiredCount)
+		return 0;
+
+	// Find the oldest epoch which is still being read.
+	dtMemoryBarrier();
+	bool reading = false;
+	unsigned int oldest = 0;
+	for (int i = 0; i < m_maxReaders; ++i)
+	{
+		const unsigned int epoch = m_readers[i].epoch;
+		if (!epoch)
+			continue;
+		if (!reading || (int)(epoch - oldest) < 0)
+			oldest = epoch;
+		reading = true;
+	}
+
+	// Release the items which were removed before the oldest read section started.
+	int n = 0;
+	while (n < m_retiredCount)
+	{
+		const dtRetiredItem& item = m_retired[n];
+		if (reading && (int)(item.epoch - oldest) >= 0)
+			break;
+		dtMeshTile* tile = &m_tiles[item.tileIndex];
+		if (item.link == DT_NULL_LINK)
+			resetTile(tile);
+		else
+			freeLink(tile, item.link);
+		n++;
+	}
+
+	m_retiredCount -= n;
+	if (n && m_retiredCount)
+		memmove(m_retired, m_retired + n, sizeof(dtRetiredItem)*m_retiredCount);
+
+	return m_retiredCount;
+}
+
+bool dtNavMesh::retire(dtMeshTile* tile, unsigned int link)
+{
+	if (m_retiredCount >= m_retiredCapacity)
+	{
+		const int capacity = m_retiredCapacity ? m_retiredCapacity*2 : 64;
+		dtRetiredItem* items = (dtRetiredItem*)dtAlloc(sizeof(dtRetiredItem)*capacity, DT_ALLOC_PERM);
+		if (!items)
+			return false;
+		if (m_retiredCount)
+			memcpy(items, m_retired, sizeof(dtRetiredItem)*m_retiredCount);
+		dtFree(m_retired);
+		m_retired = items;
+		m_retiredCapacity = capacity;
+	}
+
+	dtRetiredItem& item = m_retired[m_retiredCount++];
+	item.epoch = m_epoch;
+	item.tileIndex = (int)(tile - m_tiles);
+	item.link = link;
+
+	return true;
+}
+
 dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
@@ -240,6 +240,114 @@ static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nn
 	return curNode;
 }
 
+// The left child of an inner node directly follows it.
+static int getRightChild(const dtBVNode* tree, const int node)
+{
+	const int left = node + 1;
+	return tree[left].i >= 0 ? left + 1 : left - tree[left].i;
+}
+
+static float calcHalfSurfaceArea(const dtBVNode& node)
+{
+	const float dx = (float)(node.bmax[0] - node.bmin[0]);
+	const float dy = (float)(node.bmax[1] - node.bmin[1]);
+	const float dz = (float)(node.bmax[2] - node.bmin[2]);
+	return dx*dy + dy*dz + dz*dx;
+}
+
+static int collapseBVTree(const dtBVNode* tree, const int root, int& curNode, dtBVWideNode* nodes)
+{
+	// Gather up to four children by opening the largest inner nodes below the root.
+	// Opened nodes are replaced by their children in place, which keeps the leaves in the same order.
+	int children[4];
+	int nchildren = 0;
+	if (tree[root].i >= 0)
+	{
+		children[nchildren++] = root;
+	}
+	else
+	{
+		children[nchildren++] = root + 1;
+		children[nchildren++] = getRightChild(tree, root);
+		while (nchildren < 4)
+		{
+			int best = -1;
+			float bestArea = -1.0f;
+			for (int j = 0; j < nchildren; ++j)
+			{
+				if (tree[children[j]].i >= 0)
+					continue;
+				const float area = calcHalfSurfaceArea(tree[children[j]]);
+				if (area > bestArea)
+				{
+					best = j;
+					bestArea = area;
+				}
+			}
+			if (best == -1)
+				break;
+			const int opened = children[best];
+			for (int j = nchildren; j > best + 1; --j)
+				children[j] = children[j-1];
+			children[best] = opened + 1;
+			children[best+1] = getRightChild(tree, opened);
+			nchildren++;
+		}
+	}
+
+	const int icur = curNode++;
+	dtBVWideNode& node = nodes[icur];
+	for (int j = 0; j < 4; ++j)
+	{
+		if (j < nchildren)
+		{
+			const dtBVNode& child = tree[children[j]];
+			for (int k = 0; k < 3; ++k)
+			{
+				node.bmin[k][j] = child.bmin[k];
+				node.bmax[k][j] = child.bmax[k];
+			}
+			node.child[j] = child.i >= 0 ? -1 - child.i : collapseBVTree(tree, children[j], curNode, nodes);
+		}
+		else
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				node.bmin[k][j] = 0xffff;
+				node.bmax[k][j] = 0;
+			}
+			node.child[j] = 0;
+		}
+	}
+
+	return icur;
+}
+
+/// Builds a four-wide tree by collapsing the binary tree, so that queries find the polygons in the same order.
+/// The nodes are allocated with the temp allocator, as the node count is only known once they are built.
+static bool createWideBVTree(dtNavMeshCreateParams* params, dtBVWideNode** outNodes, int* outNodeCount)
+{
+	dtBVNode* tree = (dtBVNode*)dtAlloc(sizeof(dtBVNode)*params->polyCount*2, DT_ALLOC_TEMP);
+	// Every node has at least two children, except a root with a single leaf.
+	const int maxNodes = dtMax(params->polyCount - 1, 1);
+	dtBVWideNode* nodes = (dtBVWideNode*)dtAlloc(sizeof(dtBVWideNode)*maxNodes, DT_ALLOC_TEMP);
+	if (!tree || !nodes)
+	{
+		dtFree(tree);
+		dtFree(nodes);
+		return false;
+	}
+
+	createBVTree(params, tree, 2*params->polyCount);
+	int curNode = 0;
+	collapseBVTree(tree, 0, curNode, nodes);
+	dtFree(tree);
+
+	*outNodes = nodes;
+	*outNodeCount = curNode;
+	return true;
+}
+
 static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, const float* bmax)
 {
 	static const unsigned char XP = 1<<0;
@@ -423,6 +531,17 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 		}
 	}
 	
+	// The wide BVtree is built up front, as its size depends on the tree.
+	dtBVWideNode* wideBvNodes = 0;
+	int wideBvNodeCount = 0;
+	const bool buildWideBvTree = params->buildBvTree && params->buildWideBvTree;
+	if (buildWideBvTree && !createWideBVTree(params, &wideBvNodes, &wideBvNodeCount))
+	{
+		dtFree(offMeshConClass);
+		return false;
+	}
+	const int bvNodeCount = buildWideBvTree ? wideBvNodeCount : params->buildBvTree ? params->polyCount*2 : 0;
+
 	// Calculate data size
 	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
 	const int vertsSize = dtAlign4(sizeof(float)*3*totVertCount);
@@ -431,7 +550,7 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*params->polyCount);
 	const int detailVertsSize = dtAlign4(sizeof(float)*3*uniqueDetailVertCount);
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*detailTriCount);
-	const int bvTreeSize = params->buildBvTree ? dtAlign4(sizeof(dtBVNode)*params->polyCount*2) : 0;
+	const int bvTreeSize = buildWideBvTree ? dtAlign4(sizeof(dtBVWideNode)*bvNodeCount) : dtAlign4(sizeof(dtBVNode)*bvNodeCount);
 	const int offMeshConsSize = dtAlign4(sizeof(dtOffMeshConnection)*storedOffMeshConCount);
 	
 	const int dataSize = headerSize + vertsSize + polysSize + linksSize +
@@ -441,6 +560,7 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	unsigned char* data = (unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
 	if (!data)
 	{
+		dtFree(wideBvNodes);
 		dtFree(offMeshConClass);
 		return false;
 	}
@@ -455,7 +575,7 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	dtPolyDetail* navDMeshes = dtGetThenAdvanceBufferPointer<dtPolyDetail>(d, detailMeshesSize);
 	float* navDVerts = dtGetThenAdvanceBufferPointer<float>(d, detailVertsSize);
 	unsigned char* navDTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
-	dtBVNode* navBvtree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvTreeSize);
+	unsigned char* navBvtree = dtGetThenAdvanceBufferPointer<unsigned char>(d, bvTreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshConsSize);
 	
 	
@@ -480,7 +600,8 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	header->walkableRadius = params->walkableRadius;
 	header->walkableClimb = params->walkableClimb;
 	header->offMeshConCount = storedOffMeshConCount;
-	header->bvNodeCount = params->buildBvTree ? params->polyCount*2 : 0;
+	header->bvNodeCount = bvNodeCount;
+	header->flags = buildWideBvTree ? DT_MESH_HEADER_WIDE_BVTREE : 0;
 	
 	const int offMeshVertsBase = params->vertCount;
 	const int offMeshPolyBase = params->polyCount;
@@ -622,9 +743,14 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	}
 
 	// Store and create BVtree.
-	if (params->buildBvTree)
+	if (buildWideBvTree)
 	{
-		createBVTree(params, navBvtree, 2*params->polyCount);
+		memcpy(navBvtree, wideBvNodes, sizeof(dtBVWideNode)*wideBvNodeCount);
+		dtFree(wideBvNodes);
+	}
+	else if (params->buildBvTree)
+	{
+		createBVTree(params, (dtBVNode*)navBvtree, 2*params->polyCount);
 	}
 	
 	// Store Off-Mesh connections.
@@ -697,6 +823,7 @@ bool dtNavMeshHeaderSwapEndian(unsigned char* data, const int /*dataSize*/)
 	dtSwapEndian(&header->bmax[1]);
 	dtSwapEndian(&header->bmax[2]);
 	dtSwapEndian(&header->bvQuantFactor);
+	dtSwapEndian(&header->flags);
 
 	// Freelist index and pointers are updated when tile is added, no need to swap.
 
@@ -726,7 +853,8 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
 	const int detailVertsSize = dtAlign4(sizeof(float)*3*header->detailVertCount);
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
-	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
+	const bool wideBvTree = (header->flags & DT_MESH_HEADER_WIDE_BVTREE) != 0;
+	const int bvtreeSize = wideBvTree ? dtAlign4(sizeof(dtBVWideNode)*header->bvNodeCount) : dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
 	
 	unsigned char* d = data + headerSize;
@@ -738,7 +866,7 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	float* detailVerts = dtGetThenAdvanceBufferPointer<float>(d, detailVertsSize);
 	d += detailTrisSize; // Ignore detail tris; single bytes can't be endian-swapped.
 	//unsigned char* detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
-	dtBVNode* bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
+	unsigned char* bvTree = dtGetThenAdvanceBufferPointer<unsigned char>(d, bvtreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
 	
 	// Vertices
@@ -777,15 +905,34 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	}
 
 	// BV-tree
-	for (int i = 0; i < header->bvNodeCount; ++i)
+	if (wideBvTree)
+	{
+		for (int i = 0; i < header->bvNodeCount; ++i)
+		{
+			dtBVWideNode* node = &((dtBVWideNode*)bvTree)[i];
+			for (int j = 0; j < 4; ++j)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					dtSwapEndian(&node->bmin[k][j]);
+					dtSwapEndian(&node->bmax[k][j]);
+				}
+				dtSwapEndian(&node->child[j]);
+			}
+		}
+	}
+	else
 	{
-		dtBVNode* node = &bvTree[i];
-		for (int j = 0; j < 3; ++j)
+		for (int i = 0; i < header->bvNodeCount; ++i)
 		{
-			dtSwapEndian(&node->bmin[j]);
-			dtSwapEndian(&node->bmax[j]);
+			dtBVNode* node = &((dtBVNode*)bvTree)[i];
+			for (int j = 0; j < 3; ++j)
+			{
+				dtSwapEndian(&node->bmin[j]);
+				dtSwapEndian(&node->bmax[j]);
+			}
+			dtSwapEndian(&node->i);
 		}
-		dtSwapEndian(&node->i);
 	}
 
 	// Off-mesh Connections.
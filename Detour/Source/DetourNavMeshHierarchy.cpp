@@ -0,0 +1,826 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "DetourNavMeshHierarchy.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+static const int MIN_PORTAL_BITS = 8;		// Min number of bits for the portal index in the abstract node ids.
+static const dtPolyRef GOAL_NODE_ID = ~(dtPolyRef)0;
+static const float PORTAL_MERGE_EPS = 1e-3f;
+
+dtNavMeshHierarchy* dtAllocNavMeshHierarchy()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshHierarchy), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshHierarchy;
+}
+
+void dtFreeNavMeshHierarchy(dtNavMeshHierarchy* hierarchy)
+{
+	if (!hierarchy) return;
+	hierarchy->~dtNavMeshHierarchy();
+	dtFree(hierarchy);
+}
+
+namespace
+{
+	/// A boundary link of a tile, before the links are grouped into portals.
+	struct dtBorderLink
+	{
+		dtPolyRef ref;
+		dtPolyRef neiRef;
+		unsigned int neiTile;
+		float pos[3];
+		float bmin, bmax;
+		unsigned char side;
+	};
+
+	int compareBorderLinks(const void* va, const void* vb)
+	{
+		const dtBorderLink* a = (const dtBorderLink*)va;
+		const dtBorderLink* b = (const dtBorderLink*)vb;
+		if (a->side != b->side)
+			return a->side < b->side ? -1 : 1;
+		if (a->neiTile != b->neiTile)
+			return a->neiTile < b->neiTile ? -1 : 1;
+		if (a->bmin != b->bmin)
+			return a->bmin < b->bmin ? -1 : 1;
+		return 0;
+	}
+
+	/// Returns the axis along which the specified tile side runs.
+	int getSideAxis(unsigned char side)
+	{
+		return (side == 0 || side == 4) ? 2 : 0;
+	}
+
+	/// Calculates the position where a search moves from @p poly to its neighbour through @p link.
+	void getLinkMidPoint(const dtMeshTile* tile, const dtPoly* poly, const dtLink& link,
+						 dtPolyRef ref, const dtMeshTile* neiTile, const dtPoly* neiPoly, float* mid)
+	{
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+		{
+			dtVcopy(mid, &tile->verts[poly->verts[link.edge]*3]);
+			return;
+		}
+		if (neiPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+		{
+			// The link to an off-mesh connection does not have an edge, use the connection end point instead.
+			for (unsigned int i = neiPoly->firstLink; i != DT_NULL_LINK; i = neiTile->links[i].next)
+			{
+				if (neiTile->links[i].ref == ref)
+				{
+					dtVcopy(mid, &neiTile->verts[neiPoly->verts[neiTile->links[i].edge]*3]);
+					return;
+				}
+			}
+			dtVcopy(mid, &neiTile->verts[neiPoly->verts[0]*3]);
+			return;
+		}
+
+		const float* va = &tile->verts[poly->verts[link.edge]*3];
+		const float* vb = &tile->verts[poly->verts[(link.edge+1) % (int)poly->vertCount]*3];
+		if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+		{
+			// Boundary links may only cover a part of the edge.
+			const float s = 1.0f/255.0f;
+			float left[3], right[3];
+			dtVlerp(left, va, vb, link.bmin*s);
+			dtVlerp(right, va, vb, link.bmax*s);
+			dtVlerp(mid, left, right, 0.5f);
+		}
+		else
+		{
+			dtVlerp(mid, va, vb, 0.5f);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/// @class dtNavMeshHierarchy
+///
+/// Long paths over large tiled navigation meshes visit far more polygons
+/// than a single node pool can hold. The hierarchy keeps an abstract graph
+/// with a cluster per tile: the boundary links of a tile are grouped into
+/// portals, one per connected stretch of border shared with a neighbour
+/// tile, and the costs between the portals of a tile are found when the tile
+/// is added. #findPath searches this graph first, and then refines the
+/// result by searching the polygons between consecutive portals, which
+/// keeps every polygon search small.
+///
+/// The hierarchy does not observe the navigation mesh. Call #addTile after
+/// adding a tile to the navigation mesh, and #removeTile after removing one.
+/// Clusters of tiles which changed without notifying the hierarchy are
+/// ignored by the abstract search.
+///
+/// The abstract costs are estimates, so the refined path is not always the
+/// shortest one. Off-mesh connections between tiles are not part of the
+/// abstract graph. The costs of the default filter are assumed, where the
+/// cost of a move is at least its length and moves in both directions cost
+/// the same.
+///
+/// @see dtNavMesh, dtNavMeshQuery, #dtAllocNavMeshHierarchy, #dtFreeNavMeshHierarchy
+
+dtNavMeshHierarchy::dtNavMeshHierarchy() :
+	m_nav(0),
+	m_filter(0),
+	m_clusters(0),
+	m_maxClusters(0),
+	m_portalBits(0),
+	m_tileNodePool(0),
+	m_tileOpenList(0),
+	m_nodePool(0),
+	m_openList(0),
+	m_startCosts(0),
+	m_endCosts(0),
+	m_maxPortals(0),
+	m_portalPath(0)
+{
+}
+
+dtNavMeshHierarchy::~dtNavMeshHierarchy()
+{
+	for (int i = 0; i < m_maxClusters; ++i)
+		clearCluster(&m_clusters[i]);
+	dtFree(m_clusters);
+
+	if (m_tileNodePool)
+		m_tileNodePool->~dtNodePool();
+	if (m_tileOpenList)
+		m_tileOpenList->~dtNodeQueue();
+	if (m_nodePool)
+		m_nodePool->~dtNodePool();
+	if (m_openList)
+		m_openList->~dtNodeQueue();
+	dtFree(m_tileNodePool);
+	dtFree(m_tileOpenList);
+	dtFree(m_nodePool);
+	dtFree(m_openList);
+	dtFree(m_startCosts);
+	dtFree(m_endCosts);
+	dtFree(m_portalPath);
+}
+
+/// @par
+///
+/// Must be the first function called after construction, before other
+/// functions are used. The filter must stay valid as long as the hierarchy
+/// is used.
+dtStatus dtNavMeshHierarchy::init(const dtNavMesh* nav, const dtQueryFilter* filter, const int maxNodes)
+{
+	if (!nav || !filter || maxNodes <= 0 || maxNodes > DT_MAX_POOL_NODES)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// The tile and portal indices of the abstract nodes must fit in a polygon reference,
+	// the portal index gets the bits not needed for the tile index. The top bit is kept
+	// clear, so that no node id is the id of the goal node, and the portal count fits in an int.
+	const int maxTiles = nav->getMaxTiles();
+	const int portalBits = (int)sizeof(dtPolyRef)*8 - 1 - (int)dtIlog2(dtNextPow2((unsigned int)maxTiles));
+	if (portalBits < MIN_PORTAL_BITS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	m_portalBits = dtMin(portalBits, 30);
+
+	m_clusters = (dtHierarchyCluster*)dtAlloc(sizeof(dtHierarchyCluster)*maxTiles, DT_ALLOC_PERM);
+	if (!m_clusters)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_clusters, 0, sizeof(dtHierarchyCluster)*maxTiles);
+	m_maxClusters = maxTiles;
+
+	// The searches within a tile visit each polygon of the tile at most once.
+	const int maxTileNodes = dtMin(nav->getParams()->maxPolys, DT_MAX_POOL_NODES);
+	m_tileNodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxTileNodes, dtNextPow2(maxTileNodes/4));
+	m_tileOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxTileNodes);
+	m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+	m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+	m_portalPath = (const dtHierarchyPortal**)dtAlloc(sizeof(dtHierarchyPortal*)*maxNodes, DT_ALLOC_PERM);
+	if (!m_tileNodePool || !m_tileOpenList || !m_nodePool || !m_openList || !m_portalPath)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	m_nav = nav;
+	m_filter = filter;
+
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!tile->header)
+			continue;
+		const dtStatus status = buildCluster(tile);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	return DT_SUCCESS;
+}
+
+void dtNavMeshHierarchy::clearCluster(dtHierarchyCluster* cluster)
+{
+	dtFree(cluster->portals);
+	memset(cluster, 0, sizeof(dtHierarchyCluster));
+}
+
+dtStatus dtNavMeshHierarchy::buildCluster(const dtMeshTile* tile)
+{
+	const dtTileRef tileRef = m_nav->getTileRef(tile);
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(tileRef);
+	dtHierarchyCluster* cluster = &m_clusters[tileIndex];
+	clearCluster(cluster);
+	cluster->ref = tileRef;
+	cluster->x = tile->header->x;
+	cluster->y = tile->header->y;
+
+	// Collect the links to the neighbour tiles.
+	int linkCount = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			if (tile->links[j].side != 0xff)
+				linkCount++;
+		}
+	}
+	if (!linkCount)
+		return DT_SUCCESS;
+
+	dtBorderLink* links = (dtBorderLink*)dtAlloc(sizeof(dtBorderLink)*linkCount, DT_ALLOC_TEMP);
+	if (!links)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	int n = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtLink& link = tile->links[j];
+			if (link.side == 0xff)
+				continue;
+			const dtMeshTile* neiTile = 0;
+			const dtPoly* neiPoly = 0;
+			if (dtStatusFailed(m_nav->getTileAndPolyByRef(link.ref, &neiTile, &neiPoly)) ||
+				neiPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+
+			dtBorderLink& bl = links[n++];
+			bl.ref = base | (dtPolyRef)i;
+			bl.neiRef = link.ref;
+			bl.neiTile = m_nav->decodePolyIdTile(link.ref);
+			bl.side = link.side;
+			getLinkMidPoint(tile, poly, link, bl.ref, neiTile, neiPoly, bl.pos);
+
+			const int axis = getSideAxis(link.side);
+			const float* va = &tile->verts[poly->verts[link.edge]*3];
+			const float* vb = &tile->verts[poly->verts[(link.edge+1) % (int)poly->vertCount]*3];
+			const float s = 1.0f/255.0f;
+			const float t0 = va[axis] + (vb[axis] - va[axis]) * link.bmin*s;
+			const float t1 = va[axis] + (vb[axis] - va[axis]) * link.bmax*s;
+			bl.bmin = dtMin(t0, t1);
+			bl.bmax = dtMax(t0, t1);
+		}
+	}
+
+	if (!n)
+	{
+		dtFree(links);
+		return DT_SUCCESS;
+	}
+	qsort(links, n, sizeof(dtBorderLink), compareBorderLinks);
+
+	// Group the links into portals, each covering a connected stretch of a side.
+	// The longest link of the stretch represents the portal.
+	dtHierarchyPortal* portals = (dtHierarchyPortal*)dtAlloc(sizeof(dtHierarchyPortal)*n, DT_ALLOC_TEMP);
+	if (!portals)
+	{
+		dtFree(links);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	int portalCount = 0;
+	float bestLength = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		const dtBorderLink& bl = links[i];
+		const float length = bl.bmax - bl.bmin;
+		dtHierarchyPortal* portal = portalCount > 0 ? &portals[portalCount-1] : 0;
+		if (portal && i > 0 && links[i-1].side == bl.side && links[i-1].neiTile == bl.neiTile &&
+			bl.bmin <= portal->bmax + PORTAL_MERGE_EPS)
+		{
+			portal->bmax = dtMax(portal->bmax, bl.bmax);
+			if (length > bestLength)
+			{
+				portal->ref = bl.ref;
+				portal->neiRef = bl.neiRef;
+				dtVcopy(portal->pos, bl.pos);
+				bestLength = length;
+			}
+			continue;
+		}
+		portal = &portals[portalCount++];
+		portal->ref = bl.ref;
+		portal->neiRef = bl.neiRef;
+		dtVcopy(portal->pos, bl.pos);
+		portal->bmin = bl.bmin;
+		portal->bmax = bl.bmax;
+		portal->side = bl.side;
+		bestLength = length;
+	}
+
+	dtFree(links);
+
+	// The portal index must fit in the abstract node ids.
+	if (portalCount > (1 << m_portalBits))
+	{
+		dtFree(portals);
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// Grow the costs of the start and end portals of the abstract search to the largest cluster.
+	if (portalCount > m_maxPortals)
+	{
+		dtFree(m_startCosts);
+		dtFree(m_endCosts);
+		m_startCosts = (float*)dtAlloc(sizeof(float)*portalCount, DT_ALLOC_PERM);
+		m_endCosts = (float*)dtAlloc(sizeof(float)*portalCount, DT_ALLOC_PERM);
+		m_maxPortals = (m_startCosts && m_endCosts) ? portalCount : 0;
+		if (!m_maxPortals)
+		{
+			dtFree(portals);
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+	}
+
+	const int dataSize = (int)sizeof(dtHierarchyPortal)*portalCount + (int)sizeof(float)*portalCount*portalCount;
+	unsigned char* data = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+	if (!data)
+	{
+		dtFree(portals);
+		clearCluster(cluster);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	cluster->portals = (dtHierarchyPortal*)data;
+	cluster->costs = (float*)(data + sizeof(dtHierarchyPortal)*portalCount);
+	cluster->portalCount = portalCount;
+	memcpy(cluster->portals, portals, sizeof(dtHierarchyPortal)*portalCount);
+	dtFree(portals);
+
+	for (int i = 0; i < portalCount; ++i)
+	{
+		const dtHierarchyPortal* portal = &cluster->portals[i];
+		calcPortalCosts(tile, portal->ref, portal->pos, cluster->portals, portalCount, &cluster->costs[i*portalCount]);
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshHierarchy::buildClustersAt(const int x, const int y)
+{
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* tiles[MAX_NEIS];
+	const int ntiles = m_nav->getTilesAt(x, y, tiles, MAX_NEIS);
+	for (int i = 0; i < ntiles; ++i)
+	{
+		const dtStatus status = buildCluster(tiles[i]);
+		if (dtStatusFailed(status))
+			return status;
+	}
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// Rebuilds the clusters of the tiles next to the added tile too, as their
+/// links to the added tile create new portals.
+dtStatus dtNavMeshHierarchy::addTile(dtTileRef ref)
+{
+	dtAssert(m_nav);
+
+	const dtMeshTile* tile = m_nav->getTileByRef(ref);
+	if (!tile)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtStatus status = buildCluster(tile);
+	const int x = tile->header->x;
+	const int y = tile->header->y;
+	if (dtStatusSucceed(status)) status = buildClustersAt(x+1, y);
+	if (dtStatusSucceed(status)) status = buildClustersAt(x-1, y);
+	if (dtStatusSucceed(status)) status = buildClustersAt(x, y+1);
+	if (dtStatusSucceed(status)) status = buildClustersAt(x, y-1);
+	return status;
+}
+
+/// @par
+///
+/// Must be called after the tile has been removed from the navigation mesh.
+dtStatus dtNavMeshHierarchy::removeTile(dtTileRef ref)
+{
+	dtAssert(m_nav);
+
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(ref);
+	if (!ref || (int)tileIndex >= m_maxClusters || m_clusters[tileIndex].ref != ref)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtHierarchyCluster* cluster = &m_clusters[tileIndex];
+	const int x = cluster->x;
+	const int y = cluster->y;
+	clearCluster(cluster);
+
+	dtStatus status = buildClustersAt(x+1, y);
+	if (dtStatusSucceed(status)) status = buildClustersAt(x-1, y);
+	if (dtStatusSucceed(status)) status = buildClustersAt(x, y+1);
+	if (dtStatusSucceed(status)) status = buildClustersAt(x, y-1);
+	return status;
+}
+
+const dtHierarchyCluster* dtNavMeshHierarchy::getCluster(dtTileRef ref) const
+{
+	if (!m_nav || !ref)
+		return 0;
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(ref);
+	if ((int)tileIndex >= m_maxClusters || m_clusters[tileIndex].ref != ref)
+		return 0;
+	return &m_clusters[tileIndex];
+}
+
+void dtNavMeshHierarchy::calcPortalCosts(const dtMeshTile* tile, dtPolyRef startRef, const float* startPos,
+										 const dtHierarchyPortal* portals, const int portalCount, float* costs) const
+{
+	for (int i = 0; i < portalCount; ++i)
+		costs[i] = FLT_MAX;
+
+	const dtPoly* startPoly = &tile->polys[m_nav->decodePolyIdPoly(startRef)];
+	if (!m_filter->passFilter(startRef, tile, startPoly))
+		return;
+
+	m_tileNodePool->clear();
+	m_tileOpenList->clear();
+
+	dtNode* startNode = m_tileNodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_tileOpenList->push(startNode);
+
+	// Dijkstra search over the polygons of the tile.
+	while (!m_tileOpenList->empty())
+	{
+		dtNode* bestNode = m_tileOpenList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		const dtPolyRef bestRef = bestNode->id;
+		const dtPoly* bestPoly = &tile->polys[m_nav->decodePolyIdPoly(bestRef)];
+
+		dtPolyRef parentRef = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+		{
+			parentRef = m_tileNodePool->getNodeAtIdx(bestNode->pidx)->id;
+			parentPoly = &tile->polys[m_nav->decodePolyIdPoly(parentRef)];
+		}
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		{
+			const dtLink& link = tile->links[i];
+			const dtPolyRef neighbourRef = link.ref;
+
+			// Stay within the tile, and do not expand back to where we came from.
+			if (!neighbourRef || link.side != 0xff || neighbourRef == parentRef)
+				continue;
+
+			const dtPoly* neighbourPoly = &tile->polys[m_nav->decodePolyIdPoly(neighbourRef)];
+			if (!m_filter->passFilter(neighbourRef, tile, neighbourPoly))
+				continue;
+
+			dtNode* neighbourNode = m_tileNodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+				continue;
+
+			if (neighbourNode->flags == 0)
+				getLinkMidPoint(tile, bestPoly, link, bestRef, tile, neighbourPoly, neighbourNode->pos);
+
+			const float cost = bestNode->cost + m_filter->getCost(bestNode->pos, neighbourNode->pos,
+																   parentRef, parentRef ? tile : 0, parentPoly,
+																   bestRef, tile, bestPoly,
+																   neighbourRef, tile, neighbourPoly);
+
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && cost >= neighbourNode->total)
+				continue;
+
+			neighbourNode->pidx = m_tileNodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = cost;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_tileOpenList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_tileOpenList->push(neighbourNode);
+			}
+		}
+	}
+
+	// Add the cost of moving from where the polygon was entered to the portal.
+	for (int i = 0; i < portalCount; ++i)
+	{
+		const dtNode* node = m_tileNodePool->findNode(portals[i].ref, 0);
+		if (!node)
+			continue;
+		const dtPoly* poly = &tile->polys[m_nav->decodePolyIdPoly(node->id)];
+		costs[i] = node->cost + m_filter->getCost(node->pos, portals[i].pos,
+												  0, 0, 0,
+												  node->id, tile, poly,
+												  0, 0, 0);
+	}
+}
+
+const dtHierarchyPortal* dtNavMeshHierarchy::findOppositePortal(const dtHierarchyPortal* portal,
+																const dtHierarchyCluster** cluster) const
+{
+	*cluster = 0;
+	if (!m_nav->isValidPolyRef(portal->neiRef))
+		return 0;
+
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(portal->ref);
+	const dtHierarchyCluster* nei = &m_clusters[m_nav->decodePolyIdTile(portal->neiRef)];
+	if (!nei->ref || !m_nav->getTileByRef(nei->ref))
+		return 0;
+
+	// The portals on both sides of a border may be grouped differently, pick the closest one.
+	const unsigned char side = (unsigned char)dtOppositeTile(portal->side);
+	const dtHierarchyPortal* best = 0;
+	float bestDist = FLT_MAX;
+	for (int i = 0; i < nei->portalCount; ++i)
+	{
+		const dtHierarchyPortal* p = &nei->portals[i];
+		if (p->side != side || m_nav->decodePolyIdTile(p->neiRef) != tileIndex)
+			continue;
+		const float d = dtVdistSqr(p->pos, portal->pos);
+		if (d < bestDist)
+		{
+			bestDist = d;
+			best = p;
+		}
+	}
+
+	*cluster = nei;
+	return best;
+}
+
+dtPolyRef dtNavMeshHierarchy::encodeNodeId(unsigned int tileIndex, unsigned int portalIndex) const
+{
+	return ((dtPolyRef)tileIndex << m_portalBits) | (dtPolyRef)portalIndex;
+}
+
+const dtHierarchyPortal* dtNavMeshHierarchy::decodeNodeId(dtPolyRef id) const
+{
+	const dtPolyRef portalMask = ((dtPolyRef)1 << m_portalBits) - 1;
+	return &m_clusters[id >> m_portalBits].portals[id & portalMask];
+}
+
+int dtNavMeshHierarchy::findPortalPath(dtPolyRef startRef, dtPolyRef endRef, const float* startPos, const float* endPos,
+									   dtStatus* status) const
+{
+	const unsigned int startTileIndex = m_nav->decodePolyIdTile(startRef);
+	const unsigned int endTileIndex = m_nav->decodePolyIdTile(endRef);
+	const dtHierarchyCluster* startCluster = &m_clusters[startTileIndex];
+	const dtHierarchyCluster* endCluster = &m_clusters[endTileIndex];
+	const dtMeshTile* startTile = m_nav->getTileByRef(startCluster->ref);
+	const dtMeshTile* endTile = m_nav->getTileByRef(endCluster->ref);
+	if (!startCluster->ref || !endCluster->ref || !startTile || !endTile)
+		return -1;
+
+	calcPortalCosts(startTile, startRef, startPos, startCluster->portals, startCluster->portalCount, m_startCosts);
+	calcPortalCosts(endTile, endRef, endPos, endCluster->portals, endCluster->portalCount, m_endCosts);
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	for (int i = 0; i < startCluster->portalCount; ++i)
+	{
+		if (m_startCosts[i] == FLT_MAX)
+			continue;
+		dtNode* node = m_nodePool->getNode(encodeNodeId(startTileIndex, (unsigned int)i));
+		if (!node)
+		{
+			*status |= DT_OUT_OF_NODES;
+			break;
+		}
+		dtVcopy(node->pos, startCluster->portals[i].pos);
+		node->pidx = 0;
+		node->cost = m_startCosts[i];
+		node->total = node->cost + dtVdist(node->pos, endPos)*DT_HEURISTIC_SCALE;
+		node->id = encodeNodeId(startTileIndex, (unsigned int)i);
+		node->flags = DT_NODE_OPEN;
+		m_openList->push(node);
+	}
+
+	// The nodes are the portals the path leaves a tile through.
+	dtNode* goalNode = 0;
+	while (!m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		if (bestNode->id == GOAL_NODE_ID)
+		{
+			goalNode = bestNode;
+			break;
+		}
+
+		const dtHierarchyPortal* portal = decodeNodeId(bestNode->id);
+		const dtHierarchyCluster* cluster = 0;
+		const dtHierarchyPortal* entry = findOppositePortal(portal, &cluster);
+		if (!entry)
+			continue;
+
+		const int entryIndex = (int)(entry - cluster->portals);
+		const unsigned int tileIndex = m_nav->decodePolyIdTile(cluster->ref);
+		const float entryCost = bestNode->cost + dtVdist(portal->pos, entry->pos);
+
+		for (int i = 0; i < cluster->portalCount; ++i)
+		{
+			float cost = 0;
+			dtPolyRef id = 0;
+			if (i == entryIndex)
+			{
+				// Moving from the entry to the end polygon.
+				if (tileIndex != endTileIndex || m_endCosts[i] == FLT_MAX)
+					continue;
+				cost = entryCost + m_endCosts[i];
+				id = GOAL_NODE_ID;
+			}
+			else
+			{
+				const float portalCost = cluster->costs[entryIndex*cluster->portalCount + i];
+				if (portalCost == FLT_MAX)
+					continue;
+				cost = entryCost + portalCost;
+				id = encodeNodeId(tileIndex, (unsigned int)i);
+			}
+
+			dtNode* neighbourNode = m_nodePool->getNode(id);
+			if (!neighbourNode)
+			{
+				*status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			const float heuristic = id == GOAL_NODE_ID ? 0 : dtVdist(cluster->portals[i].pos, endPos)*DT_HEURISTIC_SCALE;
+			const float total = cost + heuristic;
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+				continue;
+
+			if (id != GOAL_NODE_ID)
+				dtVcopy(neighbourNode->pos, cluster->portals[i].pos);
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = id;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+
+	if (!goalNode)
+		return -1;
+
+	// Reverse the parent chain to get the portals in order.
+	int count = 0;
+	for (dtNode* node = m_nodePool->getNodeAtIdx(goalNode->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		count++;
+	int i = count;
+	for (dtNode* node = m_nodePool->getNodeAtIdx(goalNode->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		m_portalPath[--i] = decodeNodeId(node->id);
+
+	return count;
+}
+
+/// @par
+///
+/// Paths within a tile are found directly with dtNavMeshQuery::findPath.
+/// Otherwise the path is planned over the portals of the tiles first,
+/// and the polygons are then searched from portal to portal, so that the
+/// node pool of @p query only needs to hold the polygons of a few tiles.
+///
+/// If the end polygon cannot be reached through the abstract graph, the
+/// path is found using a single dtNavMeshQuery::findPath instead, which
+/// returns a partial result if the end cannot be reached at all.
+///
+/// If the path array is too small to hold the full result, it will be filled
+/// as far as possible from the start polygon toward the end polygon.
+dtStatus dtNavMeshHierarchy::findPath(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+									  const float* startPos, const float* endPos,
+									  dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	dtAssert(m_nav);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
+	if (!query || query->getAttachedNavMesh() != m_nav ||
+		!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!path || maxPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (m_nav->decodePolyIdTile(startRef) == m_nav->decodePolyIdTile(endRef))
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+
+	dtStatus status = DT_SUCCESS;
+	const int portalCount = findPortalPath(startRef, endRef, startPos, endPos, &status);
+	if (portalCount < 0)
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath) | (status & DT_STATUS_DETAIL_MASK);
+
+	// Refine the path from portal to portal.
+	int n = 0;
+	dtPolyRef fromRef = startRef;
+	const float* fromPos = startPos;
+	for (int i = 0; i <= portalCount; ++i)
+	{
+		if (n >= maxPath)
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+
+		const dtPolyRef toRef = i < portalCount ? m_portalPath[i]->ref : endRef;
+		const float* toPos = i < portalCount ? m_portalPath[i]->pos : endPos;
+		int segmentCount = 0;
+		const dtStatus segmentStatus = query->findPath(fromRef, toRef, fromPos, toPos, m_filter,
+													   path + n, &segmentCount, maxPath - n);
+		if (dtStatusFailed(segmentStatus))
+			return segmentStatus;
+
+		n += segmentCount;
+		if (dtStatusDetail(segmentStatus, DT_BUFFER_TOO_SMALL))
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		if (dtStatusDetail(segmentStatus, DT_PARTIAL_RESULT))
+		{
+			// The estimated portal costs do not match the polygons, search the whole path instead.
+			return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+		}
+
+		if (i < portalCount)
+		{
+			fromRef = m_portalPath[i]->neiRef;
+			fromPos = m_portalPath[i]->pos;
+		}
+	}
+
+	*pathCount = n;
+	return status;
+}
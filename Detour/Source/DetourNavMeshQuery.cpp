@@ -18,6 +18,7 @@
 
 #include <float.h>
 #include <string.h>
+#include <stdlib.h>
 #include "DetourNavMeshQuery.h"
 #include "DetourNavMesh.h"
 #include "DetourNode.h"
@@ -53,6 +54,11 @@
 /// 
 /// Custom implementations do not need to adhere to the flags or cost logic 
 /// used by the default implementation.  
+///
+/// Without DT_VIRTUAL_QUERYFILTER, a custom filter can be passed to the templated
+/// versions of dtNavMeshQuery::findPath, dtNavMeshQuery::findPolysAroundCircle and
+/// dtNavMeshQuery::raycast. They call the functions of the filter's own type, which must
+/// not derive from this class, and the calls are inlined into the search loops.
 /// 
 /// In order for A* searches to work properly, the cost should be proportional to
 /// the travel distance. Implementing a cost modifier less than 1.0 is likely 
@@ -68,7 +74,8 @@ dtQueryFilter::dtQueryFilter() :
 		m_areaCost[i] = 1.0f;
 }
 
-#ifdef DT_VIRTUAL_QUERYFILTER
+// Not declared inline, so that the other parts of Detour using a filter can link against them.
+// The compiler still inlines them within this file.
 bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
 							   const dtMeshTile* /*tile*/,
 							   const dtPoly* poly) const
@@ -83,24 +90,6 @@ float dtQueryFilter::getCost(const float* pa, const float* pb,
 {
 	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
 }
-#else
-inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
-									  const dtMeshTile* /*tile*/,
-									  const dtPoly* poly) const
-{
-	return (poly->flags & m_includeFlags) != 0 && (poly->flags & m_excludeFlags) == 0;
-}
-
-inline float dtQueryFilter::getCost(const float* pa, const float* pb,
-									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
-									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
-									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
-{
-	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
-}
-#endif	
-	
-static const float H_SCALE = 0.999f; // Search heuristic scale.
 
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
@@ -122,6 +111,11 @@ dtPolyQuery::~dtPolyQuery()
 	// Defined out of line to fix the weak v-tables warning
 }
 
+dtTaskDispatcher::~dtTaskDispatcher()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /// @class dtNavMeshQuery
@@ -144,7 +138,8 @@ dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_backOpenList(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
 }
@@ -157,9 +152,12 @@ dtNavMeshQuery::~dtNavMeshQuery()
 		m_nodePool->~dtNodePool();
 	if (m_openList)
 		m_openList->~dtNodeQueue();
+	if (m_backOpenList)
+		m_backOpenList->~dtNodeQueue();
 	dtFree(m_tinyNodePool);
 	dtFree(m_nodePool);
 	dtFree(m_openList);
+	dtFree(m_backOpenList);
 }
 
 /// @par 
@@ -170,7 +168,7 @@ dtNavMeshQuery::~dtNavMeshQuery()
 /// This function can be used multiple times.
 dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 {
-	if (maxNodes > DT_NULL_IDX || maxNodes > (1 << DT_NODE_PARENT_BITS) - 1)
+	if (maxNodes > DT_MAX_POOL_NODES)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
 	m_nav = nav;
@@ -219,6 +217,23 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		m_openList->clear();
 	}
+
+	if (!m_backOpenList || m_backOpenList->getCapacity() < maxNodes)
+	{
+		if (m_backOpenList)
+		{
+			m_backOpenList->~dtNodeQueue();
+			dtFree(m_backOpenList);
+			m_backOpenList = 0;
+		}
+		m_backOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+		if (!m_backOpenList)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	else
+	{
+		m_backOpenList->clear();
+	}
 	
 	return DT_SUCCESS;
 }
@@ -729,25 +744,16 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
-void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
-										 const dtQueryFilter* filter, dtPolyQuery* query) const
+namespace
 {
-	dtAssert(m_nav);
-	static const int batchSize = 32;
-	dtPolyRef polyRefs[batchSize];
-	dtPoly* polys[batchSize];
-	int n = 0;
-
-	if (tile->bvTree)
+	// Quantizes a query box to the bounding volume tree space of a tile.
+	void quantizeQueryBounds(const dtMeshTile* tile, const float* qmin, const float* qmax,
+							 unsigned short* bmin, unsigned short* bmax)
 	{
-		const dtBVNode* node = &tile->bvTree[0];
-		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
 		const float* tbmin = tile->header->bmin;
 		const float* tbmax = tile->header->bmax;
 		const float qfac = tile->header->bvQuantFactor;
 
-		// Calculate quantized box
-		unsigned short bmin[3], bmax[3];
 		// dtClamp query box to world box.
 		float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
 		float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
@@ -762,40 +768,559 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 		bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
 		bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
 		bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+	}
 
-		// Traverse tree
-		const dtPolyRef base = m_nav->getPolyRefBase(tile);
-		while (node < end)
+	// The most requests searched together, each has a bit in the masks selecting the members of a group.
+	const int MAX_NEAREST_POLY_GROUP = 16;
+
+	struct dtNearestPolyOrder
+	{
+		int minx, miny, maxx, maxy;
+		unsigned int cell;
+		int index;
+	};
+
+	int compareNearestPolyRequests(const void* va, const void* vb)
+	{
+		const dtNearestPolyOrder* a = (const dtNearestPolyOrder*)va;
+		const dtNearestPolyOrder* b = (const dtNearestPolyOrder*)vb;
+		if (a->miny != b->miny)
+			return a->miny < b->miny ? -1 : 1;
+		if (a->minx != b->minx)
+			return a->minx < b->minx ? -1 : 1;
+		if (a->maxy != b->maxy)
+			return a->maxy < b->maxy ? -1 : 1;
+		if (a->maxx != b->maxx)
+			return a->maxx < b->maxx ? -1 : 1;
+		if (a->cell != b->cell)
+			return a->cell < b->cell ? -1 : 1;
+		return a->index - b->index;
+	}
+
+	bool isSameTileRange(const dtNearestPolyOrder& a, const dtNearestPolyOrder& b)
+	{
+		return a.minx == b.minx && a.miny == b.miny && a.maxx == b.maxx && a.maxy == b.maxy;
+	}
+
+	// Spreads the low 16 bits of a value to the even bits.
+	unsigned int spreadBits(unsigned int v)
+	{
+		v &= 0xffff;
+		v = (v | (v << 8)) & 0x00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+
+	// Locates a position on a 1024x1024 grid within its tile, in Morton order so that nearby positions are sorted together.
+	unsigned int calcTileCellOrder(const dtNavMeshParams* params, const float* pos)
+	{
+		const float fx = (pos[0] - params->orig[0]) / params->tileWidth;
+		const float fz = (pos[2] - params->orig[2]) / params->tileHeight;
+		const unsigned int x = (unsigned int)((fx - dtMathFloorf(fx)) * 1024.0f) & 1023;
+		const unsigned int z = (unsigned int)((fz - dtMathFloorf(fz)) * 1024.0f) & 1023;
+		return spreadBits(x) | (spreadBits(z) << 1);
+	}
+
+	void getDetailTriVerts(const dtMeshTile* tile, const dtPoly* poly, const dtPolyDetail* pd,
+						   const unsigned char* tris, const float** v)
+	{
+		for (int k = 0; k < 3; ++k)
 		{
-			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
-			const bool isLeafNode = node->i >= 0;
+			if (tris[k] < poly->vertCount)
+				v[k] = &tile->verts[poly->verts[tris[k]]*3];
+			else
+				v[k] = &tile->detailVerts[(pd->vertBase+(tris[k]-poly->vertCount))*3];
+		}
+	}
+
+	// Finds the closest points on a ground polygon of up to four positions, the same way as
+	// dtNavMesh::closestPointOnPoly. Returns the mask of the positions which are over the
+	// polygon but outside the detail triangles, those have to be solved one by one.
+	unsigned int closestPointsOnPoly4(const dtMeshTile* tile, const dtPoly* poly, const unsigned int lanes,
+									  const float px[4], const float pz[4], float closest[4][3], unsigned int& overPoly)
+	{
+		const unsigned int ip = (unsigned int)(poly - tile->polys);
+		const dtPolyDetail* pd = &tile->detailMeshes[ip];
+
+		float verts[DT_VERTS_PER_POLYGON*3];
+		const int nv = poly->vertCount;
+		for (int i = 0; i < nv; ++i)
+			dtVcopy(&verts[i*3], &tile->verts[poly->verts[i]*3]);
+
+		overPoly = dtPointInPolygon4(px, pz, verts, nv) & lanes;
 
-			if (isLeafNode && overlap)
+		// Find the height at the positions over the polygon, from the first triangle containing them.
+		unsigned int unsolved = overPoly;
+		for (int j = 0; j < pd->triCount && unsolved; ++j)
+		{
+			const float* v[3];
+			getDetailTriVerts(tile, poly, pd, &tile->detailTris[(pd->triBase+j)*4], v);
+			float h[4];
+			const unsigned int hit = dtClosestHeightPointTriangle4(px, pz, v[0], v[1], v[2], h) & unsolved;
+			for (int i = 0; i < 4; ++i)
 			{
-				dtPolyRef ref = base | (dtPolyRef)node->i;
-				if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+				if (hit & (1u << i))
 				{
-					polyRefs[n] = ref;
-					polys[n] = &tile->polys[node->i];
+					closest[i][0] = px[i];
+					closest[i][1] = h[i];
+					closest[i][2] = pz[i];
+				}
+			}
+			unsolved &= ~hit;
+		}
+
+		// Find the closest point on the boundary edges for the positions outside the polygon.
+		const unsigned int outside = lanes & ~overPoly;
+		if (!outside)
+			return unsolved;
+
+		float dmin[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+		float tmin[4] = { 0, 0, 0, 0 };
+		const float* pmin[4] = { 0, 0, 0, 0 };
+		const float* pmax[4] = { 0, 0, 0, 0 };
+		for (int i = 0; i < pd->triCount; ++i)
+		{
+			const unsigned char* tris = &tile->detailTris[(pd->triBase + i) * 4];
+			const int ANY_BOUNDARY_EDGE =
+				(DT_DETAIL_EDGE_BOUNDARY << 0) |
+				(DT_DETAIL_EDGE_BOUNDARY << 2) |
+				(DT_DETAIL_EDGE_BOUNDARY << 4);
+			if ((tris[3] & ANY_BOUNDARY_EDGE) == 0)
+				continue;
 
-					if (n == batchSize - 1)
+			const float* v[3];
+			getDetailTriVerts(tile, poly, pd, tris, v);
+
+			for (int k = 0, j = 2; k < 3; j = k++)
+			{
+				if ((dtGetDetailTriEdgeFlags(tris[3], j) & DT_DETAIL_EDGE_BOUNDARY) == 0)
+					continue;
+
+				float d[4], t[4];
+				dtDistancePtSegSqr2D4(px, pz, v[j], v[k], d, t);
+				for (int n = 0; n < 4; ++n)
+				{
+					if ((outside & (1u << n)) && d[n] < dmin[n])
 					{
-						query->process(tile, polys, polyRefs, batchSize);
-						n = 0;
+						dmin[n] = d[n];
+						tmin[n] = t[n];
+						pmin[n] = v[j];
+						pmax[n] = v[k];
 					}
+				}
+			}
+		}
+
+		for (int n = 0; n < 4; ++n)
+		{
+			if ((outside & (1u << n)) == 0)
+				continue;
+			if (pmin[n])
+				dtVlerp(closest[n], pmin[n], pmax[n], tmin[n]);
+			else
+				unsolved |= 1u << n;
+		}
+
+		return unsolved;
+	}
+
+	// The search state of a request in dtNavMeshQuery::findNearestPolys.
+	struct dtNearestPolySearch
+	{
+		dtNearestPolyRequest* req;
+		float bmin[3], bmax[3];
+		unsigned short qbmin[3], qbmax[3];
+		float nearestDistanceSqr;
+	};
+
+	// Nearby requests which search the tiles together.
+	struct dtNearestPolyGroup
+	{
+		const dtNavMeshQuery* query;
+		const dtQueryFilter* filter;
+		dtNearestPolySearch searches[MAX_NEAREST_POLY_GROUP];
+		int count;
+	};
+
+	unsigned int overlappingSearches(const dtNearestPolyGroup& group, const unsigned short* bmin, const unsigned short* bmax)
+	{
+		unsigned int members = 0;
+		for (int i = 0; i < group.count; ++i)
+		{
+			if (dtOverlapQuantBounds(group.searches[i].qbmin, group.searches[i].qbmax, bmin, bmax))
+				members |= 1u << i;
+		}
+		return members;
+	}
+
+	// Updates the nearest polygon of the group members whose search boxes overlap the polygon.
+	void processNearestPolyCandidate(dtNearestPolyGroup& group, const dtMeshTile* tile, const dtPolyRef base,
+									 const int ip, unsigned int members)
+	{
+		if (!members)
+			return;
+
+		const dtPolyRef ref = base | (dtPolyRef)ip;
+		const dtPoly* poly = &tile->polys[ip];
+		if (!group.filter->passFilter(ref, tile, poly))
+			return;
+
+		while (members)
+		{
+			// Take the next four members, the unused lanes are ignored.
+			int lane[4];
+			float px[4] = { 0, 0, 0, 0 };
+			float pz[4] = { 0, 0, 0, 0 };
+			int n = 0;
+			for (int i = 0; i < group.count && n < 4; ++i)
+			{
+				if ((members & (1u << i)) == 0)
+					continue;
+				members &= ~(1u << i);
+				lane[n] = i;
+				px[n] = group.searches[i].req->center[0];
+				pz[n] = group.searches[i].req->center[2];
+				n++;
+			}
+
+			float closest[4][3];
+			unsigned int overPoly = 0;
+			const unsigned int unsolved = closestPointsOnPoly4(tile, poly, (1u << n) - 1, px, pz, closest, overPoly);
+
+			for (int i = 0; i < n; ++i)
+			{
+				dtNearestPolySearch& search = group.searches[lane[i]];
+				const float* center = search.req->center;
+				bool posOverPoly = (overPoly & (1u << i)) != 0;
+				if (unsolved & (1u << i))
+					group.query->closestPointOnPoly(ref, center, closest[i], &posOverPoly);
+
+				// Same as dtFindNearestPolyQuery, favor a polygon under the point within climb height.
+				float diff[3];
+				float d;
+				dtVsub(diff, center, closest[i]);
+				if (posOverPoly)
+				{
+					d = dtAbs(diff[1]) - tile->header->walkableClimb;
+					d = d > 0 ? d*d : 0;
+				}
+				else
+				{
+					d = dtVlenSqr(diff);
+				}
+
+				if (d < search.nearestDistanceSqr)
+				{
+					dtVcopy(search.req->nearestPt, closest[i]);
+					search.nearestDistanceSqr = d;
+					search.req->nearestRef = ref;
+					search.req->isOverPoly = posOverPoly;
+				}
+			}
+		}
+	}
+
+	// Visits the polygons of a tile overlapping the search boxes of the group, in the
+	// same order as dtNavMeshQuery::queryPolygonsInTile.
+	void findNearestPolysInTile(dtNearestPolyGroup& group, const dtNavMesh* nav, const dtMeshTile* tile)
+	{
+		const dtPolyRef base = nav->getPolyRefBase(tile);
+
+		if (tile->bvTree || tile->bvWideTree)
+		{
+			// The tree is traversed once with the union of the search boxes.
+			unsigned short bmin[3] = { 0xffff, 0xffff, 0xffff };
+			unsigned short bmax[3] = { 0, 0, 0 };
+			for (int i = 0; i < group.count; ++i)
+			{
+				dtNearestPolySearch& search = group.searches[i];
+				quantizeQueryBounds(tile, search.bmin, search.bmax, search.qbmin, search.qbmax);
+				for (int k = 0; k < 3; ++k)
+				{
+					bmin[k] = dtMin(bmin[k], search.qbmin[k]);
+					bmax[k] = dtMax(bmax[k], search.qbmax[k]);
+				}
+			}
+
+			if (tile->bvWideTree)
+			{
+				// Leaves are pushed as -1 - (node * 4 + slot) to keep their bounds.
+				int stack[DT_BVWIDE_STACK_SIZE];
+				int nstack = 0;
+				stack[nstack++] = 0;
+				while (nstack > 0)
+				{
+					const int index = stack[--nstack];
+					if (index < 0)
+					{
+						const int leaf = -1 - index;
+						const dtBVWideNode* node = &tile->bvWideTree[leaf >> 2];
+						const int slot = leaf & 3;
+						const unsigned short leafMin[3] = { node->bmin[0][slot], node->bmin[1][slot], node->bmin[2][slot] };
+						const unsigned short leafMax[3] = { node->bmax[0][slot], node->bmax[1][slot], node->bmax[2][slot] };
+						processNearestPolyCandidate(group, tile, base, -1 - node->child[slot],
+													overlappingSearches(group, leafMin, leafMax));
+						continue;
+					}
+					const dtBVWideNode* node = &tile->bvWideTree[index];
+					const unsigned int overlap = dtOverlapQuantBounds4(bmin, bmax, node->bmin, node->bmax);
+					for (int i = 3; i >= 0; --i)
+					{
+						if ((overlap & (1u << i)) && node->child[i] != 0)
+							stack[nstack++] = node->child[i] > 0 ? node->child[i] : -1 - (index * 4 + i);
+					}
+				}
+			}
+			else
+			{
+				const dtBVNode* node = &tile->bvTree[0];
+				const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+				while (node < end)
+				{
+					const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+					const bool isLeafNode = node->i >= 0;
+
+					if (isLeafNode && overlap)
+						processNearestPolyCandidate(group, tile, base, node->i, overlappingSearches(group, node->bmin, node->bmax));
+
+					if (overlap || isLeafNode)
+						node++;
 					else
 					{
-						n++;
+						const int escapeIndex = -node->i;
+						node += escapeIndex;
 					}
 				}
 			}
+		}
+		else
+		{
+			float bmin[3], bmax[3];
+			for (int i = 0; i < tile->header->polyCount; ++i)
+			{
+				const dtPoly* p = &tile->polys[i];
+				// Do not return off-mesh connection polygons.
+				if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+					continue;
+				// Calc polygon bounds.
+				const float* v = &tile->verts[p->verts[0]*3];
+				dtVcopy(bmin, v);
+				dtVcopy(bmax, v);
+				for (int j = 1; j < p->vertCount; ++j)
+				{
+					v = &tile->verts[p->verts[j]*3];
+					dtVmin(bmin, v);
+					dtVmax(bmax, v);
+				}
+				unsigned int members = 0;
+				for (int j = 0; j < group.count; ++j)
+				{
+					if (dtOverlapBounds(group.searches[j].bmin, group.searches[j].bmax, bmin, bmax))
+						members |= 1u << j;
+				}
+				processNearestPolyCandidate(group, tile, base, i, members);
+			}
+		}
+	}
+}
 
-			if (overlap || isLeafNode)
-				node++;
-			else
+/// @par
+///
+/// Produces the same results as calling #findNearestPoly for every request. The
+/// requests are sorted by the tiles they search, and nearby requests traverse the
+/// tiles together and test the polygons for four points at a time.
+///
+/// The status of every request is stored in the request. The function fails
+/// only if the parameters of the batch itself are invalid.
+///
+/// @see findNearestPoly
+dtStatus dtNavMeshQuery::findNearestPolys(dtNearestPolyRequest* requests, const int requestCount,
+										  const float* halfExtents, const dtQueryFilter* filter) const
+{
+	dtAssert(m_nav);
+
+	if ((!requests && requestCount > 0) || requestCount < 0 ||
+		!halfExtents || !dtVisfinite(halfExtents) || !filter)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (requestCount == 0)
+		return DT_SUCCESS;
+
+	dtNearestPolyOrder* order = (dtNearestPolyOrder*)dtAlloc(sizeof(dtNearestPolyOrder)*requestCount, DT_ALLOC_TEMP);
+	if (!order)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	int orderCount = 0;
+	for (int i = 0; i < requestCount; ++i)
+	{
+		dtNearestPolyRequest& req = requests[i];
+		req.nearestRef = 0;
+		if (!dtVisfinite(req.center))
+		{
+			req.status = DT_FAILURE | DT_INVALID_PARAM;
+			continue;
+		}
+		req.status = DT_SUCCESS;
+
+		float bmin[3], bmax[3];
+		dtVsub(bmin, req.center, halfExtents);
+		dtVadd(bmax, req.center, halfExtents);
+
+		dtNearestPolyOrder& o = order[orderCount++];
+		m_nav->calcTileLoc(bmin, &o.minx, &o.miny);
+		m_nav->calcTileLoc(bmax, &o.maxx, &o.maxy);
+		o.cell = calcTileCellOrder(m_nav->getParams(), req.center);
+		o.index = i;
+	}
+	qsort(order, orderCount, sizeof(dtNearestPolyOrder), compareNearestPolyRequests);
+
+	dtNearestPolyGroup group;
+	group.query = this;
+	group.filter = filter;
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	for (int first = 0; first < orderCount; )
+	{
+		// Requests close to the first one of the group share most of the polygons they search.
+		const dtNearestPolyOrder& lead = order[first];
+		const float* leadCenter = requests[lead.index].center;
+		int last = first + 1;
+		while (last < orderCount && last - first < MAX_NEAREST_POLY_GROUP && isSameTileRange(order[last], lead))
+		{
+			const float* center = requests[order[last].index].center;
+			if (dtAbs(center[0] - leadCenter[0]) > halfExtents[0]*2 ||
+				dtAbs(center[1] - leadCenter[1]) > halfExtents[1]*2 ||
+				dtAbs(center[2] - leadCenter[2]) > halfExtents[2]*2)
+				break;
+			last++;
+		}
+
+		group.count = 0;
+		for (int i = first; i < last; ++i)
+		{
+			dtNearestPolySearch& search = group.searches[group.count++];
+			search.req = &requests[order[i].index];
+			dtVsub(search.bmin, search.req->center, halfExtents);
+			dtVadd(search.bmax, search.req->center, halfExtents);
+			search.nearestDistanceSqr = FLT_MAX;
+		}
+
+		for (int y = lead.miny; y <= lead.maxy; ++y)
+		{
+			for (int x = lead.minx; x <= lead.maxx; ++x)
 			{
-				const int escapeIndex = -node->i;
-				node += escapeIndex;
+				const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+				for (int j = 0; j < nneis; ++j)
+					findNearestPolysInTile(group, m_nav, neis[j]);
+			}
+		}
+
+		first = last;
+	}
+
+	dtFree(order);
+
+	return DT_SUCCESS;
+}
+
+void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
+										 const dtQueryFilter* filter, dtPolyQuery* query) const
+{
+	dtAssert(m_nav);
+	static const int batchSize = 32;
+	dtPolyRef polyRefs[batchSize];
+	dtPoly* polys[batchSize];
+	int n = 0;
+
+	if (tile->bvTree || tile->bvWideTree)
+	{
+		// Calculate quantized box
+		unsigned short bmin[3], bmax[3];
+		quantizeQueryBounds(tile, qmin, qmax, bmin, bmax);
+
+		// Traverse tree
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+		if (tile->bvWideTree)
+		{
+			// The children are pushed in reverse, so that the polygons are found in the same order as in the binary tree.
+			int stack[DT_BVWIDE_STACK_SIZE];
+			int nstack = 0;
+			stack[nstack++] = 0;
+			while (nstack > 0)
+			{
+				const int index = stack[--nstack];
+				if (index < 0)
+				{
+					const int ip = -1 - index;
+					dtPolyRef ref = base | (dtPolyRef)ip;
+					if (filter->passFilter(ref, tile, &tile->polys[ip]))
+					{
+						polyRefs[n] = ref;
+						polys[n] = &tile->polys[ip];
+
+						if (n == batchSize - 1)
+						{
+							query->process(tile, polys, polyRefs, batchSize);
+							n = 0;
+						}
+						else
+						{
+							n++;
+						}
+					}
+					continue;
+				}
+				const dtBVWideNode* node = &tile->bvWideTree[index];
+				const unsigned int overlap = dtOverlapQuantBounds4(bmin, bmax, node->bmin, node->bmax);
+				for (int i = 3; i >= 0; --i)
+				{
+					if ((overlap & (1u << i)) && node->child[i] != 0)
+						stack[nstack++] = node->child[i];
+				}
+			}
+		}
+		else
+		{
+			const dtBVNode* node = &tile->bvTree[0];
+			const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+			while (node < end)
+			{
+				const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+				const bool isLeafNode = node->i >= 0;
+
+				if (isLeafNode && overlap)
+				{
+					dtPolyRef ref = base | (dtPolyRef)node->i;
+					if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+					{
+						polyRefs[n] = ref;
+						polys[n] = &tile->polys[node->i];
+
+						if (n == batchSize - 1)
+						{
+							query->process(tile, polys, polyRefs, batchSize);
+							n = 0;
+						}
+						else
+						{
+							n++;
+						}
+					}
+				}
+
+				if (overlap || isLeafNode)
+					node++;
+				else
+				{
+					const int escapeIndex = -node->i;
+					node += escapeIndex;
+				}
 			}
 		}
 	}
@@ -970,197 +1495,208 @@ dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExt
 /// The start and end positions are used to calculate traversal costs. 
 /// (The y-values impact the result.)
 ///
+/// With #DT_FINDPATH_BIDIRECTIONAL, the polygons are searched from the start and
+/// the end polygon at the same time. The search stops once no path through the
+/// open nodes of both searches can be cheaper than the best connection found.
+/// This visits fewer nodes when the straight distance is a poor estimate of the
+/// cost, e.g. with area costs above one or walls to go around, but more nodes on
+/// open ground where the default search heads straight to the end. Where several
+/// paths have about the same cost, the path found may differ from the one of the
+/// default search.
+///
 dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 								  const float* startPos, const float* endPos,
 								  const dtQueryFilter* filter,
-								  dtPolyRef* path, int* pathCount, const int maxPath) const
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options) const
+{
+	return findPath<dtQueryFilter>(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath, options);
+}
+
+namespace
+{
+	struct dtPathRequestOrder
+	{
+		dtPolyRef endRef;
+		dtPolyRef startRef;
+		int index;
+	};
+
+	int comparePathRequests(const void* va, const void* vb)
+	{
+		const dtPathRequestOrder* a = (const dtPathRequestOrder*)va;
+		const dtPathRequestOrder* b = (const dtPathRequestOrder*)vb;
+		if (a->endRef != b->endRef)
+			return a->endRef < b->endRef ? -1 : 1;
+		if (a->startRef != b->startRef)
+			return a->startRef < b->startRef ? -1 : 1;
+		return a->index - b->index;
+	}
+
+	bool isSamePathRequest(const dtPathRequest& a, const dtPathRequest& b)
+	{
+		return a.startRef == b.startRef && a.endRef == b.endRef &&
+			a.startPos[0] == b.startPos[0] && a.startPos[1] == b.startPos[1] && a.startPos[2] == b.startPos[2] &&
+			a.endPos[0] == b.endPos[0] && a.endPos[1] == b.endPos[1] && a.endPos[2] == b.endPos[2];
+	}
+
+	// Copies the path found for an identical request, returns false if the path does not fit the request.
+	bool copyPathRequestResult(const dtPathRequest& from, dtPathRequest& to)
+	{
+		// The path of the source was cut short, a longer path has to be searched again.
+		if ((from.status & DT_BUFFER_TOO_SMALL) && to.maxPath > from.maxPath)
+			return false;
+
+		to.pathCount = dtMin(from.pathCount, to.maxPath);
+		memcpy(to.path, from.path, sizeof(dtPolyRef)*to.pathCount);
+		to.status = from.status;
+		if (from.pathCount > to.maxPath)
+			to.status |= DT_BUFFER_TOO_SMALL;
+		return true;
+	}
+}
+
+/// @par
+///
+/// Produces the same results as calling #findPath for every request, but
+/// processes the requests in an order which keeps the searches towards the same
+/// goal together, and searches each distinct request only once.
+///
+/// The status of every request is stored in the request. The function fails
+/// only if the parameters of the batch itself are invalid.
+///
+/// @see findPath, dtFindPaths
+dtStatus dtNavMeshQuery::findPaths(dtPathRequest* requests, const int requestCount, const dtQueryFilter* filter) const
 {
 	dtAssert(m_nav);
-	dtAssert(m_nodePool);
-	dtAssert(m_openList);
 
-	if (!pathCount)
+	if ((!requests && requestCount > 0) || requestCount < 0 || !filter)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
-	*pathCount = 0;
-	
-	// Validate input
-	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
-		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!filter || !path || maxPath <= 0)
+	for (int i = 0; i < requestCount; ++i)
 	{
-		return DT_FAILURE | DT_INVALID_PARAM;
+		requests[i].pathCount = 0;
+		requests[i].status = DT_FAILURE | DT_INVALID_PARAM;
 	}
 
-	if (startRef == endRef)
+	if (requestCount <= 1)
 	{
-		path[0] = startRef;
-		*pathCount = 1;
+		if (requestCount == 1)
+		{
+			dtPathRequest& req = requests[0];
+			req.status = findPath(req.startRef, req.endRef, req.startPos, req.endPos, filter,
+								  req.path, &req.pathCount, req.maxPath);
+		}
 		return DT_SUCCESS;
 	}
-	
-	m_nodePool->clear();
-	m_openList->clear();
-	
-	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, startPos);
-	startNode->pidx = 0;
-	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
-	startNode->id = startRef;
-	startNode->flags = DT_NODE_OPEN;
-	m_openList->push(startNode);
-	
-	dtNode* lastBestNode = startNode;
-	float lastBestNodeCost = startNode->total;
-	
-	bool outOfNodes = false;
-	
-	while (!m_openList->empty())
+
+	dtPathRequestOrder* order = (dtPathRequestOrder*)dtAlloc(sizeof(dtPathRequestOrder)*requestCount, DT_ALLOC_TEMP);
+	if (!order)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	for (int i = 0; i < requestCount; ++i)
 	{
-		// Remove node from open list and put it in closed list.
-		dtNode* bestNode = m_openList->pop();
-		bestNode->flags &= ~DT_NODE_OPEN;
-		bestNode->flags |= DT_NODE_CLOSED;
-		
-		// Reached the goal, stop searching.
-		if (bestNode->id == endRef)
+		order[i].endRef = requests[i].endRef;
+		order[i].startRef = requests[i].startRef;
+		order[i].index = i;
+	}
+	qsort(order, requestCount, sizeof(dtPathRequestOrder), comparePathRequests);
+
+	const dtPathRequest* prev = 0;
+	for (int i = 0; i < requestCount; ++i)
+	{
+		dtPathRequest& req = requests[order[i].index];
+
+		if (prev && isSamePathRequest(*prev, req) && req.path && dtStatusSucceed(prev->status) &&
+			copyPathRequestResult(*prev, req))
 		{
-			lastBestNode = bestNode;
-			break;
+			continue;
 		}
-		
-		// Get current poly and tile.
-		// The API input has been cheked already, skip checking internal data.
-		const dtPolyRef bestRef = bestNode->id;
-		const dtMeshTile* bestTile = 0;
-		const dtPoly* bestPoly = 0;
-		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
-		
-		// Get parent poly and tile.
-		dtPolyRef parentRef = 0;
-		const dtMeshTile* parentTile = 0;
-		const dtPoly* parentPoly = 0;
-		if (bestNode->pidx)
-			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
-		if (parentRef)
-			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
-		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
-		{
-			dtPolyRef neighbourRef = bestTile->links[i].ref;
-			
-			// Skip invalid ids and do not expand back to where we came from.
-			if (!neighbourRef || neighbourRef == parentRef)
-				continue;
-			
-			// Get neighbour poly and tile.
-			// The API input has been cheked already, skip checking internal data.
-			const dtMeshTile* neighbourTile = 0;
-			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
-			
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
-				continue;
 
-			// deal explicitly with crossing tile boundaries
-			unsigned char crossSide = 0;
-			if (bestTile->links[i].side != 0xff)
-				crossSide = bestTile->links[i].side >> 1;
+		req.status = findPath(req.startRef, req.endRef, req.startPos, req.endPos, filter,
+							  req.path, &req.pathCount, req.maxPath);
+		prev = &req;
+	}
 
-			// get the node
-			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
-			if (!neighbourNode)
-			{
-				outOfNodes = true;
-				continue;
-			}
-			
-			// If the node is visited the first time, calculate node position.
-			if (neighbourNode->flags == 0)
-			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
-								neighbourRef, neighbourPoly, neighbourTile,
-								neighbourNode->pos);
-			}
+	dtFree(order);
 
-			// Calculate cost and heuristic.
-			float cost = 0;
-			float heuristic = 0;
-			
-			// Special case for last node.
-			if (neighbourRef == endRef)
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				const float endCost = filter->getCost(neighbourNode->pos, endPos,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly,
-													  0, 0, 0);
-				
-				cost = bestNode->cost + curCost + endCost;
-				heuristic = 0;
-			}
-			else
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
-			}
+	return DT_SUCCESS;
+}
 
-			const float total = cost + heuristic;
-			
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
-				continue;
-			// The node is already visited and process, and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
-				continue;
-			
-			// Add or update the node.
-			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
-			neighbourNode->id = neighbourRef;
-			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
-			neighbourNode->cost = cost;
-			neighbourNode->total = total;
-			
-			if (neighbourNode->flags & DT_NODE_OPEN)
-			{
-				// Already in open, update node location.
-				m_openList->modify(neighbourNode);
-			}
-			else
-			{
-				// Put the node in open list.
-				neighbourNode->flags |= DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
-			}
-			
-			// Update nearest node to target so far.
-			if (heuristic < lastBestNodeCost)
-			{
-				lastBestNodeCost = heuristic;
-				lastBestNode = neighbourNode;
-			}
-		}
+namespace
+{
+	struct dtFindPathsJob
+	{
+		dtNavMeshQuery** queries;
+		dtPathRequest* requests;
+		int requestCount;
+		int batchSize;
+		const dtQueryFilter* filter;
+		dtStatus* batchStatus;	// The status of each batch, written only by the worker running it.
+	};
+
+	void findPathsTask(int index, int worker, void* userData)
+	{
+		dtFindPathsJob* job = (dtFindPathsJob*)userData;
+		const int first = index * job->batchSize;
+		const int count = dtMin(job->batchSize, job->requestCount - first);
+		job->batchStatus[index] = job->queries[worker]->findPaths(job->requests + first, count, job->filter);
 	}
+}
 
-	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+/// @par
+///
+/// The requests are split into batches which are solved by #dtNavMeshQuery::findPaths
+/// on the query object of the worker running the batch. All query objects must use
+/// the same navigation mesh. The results are the same as when searching the paths one by one.
+///
+/// @see dtNavMeshQuery::findPaths
+dtStatus dtFindPaths(dtNavMeshQuery** queries, dtTaskDispatcher* dispatcher,
+					 dtPathRequest* requests, const int requestCount, const dtQueryFilter* filter)
+{
+	if (!queries || !queries[0])
+		return DT_FAILURE | DT_INVALID_PARAM;
 
-	if (lastBestNode->id != endRef)
-		status |= DT_PARTIAL_RESULT;
+	const int workerCount = dispatcher ? dispatcher->getWorkerCount() : 1;
+	if (workerCount <= 1 || requestCount <= 1)
+		return queries[0]->findPaths(requests, requestCount, filter);
+
+	for (int i = 1; i < workerCount; ++i)
+	{
+		if (!queries[i] || queries[i]->getAttachedNavMesh() != queries[0]->getAttachedNavMesh())
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// A few batches per worker balance the uneven cost of the searches.
+	static const int BATCHES_PER_WORKER = 4;
+	const int batchCount = dtMin(requestCount, workerCount * BATCHES_PER_WORKER);
+
+	dtFindPathsJob job;
+	job.queries = queries;
+	job.requests = requests;
+	job.requestCount = requestCount;
+	job.batchSize = (requestCount + batchCount - 1) / batchCount;
+	job.filter = filter;
+
+	const int taskCount = (requestCount + job.batchSize - 1) / job.batchSize;
+	job.batchStatus = (dtStatus*)dtAlloc(sizeof(dtStatus)*taskCount, DT_ALLOC_TEMP);
+	if (!job.batchStatus)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	dispatcher->parallelFor(taskCount, findPathsTask, &job);
+
+	// Report the first failed batch, the workers may have finished in any order.
+	dtStatus status = DT_SUCCESS;
+	for (int i = 0; i < taskCount; ++i)
+	{
+		if (dtStatusFailed(job.batchStatus[i]))
+		{
+			status = job.batchStatus[i];
+			break;
+		}
+	}
+	dtFree(job.batchStatus);
 
-	if (outOfNodes)
-		status |= DT_OUT_OF_NODES;
-	
 	return status;
 }
 
@@ -1204,6 +1740,73 @@ dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pa
 	return DT_SUCCESS;
 }
 
+int dtNavMeshQuery::findIncomingOffMeshConnections(dtPolyRef ref, const dtMeshTile* tile, const int skip,
+													dtPolyRef* refs, const int maxRefs, bool* nearby) const
+{
+	// Off-mesh connections are linked to the polygons of their own tile and the neighbour tiles.
+	static const int MAX_NEIS = 32;
+	dtMeshTile* neis[MAX_NEIS];
+	int nneis = m_nav->getTilesAt(tile->header->x, tile->header->y, neis, MAX_NEIS);
+	for (int side = 0; side < 8; ++side)
+		nneis += m_nav->getNeighbourTilesAt(tile->header->x, tile->header->y, side, neis + nneis, MAX_NEIS - nneis);
+
+	int found = 0;
+	int n = 0;
+	*nearby = false;
+	for (int i = 0; i < nneis; ++i)
+	{
+		const dtMeshTile* nei = neis[i];
+		const dtPolyRef base = m_nav->getPolyRefBase(nei);
+		for (int j = 0; j < nei->header->offMeshConCount; ++j)
+		{
+			const dtOffMeshConnection* con = &nei->offMeshCons[j];
+			if (con->flags & DT_OFFMESH_CON_BIDIR)
+				continue;
+			*nearby = true;
+
+			const dtPoly* poly = &nei->polys[con->poly];
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = nei->links[k].next)
+			{
+				if (nei->links[k].edge == 1 && nei->links[k].ref == ref)
+				{
+					if (found++ >= skip)
+					{
+						refs[n++] = base | (dtPolyRef)con->poly;
+						if (n == maxRefs)
+							return n;
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	return n;
+}
+
+dtStatus dtNavMeshQuery::getBidirectionalPath(const dtQueryData& query, dtPolyRef* path, int* pathCount, int maxPath) const
+{
+	const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+	if (!query.meetNode)
+		return getPathToNode(query.lastBestNode, path, pathCount, maxPath) | details | DT_PARTIAL_RESULT;
+
+	// The forward search leads from the start to the connecting polygon, and the backward search from there to the end.
+	dtStatus status = getPathToNode(query.meetNode, path, pathCount, maxPath) | details;
+	int n = *pathCount;
+	for (const dtNode* node = m_nodePool->getNodeAtIdx(query.meetBackNode->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+	{
+		if (n >= maxPath)
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		path[n++] = node->id;
+	}
+	*pathCount = n;
+
+	return status;
+}
+
 
 /// @par
 ///
@@ -1213,6 +1816,10 @@ dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pa
 /// The @p filter pointer is stored and used for the duration of the sliced
 /// path query.
 ///
+/// #DT_FINDPATH_BIDIRECTIONAL searches from both ends as described for findPath().
+/// It is ignored together with #DT_FINDPATH_ANY_ANGLE. finalizeSlicedFindPathPartial()
+/// only considers the polygons visited by the search from the start.
+///
 dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
 											const float* startPos, const float* endPos,
 											const dtQueryFilter* filter, const unsigned int options)
@@ -1233,6 +1840,10 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	m_query.filter = filter;
 	m_query.options = options;
 	m_query.raycastLimitSqr = FLT_MAX;
+
+	// The bidirectional search does not take raycast shortcuts.
+	if (options & DT_FINDPATH_ANY_ANGLE)
+		m_query.options &= ~DT_FINDPATH_BIDIRECTIONAL;
 	
 	// Validate input
 	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
@@ -1257,6 +1868,12 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 		m_query.status = DT_SUCCESS;
 		return DT_SUCCESS;
 	}
+
+	if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		initBidirectionalSearch(m_query, filter);
+		return m_query.status;
+	}
 	
 	m_nodePool->clear();
 	m_openList->clear();
@@ -1265,7 +1882,7 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
@@ -1289,6 +1906,9 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		return DT_FAILURE;
 	}
 
+	if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+		return updateBidirectionalSearch(m_query, m_query.filter, maxIter, doneIters);
+
 	dtRaycastHit rayHit;
 	rayHit.maxPath = 0;
 		
@@ -1439,7 +2059,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			}
 			else
 			{
-				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*H_SCALE;
+				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*DT_HEURISTIC_SCALE;
 			}
 			
 			const float total = cost + heuristic;
@@ -1518,6 +2138,11 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount,
 		// Special case: the search starts and ends at same poly.
 		path[n++] = m_query.startRef;
 	}
+	else if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		dtAssert(m_query.lastBestNode);
+		m_query.status |= getBidirectionalPath(m_query, path, &n, maxPath) & DT_STATUS_DETAIL_MASK;
+	}
 	else
 	{
 		// Reverse the path.
@@ -1611,12 +2236,12 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 	}
 	else
 	{
-		// Find furthest existing node that was visited.
+		// Find furthest existing node that was visited by the forward search.
 		dtNode* prev = 0;
 		dtNode* node = 0;
 		for (int i = existingSize-1; i >= 0; --i)
 		{
-			m_nodePool->findNodes(existing[i], &node, 1);
+			node = m_nodePool->findNode(existing[i], 0);
 			if (node)
 				break;
 		}
@@ -2425,6 +3050,32 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 }
 
 
+void dtNavMeshQuery::initRaycast(dtRaycastState& ray, dtPolyRef startRef, const float* startPos,
+								  const float* endPos, dtPolyRef prevRef, dtRaycastHit* hit) const
+{
+	ray.startPos = startPos;
+	ray.endPos = endPos;
+	ray.n = 0;
+	ray.hit = hit;
+	ray.status = DT_SUCCESS;
+
+	dtVcopy(ray.curPos, startPos);
+	dtVsub(ray.dir, endPos, startPos);
+	dtVset(hit->hitNormal, 0, 0, 0);
+
+	// The API input has been checked already, skip checking internal data.
+	ray.curRef = startRef;
+	ray.tile = 0;
+	ray.poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(ray.curRef, &ray.tile, &ray.poly);
+	ray.nextTile = ray.prevTile = ray.tile;
+	ray.nextPoly = ray.prevPoly = ray.poly;
+	ray.prevRef = prevRef;
+	if (prevRef)
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &ray.prevTile, &ray.prevPoly);
+}
+
+
 /// @par
 ///
 /// This method is meant to be used for quick, short distance checks.
@@ -2466,226 +3117,163 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
 								 const dtQueryFilter* filter, const unsigned int options,
 								 dtRaycastHit* hit, dtPolyRef prevRef) const
+{
+	return raycast<dtQueryFilter>(startRef, startPos, endPos, filter, options, hit, prevRef);
+}
+
+/// @par
+///
+/// Produces the same results as calling #raycast for every request. Consecutive
+/// requests starting from the same polygon, such as the visibility checks from one
+/// agent, are advanced together one polygon at a time. Rays which are in the same
+/// polygon share its vertices, and are intersected with it four at a time.
+///
+/// The status of every request is stored in the request. The function fails
+/// only if the parameters of the batch itself are invalid.
+///
+/// @see raycast
+dtStatus dtNavMeshQuery::raycasts(dtRaycastRequest* requests, const int requestCount,
+								  const dtQueryFilter* filter, const unsigned int options) const
 {
 	dtAssert(m_nav);
 
-	if (!hit)
+	if ((!requests && requestCount > 0) || requestCount < 0 || !filter)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
-	hit->t = 0;
-	hit->pathCount = 0;
-	hit->pathCost = 0;
+	if (requestCount == 0)
+		return DT_SUCCESS;
 
-	// Validate input
-	if (!m_nav->isValidPolyRef(startRef) ||
-		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!filter ||
-		(prevRef && !m_nav->isValidPolyRef(prevRef)))
+	dtRaycastState* rays = (dtRaycastState*)dtAlloc(sizeof(dtRaycastState)*requestCount, DT_ALLOC_TEMP);
+	int* rayRequests = (int*)dtAlloc(sizeof(int)*requestCount, DT_ALLOC_TEMP);
+	int* active = (int*)dtAlloc(sizeof(int)*requestCount, DT_ALLOC_TEMP);
+	if (!rays || !rayRequests || !active)
 	{
-		return DT_FAILURE | DT_INVALID_PARAM;
+		dtFree(rays);
+		dtFree(rayRequests);
+		dtFree(active);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
-	
-	float dir[3], curPos[3], lastPos[3];
-	float verts[DT_VERTS_PER_POLYGON*3+3];	
-	int n = 0;
 
-	dtVcopy(curPos, startPos);
-	dtVsub(dir, endPos, startPos);
-	dtVset(hit->hitNormal, 0, 0, 0);
-
-	dtStatus status = DT_SUCCESS;
-
-	const dtMeshTile* prevTile, *tile, *nextTile;
-	const dtPoly* prevPoly, *poly, *nextPoly;
-	dtPolyRef curRef;
-
-	// The API input has been checked already, skip checking internal data.
-	curRef = startRef;
-	tile = 0;
-	poly = 0;
-	m_nav->getTileAndPolyByRefUnsafe(curRef, &tile, &poly);
-	nextTile = prevTile = tile;
-	nextPoly = prevPoly = poly;
-	if (prevRef)
-		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
-
-	while (curRef)
+	float verts[DT_VERTS_PER_POLYGON*3+3];
+	for (int groupStart = 0; groupStart < requestCount; )
 	{
-		// Cast ray against current polygon.
-		
-		// Collect vertices.
-		int nv = 0;
-		for (int i = 0; i < (int)poly->vertCount; ++i)
-		{
-			dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
-			nv++;
-		}
-		
-		float tmin, tmax;
-		int segMin, segMax;
-		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
-		{
-			// Could not hit the polygon, keep the old t and report hit.
-			hit->pathCount = n;
-			return status;
-		}
-
-		hit->hitEdgeIndex = segMax;
+		int groupEnd = groupStart + 1;
+		while (groupEnd < requestCount && requests[groupEnd].startRef == requests[groupStart].startRef)
+			groupEnd++;
 
-		// Keep track of furthest t so far.
-		if (tmax > hit->t)
-			hit->t = tmax;
-		
-		// Store visited polygons.
-		if (n < hit->maxPath)
-			hit->path[n++] = curRef;
-		else
-			status |= DT_BUFFER_TOO_SMALL;
-
-		// Ray end is completely inside the polygon.
-		if (segMax == -1)
+		int rayCount = 0;
+		for (int i = groupStart; i < groupEnd; ++i)
 		{
-			hit->t = FLT_MAX;
-			hit->pathCount = n;
-			
-			// add the cost
-			if (options & DT_RAYCAST_USE_COSTS)
-				hit->pathCost += filter->getCost(curPos, endPos, prevRef, prevTile, prevPoly, curRef, tile, poly, curRef, tile, poly);
-			return status;
+			dtRaycastRequest& req = requests[i];
+			req.hit.t = 0;
+			req.hit.pathCount = 0;
+			req.hit.pathCost = 0;
+
+			// Validate input
+			if (!m_nav->isValidPolyRef(req.startRef) ||
+				!dtVisfinite(req.startPos) ||
+				!dtVisfinite(req.endPos) ||
+				(req.prevRef && !m_nav->isValidPolyRef(req.prevRef)))
+			{
+				req.status = DT_FAILURE | DT_INVALID_PARAM;
+				continue;
+			}
+
+			initRaycast(rays[rayCount], req.startRef, req.startPos, req.endPos, req.prevRef, &req.hit);
+			rayRequests[rayCount] = i;
+			rayCount++;
 		}
 
-		// Follow neighbours.
-		dtPolyRef nextRef = 0;
-		
-		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		if (rayCount == 1)
 		{
-			const dtLink* link = &tile->links[i];
-			
-			// Find link which contains this edge.
-			if ((int)link->edge != segMax)
-				continue;
-			
-			// Get pointer to the next polygon.
-			nextTile = 0;
-			nextPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(link->ref, &nextTile, &nextPoly);
-			
-			// Skip off-mesh connections.
-			if (nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
-				continue;
-			
-			// Skip links based on filter.
-			if (!filter->passFilter(link->ref, nextTile, nextPoly))
-				continue;
-			
-			// If the link is internal, just return the ref.
-			if (link->side == 0xff)
-			{
-				nextRef = link->ref;
-				break;
-			}
-			
-			// If the link is at tile boundary,
-			
-			// Check if the link spans the whole edge, and accept.
-			if (link->bmin == 0 && link->bmax == 255)
+			// A single ray is walked to its end, like in raycast.
+			dtRaycastState& ray = rays[0];
+			for (;;)
 			{
-				nextRef = link->ref;
-				break;
-			}
-			
-			// Check for partial edge links.
-			const int v0 = poly->verts[link->edge];
-			const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
-			const float* left = &tile->verts[v0*3];
-			const float* right = &tile->verts[v1*3];
-			
-			// Check that the intersection lies inside the link portal.
-			if (link->side == 0 || link->side == 4)
-			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
-				float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find Z intersection.
-				float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
-				if (z >= lmin && z <= lmax)
-				{
-					nextRef = link->ref;
+				const int nv = collectPolyVerts(ray.tile, ray.poly, verts);
+				float tmin, tmax;
+				int segMin, segMax;
+				const bool intersects = dtIntersectSegmentPoly2D(ray.startPos, ray.endPos, verts, nv, tmin, tmax, segMin, segMax);
+				if (!advanceRaycast(ray, filter, options, verts, nv, intersects, tmax, segMax))
 					break;
-				}
 			}
-			else if (link->side == 2 || link->side == 6)
+			requests[rayRequests[0]].status = ray.status;
+			groupStart = groupEnd;
+			continue;
+		}
+
+		// The rays from the same polygon are advanced one polygon at a time, so that the rays
+		// which are in the same polygon can be intersected with it together.
+		for (int i = 0; i < rayCount; ++i)
+			active[i] = i;
+		int activeCount = rayCount;
+		while (activeCount > 0)
+		{
+			// The rays which continue are compacted to the front of the active list, keeping their order.
+			int nextCount = 0;
+			for (int first = 0; first < activeCount; )
 			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
-				float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find X intersection.
-				float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
-				if (x >= lmin && x <= lmax)
+				// Consecutive rays in the same polygon share its vertices.
+				const dtRaycastState& lead = rays[active[first]];
+				int last = first + 1;
+				while (last < activeCount && rays[active[last]].curRef == lead.curRef)
+					last++;
+				const int nv = collectPolyVerts(lead.tile, lead.poly, verts);
+
+				for (int i = first; i < last; i += 4)
 				{
-					nextRef = link->ref;
-					break;
+					const int n = dtMin(4, last - i);
+					float tmin[4], tmax[4];
+					int segMin[4], segMax[4];
+					unsigned int intersects = 0;
+					if (n == 1)
+					{
+						const dtRaycastState& ray = rays[active[i]];
+						if (dtIntersectSegmentPoly2D(ray.startPos, ray.endPos, verts, nv, tmin[0], tmax[0], segMin[0], segMax[0]))
+							intersects = 1;
+					}
+					else
+					{
+						float p0x[4] = { 0, 0, 0, 0 };
+						float p0z[4] = { 0, 0, 0, 0 };
+						float p1x[4] = { 0, 0, 0, 0 };
+						float p1z[4] = { 0, 0, 0, 0 };
+						for (int k = 0; k < n; ++k)
+						{
+							const dtRaycastState& ray = rays[active[i + k]];
+							p0x[k] = ray.startPos[0];
+							p0z[k] = ray.startPos[2];
+							p1x[k] = ray.endPos[0];
+							p1z[k] = ray.endPos[2];
+						}
+						intersects = dtIntersectSegmentPoly2D4(p0x, p0z, p1x, p1z, verts, nv, tmin, tmax, segMin, segMax);
+					}
+
+					for (int k = 0; k < n; ++k)
+					{
+						const int index = active[i + k];
+						const bool hit = (intersects & (1u << k)) != 0;
+						if (advanceRaycast(rays[index], filter, options, verts, nv, hit, tmax[k], segMax[k]))
+							active[nextCount++] = index;
+					}
 				}
-			}
-		}
-		
-		// add the cost
-		if (options & DT_RAYCAST_USE_COSTS)
-		{
-			// compute the intersection point at the furthest end of the polygon
-			// and correct the height (since the raycast moves in 2d)
-			dtVcopy(lastPos, curPos);
-			dtVmad(curPos, startPos, dir, hit->t);
-			float* e1 = &verts[segMax*3];
-			float* e2 = &verts[((segMax+1)%nv)*3];
-			float eDir[3], diff[3];
-			dtVsub(eDir, e2, e1);
-			dtVsub(diff, curPos, e1);
-			float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
-			curPos[1] = e1[1] + eDir[1] * s;
 
-			hit->pathCost += filter->getCost(lastPos, curPos, prevRef, prevTile, prevPoly, curRef, tile, poly, nextRef, nextTile, nextPoly);
+				first = last;
+			}
+			activeCount = nextCount;
 		}
 
-		if (!nextRef)
-		{
-			// No neighbour, we hit a wall.
-			
-			// Calculate hit normal.
-			const int a = segMax;
-			const int b = segMax+1 < nv ? segMax+1 : 0;
-			const float* va = &verts[a*3];
-			const float* vb = &verts[b*3];
-			const float dx = vb[0] - va[0];
-			const float dz = vb[2] - va[2];
-			hit->hitNormal[0] = dz;
-			hit->hitNormal[1] = 0;
-			hit->hitNormal[2] = -dx;
-			dtVnormalize(hit->hitNormal);
-			
-			hit->pathCount = n;
-			return status;
-		}
+		for (int i = 0; i < rayCount; ++i)
+			requests[rayRequests[i]].status = rays[i].status;
 
-		// No hit, advance to neighbour polygon.
-		prevRef = curRef;
-		curRef = nextRef;
-		prevTile = tile;
-		tile = nextTile;
-		prevPoly = poly;
-		poly = nextPoly;
+		groupStart = groupEnd;
 	}
-	
-	hit->pathCount = n;
-	
-	return status;
+
+	dtFree(rays);
+	dtFree(rayRequests);
+	dtFree(active);
+
+	return DT_SUCCESS;
 }
 
 /// @par
@@ -2722,151 +3310,8 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 											   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 											   int* resultCount, const int maxResult) const
 {
-	dtAssert(m_nav);
-	dtAssert(m_nodePool);
-	dtAssert(m_openList);
-
-	if (!resultCount)
-		return DT_FAILURE | DT_INVALID_PARAM;
-
-	*resultCount = 0;
-
-	if (!m_nav->isValidPolyRef(startRef) ||
-		!centerPos || !dtVisfinite(centerPos) ||
-		radius < 0 || !dtMathIsfinite(radius) ||
-		!filter || maxResult < 0)
-	{
-		return DT_FAILURE | DT_INVALID_PARAM;
-	}
-	
-	m_nodePool->clear();
-	m_openList->clear();
-	
-	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, centerPos);
-	startNode->pidx = 0;
-	startNode->cost = 0;
-	startNode->total = 0;
-	startNode->id = startRef;
-	startNode->flags = DT_NODE_OPEN;
-	m_openList->push(startNode);
-	
-	dtStatus status = DT_SUCCESS;
-	
-	int n = 0;
-	
-	const float radiusSqr = dtSqr(radius);
-	
-	while (!m_openList->empty())
-	{
-		dtNode* bestNode = m_openList->pop();
-		bestNode->flags &= ~DT_NODE_OPEN;
-		bestNode->flags |= DT_NODE_CLOSED;
-		
-		// Get poly and tile.
-		// The API input has been cheked already, skip checking internal data.
-		const dtPolyRef bestRef = bestNode->id;
-		const dtMeshTile* bestTile = 0;
-		const dtPoly* bestPoly = 0;
-		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
-		
-		// Get parent poly and tile.
-		dtPolyRef parentRef = 0;
-		const dtMeshTile* parentTile = 0;
-		const dtPoly* parentPoly = 0;
-		if (bestNode->pidx)
-			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
-		if (parentRef)
-			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
-
-		if (n < maxResult)
-		{
-			if (resultRef)
-				resultRef[n] = bestRef;
-			if (resultParent)
-				resultParent[n] = parentRef;
-			if (resultCost)
-				resultCost[n] = bestNode->total;
-			++n;
-		}
-		else
-		{
-			status |= DT_BUFFER_TOO_SMALL;
-		}
-		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
-		{
-			const dtLink* link = &bestTile->links[i];
-			dtPolyRef neighbourRef = link->ref;
-			// Skip invalid neighbours and do not follow back to parent.
-			if (!neighbourRef || neighbourRef == parentRef)
-				continue;
-			
-			// Expand to neighbour
-			const dtMeshTile* neighbourTile = 0;
-			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
-		
-			// Do not advance if the polygon is excluded by the filter.
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
-				continue;
-			
-			// Find edge and calc distance to the edge.
-			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
-				continue;
-			
-			// If the circle is not touching the next polygon, skip it.
-			float tseg;
-			float distSqr = dtDistancePtSegSqr2D(centerPos, va, vb, tseg);
-			if (distSqr > radiusSqr)
-				continue;
-			
-			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
-			if (!neighbourNode)
-			{
-				status |= DT_OUT_OF_NODES;
-				continue;
-			}
-				
-			if (neighbourNode->flags & DT_NODE_CLOSED)
-				continue;
-			
-			// Cost
-			if (neighbourNode->flags == 0)
-				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
-			
-			float cost = filter->getCost(
-				bestNode->pos, neighbourNode->pos,
-				parentRef, parentTile, parentPoly,
-				bestRef, bestTile, bestPoly,
-				neighbourRef, neighbourTile, neighbourPoly);
-
-			const float total = bestNode->total + cost;
-			
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
-				continue;
-			
-			neighbourNode->id = neighbourRef;
-			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
-			neighbourNode->total = total;
-			
-			if (neighbourNode->flags & DT_NODE_OPEN)
-			{
-				m_openList->modify(neighbourNode);
-			}
-			else
-			{
-				neighbourNode->flags = DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
-			}
-		}
-	}
-	
-	*resultCount = n;
-	
-	return status;
+	return findPolysAroundCircle<dtQueryFilter>(startRef, centerPos, radius, filter,
+												resultRef, resultParent, resultCost, resultCount, maxResult);
 }
 
 /// @par
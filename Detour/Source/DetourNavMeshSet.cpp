@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourNavMeshSet.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
+
+static size_t alignSize(const size_t size, const int alignment)
+{
+	return (size + (size_t)alignment-1) & ~((size_t)alignment-1);
+}
+
+static bool isValidAlignment(const int alignment)
+{
+	return alignment >= 16 && (alignment & (alignment-1)) == 0;
+}
+
+static bool isStoredTile(const dtMeshTile* tile)
+{
+	return tile && tile->header && tile->dataSize;
+}
+
+/// @par
+///
+/// The set starts with a #dtNavMeshSetHeader, followed by a #dtNavMeshSetTile for each tile.
+/// The data of each tile starts at a multiple of @p alignment, so that a memory mapped set
+/// can be used in place by #dtLoadNavMeshSet.
+size_t dtGetNavMeshSetSize(const dtNavMesh* mesh, const int alignment)
+{
+	if (!mesh || !isValidAlignment(alignment))
+		return 0;
+
+	int tileCount = 0;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		if (isStoredTile(mesh->getTile(i)))
+			tileCount++;
+	}
+
+	size_t size = alignSize(sizeof(dtNavMeshSetHeader) + sizeof(dtNavMeshSetTile)*tileCount, alignment);
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (isStoredTile(tile))
+			size += alignSize((size_t)tile->dataSize, alignment);
+	}
+	return size;
+}
+
+/// @par
+///
+/// The tiles are stored with their current references, so that the same references are
+/// valid after the set is loaded. The padding between the tiles is cleared.
+dtStatus dtStoreNavMeshSet(const dtNavMesh* mesh, const int alignment, unsigned char* data, const size_t dataSize)
+{
+	if (!mesh || !data || !isValidAlignment(alignment))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (dataSize < dtGetNavMeshSetSize(mesh, alignment))
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	memset(data, 0, dataSize);
+
+	dtNavMeshSetHeader* header = (dtNavMeshSetHeader*)data;
+	header->magic = DT_NAVMESH_SET_MAGIC;
+	header->version = DT_NAVMESH_SET_VERSION;
+	header->alignment = alignment;
+	header->tileCount = 0;
+	memcpy(&header->params, mesh->getParams(), sizeof(dtNavMeshParams));
+
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		if (isStoredTile(mesh->getTile(i)))
+			header->tileCount++;
+	}
+
+	dtNavMeshSetTile* tiles = (dtNavMeshSetTile*)(data + sizeof(dtNavMeshSetHeader));
+	size_t offset = alignSize(sizeof(dtNavMeshSetHeader) + sizeof(dtNavMeshSetTile)*header->tileCount, alignment);
+	int n = 0;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!isStoredTile(tile))
+			continue;
+
+		const size_t page = offset / (size_t)alignment;
+		if (page > 0xffffffff)
+			return DT_FAILURE | DT_INVALID_PARAM;
+
+		dtNavMeshSetTile& entry = tiles[n++];
+		entry.tileRef = mesh->getTileRef(tile);
+		entry.dataPage = (unsigned int)page;
+		entry.dataSize = tile->dataSize;
+		memcpy(data + offset, tile->data, tile->dataSize);
+
+		offset += alignSize((size_t)tile->dataSize, alignment);
+	}
+	dtAssert(offset <= dataSize);
+
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// The tiles are added to the navigation mesh in place, without #DT_TILE_FREE_DATA.
+/// The set data must stay valid until the navigation mesh has been freed, and must be
+/// writable: the navigation mesh stores the polygon links within the tile data.
+///
+/// The set is typically a private (copy-on-write) memory mapping of a file. Loading it
+/// then only touches the pages holding the tile headers, polygons and links. The pages
+/// holding the vertices, detail meshes and bounding volume trees stay shared with the file
+/// and are read in when first used.
+dtStatus dtLoadNavMeshSet(dtNavMesh* mesh, unsigned char* data, const size_t dataSize)
+{
+	if (!mesh || !data || ((size_t)data & 7) != 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (dataSize < sizeof(dtNavMeshSetHeader))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtNavMeshSetHeader* header = (const dtNavMeshSetHeader*)data;
+	if (header->magic != DT_NAVMESH_SET_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header->version != DT_NAVMESH_SET_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	if (!isValidAlignment(header->alignment) || header->tileCount < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if ((size_t)header->tileCount > (dataSize - sizeof(dtNavMeshSetHeader)) / sizeof(dtNavMeshSetTile))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtStatus status = mesh->init(&header->params);
+	if (dtStatusFailed(status))
+		return status;
+
+	const dtNavMeshSetTile* tiles = (const dtNavMeshSetTile*)(data + sizeof(dtNavMeshSetHeader));
+	for (int i = 0; i < header->tileCount; ++i)
+	{
+		const dtNavMeshSetTile& entry = tiles[i];
+		if ((size_t)entry.dataPage > dataSize / (size_t)header->alignment)
+			return DT_FAILURE | DT_INVALID_PARAM;
+		const size_t offset = (size_t)entry.dataPage * (size_t)header->alignment;
+		if (entry.dataSize < (int)sizeof(dtMeshHeader) || (size_t)entry.dataSize > dataSize - offset)
+			return DT_FAILURE | DT_INVALID_PARAM;
+
+		status = mesh->addTile(data + offset, entry.dataSize, 0, entry.tileRef, 0);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	return DT_SUCCESS;
+}
@@ -48,6 +48,130 @@ inline unsigned int dtHashRef(dtPolyRef a)
 #endif
 
 //////////////////////////////////////////////////////////////////////////////////////////
+#ifdef DT_OPEN_ADDRESSING_NODE_POOL
+
+static const unsigned int DT_NODE_STATE_MASK = (1 << DT_NODE_STATE_BITS) - 1;
+
+dtNodePool::dtNodePool(int maxNodes, int hashSize) :
+	m_nodes(0),
+	m_slots(0),
+	m_slotCount(0),
+	m_maxNodes(maxNodes),
+	m_hashSize(hashSize),
+	m_nodeCount(0)
+{
+	dtAssert(dtNextPow2(m_hashSize) == (unsigned int)m_hashSize);
+	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_MAX_POOL_NODES);
+
+	// Keep the table at most half full, so that the probe sequences stay short.
+	m_slotCount = dtMax((int)dtNextPow2((unsigned int)m_maxNodes*2), m_hashSize);
+
+	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
+	m_slots = (dtNodeSlot*)dtAlloc(sizeof(dtNodeSlot)*m_slotCount, DT_ALLOC_PERM);
+
+	dtAssert(m_nodes);
+	dtAssert(m_slots);
+
+	memset(m_slots, 0xff, sizeof(dtNodeSlot)*m_slotCount);
+}
+
+dtNodePool::~dtNodePool()
+{
+	dtFree(m_nodes);
+	dtFree(m_slots);
+}
+
+void dtNodePool::clear()
+{
+	// Small searches in a large pool touch only a few slots, clear just those.
+	// The nodes are removed in reverse order, so the probe sequences of the
+	// remaining nodes, which never pass a slot filled later, stay intact.
+	if (m_nodeCount*8 < m_slotCount)
+	{
+		for (int i = m_nodeCount-1; i >= 0; --i)
+		{
+			dtNodeSlot* slot = findSlot(m_nodes[i].id, (unsigned char)m_nodes[i].state);
+			dtAssert(slot->node != DT_NULL_IDX);
+			slot->node = DT_NULL_IDX;
+		}
+	}
+	else
+	{
+		memset(m_slots, 0xff, sizeof(dtNodeSlot)*m_slotCount);
+	}
+	m_nodeCount = 0;
+}
+
+dtNodePool::dtNodeSlot* dtNodePool::findSlot(dtPolyRef id, unsigned char state)
+{
+	const unsigned int mask = (unsigned int)m_slotCount-1;
+	const unsigned int key = state;
+	unsigned int i = dtHashRef(id) & mask;
+	for (;;)
+	{
+		dtNodeSlot* slot = &m_slots[i];
+		if (slot->node == DT_NULL_IDX)
+			return slot;
+		if (slot->id == id && (slot->node & DT_NODE_STATE_MASK) == key)
+			return slot;
+		i = (i+1) & mask;
+	}
+}
+
+unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNodes)
+{
+	int n = 0;
+	const unsigned int mask = (unsigned int)m_slotCount-1;
+	for (unsigned int i = dtHashRef(id) & mask; m_slots[i].node != DT_NULL_IDX; i = (i+1) & mask)
+	{
+		if (m_slots[i].id == id)
+		{
+			if (n >= maxNodes)
+				return n;
+			nodes[n++] = &m_nodes[m_slots[i].node >> DT_NODE_STATE_BITS];
+		}
+	}
+
+	return n;
+}
+
+dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state)
+{
+	const dtNodeSlot* slot = findSlot(id, state);
+	if (slot->node == DT_NULL_IDX)
+		return 0;
+	return &m_nodes[slot->node >> DT_NODE_STATE_BITS];
+}
+
+dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
+{
+	dtNodeSlot* slot = findSlot(id, state);
+	if (slot->node != DT_NULL_IDX)
+		return &m_nodes[slot->node >> DT_NODE_STATE_BITS];
+	
+	if (m_nodeCount >= m_maxNodes)
+		return 0;
+	
+	const unsigned int i = (unsigned int)m_nodeCount;
+	m_nodeCount++;
+	
+	// Init node
+	dtNode* node = &m_nodes[i];
+	node->pidx = 0;
+	node->cost = 0;
+	node->total = 0;
+	node->id = id;
+	node->state = state;
+	node->flags = 0;
+	
+	slot->id = id;
+	slot->node = (i << DT_NODE_STATE_BITS) | state;
+	
+	return node;
+}
+
+#else // DT_OPEN_ADDRESSING_NODE_POOL
+
 dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	m_nodes(0),
 	m_first(0),
@@ -57,9 +181,7 @@ dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	m_nodeCount(0)
 {
 	dtAssert(dtNextPow2(m_hashSize) == (unsigned int)m_hashSize);
-	// pidx is special as 0 means "none" and 1 is the first node. For that reason
-	// we have 1 fewer nodes available than the number of values it can contain.
-	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_NULL_IDX && m_maxNodes <= (1 << DT_NODE_PARENT_BITS) - 1);
+	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_MAX_POOL_NODES);
 
 	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
 	m_next = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
@@ -82,7 +204,16 @@ dtNodePool::~dtNodePool()
 
 void dtNodePool::clear()
 {
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	// Small searches in a large pool touch only a few buckets, clear just those.
+	if (m_nodeCount*8 < m_hashSize)
+	{
+		for (int i = 0; i < m_nodeCount; ++i)
+			m_first[dtHashRef(m_nodes[i].id) & (m_hashSize-1)] = DT_NULL_IDX;
+	}
+	else
+	{
+		memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	}
 	m_nodeCount = 0;
 }
 
@@ -151,6 +282,7 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 	return node;
 }
 
+#endif // DT_OPEN_ADDRESSING_NODE_POOL
 
 //////////////////////////////////////////////////////////////////////////////////////////
 dtNodeQueue::dtNodeQueue(int n) :
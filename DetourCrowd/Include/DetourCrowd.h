@@ -198,6 +198,18 @@ struct dtCrowdAgentDebugInfo
 	dtObstacleAvoidanceDebugData* vod;
 };
 
+/// The query objects a worker uses to update its share of the agents.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtCrowd::setTaskDispatcher
+struct dtCrowdWorker
+{
+	dtNavMeshQuery* navquery;					///< The query used for the corridors and boundaries of the agents.
+	dtObstacleAvoidanceQuery* obstacleQuery;	///< The query used to sample the velocities of the agents.
+	int velocitySampleCount;					///< The number of velocity samples taken by the worker during the update.
+};
+
+struct dtCrowdUpdateJob;
+
 /// Provides local steering behaviors for a group of agents. 
 /// @ingroup crowd
 class dtCrowd
@@ -227,6 +239,10 @@ class dtCrowd
 
 	dtNavMeshQuery* m_navquery;
 
+	dtTaskDispatcher* m_dispatcher;
+	dtCrowdWorker* m_workers;
+	int m_workerCount;
+
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
 	void checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt);
@@ -235,6 +251,11 @@ class dtCrowd
 
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
 
+	void runUpdatePhase(const int phase, dtCrowdUpdateJob& job);
+	void updateAgentRange(const int phase, const int first, const int last, dtCrowdWorker& worker, const dtCrowdUpdateJob& job);
+	static void runUpdateTask(int index, int worker, void* userData);
+
+	void freeWorkers();
 	void purge();
 	
 public:
@@ -316,6 +337,11 @@ public:
 	///  @param[in]		dt		The time, in seconds, to update the simulation. [Limit: > 0]
 	///  @param[out]	debug	A debug object to load with debug information. [Opt]
 	void update(const float dt, dtCrowdAgentDebugInfo* debug);
+
+	/// Sets the dispatcher used to spread the phases of #update() over several workers.
+	///  @param[in]		dispatcher	The dispatcher, or null to update all agents on the calling thread.
+	/// @return True if the queries of the workers were allocated.
+	bool setTaskDispatcher(dtTaskDispatcher* dispatcher);
 	
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
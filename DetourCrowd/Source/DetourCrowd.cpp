@@ -303,6 +303,7 @@ A common method for setting up the crowd is as follows:
 -# Initialize the crowd using #init().
 -# Set the avoidance configurations using #setObstacleAvoidanceParams().
 -# Add agents using #addAgent() and make an initial movement request using #requestMoveTarget().
+-# Optionally spread the updates over several threads using #setTaskDispatcher().
 
 A common process for managing the crowd is as follows:
 
@@ -339,7 +340,10 @@ dtCrowd::dtCrowd() :
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_dispatcher(0),
+	m_workers(0),
+	m_workerCount(0)
 {
 }
 
@@ -348,8 +352,25 @@ dtCrowd::~dtCrowd()
 	purge();
 }
 
+void dtCrowd::freeWorkers()
+{
+	// The first worker uses the queries of the crowd.
+	for (int i = 1; i < m_workerCount; ++i)
+	{
+		dtFreeNavMeshQuery(m_workers[i].navquery);
+		dtFreeObstacleAvoidanceQuery(m_workers[i].obstacleQuery);
+	}
+	dtFree(m_workers);
+	m_workers = 0;
+	m_workerCount = 0;
+}
+
 void dtCrowd::purge()
 {
+	freeWorkers();
+	m_dispatcher = 0;
+
+
 	for (int i = 0; i < m_maxAgents; ++i)
 		m_agents[i].~dtCrowdAgent();
 	dtFree(m_agents);
@@ -457,6 +478,10 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 		return false;
 	if (dtStatusFailed(m_navquery->init(nav, MAX_COMMON_NODES)))
 		return false;
+
+	// Update all agents on the calling thread until a dispatcher is set.
+	if (!setTaskDispatcher(0))
+		return false;
 	
 	return true;
 }
@@ -1043,289 +1068,377 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 	}
 }
 	
-void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
+/// The phases of dtCrowd::update which are run over ranges of agents.
+/// Within a phase an agent only changes its own state, so the agents can be updated in any order.
+enum dtCrowdUpdatePhase
 {
-	m_velocitySampleCount = 0;
-	
-	const int debugIdx = debug ? debug->idx : -1;
-	
-	dtCrowdAgent** agents = m_activeAgents;
-	int nagents = getActiveAgents(agents, m_maxAgents);
+	DT_CROWD_UPDATE_NEIGHBOURS,
+	DT_CROWD_UPDATE_CORNERS,
+	DT_CROWD_UPDATE_OFFMESH_TRIGGERS,
+	DT_CROWD_UPDATE_STEERING,
+	DT_CROWD_UPDATE_VELOCITY_PLANNING,
+	DT_CROWD_UPDATE_INTEGRATION,
+	DT_CROWD_UPDATE_COLLISION_DISPLACEMENT,
+	DT_CROWD_UPDATE_COLLISION_RESOLVE,
+	DT_CROWD_UPDATE_MOVE_ALONG_NAVMESH,
+	DT_CROWD_UPDATE_OFFMESH_ANIMATIONS,
+};
+
+/// The number of agents updated by a single task.
+static const int AGENTS_PER_TASK = 32;
+
+struct dtCrowdUpdateJob
+{
+	dtCrowd* crowd;
+	int phase;
+	float dt;
+	dtCrowdAgentDebugInfo* debug;
+	dtCrowdAgent** agents;
+	int nagents;
+};
 
-	// Check that all agents still have valid paths.
-	checkPathValidity(agents, nagents, dt);
-	
-	// Update async move request and path finder.
-	updateMoveRequest(dt);
+/// @par
+///
+/// The dispatcher must outlive its use by the crowd, and its worker count must not change.
+/// Each worker gets its own navigation mesh query and obstacle avoidance query, the first
+/// worker uses the queries of the crowd. Must be called after #init().
+///
+/// The agents are updated exactly as without a dispatcher, so the results do not depend
+/// on the number of workers.
+bool dtCrowd::setTaskDispatcher(dtTaskDispatcher* dispatcher)
+{
+	freeWorkers();
+	m_dispatcher = 0;
 
-	// Optimize path topology.
-	updateTopologyOptimization(agents, nagents, dt);
-	
-	// Register agents to proximity grid.
-	m_grid->clear();
-	for (int i = 0; i < nagents; ++i)
+	const int workerCount = dispatcher ? dtMax(dispatcher->getWorkerCount(), 1) : 1;
+	m_workers = (dtCrowdWorker*)dtAlloc(sizeof(dtCrowdWorker)*workerCount, DT_ALLOC_PERM);
+	if (!m_workers)
+		return false;
+	memset(m_workers, 0, sizeof(dtCrowdWorker)*workerCount);
+	m_workerCount = workerCount;
+
+	m_workers[0].navquery = m_navquery;
+	m_workers[0].obstacleQuery = m_obstacleQuery;
+	for (int i = 1; i < workerCount; ++i)
 	{
-		dtCrowdAgent* ag = agents[i];
-		const float* p = ag->npos;
-		const float r = ag->params.radius;
-		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
+		dtCrowdWorker& worker = m_workers[i];
+		worker.navquery = dtAllocNavMeshQuery();
+		if (!worker.navquery)
+			return false;
+		if (dtStatusFailed(worker.navquery->init(m_navquery->getAttachedNavMesh(), MAX_COMMON_NODES)))
+			return false;
+		worker.obstacleQuery = dtAllocObstacleAvoidanceQuery();
+		if (!worker.obstacleQuery)
+			return false;
+		if (!worker.obstacleQuery->init(6, 8))
+			return false;
 	}
-	
-	// Get nearby navmesh segments and agents to collide with.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
 
-		// Update the collision boundary after certain distance has been passed or
-		// if it has become invalid.
-		const float updateThr = ag->params.collisionQueryRange*0.25f;
-		if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
-			!ag->boundary.isValid(m_navquery, &m_filters[ag->params.queryFilterType]))
-		{
-			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
-								m_navquery, &m_filters[ag->params.queryFilterType]);
-		}
-		// Query neighbour agents
-		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
-								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
-								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
+	m_dispatcher = workerCount > 1 ? dispatcher : 0;
+	return true;
+}
+
+void dtCrowd::runUpdateTask(int index, int worker, void* userData)
+{
+	const dtCrowdUpdateJob& job = *(const dtCrowdUpdateJob*)userData;
+	dtCrowd* crowd = job.crowd;
+	const int first = index*AGENTS_PER_TASK;
+	const int last = dtMin(first + AGENTS_PER_TASK, job.nagents);
+	crowd->updateAgentRange(job.phase, first, last, crowd->m_workers[worker], job);
+}
+
+void dtCrowd::runUpdatePhase(const int phase, dtCrowdUpdateJob& job)
+{
+	job.phase = phase;
+	if (m_dispatcher && job.nagents > AGENTS_PER_TASK)
+	{
+		const int taskCount = (job.nagents + AGENTS_PER_TASK-1) / AGENTS_PER_TASK;
+		m_dispatcher->parallelFor(taskCount, runUpdateTask, &job);
 	}
-	
-	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
+	else
 	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
-		
-		// Check to see if the corner after the next corner is directly visible,
-		// and short cut to there.
-		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
-		{
-			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
-			
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
-				dtVcopy(debug->optEnd, target);
-			}
-		}
-		else
+		updateAgentRange(phase, 0, job.nagents, m_workers[0], job);
+	}
+}
+
+void dtCrowd::updateAgentRange(const int phase, const int first, const int last, dtCrowdWorker& worker, const dtCrowdUpdateJob& job)
+{
+	const float dt = job.dt;
+	dtCrowdAgentDebugInfo* debug = job.debug;
+	const int debugIdx = debug ? debug->idx : -1;
+	dtCrowdAgent** agents = job.agents;
+	const int nagents = job.nagents;
+	dtNavMeshQuery* navquery = worker.navquery;
+	dtObstacleAvoidanceQuery* obstacleQuery = worker.obstacleQuery;
+
+	switch (phase)
+	{
+	case DT_CROWD_UPDATE_NEIGHBOURS:
+		// Get nearby navmesh segments and agents to collide with.
+		for (int i = first; i < last; ++i)
 		{
-			// Copy data for debug purposes.
-			if (debugIdx == i)
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+
+			// Update the collision boundary after certain distance has been passed or
+			// if it has become invalid.
+			const float updateThr = ag->params.collisionQueryRange*0.25f;
+			if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
+				!ag->boundary.isValid(navquery, &m_filters[ag->params.queryFilterType]))
 			{
-				dtVset(debug->optStart, 0,0,0);
-				dtVset(debug->optEnd, 0,0,0);
+				ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
+									navquery, &m_filters[ag->params.queryFilterType]);
 			}
+			// Query neighbour agents
+			ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+									  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
+									  agents, nagents, m_grid);
+			for (int j = 0; j < ag->nneis; j++)
+				ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 		}
-	}
-	
-	// Trigger off-mesh connections (depends on corners).
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Check 
-		const float triggerRadius = ag->params.radius*2.25f;
-		if (overOffmeshConnection(ag, triggerRadius))
+		break;
+
+	case DT_CROWD_UPDATE_CORNERS:
+		// Find next corner to steer to.
+		for (int i = first; i < last; ++i)
 		{
-			// Prepare to off-mesh connection.
-			const int idx = (int)(ag - m_agents);
-			dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
+			dtCrowdAgent* ag = agents[i];
+			
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				continue;
+			
+			// Find corners for steering
+			ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+													DT_CROWDAGENT_MAX_CORNERS, navquery, &m_filters[ag->params.queryFilterType]);
 			
-			// Adjust the path over the off-mesh connection.
-			dtPolyRef refs[2];
-			if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
-													   anim->startPos, anim->endPos, m_navquery))
+			// Check to see if the corner after the next corner is directly visible,
+			// and short cut to there.
+			if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
 			{
-				dtVcopy(anim->initPos, ag->npos);
-				anim->polyRef = refs[1];
-				anim->active = true;
-				anim->t = 0.0f;
-				anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
+				const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
+				ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, navquery, &m_filters[ag->params.queryFilterType]);
 				
-				ag->state = DT_CROWDAGENT_STATE_OFFMESH;
-				ag->ncorners = 0;
-				ag->nneis = 0;
-				continue;
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVcopy(debug->optStart, ag->corridor.getPos());
+					dtVcopy(debug->optEnd, target);
+				}
 			}
 			else
 			{
-				// Path validity check will ensure that bad/blocked connections will be replanned.
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVset(debug->optStart, 0,0,0);
+					dtVset(debug->optEnd, 0,0,0);
+				}
 			}
 		}
-	}
-		
-	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
+		break;
 
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
-			continue;
-		
-		float dvel[3] = {0,0,0};
-
-		if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			dtVcopy(dvel, ag->targetPos);
-			ag->desiredSpeed = dtVlen(ag->targetPos);
-		}
-		else
+	case DT_CROWD_UPDATE_OFFMESH_TRIGGERS:
+		// Trigger off-mesh connections (depends on corners).
+		for (int i = first; i < last; ++i)
 		{
-			// Calculate steering direction.
-			if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
-				calcSmoothSteerDirection(ag, dvel);
-			else
-				calcStraightSteerDirection(ag, dvel);
+			dtCrowdAgent* ag = agents[i];
 			
-			// Calculate speed scale, which tells the agent to slowdown at the end of the path.
-			const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
-			const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				continue;
+			
+			// Check 
+			const float triggerRadius = ag->params.radius*2.25f;
+			if (overOffmeshConnection(ag, triggerRadius))
+			{
+				// Prepare to off-mesh connection.
+				const int idx = (int)(ag - m_agents);
+				dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
 				
-			ag->desiredSpeed = ag->params.maxSpeed;
-			dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+				// Adjust the path over the off-mesh connection.
+				dtPolyRef refs[2];
+				if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
+														   anim->startPos, anim->endPos, navquery))
+				{
+					dtVcopy(anim->initPos, ag->npos);
+					anim->polyRef = refs[1];
+					anim->active = true;
+					anim->t = 0.0f;
+					anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
+					
+					ag->state = DT_CROWDAGENT_STATE_OFFMESH;
+					ag->ncorners = 0;
+					ag->nneis = 0;
+					continue;
+				}
+				else
+				{
+					// Path validity check will ensure that bad/blocked connections will be replanned.
+				}
+			}
 		}
+		break;
 
-		// Separation
-		if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+	case DT_CROWD_UPDATE_STEERING:
+		// Calculate steering.
+		for (int i = first; i < last; ++i)
 		{
-			const float separationDist = ag->params.collisionQueryRange; 
-			const float invSeparationDist = 1.0f / separationDist; 
-			const float separationWeight = ag->params.separationWeight;
-			
-			float w = 0;
-			float disp[3] = {0,0,0};
+			dtCrowdAgent* ag = agents[i];
+
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
 			
-			for (int j = 0; j < ag->nneis; ++j)
+			float dvel[3] = {0,0,0};
+
+			if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+				dtVcopy(dvel, ag->targetPos);
+				ag->desiredSpeed = dtVlen(ag->targetPos);
+			}
+			else
+			{
+				// Calculate steering direction.
+				if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
+					calcSmoothSteerDirection(ag, dvel);
+				else
+					calcStraightSteerDirection(ag, dvel);
 				
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
+				// Calculate speed scale, which tells the agent to slowdown at the end of the path.
+				const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
+				const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+					
+				ag->desiredSpeed = ag->params.maxSpeed;
+				dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+			}
+
+			// Separation
+			if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+			{
+				const float separationDist = ag->params.collisionQueryRange; 
+				const float invSeparationDist = 1.0f / separationDist; 
+				const float separationWeight = ag->params.separationWeight;
 				
-				const float distSqr = dtVlenSqr(diff);
-				if (distSqr < 0.00001f)
-					continue;
-				if (distSqr > dtSqr(separationDist))
-					continue;
-				const float dist = dtMathSqrtf(distSqr);
-				const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+				float w = 0;
+				float disp[3] = {0,0,0};
 				
-				dtVmad(disp, disp, diff, weight/dist);
-				w += 1.0f;
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
+					
+					const float distSqr = dtVlenSqr(diff);
+					if (distSqr < 0.00001f)
+						continue;
+					if (distSqr > dtSqr(separationDist))
+						continue;
+					const float dist = dtMathSqrtf(distSqr);
+					const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+					
+					dtVmad(disp, disp, diff, weight/dist);
+					w += 1.0f;
+				}
+				
+				if (w > 0.0001f)
+				{
+					// Adjust desired velocity.
+					dtVmad(dvel, dvel, disp, 1.0f/w);
+					// Clamp desired velocity to desired speed.
+					const float speedSqr = dtVlenSqr(dvel);
+					const float desiredSqr = dtSqr(ag->desiredSpeed);
+					if (speedSqr > desiredSqr)
+						dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				}
 			}
 			
-			if (w > 0.0001f)
-			{
-				// Adjust desired velocity.
-				dtVmad(dvel, dvel, disp, 1.0f/w);
-				// Clamp desired velocity to desired speed.
-				const float speedSqr = dtVlenSqr(dvel);
-				const float desiredSqr = dtSqr(ag->desiredSpeed);
-				if (speedSqr > desiredSqr)
-					dtVscale(dvel, dvel, desiredSqr/speedSqr);
-			}
+			// Set the desired velocity.
+			dtVcopy(ag->dvel, dvel);
 		}
-		
-		// Set the desired velocity.
-		dtVcopy(ag->dvel, dvel);
-	}
-	
-	// Velocity planning.	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
-		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
+		break;
+
+	case DT_CROWD_UPDATE_VELOCITY_PLANNING:
+		// Velocity planning.	
+		for (int i = first; i < last; ++i)
 		{
-			m_obstacleQuery->reset();
+			dtCrowdAgent* ag = agents[i];
 			
-			// Add neighbours as obstacles.
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
-			}
-
-			// Append neighbour segments as obstacles.
-			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			
+			if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
 			{
-				const float* s = ag->boundary.getSegment(j);
-				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
-					continue;
-				m_obstacleQuery->addSegment(s, s+3);
-			}
+				obstacleQuery->reset();
+				
+				// Add neighbours as obstacles.
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+				}
 
-			dtObstacleAvoidanceDebugData* vod = 0;
-			if (debugIdx == i) 
-				vod = debug->vod;
-			
-			// Sample new safe velocity.
-			bool adaptive = true;
-			int ns = 0;
+				// Append neighbour segments as obstacles.
+				for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+				{
+					const float* s = ag->boundary.getSegment(j);
+					if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+						continue;
+					obstacleQuery->addSegment(s, s+3);
+				}
 
-			const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+				dtObstacleAvoidanceDebugData* vod = 0;
+				if (debugIdx == i) 
+					vod = debug->vod;
 				
-			if (adaptive)
-			{
-				ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
-															 ag->vel, ag->dvel, ag->nvel, params, vod);
+				// Sample new safe velocity.
+				bool adaptive = true;
+				int ns = 0;
+
+				const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+					
+				if (adaptive)
+				{
+					ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+															   ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				else
+				{
+					ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
+														   ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				worker.velocitySampleCount += ns;
 			}
 			else
 			{
-				ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-														 ag->vel, ag->dvel, ag->nvel, params, vod);
+				// If not using velocity planning, new velocity is directly the desired velocity.
+				dtVcopy(ag->nvel, ag->dvel);
 			}
-			m_velocitySampleCount += ns;
 		}
-		else
+		break;
+
+	case DT_CROWD_UPDATE_INTEGRATION:
+		// Integrate.
+		for (int i = first; i < last; ++i)
 		{
-			// If not using velocity planning, new velocity is directly the desired velocity.
-			dtVcopy(ag->nvel, ag->dvel);
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			integrate(ag, dt);
 		}
-	}
+		break;
 
-	// Integrate.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		integrate(ag, dt);
-	}
-	
-	// Handle collisions.
-	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
-	
-	for (int iter = 0; iter < 4; ++iter)
+	case DT_CROWD_UPDATE_COLLISION_DISPLACEMENT:
 	{
-		for (int i = 0; i < nagents; ++i)
+		static const float COLLISION_RESOLVE_FACTOR = 0.7f;
+
+		for (int i = first; i < last; ++i)
 		{
 			dtCrowdAgent* ag = agents[i];
 			const int idx0 = getAgentIndex(ag);
@@ -1376,8 +1489,11 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 				dtVscale(ag->disp, ag->disp, iw);
 			}
 		}
-		
-		for (int i = 0; i < nagents; ++i)
+		break;
+	}
+
+	case DT_CROWD_UPDATE_COLLISION_RESOLVE:
+		for (int i = first; i < last; ++i)
 		{
 			dtCrowdAgent* ag = agents[i];
 			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
@@ -1385,65 +1501,131 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 			
 			dtVadd(ag->npos, ag->npos, ag->disp);
 		}
-	}
-	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
-		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
-		// Get valid constrained position back.
-		dtVcopy(ag->npos, ag->corridor.getPos());
+		break;
 
-		// If not using path, truncate the corridor to just one poly.
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+	case DT_CROWD_UPDATE_MOVE_ALONG_NAVMESH:
+		for (int i = first; i < last; ++i)
 		{
-			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
-			ag->partial = false;
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			
+			// Move along navmesh.
+			ag->corridor.movePosition(ag->npos, navquery, &m_filters[ag->params.queryFilterType]);
+			// Get valid constrained position back.
+			dtVcopy(ag->npos, ag->corridor.getPos());
+
+			// If not using path, truncate the corridor to just one poly.
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			{
+				ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+				ag->partial = false;
+			}
+
 		}
+		break;
 
+	case DT_CROWD_UPDATE_OFFMESH_ANIMATIONS:
+		// Update agents using off-mesh connection.
+		for (int i = first; i < last; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			const int idx = (int)(ag - m_agents);
+			dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
+			if (!anim->active)
+				continue;
+			
+
+			anim->t += dt;
+			if (anim->t > anim->tmax)
+			{
+				// Reset animation
+				anim->active = false;
+				// Prepare agent for walking.
+				ag->state = DT_CROWDAGENT_STATE_WALKING;
+				continue;
+			}
+			
+			// Update position
+			const float ta = anim->tmax*0.15f;
+			const float tb = anim->tmax;
+			if (anim->t < ta)
+			{
+				const float u = tween(anim->t, 0.0, ta);
+				dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
+			}
+			else
+			{
+				const float u = tween(anim->t, ta, tb);
+				dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
+			}
+				
+			// Update velocity.
+			dtVset(ag->vel, 0,0,0);
+			dtVset(ag->dvel, 0,0,0);
+		}
+		break;
 	}
+}
+
+/// @par
+///
+/// With a task dispatcher, the steering, avoidance and movement phases are split into
+/// ranges of agents and run on the workers of the dispatcher. See #setTaskDispatcher().
+void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	m_velocitySampleCount = 0;
 	
-	// Update agents using off-mesh connection.
+	dtCrowdAgent** agents = m_activeAgents;
+	int nagents = getActiveAgents(agents, m_maxAgents);
+
+	// Check that all agents still have valid paths.
+	checkPathValidity(agents, nagents, dt);
+	
+	// Update async move request and path finder.
+	updateMoveRequest(dt);
+
+	// Optimize path topology.
+	updateTopologyOptimization(agents, nagents, dt);
+	
+	// Register agents to proximity grid.
+	m_grid->clear();
 	for (int i = 0; i < nagents; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
-		const int idx = (int)(ag - m_agents);
-		dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
-		if (!anim->active)
-			continue;
-		
+		const float* p = ag->npos;
+		const float r = ag->params.radius;
+		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
+	}
 
-		anim->t += dt;
-		if (anim->t > anim->tmax)
-		{
-			// Reset animation
-			anim->active = false;
-			// Prepare agent for walking.
-			ag->state = DT_CROWDAGENT_STATE_WALKING;
-			continue;
-		}
-		
-		// Update position
-		const float ta = anim->tmax*0.15f;
-		const float tb = anim->tmax;
-		if (anim->t < ta)
-		{
-			const float u = tween(anim->t, 0.0, ta);
-			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
-		}
-		else
-		{
-			const float u = tween(anim->t, ta, tb);
-			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
-		}
-			
-		// Update velocity.
-		dtVset(ag->vel, 0,0,0);
-		dtVset(ag->dvel, 0,0,0);
+	dtCrowdUpdateJob job;
+	job.crowd = this;
+	job.phase = 0;
+	job.dt = dt;
+	job.debug = debug;
+	job.agents = agents;
+	job.nagents = nagents;
+
+	runUpdatePhase(DT_CROWD_UPDATE_NEIGHBOURS, job);
+	runUpdatePhase(DT_CROWD_UPDATE_CORNERS, job);
+	runUpdatePhase(DT_CROWD_UPDATE_OFFMESH_TRIGGERS, job);
+	runUpdatePhase(DT_CROWD_UPDATE_STEERING, job);
+
+	for (int i = 0; i < m_workerCount; ++i)
+		m_workers[i].velocitySampleCount = 0;
+	runUpdatePhase(DT_CROWD_UPDATE_VELOCITY_PLANNING, job);
+	for (int i = 0; i < m_workerCount; ++i)
+		m_velocitySampleCount += m_workers[i].velocitySampleCount;
+
+	runUpdatePhase(DT_CROWD_UPDATE_INTEGRATION, job);
+
+	// Handle collisions.
+	for (int iter = 0; iter < 4; ++iter)
+	{
+		runUpdatePhase(DT_CROWD_UPDATE_COLLISION_DISPLACEMENT, job);
+		runUpdatePhase(DT_CROWD_UPDATE_COLLISION_RESOLVE, job);
 	}
-	
+
+	runUpdatePhase(DT_CROWD_UPDATE_MOVE_ALONG_NAVMESH, job);
+	runUpdatePhase(DT_CROWD_UPDATE_OFFMESH_ANIMATIONS, job);
 }
@@ -94,10 +94,14 @@ enum rcTimerLabel
 	RC_TIMER_BUILD_POLYMESHDETAIL,
 	/// The time to merge polygon mesh details. (See: #rcMergePolyMeshDetails)
 	RC_TIMER_MERGE_POLYMESHDETAIL,
+	/// The time to apply the fused heightfield filters. (See: #rcFilterHeightfield)
+	RC_TIMER_FILTER_HEIGHTFIELD,
 	/// The maximum number of timers.  (Used for iterating timers.)
 	RC_MAX_TIMERS
 };
 
+class rcTempArena;
+
 /// Provides an interface for optional logging and performance tracking of the Recast 
 /// build process.
 /// 
@@ -116,7 +120,7 @@ class rcContext
 public:
 	/// Constructor.
 	///  @param[in]		state	TRUE if the logging and performance timers should be enabled.  [Default: true]
-	inline rcContext(bool state = true) : m_logEnabled(state), m_timerEnabled(state) {}
+	inline rcContext(bool state = true) : m_logEnabled(state), m_timerEnabled(state), m_tempArena(0) {}
 	virtual ~rcContext() {}
 
 	/// Enables or disables logging.
@@ -158,6 +162,22 @@ public:
 	/// @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	inline int getAccumulatedTime(const rcTimerLabel label) const { return m_timerEnabled ? doGetAccumulatedTime(label) : -1; }
 
+	/// Adds time measured outside of the context to the specified performance timer.
+	/// The parallel build functions use it to report the time their workers spent in a stage.
+	/// @param	label	The category of the timer.
+	/// @param	time	The time to add. [Units: us]
+	inline void addAccumulatedTime(const rcTimerLabel label, const int time) { if (m_timerEnabled) doAddAccumulatedTime(label, time); }
+
+	/// Sets the arena the build functions allocate their temporary memory from.
+	/// The context does not take ownership of the arena.
+	///  @param[in]		arena	The arena to use, or null to use the Recast allocator.
+	/// @see rcTempArena
+	inline void setTempArena(rcTempArena* arena) { m_tempArena = arena; }
+
+	/// Returns the arena the build functions allocate their temporary memory from.
+	/// @return The arena, or null if the Recast allocator is used.
+	inline rcTempArena* getTempArena() const { return m_tempArena; }
+
 protected:
 	/// Clears all log entries.
 	virtual void doResetLog();
@@ -183,12 +203,20 @@ protected:
 	/// @param[in]		label	The category of the timer.
 	/// @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	virtual int doGetAccumulatedTime(const rcTimerLabel label) const { rcIgnoreUnused(label); return -1; }
+
+	/// Adds time measured outside of the context to the specified performance timer.
+	/// @param[in]		label	The category of the timer.
+	/// @param[in]		time	The time to add. [Units: us]
+	virtual void doAddAccumulatedTime(const rcTimerLabel label, const int time) { rcIgnoreUnused(label); rcIgnoreUnused(time); }
 	
 	/// True if logging is enabled.
 	bool m_logEnabled;
 
 	/// True if the performance timers are enabled.
 	bool m_timerEnabled;
+
+	/// The arena for temporary allocations, or null.
+	rcTempArena* m_tempArena;
 };
 
 /// A helper to first start a timer and then stop it when this helper goes out of scope.
@@ -321,6 +349,7 @@ struct rcHeightfield
 	float cs;			///< The size of each cell. (On the xz-plane.)
 	float ch;			///< The height of each cell. (The minimum increment along the y-axis.)
 	rcSpan** spans;		///< Heightfield of spans (width*height).
+	int maxColumns;		///< The number of columns the #spans array can hold.
 	rcSpanPool* pools;	///< Linked list of span pools.
 	rcSpan* freelist;	///< The next free span.
 
@@ -330,6 +359,54 @@ private:
 	rcHeightfield& operator=(const rcHeightfield&);
 };
 
+/// Represents a span in a column heightfield.
+/// @see rcColumnHeightfield
+struct rcColumnSpan
+{
+	unsigned int smin : RC_SPAN_HEIGHT_BITS; ///< The lower limit of the span. [Limit: < #smax]
+	unsigned int smax : RC_SPAN_HEIGHT_BITS; ///< The upper limit of the span. [Limit: <= #RC_SPAN_MAX_HEIGHT]
+	unsigned int area : 6;                   ///< The area id assigned to the span.
+};
+
+/// Provides information on the spans of a cell column in a column heightfield.
+/// @see rcColumnHeightfield
+struct rcHeightfieldColumn
+{
+	unsigned int index;			///< Index to the first span in the column.
+	unsigned short count;		///< Number of spans in the column.
+	unsigned short capacity;	///< Number of spans the column can hold before it is moved.
+};
+
+/// A dynamic heightfield representing obstructed space, storing the spans of each column in a contiguous array.
+///
+/// Holds the same spans as #rcHeightfield, sorted from the bottom of the column up, but without a pointer
+/// per span. The columns live in a shared span buffer. A column that runs out of room is moved to the end
+/// of the buffer, and the buffer is packed whenever it grows.
+/// @ingroup recast
+/// @see rcCreateHeightfield, rcRasterizeTriangles, rcFilterHeightfield, rcBuildCompactHeightfield
+struct rcColumnHeightfield
+{
+	rcColumnHeightfield();
+	~rcColumnHeightfield();
+
+	int width;						///< The width of the heightfield. (Along the x-axis in cell units.)
+	int height;						///< The height of the heightfield. (Along the z-axis in cell units.)
+	float bmin[3];  				///< The minimum bounds in world space. [(x, y, z)]
+	float bmax[3];					///< The maximum bounds in world space. [(x, y, z)]
+	float cs;						///< The size of each cell. (On the xz-plane.)
+	float ch;						///< The height of each cell. (The minimum increment along the y-axis.)
+	rcHeightfieldColumn* columns;	///< The columns of the heightfield. [Size: #width*#height]
+	rcColumnSpan* spans;			///< The span buffer holding the spans of all columns. [Size: #maxSpans]
+	int usedSpans;					///< The number of spans used in the buffer, including the room of moved columns.
+	int maxSpans;					///< The number of spans the #spans buffer can hold.
+	int maxColumns;					///< The number of columns the #columns array can hold.
+
+private:
+	// Explicitly-disabled copy constructor and copy assignment operator.
+	rcColumnHeightfield(const rcColumnHeightfield&);
+	rcColumnHeightfield& operator=(const rcColumnHeightfield&);
+};
+
 /// Provides information on the content of a cell column in a compact heightfield. 
 struct rcCompactCell
 {
@@ -367,8 +444,10 @@ struct rcCompactHeightfield
 	float ch;					///< The height of each cell. (The minimum increment along the y-axis.)
 	rcCompactCell* cells;		///< Array of cells. [Size: #width*#height]
 	rcCompactSpan* spans;		///< Array of spans. [Size: #spanCount]
-	unsigned short* dist;		///< Array containing border distance data. [Size: #spanCount]
+	unsigned short* dist;		///< Array containing border distance data, zero until the distance field is built again. [Size: #spanCount]
 	unsigned char* areas;		///< Array containing area id data. [Size: #spanCount]
+	int maxCells;				///< The number of cells the #cells array can hold.
+	int maxSpans;				///< The number of spans the #spans, #areas and #dist arrays can hold.
 	
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -423,6 +502,8 @@ struct rcContour
 	int nrverts;		///< The number of vertices in the raw contour. 
 	unsigned short reg;	///< The region id of the contour.
 	unsigned char area;	///< The area id of the contour.
+	int maxverts;		///< The number of vertices the #verts array can hold.
+	int maxrverts;		///< The number of vertices the #rverts array can hold.
 };
 
 /// Represents a group of related contours.
@@ -434,6 +515,7 @@ struct rcContourSet
 	
 	rcContour* conts;	///< An array of the contours in the set. [Size: #nconts]
 	int nconts;			///< The number of contours in the set.
+	int maxconts;		///< The number of contours the #conts array can hold.
 	float bmin[3];  	///< The minimum bounds in world space. [(x, y, z)]
 	float bmax[3];		///< The maximum bounds in world space. [(x, y, z)]
 	float cs;			///< The size of each cell. (On the xz-plane.)
@@ -464,6 +546,7 @@ struct rcPolyMesh
 	int nverts;				///< The number of vertices.
 	int npolys;				///< The number of polygons.
 	int maxpolys;			///< The number of allocated polygons.
+	int maxverts;			///< The number of allocated vertices.
 	int nvp;				///< The maximum number of vertices per polygon.
 	float bmin[3];			///< The minimum bounds in world space. [(x, y, z)]
 	float bmax[3];			///< The maximum bounds in world space. [(x, y, z)]
@@ -515,6 +598,31 @@ rcHeightfield* rcAllocHeightfield();
 /// @see rcAllocHeightfield
 void rcFreeHeightField(rcHeightfield* heightfield);
 
+/// Removes all spans from the heightfield, keeping its memory for the next build.
+/// The spans are returned to the free list of the span pools.
+/// @param[in,out]	heightfield	The heightfield to reset.
+/// @ingroup recast
+/// @see rcCreateHeightfield
+void rcResetHeightfield(rcHeightfield& heightfield);
+
+/// Allocates a column heightfield object using the Recast allocator.
+/// @return A column heightfield that is ready for initialization, or null on failure.
+/// @ingroup recast
+/// @see rcCreateHeightfield, rcFreeColumnHeightfield
+rcColumnHeightfield* rcAllocColumnHeightfield();
+
+/// Frees the specified column heightfield object using the Recast allocator.
+/// @param[in]		heightfield	A column heightfield allocated using #rcAllocColumnHeightfield
+/// @ingroup recast
+/// @see rcAllocColumnHeightfield
+void rcFreeColumnHeightfield(rcColumnHeightfield* heightfield);
+
+/// Removes all spans from the column heightfield, keeping its memory for the next build.
+/// @param[in,out]	heightfield	The column heightfield to reset.
+/// @ingroup recast
+/// @see rcCreateHeightfield
+void rcResetHeightfield(rcColumnHeightfield& heightfield);
+
 /// Allocates a compact heightfield object using the Recast allocator.
 /// @return A compact heightfield that is ready for initialization, or null on failure.
 /// @ingroup recast
@@ -527,6 +635,12 @@ rcCompactHeightfield* rcAllocCompactHeightfield();
 /// @see rcAllocCompactHeightfield
 void rcFreeCompactHeightfield(rcCompactHeightfield* compactHeightfield);
 
+/// Empties the compact heightfield, keeping its memory for the next build.
+/// @param[in,out]	compactHeightfield		The compact heightfield to reset.
+/// @ingroup recast
+/// @see rcBuildCompactHeightfield
+void rcResetCompactHeightfield(rcCompactHeightfield& compactHeightfield);
+
 /// Allocates a heightfield layer set using the Recast allocator.
 /// @return A heightfield layer set that is ready for initialization, or null on failure.
 /// @ingroup recast
@@ -551,6 +665,12 @@ rcContourSet* rcAllocContourSet();
 /// @see rcAllocContourSet
 void rcFreeContourSet(rcContourSet* contourSet);
 
+/// Empties the contour set, keeping the memory of the contours for the next build.
+/// @param[in,out]	contourSet	The contour set to reset.
+/// @ingroup recast
+/// @see rcBuildContours
+void rcResetContourSet(rcContourSet& contourSet);
+
 /// Allocates a polygon mesh object using the Recast allocator.
 /// @return A polygon mesh that is ready for initialization, or null on failure.
 /// @ingroup recast
@@ -563,6 +683,12 @@ rcPolyMesh* rcAllocPolyMesh();
 /// @see rcAllocPolyMesh
 void rcFreePolyMesh(rcPolyMesh* polyMesh);
 
+/// Empties the polygon mesh, keeping its memory for the next build.
+/// @param[in,out]	polyMesh	The polygon mesh to reset.
+/// @ingroup recast
+/// @see rcBuildPolyMesh
+void rcResetPolyMesh(rcPolyMesh& polyMesh);
+
 /// Allocates a detail mesh object using the Recast allocator.
 /// @return A detail mesh that is ready for initialization, or null on failure.
 /// @ingroup recast
@@ -616,6 +742,16 @@ enum rcBuildContoursFlags
 	RC_CONTOUR_TESS_AREA_EDGES = 0x02	///< Tessellate edges between areas during contour simplification.
 };
 
+/// Heightfield filter flags.
+/// @see rcFilterHeightfield
+enum rcFilterFlags
+{
+	RC_FILTER_LOW_HANGING_OBSTACLES = 0x01,		///< Apply #rcFilterLowHangingWalkableObstacles.
+	RC_FILTER_LEDGE_SPANS = 0x02,				///< Apply #rcFilterLedgeSpans.
+	RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS = 0x04,	///< Apply #rcFilterWalkableLowHeightSpans.
+	RC_FILTER_ALL = 0x07						///< Apply all of the filters.
+};
+
 /// Applied to the region id field of contour vertices in order to extract the region id.
 /// The region id field of a vertex may have several flags applied to it.  So the
 /// fields value can't be used directly.
@@ -830,10 +966,31 @@ void rcCalcBounds(const float* verts, int numVerts, float* minBounds, float* max
 /// @param[out]		sizeZ		The height along the z-axis. [Limit: >= 0] [Units: vx]
 void rcCalcGridSize(const float* minBounds, const float* maxBounds, float cellSize, int* sizeX, int* sizeZ);
 
+/// Calculates the range of heightfield columns which need to be rebuilt when the geometry within the
+/// specified bounds changes. The range includes the neighbouring columns, as used by #rcFilterLedgeSpans.
+///
+/// To update a heightfield after some of its geometry changed, calculate the range from the bounds of
+/// both the old and the new geometry, remove the spans of the range using #rcClearSpans, rasterize the
+/// triangles into the range and run the filters over the range. The updated columns are identical to the
+/// ones of a heightfield built from scratch, if the triangles are rasterized in the same order.
+/// @ingroup recast
+/// @param[in]		heightfield	The heightfield to update.
+/// @param[in]		minBounds	The minimum bounds of the changed geometry. [(x, y, z)] [Units: wu]
+/// @param[in]		maxBounds	The maximum bounds of the changed geometry. [(x, y, z)] [Units: wu]
+/// @param[out]		minX		The minimum column x index of the range.
+/// @param[out]		minZ		The minimum column z index of the range.
+/// @param[out]		maxX		The maximum column x index of the range. (Inclusive)
+/// @param[out]		maxZ		The maximum column z index of the range. (Inclusive)
+/// @returns False if the bounds do not overlap the heightfield.
+bool rcCalcColumnRange(const rcHeightfield& heightfield, const float* minBounds, const float* maxBounds,
+                       int* minX, int* minZ, int* maxX, int* maxZ);
+
 /// Initializes a new heightfield.
 /// See the #rcConfig documentation for more information on the configuration parameters.
+///
+/// The heightfield may have been used before, its span pools and column array are reused.
 /// 
-/// @see rcAllocHeightfield, rcHeightfield
+/// @see rcAllocHeightfield, rcHeightfield, rcResetHeightfield
 /// @ingroup recast
 /// 
 /// @param[in,out]	context		The build context to use during the operation.
@@ -849,6 +1006,14 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 						 const float* minBounds, const float* maxBounds,
 						 float cellSize, float cellHeight);
 
+/// Initializes a new column heightfield.
+/// The heightfield may have been used before, its column array and span buffer are reused.
+/// @ingroup recast
+/// @see rcCreateHeightfield, rcAllocColumnHeightfield, rcColumnHeightfield
+bool rcCreateHeightfield(rcContext* context, rcColumnHeightfield& heightfield, int sizeX, int sizeZ,
+						 const float* minBounds, const float* maxBounds,
+						 float cellSize, float cellHeight);
+
 /// Sets the area id of all triangles with a slope below the specified value
 /// to #RC_WALKABLE_AREA.
 ///
@@ -915,6 +1080,49 @@ bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
                unsigned short spanMin, unsigned short spanMax,
                unsigned char areaID, int flagMergeThreshold);
 
+/// Adds a span to the specified column heightfield, merging it the same way as into an #rcHeightfield.
+/// @ingroup recast
+/// @see rcAddSpan
+bool rcAddSpan(rcContext* context, rcColumnHeightfield& heightfield,
+               int x, int z,
+               unsigned short spanMin, unsigned short spanMax,
+               unsigned char areaID, int flagMergeThreshold);
+
+/// The kernels which can be used to rasterize triangles.
+/// @see rcSetRasterizationKernel
+enum rcRasterizationKernel
+{
+	RC_RASTERIZATION_REFERENCE = 0,	///< Clips the triangle cell by cell. The default.
+	RC_RASTERIZATION_BATCHED,		///< Finds the spans of several cells of a row at once, without SIMD instructions.
+	RC_RASTERIZATION_SSE2,			///< The batched kernel, using SSE2 instructions.
+	RC_RASTERIZATION_AVX2			///< The batched kernel, using AVX2 instructions.
+};
+
+/// Selects the kernel used by #rcRasterizeTriangle and #rcRasterizeTriangles.
+///
+/// The batched kernels find the height range of several cells of a row at once,
+/// and then add the spans of the row. They all produce the same spans, which can
+/// differ from the reference kernel where the rounding of a span height differs.
+///
+/// The kernel is shared by all threads, so it should be selected before any
+/// heightfields are built.
+///
+/// @see rcGetBestRasterizationKernel
+/// @ingroup recast
+/// @param[in]		kernel		The kernel to use.
+/// @returns False if the kernel is not supported by the build or the processor.
+bool rcSetRasterizationKernel(rcRasterizationKernel kernel);
+
+/// Gets the kernel used by #rcRasterizeTriangle and #rcRasterizeTriangles.
+/// @ingroup recast
+/// @returns The kernel in use.
+rcRasterizationKernel rcGetRasterizationKernel();
+
+/// Gets the fastest batched kernel supported by the build and the processor.
+/// @ingroup recast
+/// @returns The fastest supported kernel.
+rcRasterizationKernel rcGetBestRasterizationKernel();
+
 /// Rasterizes a single triangle into the specified heightfield.
 ///
 /// Calling this for each triangle in a mesh is less efficient than calling rcRasterizeTriangles
@@ -936,6 +1144,13 @@ bool rcRasterizeTriangle(rcContext* context,
                          const float* v0, const float* v1, const float* v2,
                          unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes a single triangle into the specified column heightfield.
+/// @ingroup recast
+/// @see rcRasterizeTriangle
+bool rcRasterizeTriangle(rcContext* context,
+                         const float* v0, const float* v1, const float* v2,
+                         unsigned char areaID, rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
 /// Rasterizes an indexed triangle mesh into the specified heightfield.
 ///
 /// Spans will only be added for triangles that overlap the heightfield grid.
@@ -957,6 +1172,15 @@ bool rcRasterizeTriangles(rcContext* context,
                           const int* tris, const unsigned char* triAreaIDs, int numTris,
                           rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes an indexed triangle mesh into the specified column heightfield.
+/// The column heightfield gets the same spans as an #rcHeightfield would.
+/// @ingroup recast
+/// @see rcRasterizeTriangles
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, int numVerts,
+                          const int* tris, const unsigned char* triAreaIDs, int numTris,
+                          rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
 /// Rasterizes an indexed triangle mesh into the specified heightfield.
 ///
 /// Spans will only be added for triangles that overlap the heightfield grid.
@@ -978,6 +1202,70 @@ bool rcRasterizeTriangles(rcContext* context,
                           const unsigned short* tris, const unsigned char* triAreaIDs, int numTris,
                           rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes an indexed triangle mesh into the specified column heightfield.
+/// The column heightfield gets the same spans as an #rcHeightfield would.
+/// @ingroup recast
+/// @see rcRasterizeTriangles
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, int numVerts,
+                          const unsigned short* tris, const unsigned char* triAreaIDs, int numTris,
+                          rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes an indexed triangle mesh into a range of columns of the specified heightfield.
+///
+/// Spans will only be added to the columns within the range. The triangles are clipped the same way
+/// as by the other overloads, so the columns get the same spans as when rasterizing the whole heightfield.
+/// Used to update the columns emptied by #rcClearSpans after the geometry changed.
+/// 
+/// @see rcHeightfield, rcCalcColumnRange
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The vertices. [(x, y, z) * @p nv]
+/// @param[in]		numVerts			The number of vertices. (unused)
+/// @param[in]		tris				The triangle indices. [(vertA, vertB, vertC) * @p nt]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		minX				The minimum column x index of the range.
+/// @param[in]		minZ				The minimum column z index of the range.
+/// @param[in]		maxX				The maximum column x index of the range. (Inclusive)
+/// @param[in]		maxZ				The maximum column z index of the range. (Inclusive)
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag. 
+///										[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, int numVerts,
+                          const int* tris, const unsigned char* triAreaIDs, int numTris,
+                          rcHeightfield& heightfield,
+                          int minX, int minZ, int maxX, int maxZ,
+                          int flagMergeThreshold = 1);
+
+/// Rasterizes an indexed triangle mesh into a column heightfield holding a band of rows of a larger grid.
+///
+/// The grid has the bounds and cell size of the heightfield. Its rows from @p firstRow up to
+/// @p firstRow + heightfield.height - 1 are stored in the heightfield. The triangles are clipped against
+/// the whole grid, so the band gets the same spans as those rows of a heightfield covering the grid.
+/// 
+/// @see rcColumnHeightfield, rcRasterizeCompactHeightfield
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The vertices. [(x, y, z) * @p nv]
+/// @param[in]		numVerts			The number of vertices. (unused)
+/// @param[in]		tris				The triangle indices. [(vertA, vertB, vertC) * @p nt]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in,out]	heightfield			An initialized heightfield holding the rows of the band.
+/// @param[in]		firstRow			The row of the grid stored in the first row of the heightfield. [Limit: >= 0]
+/// @param[in]		gridHeight			The number of rows of the grid. [Limit: >= @p firstRow + heightfield.height]
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag. 
+///										[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeTriangleBand(rcContext* context,
+                             const float* verts, int numVerts,
+                             const int* tris, const unsigned char* triAreaIDs, int numTris,
+                             rcColumnHeightfield& heightfield, int firstRow, int gridHeight,
+                             int flagMergeThreshold = 1);
+
 /// Rasterizes a triangle list into the specified heightfield.
 ///
 /// Expects each triangle to be specified as three sequential vertices of 3 floats.
@@ -998,6 +1286,26 @@ bool rcRasterizeTriangles(rcContext* context,
                           const float* verts, const unsigned char* triAreaIDs, int numTris,
                           rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes a triangle list into the specified column heightfield.
+/// The column heightfield gets the same spans as an #rcHeightfield would.
+/// @ingroup recast
+/// @see rcRasterizeTriangles
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const unsigned char* triAreaIDs, int numTris,
+                          rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Removes all spans from a range of columns of the specified heightfield.
+/// The spans are returned to the span pool of the heightfield, to be reused by the next rasterization.
+/// @see rcHeightfield, rcCalcColumnRange
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in,out]	heightfield		The heightfield to remove the spans from.
+/// @param[in]		minX			The minimum column x index of the range.
+/// @param[in]		minZ			The minimum column z index of the range.
+/// @param[in]		maxX			The maximum column x index of the range. (Inclusive)
+/// @param[in]		maxZ			The maximum column z index of the range. (Inclusive)
+void rcClearSpans(rcContext* context, rcHeightfield& heightfield, int minX, int minZ, int maxX, int maxZ);
+
 /// Marks non-walkable spans as walkable if their maximum is within @p walkableClimb of a walkable neighbor.
 ///
 /// Allows the formation of walkable regions that will flow over low lying 
@@ -1017,6 +1325,13 @@ bool rcRasterizeTriangles(rcContext* context,
 /// @param[in,out]	heightfield			A fully built heightfield.  (All spans have been added.)
 void rcFilterLowHangingWalkableObstacles(rcContext* context, int walkableClimb, rcHeightfield& heightfield);
 
+/// Marks non-walkable spans within a range of columns as walkable if their maximum is within @p walkableClimb
+/// of a walkable neighbor. Used after re-rasterizing the columns. (See: #rcCalcColumnRange)
+/// @ingroup recast
+/// @see rcFilterLowHangingWalkableObstacles
+void rcFilterLowHangingWalkableObstacles(rcContext* context, int walkableClimb, rcHeightfield& heightfield,
+                                         int minX, int minZ, int maxX, int maxZ);
+
 /// Marks spans that are ledges as not-walkable.
 ///
 /// A ledge is a span with one or more neighbors whose maximum is further away than @p walkableClimb
@@ -1037,6 +1352,13 @@ void rcFilterLowHangingWalkableObstacles(rcContext* context, int walkableClimb,
 /// @param[in,out]	heightfield			A fully built heightfield.  (All spans have been added.)
 void rcFilterLedgeSpans(rcContext* context, int walkableHeight, int walkableClimb, rcHeightfield& heightfield);
 
+/// Marks spans within a range of columns that are ledges as not-walkable. The neighbours of the columns
+/// are read, but not modified. Used after re-rasterizing the columns. (See: #rcCalcColumnRange)
+/// @ingroup recast
+/// @see rcFilterLedgeSpans
+void rcFilterLedgeSpans(rcContext* context, int walkableHeight, int walkableClimb, rcHeightfield& heightfield,
+                        int minX, int minZ, int maxX, int maxZ);
+
 /// Marks walkable spans as not walkable if the clearance above the span is less than the specified height.
 /// 
 /// For this filter, the clearance above the span is the distance from the span's 
@@ -1051,6 +1373,50 @@ void rcFilterLedgeSpans(rcContext* context, int walkableHeight, int walkableClim
 /// @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
 void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcHeightfield& heightfield);
 
+/// Marks walkable spans within a range of columns as not walkable if the clearance above the span is less
+/// than the specified height. Used after re-rasterizing the columns. (See: #rcCalcColumnRange)
+/// @ingroup recast
+/// @see rcFilterWalkableLowHeightSpans
+void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcHeightfield& heightfield,
+                                    int minX, int minZ, int maxX, int maxZ);
+
+/// Applies the selected span filters to the heightfield in a single pass.
+///
+/// Produces the same result as calling #rcFilterLowHangingWalkableObstacles, #rcFilterLedgeSpans and
+/// #rcFilterWalkableLowHeightSpans in that order, but visits each column only once.
+///
+/// @see rcHeightfield, rcConfig, rcFilterFlags
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+/// 								be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
+/// @param[in]		filterFlags		The filters to apply. [Limit: Combination of #rcFilterFlags]
+void rcFilterHeightfield(rcContext* context, int walkableHeight, int walkableClimb, rcHeightfield& heightfield,
+                         int filterFlags = RC_FILTER_ALL);
+
+/// Applies the selected span filters to a range of columns in a single pass. The neighbours of the columns
+/// are read, but not modified. Used after re-rasterizing the columns. (See: #rcCalcColumnRange)
+/// @ingroup recast
+/// @see rcFilterHeightfield
+void rcFilterHeightfield(rcContext* context, int walkableHeight, int walkableClimb, rcHeightfield& heightfield,
+                         int minX, int minZ, int maxX, int maxZ, int filterFlags = RC_FILTER_ALL);
+
+/// Applies the selected span filters to a column heightfield in a single pass.
+/// Produces the same spans as filtering an #rcHeightfield built from the same geometry.
+/// @ingroup recast
+/// @see rcFilterHeightfield
+void rcFilterHeightfield(rcContext* context, int walkableHeight, int walkableClimb, rcColumnHeightfield& heightfield,
+                         int filterFlags = RC_FILTER_ALL);
+
+/// Applies the selected span filters to a range of columns of a column heightfield in a single pass.
+/// @ingroup recast
+/// @see rcFilterHeightfield
+void rcFilterHeightfield(rcContext* context, int walkableHeight, int walkableClimb, rcColumnHeightfield& heightfield,
+                         int minX, int minZ, int maxX, int maxZ, int filterFlags = RC_FILTER_ALL);
+
 /// Returns the number of spans contained in the specified heightfield.
 ///  @ingroup recast
 ///  @param[in,out]	context		The build context to use during the operation.
@@ -1058,6 +1424,11 @@ void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcHe
 ///  @returns The number of spans in the heightfield.
 int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfield);
 
+/// Returns the number of walkable spans contained in the specified column heightfield.
+///  @ingroup recast
+///  @see rcGetHeightFieldSpanCount
+int rcGetHeightFieldSpanCount(rcContext* context, const rcColumnHeightfield& heightfield);
+
 /// @}
 /// @name Compact Heightfield Functions
 /// @see rcCompactHeightfield
@@ -1085,6 +1456,35 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walkableClimb,
 							   const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
 
+/// Builds a compact heightfield representing open space, from a column heightfield representing solid space.
+/// Produces the same compact heightfield as building from an #rcHeightfield with the same spans.
+/// @ingroup recast
+/// @see rcBuildCompactHeightfield
+bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walkableClimb,
+							   const rcColumnHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
+
+/// Rasterizes an indexed triangle mesh, filters it and builds a compact heightfield from it in a single pass,
+/// without building a heightfield of the whole mesh.
+///
+/// @see rcAllocCompactHeightfield, rcCompactHeightfield, rcConfig
+/// @ingroup recast
+///
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		config				The configuration. The grid size, bounds, cell sizes, walkable height
+/// 									and walkable climb are used.
+/// @param[in]		verts				The vertices. [(x, y, z) * @p numVerts]
+/// @param[in]		numVerts			The number of vertices.
+/// @param[in]		tris				The triangle indices. [(vertA, vertB, vertC) * @p numTris]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p numTris]
+/// @param[in]		numTris				The number of triangles.
+/// @param[out]		compactHeightfield	The resulting compact heightfield. (Must be pre-allocated.)
+/// @param[in]		filterFlags			The filters to apply. [Limit: Combination of #rcFilterFlags]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeCompactHeightfield(rcContext* context, const rcConfig& config,
+								   const float* verts, int numVerts,
+								   const int* tris, const unsigned char* triAreaIDs, int numTris,
+								   rcCompactHeightfield& compactHeightfield, int filterFlags = RC_FILTER_ALL);
+
 /// Erodes the walkable area within the heightfield by the specified radius. 
 /// @ingroup recast
 /// @param[in,out]	ctx		The build context to use during the operation.
@@ -52,6 +52,9 @@ typedef void (rcFreeFunc)(void* ptr);
 void rcAllocSetCustom(rcAllocFunc *allocFunc, rcFreeFunc *freeFunc);
 
 /// Allocates a memory block.
+///
+/// While the calling thread is within an #rcTempArenaScope, #RC_ALLOC_TEMP
+/// allocations are made from the arena of the scope.
 /// 
 /// @param[in]		size	The size, in bytes of memory, to allocate.
 /// @param[in]		hint	A hint to the allocator on how long the memory is expected to be in use.
@@ -369,4 +372,121 @@ private:
 	rcScopedDelete& operator=(const rcScopedDelete&);
 };
 
+struct rcTempArenaBlock;
+
+/// A position in a temporary memory arena, returned by rcTempArena::mark().
+/// @note This structure is rarely if ever used by the end user.
+struct rcTempArenaMark
+{
+	rcTempArenaBlock* block;	///< The block allocations were made from, or null if no block was in use.
+	size_t offset;				///< The number of bytes used in @p block.
+	size_t used;				///< The total number of bytes allocated.
+};
+
+/// A bump allocator for temporary memory.
+///
+/// Memory is handed out from large blocks and is freed all at once by releasing
+/// the arena to an earlier mark. The blocks are kept for the following allocations,
+/// so once the arena has grown to fit a build, temporary allocations no longer
+/// reach the general heap.
+///
+/// Attach an arena to a context with rcContext::setTempArena(). The build functions
+/// then allocate their #RC_ALLOC_TEMP memory from the arena and release it before
+/// returning. An arena must only be used by one thread at a time, so when building
+/// on several threads, each context should have its own arena.
+/// @see rcTempArenaScope
+class rcTempArena
+{
+public:
+	/// Constructor.
+	///  @param[in]		blockSize	The size of the blocks allocated for the arena. [Units: bytes]
+	///  							Larger allocations get a block of their own.
+	explicit rcTempArena(size_t blockSize = 1024*1024);
+	~rcTempArena();
+
+	/// Allocates memory from the arena.
+	///  @param[in]		size	The size, in bytes of memory, to allocate.
+	/// @return A pointer to the allocated memory, aligned to 16 bytes, or null if a new block could not be allocated.
+	void* alloc(size_t size);
+
+	/// Frees memory allocated from the arena.
+	/// The memory is only reclaimed if it was the last allocation made, otherwise it is
+	/// reclaimed when the arena is released.
+	///  @param[in]		ptr		A pointer to memory allocated using #alloc.
+	void free(void* ptr);
+
+	/// Checks if the memory was allocated from the arena.
+	///  @param[in]		ptr		A pointer to a memory block.
+	/// @return True if @p ptr points to memory within the blocks of the arena.
+	bool owns(const void* ptr) const;
+
+	/// Gets the current position of the arena.
+	/// @return The position to pass to #release to free everything allocated after this call.
+	rcTempArenaMark mark() const;
+
+	/// Frees all allocations made since the mark was taken.
+	///  @param[in]		mark	A position returned by #mark.
+	void release(const rcTempArenaMark& mark);
+
+	/// Frees all allocations. The blocks are kept for reuse.
+	void reset();
+
+	/// Frees all allocations and returns the blocks to the Recast allocator.
+	void purge();
+
+	/// The number of bytes currently allocated from the arena.
+	size_t getUsedSize() const { return m_used; }
+
+	/// The largest number of bytes allocated from the arena at once since it was created
+	/// or the peak was last reset.
+	size_t getPeakSize() const { return m_peak; }
+
+	/// Resets the peak usage to the current usage.
+	void resetPeakSize() { m_peak = m_used; }
+
+	/// The number of bytes held in blocks by the arena.
+	size_t getReservedSize() const { return m_reserved; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTempArena(const rcTempArena&);
+	rcTempArena& operator=(const rcTempArena&);
+
+	size_t m_blockSize;
+	rcTempArenaBlock* m_first;		///< The first block of the arena.
+	rcTempArenaBlock* m_current;	///< The block allocations are made from, or null before the first allocation.
+	size_t m_offset;				///< The number of bytes used in the current block.
+	size_t m_used;
+	size_t m_peak;
+	size_t m_reserved;
+	void* m_last;					///< The last allocation, or null if it has been freed.
+	size_t m_lastSize;				///< The aligned size of the last allocation.
+};
+
+/// Routes the #RC_ALLOC_TEMP allocations of the calling thread to an arena while in scope.
+///
+/// The arena is marked when the scope is entered, and released to the mark when the
+/// scope is left, so everything allocated within the scope must also be freed within it.
+/// Scopes can be nested. A null arena leaves the routing of the thread unchanged.
+/// @note This class is rarely if ever used by the end user.
+class rcTempArenaScope
+{
+public:
+	/// Starts routing temporary allocations to the arena.
+	///  @param[in]		arena	The arena to allocate from, or null.
+	explicit rcTempArenaScope(rcTempArena* arena);
+
+	/// Releases the arena and restores the previous routing.
+	~rcTempArenaScope();
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTempArenaScope(const rcTempArenaScope&);
+	rcTempArenaScope& operator=(const rcTempArenaScope&);
+
+	rcTempArena* m_arena;
+	rcTempArena* m_prev;
+	rcTempArenaMark m_mark;
+};
+
 #endif
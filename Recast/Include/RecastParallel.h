@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTPARALLEL_H
+#define RECASTPARALLEL_H
+
+#include "Recast.h"
+
+/// A task executed by #rcThreadPool::parallelFor.
+///  @param[in]		index		The index of the task. [Limits: 0 <= value < count]
+///  @param[in]		worker		The index of the worker running the task. [Limits: 0 <= value < #rcThreadPool::getWorkerCount]
+///  @param[in]		userData	The user data passed to #rcThreadPool::parallelFor.
+typedef void (rcParallelTaskFunc)(int index, int worker, void* userData);
+
+/// A fixed size pool of worker threads used to run independent Recast build tasks in parallel.
+///
+/// Tasks are distributed to the workers in contiguous ranges. A worker which runs out of
+/// work steals the back half of the largest remaining range, so uneven task costs
+/// (e.g. empty vs. dense tiles) still keep all workers busy.
+///
+/// The thread calling #parallelFor takes part in the work as worker 0, so a pool
+/// initialized with @p workerCount workers creates @p workerCount - 1 threads.
+///
+/// Nested calls to #parallelFor (from within a running task) are executed serially
+/// on the calling worker.
+///
+/// @note Recast objects such as rcContext are not thread safe. Use the worker index passed
+/// to the task to select per-worker state.
+/// @ingroup recast
+class rcThreadPool
+{
+public:
+	rcThreadPool();
+	~rcThreadPool();
+
+	/// Starts the worker threads.
+	///  @param[in]		workerCount		The number of workers, including the calling thread. [Limit: > 0]
+	/// @returns True if the operation completed successfully.
+	bool init(int workerCount);
+
+	/// Stops and joins all worker threads. Called automatically by the destructor.
+	void shutdown();
+
+	/// The number of workers in the pool, including the calling thread.
+	/// @returns The number of workers, or 1 if the pool has not been initialized.
+	int getWorkerCount() const;
+
+	/// Runs @p func for every index in [0, @p count) and returns once all tasks have completed.
+	///  @param[in]		count		The number of tasks to run.
+	///  @param[in]		func		The task function.
+	///  @param[in]		userData	User data passed to each task. [opt]
+	void parallelFor(int count, rcParallelTaskFunc* func, void* userData);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcThreadPool(const rcThreadPool&);
+	rcThreadPool& operator=(const rcThreadPool&);
+
+	struct rcThreadPoolImpl* m_impl;
+};
+
+/// A build context which measures the time of the performance timers itself, and has no log.
+///
+/// The build functions running a stage on the workers of a thread pool time it with one
+/// context per worker, and add the times to the context of the caller with #addTimesTo.
+/// @ingroup recast
+class rcTimerContext : public rcContext
+{
+public:
+	rcTimerContext();
+
+	/// Adds the accumulated time of every timer which has been started to @p ctx.
+	///  @param[in,out]	ctx		The context to add the times to.
+	void addTimesTo(rcContext* ctx) const;
+
+protected:
+	virtual void doResetTimers();
+	virtual void doStartTimer(const rcTimerLabel label);
+	virtual void doStopTimer(const rcTimerLabel label);
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const;
+	virtual void doAddAccumulatedTime(const rcTimerLabel label, const int time);
+
+private:
+	double m_startTime[RC_MAX_TIMERS];	///< The time each timer was started at. [Units: us]
+	double m_accTime[RC_MAX_TIMERS];	///< The accumulated time of each timer, negative if never started. [Units: us]
+};
+
+/// Builds the data for a single tile, e.g. by running the Recast pipeline and #dtCreateNavMeshData.
+/// Called concurrently from the workers of the thread pool passed to #rcBuildTiles.
+///  @param[in,out]	ctx			The build context of the worker running the build.
+///  @param[in]		tileX		The x-location of the tile.
+///  @param[in]		tileY		The y-location of the tile. (Along the z-axis.)
+///  @param[in]		worker		The index of the worker running the build. Use it to select per-worker scratch data.
+///  @param[in]		userData	The user data passed to #rcBuildTiles.
+///  @param[out]	dataSize	The size of the returned data.
+/// @returns The tile data, or null if the tile is empty or could not be built.
+typedef unsigned char* (rcBuildTileFunc)(rcContext* ctx, int tileX, int tileY, int worker, void* userData, int* dataSize);
+
+/// Receives the data of a built tile, e.g. to pass it to dtNavMesh::addTile.
+/// Always called from the thread which called #rcBuildTiles.
+///  @param[in]		tileX		The x-location of the tile.
+///  @param[in]		tileY		The y-location of the tile. (Along the z-axis.)
+///  @param[in]		data		The tile data returned by the #rcBuildTileFunc. Ownership is passed to the callee.
+///  							Only null when rebuilding a tile which became empty. (See: #rcRebuildTiles)
+///  @param[in]		dataSize	The size of the tile data.
+///  @param[in]		userData	The user data passed to #rcBuildTiles.
+typedef void (rcAddTileFunc)(int tileX, int tileY, unsigned char* data, int dataSize, void* userData);
+
+/// Builds a grid of tiles in parallel.
+///
+/// The tiles are built on the workers of @p pool, each using its own build context. Once all tiles
+/// are built, @p addFunc is called for every non-empty tile in ascending (tileY, tileX) order, so the
+/// resulting navigation mesh is identical regardless of the number of workers.
+///
+/// @ingroup recast
+///  @param[in]		pool			The thread pool to build the tiles with, or null to build on the calling thread.
+///  @param[in]		contexts		A build context per worker. [Size: pool->getWorkerCount(), or 1 if @p pool is null]
+///  @param[in]		tilesX			The number of tiles along the x-axis.
+///  @param[in]		tilesY			The number of tiles along the z-axis.
+///  @param[in]		buildFunc		The function building the data of a tile.
+///  @param[in]		addFunc			The function receiving the built tile data.
+///  @param[in]		userData		User data passed to @p buildFunc and @p addFunc. [opt]
+/// @returns True if the operation completed successfully.
+bool rcBuildTiles(rcThreadPool* pool, rcContext** contexts, int tilesX, int tilesY,
+				  rcBuildTileFunc* buildFunc, rcAddTileFunc* addFunc, void* userData);
+
+/// Rebuilds a list of tiles in parallel.
+///
+/// Works like #rcBuildTiles, but only builds the listed tiles, and calls @p addFunc for every listed tile
+/// in the order of the list, with null data if the tile became empty.
+///
+/// @ingroup recast
+///  @param[in]		pool			The thread pool to build the tiles with, or null to build on the calling thread.
+///  @param[in]		contexts		A build context per worker. [Size: pool->getWorkerCount(), or 1 if @p pool is null]
+///  @param[in]		tiles			The locations of the tiles to rebuild. [(x, y) * @p tileCount]
+///  @param[in]		tileCount		The number of tiles to rebuild.
+///  @param[in]		buildFunc		The function building the data of a tile.
+///  @param[in]		addFunc			The function receiving the built tile data.
+///  @param[in]		userData		User data passed to @p buildFunc and @p addFunc. [opt]
+/// @returns True if the operation completed successfully.
+bool rcRebuildTiles(rcThreadPool* pool, rcContext** contexts, const int* tiles, int tileCount,
+					rcBuildTileFunc* buildFunc, rcAddTileFunc* addFunc, void* userData);
+
+/// Builds the distance field for the specified compact heightfield on the workers of a thread pool.
+///
+/// Works like #rcBuildDistanceField, and produces identical distances.
+///
+/// @ingroup recast
+///  @param[in,out]	ctx		The build context to use during the operation. Only used from the calling thread.
+///  @param[in,out]	chf		A populated compact heightfield.
+///  @param[in]		pool	The thread pool to build the distance field with, or null to build on the calling thread.
+/// @returns True if the operation completed successfully.
+bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcThreadPool* pool);
+
+/// Builds the region data for the heightfield using watershed partitioning on the workers of a thread pool.
+///
+/// Works like #rcBuildRegions, but partitions strips of the heightfield concurrently and joins the
+/// regions split by the seams between the strips. The regions do not depend on the number of workers,
+/// but may differ from the regions built by #rcBuildRegions.
+///
+/// @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation. Only used from the calling thread.
+///  @param[in,out]	chf				A populated compact heightfield.
+///  @param[in]		borderSize		The size of the non-navigable border around the heightfield.
+///  								[Limit: >=0] [Units: vx]
+///  @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas.
+///  								[Limit: >=0] [Units: vx].
+///  @param[in]		mergeRegionArea	Any regions with a span count smaller than this value will, if possible,
+///  								be merged with larger regions. [Limit: >=0] [Units: vx]
+///  @param[in]		pool			The thread pool to build the regions with, or null to use #rcBuildRegions.
+/// @returns True if the operation completed successfully.
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					int borderSize, int minRegionArea, int mergeRegionArea,
+					rcThreadPool* pool);
+
+/// Applies the selected span filters to the heightfield on the workers of a thread pool.
+///
+/// Works like #rcFilterHeightfield, and produces identical results.
+///
+/// @ingroup recast
+///  @param[in,out]	context			The build context to use during the operation. Only used from the calling thread.
+///  @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+///  								be considered walkable. [Limit: >= 3] [Units: vx]
+///  @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+///  								[Limit: >=0] [Units: vx]
+///  @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
+///  @param[in]		filterFlags		The filters to apply. [Limit: Combination of #rcFilterFlags]
+///  @param[in]		pool			The thread pool to filter with, or null to filter on the calling thread.
+void rcFilterHeightfield(rcContext* context, int walkableHeight, int walkableClimb, rcHeightfield& heightfield,
+						 int filterFlags, rcThreadPool* pool);
+
+#endif // RECASTPARALLEL_H
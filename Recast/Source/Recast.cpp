@@ -101,6 +101,7 @@ rcHeightfield::rcHeightfield()
 , cs()
 , ch()
 , spans()
+, maxColumns()
 , pools()
 , freelist()
 {
@@ -119,6 +120,67 @@ rcHeightfield::~rcHeightfield()
 	}
 }
 
+void rcResetHeightfield(rcHeightfield& heightfield)
+{
+	// Return the spans of all pools to the free list.
+	heightfield.freelist = 0;
+	for (rcSpanPool* pool = heightfield.pools; pool; pool = pool->next)
+	{
+		rcSpan* head = heightfield.freelist;
+		for (int i = RC_SPANS_PER_POOL - 1; i >= 0; --i)
+		{
+			pool->items[i].next = head;
+			head = &pool->items[i];
+		}
+		heightfield.freelist = head;
+	}
+
+	if (heightfield.spans)
+	{
+		memset(heightfield.spans, 0, sizeof(rcSpan*) * heightfield.width * heightfield.height);
+	}
+}
+
+rcColumnHeightfield* rcAllocColumnHeightfield()
+{
+	return rcNew<rcColumnHeightfield>(RC_ALLOC_PERM);
+}
+
+void rcFreeColumnHeightfield(rcColumnHeightfield* heightfield)
+{
+	rcDelete(heightfield);
+}
+
+rcColumnHeightfield::rcColumnHeightfield()
+: width()
+, height()
+, bmin()
+, bmax()
+, cs()
+, ch()
+, columns()
+, spans()
+, usedSpans()
+, maxSpans()
+, maxColumns()
+{
+}
+
+rcColumnHeightfield::~rcColumnHeightfield()
+{
+	rcFree(columns);
+	rcFree(spans);
+}
+
+void rcResetHeightfield(rcColumnHeightfield& heightfield)
+{
+	heightfield.usedSpans = 0;
+	if (heightfield.columns)
+	{
+		memset(heightfield.columns, 0, sizeof(rcHeightfieldColumn) * heightfield.width * heightfield.height);
+	}
+}
+
 rcCompactHeightfield* rcAllocCompactHeightfield()
 {
 	return rcNew<rcCompactHeightfield>(RC_ALLOC_PERM);
@@ -146,6 +208,8 @@ rcCompactHeightfield::rcCompactHeightfield()
 , spans()
 , dist()
 , areas()
+, maxCells()
+, maxSpans()
 {
 }
 
@@ -157,6 +221,15 @@ rcCompactHeightfield::~rcCompactHeightfield()
 	rcFree(areas);
 }
 
+void rcResetCompactHeightfield(rcCompactHeightfield& compactHeightfield)
+{
+	compactHeightfield.width = 0;
+	compactHeightfield.height = 0;
+	compactHeightfield.spanCount = 0;
+	compactHeightfield.maxDistance = 0;
+	compactHeightfield.maxRegions = 0;
+}
+
 rcHeightfieldLayerSet* rcAllocHeightfieldLayerSet()
 {
 	return rcNew<rcHeightfieldLayerSet>(RC_ALLOC_PERM);
@@ -198,6 +271,7 @@ void rcFreeContourSet(rcContourSet* contourSet)
 rcContourSet::rcContourSet()
 : conts()
 , nconts()
+, maxconts()
 , bmin()
 , bmax()
 , cs()
@@ -211,7 +285,9 @@ rcContourSet::rcContourSet()
 
 rcContourSet::~rcContourSet()
 {
-	for (int i = 0; i < nconts; ++i)
+	// The contours past nconts may still hold memory kept for reuse.
+	const int n = rcMax(nconts, maxconts);
+	for (int i = 0; i < n; ++i)
 	{
 		rcFree(conts[i].verts);
 		rcFree(conts[i].rverts);
@@ -219,6 +295,16 @@ rcContourSet::~rcContourSet()
 	rcFree(conts);
 }
 
+void rcResetContourSet(rcContourSet& contourSet)
+{
+	for (int i = 0; i < contourSet.nconts; ++i)
+	{
+		contourSet.conts[i].nverts = 0;
+		contourSet.conts[i].nrverts = 0;
+	}
+	contourSet.nconts = 0;
+}
+
 rcPolyMesh* rcAllocPolyMesh()
 {
 	return rcNew<rcPolyMesh>(RC_ALLOC_PERM);
@@ -238,6 +324,7 @@ rcPolyMesh::rcPolyMesh()
 , nverts()
 , npolys()
 , maxpolys()
+, maxverts()
 , nvp()
 , bmin()
 , bmax()
@@ -257,6 +344,12 @@ rcPolyMesh::~rcPolyMesh()
 	rcFree(areas);
 }
 
+void rcResetPolyMesh(rcPolyMesh& polyMesh)
+{
+	polyMesh.nverts = 0;
+	polyMesh.npolys = 0;
+}
+
 rcPolyMeshDetail* rcAllocPolyMeshDetail()
 {
 	return rcNew<rcPolyMeshDetail>(RC_ALLOC_PERM);
@@ -303,6 +396,20 @@ void rcCalcGridSize(const float* minBounds, const float* maxBounds, const float
 	*sizeZ = (int)((maxBounds[2] - minBounds[2]) / cellSize + 0.5f);
 }
 
+bool rcCalcColumnRange(const rcHeightfield& heightfield, const float* minBounds, const float* maxBounds,
+                       int* minX, int* minZ, int* maxX, int* maxZ)
+{
+	const float inverseCellSize = 1.0f / heightfield.cs;
+
+	// Grow the range by a column on each side, the ledge filter looks at the neighbours of each column.
+	*minX = rcMax((int)floorf((minBounds[0] - heightfield.bmin[0]) * inverseCellSize) - 1, 0);
+	*minZ = rcMax((int)floorf((minBounds[2] - heightfield.bmin[2]) * inverseCellSize) - 1, 0);
+	*maxX = rcMin((int)floorf((maxBounds[0] - heightfield.bmin[0]) * inverseCellSize) + 1, heightfield.width - 1);
+	*maxZ = rcMin((int)floorf((maxBounds[2] - heightfield.bmin[2]) * inverseCellSize) + 1, heightfield.height - 1);
+
+	return *minX <= *maxX && *minZ <= *maxZ;
+}
+
 bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int sizeX, int sizeZ,
                          const float* minBounds, const float* maxBounds,
                          float cellSize, float cellHeight)
@@ -315,12 +422,53 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 	rcVcopy(heightfield.bmax, maxBounds);
 	heightfield.cs = cellSize;
 	heightfield.ch = cellHeight;
-	heightfield.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*) * heightfield.width * heightfield.height, RC_ALLOC_PERM);
-	if (!heightfield.spans)
+
+	const int columnCount = heightfield.width * heightfield.height;
+	if (heightfield.maxColumns < columnCount)
 	{
-		return false;
+		rcFree(heightfield.spans);
+		heightfield.maxColumns = 0;
+		heightfield.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*) * columnCount, RC_ALLOC_PERM);
+		if (!heightfield.spans)
+		{
+			return false;
+		}
+		heightfield.maxColumns = columnCount;
 	}
-	memset(heightfield.spans, 0, sizeof(rcSpan*) * heightfield.width * heightfield.height);
+
+	// Keep the spans allocated by a previous build.
+	rcResetHeightfield(heightfield);
+	return true;
+}
+
+bool rcCreateHeightfield(rcContext* context, rcColumnHeightfield& heightfield, int sizeX, int sizeZ,
+                         const float* minBounds, const float* maxBounds,
+                         float cellSize, float cellHeight)
+{
+	rcIgnoreUnused(context);
+
+	heightfield.width = sizeX;
+	heightfield.height = sizeZ;
+	rcVcopy(heightfield.bmin, minBounds);
+	rcVcopy(heightfield.bmax, maxBounds);
+	heightfield.cs = cellSize;
+	heightfield.ch = cellHeight;
+
+	const int columnCount = heightfield.width * heightfield.height;
+	if (heightfield.maxColumns < columnCount)
+	{
+		rcFree(heightfield.columns);
+		heightfield.maxColumns = 0;
+		heightfield.columns = (rcHeightfieldColumn*)rcAlloc(sizeof(rcHeightfieldColumn) * columnCount, RC_ALLOC_PERM);
+		if (!heightfield.columns)
+		{
+			return false;
+		}
+		heightfield.maxColumns = columnCount;
+	}
+
+	// Keep the span buffer allocated by a previous build.
+	rcResetHeightfield(heightfield);
 	return true;
 }
 
@@ -400,16 +548,35 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 	return spanCount;
 }
 
-bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
-                               const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+int rcGetHeightFieldSpanCount(rcContext* context, const rcColumnHeightfield& heightfield)
 {
-	rcAssert(context);
+	rcIgnoreUnused(context);
 
-	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+	const int numCols = heightfield.width * heightfield.height;
+	int spanCount = 0;
+	for (int columnIndex = 0; columnIndex < numCols; ++columnIndex)
+	{
+		const rcHeightfieldColumn& column = heightfield.columns[columnIndex];
+		const rcColumnSpan* spans = &heightfield.spans[column.index];
+		for (int i = 0; i < (int)column.count; ++i)
+		{
+			if (spans[i].area != RC_NULL_AREA)
+			{
+				spanCount++;
+			}
+		}
+	}
+	return spanCount;
+}
 
+/// Fills in the header of the compact heightfield, and makes room for the cells and spans.
+template <class Heightfield>
+static bool initCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                                   const Heightfield& heightfield, const int spanCount,
+                                   rcCompactHeightfield& compactHeightfield)
+{
 	const int xSize = heightfield.width;
 	const int zSize = heightfield.height;
-	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
 
 	// Fill in header.
 	compactHeightfield.width = xSize;
@@ -417,69 +584,72 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 	compactHeightfield.spanCount = spanCount;
 	compactHeightfield.walkableHeight = walkableHeight;
 	compactHeightfield.walkableClimb = walkableClimb;
+	compactHeightfield.maxDistance = 0;
 	compactHeightfield.maxRegions = 0;
 	rcVcopy(compactHeightfield.bmin, heightfield.bmin);
 	rcVcopy(compactHeightfield.bmax, heightfield.bmax);
 	compactHeightfield.bmax[1] += walkableHeight * heightfield.ch;
 	compactHeightfield.cs = heightfield.cs;
 	compactHeightfield.ch = heightfield.ch;
-	compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * xSize * zSize, RC_ALLOC_PERM);
-	if (!compactHeightfield.cells)
+
+	// Reuse the arrays of a previous build when they are large enough.
+	if (compactHeightfield.maxCells < xSize * zSize)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
-		return false;
+		rcFree(compactHeightfield.cells);
+		compactHeightfield.maxCells = 0;
+		compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * xSize * zSize, RC_ALLOC_PERM);
+		if (!compactHeightfield.cells)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
+			return false;
+		}
+		compactHeightfield.maxCells = xSize * zSize;
 	}
 	memset(compactHeightfield.cells, 0, sizeof(rcCompactCell) * xSize * zSize);
-	compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * spanCount, RC_ALLOC_PERM);
-	if (!compactHeightfield.spans)
+	if (compactHeightfield.maxSpans < spanCount)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
-		return false;
+		rcFree(compactHeightfield.spans);
+		rcFree(compactHeightfield.areas);
+		rcFree(compactHeightfield.dist);
+		compactHeightfield.areas = 0;
+		compactHeightfield.dist = 0;
+		compactHeightfield.maxSpans = 0;
+		compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * spanCount, RC_ALLOC_PERM);
+		if (!compactHeightfield.spans)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
+			return false;
+		}
+		compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * spanCount, RC_ALLOC_PERM);
+		if (!compactHeightfield.areas)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
+			return false;
+		}
+		compactHeightfield.maxSpans = spanCount;
 	}
-	memset(compactHeightfield.spans, 0, sizeof(rcCompactSpan) * spanCount);
-	compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * spanCount, RC_ALLOC_PERM);
-	if (!compactHeightfield.areas)
+	if (spanCount > 0)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
-		return false;
+		memset(compactHeightfield.spans, 0, sizeof(rcCompactSpan) * spanCount);
+		memset(compactHeightfield.areas, RC_NULL_AREA, sizeof(unsigned char) * spanCount);
+		// The distances of a previous build do not belong to the new spans, keep the array
+		// for rcBuildDistanceField, but clear it like maxDistance.
+		if (compactHeightfield.dist)
+		{
+			memset(compactHeightfield.dist, 0, sizeof(unsigned short) * spanCount);
+		}
 	}
-	memset(compactHeightfield.areas, RC_NULL_AREA, sizeof(unsigned char) * spanCount);
 
-	const int MAX_HEIGHT = 0xffff;
+	return true;
+}
 
-	// Fill in cells and spans.
-	int currentCellIndex = 0;
-	const int numColumns = xSize * zSize;
-	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
-	{
-		const rcSpan* span = heightfield.spans[columnIndex];
-			
-		// If there are no spans at this cell, just leave the data to index=0, count=0.
-		if (span == NULL)
-		{
-			continue;
-		}
-			
-		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
-		cell.index = currentCellIndex;
-		cell.count = 0;
+/// Finds the neighbour connections of the spans of the compact heightfield.
+static void connectCompactSpans(rcContext* context, const int walkableHeight, const int walkableClimb,
+                                rcCompactHeightfield& compactHeightfield)
+{
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
 
-		for (; span != NULL; span = span->next)
-		{
-			if (span->area != RC_NULL_AREA)
-			{
-				const int bot = (int)span->smax;
-				const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
-				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
-				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
-				compactHeightfield.areas[currentCellIndex] = span->area;
-				currentCellIndex++;
-				cell.count++;
-			}
-		}
-	}
-	
-	// Find neighbour connections.
 	const int MAX_LAYERS = RC_NOT_CONNECTED - 1;
 	int maxLayerIndex = 0;
 	const int zStride = xSize; // for readability
@@ -537,6 +707,318 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Heightfield has too many layers %d (max: %d)",
 		         maxLayerIndex, MAX_LAYERS);
 	}
+}
+
+bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                               const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
+	if (!initCompactHeightfield(context, walkableHeight, walkableClimb, heightfield, spanCount, compactHeightfield))
+	{
+		return false;
+	}
+
+	const int MAX_HEIGHT = 0xffff;
+
+	// Fill in cells and spans.
+	int currentCellIndex = 0;
+	const int numColumns = xSize * zSize;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const rcSpan* span = heightfield.spans[columnIndex];
+			
+		// If there are no spans at this cell, just leave the data to index=0, count=0.
+		if (span == NULL)
+		{
+			continue;
+		}
+			
+		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+		cell.index = currentCellIndex;
+		cell.count = 0;
+
+		for (; span != NULL; span = span->next)
+		{
+			if (span->area != RC_NULL_AREA)
+			{
+				const int bot = (int)span->smax;
+				const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
+				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+				compactHeightfield.areas[currentCellIndex] = span->area;
+				currentCellIndex++;
+				cell.count++;
+			}
+		}
+	}
+	
+	connectCompactSpans(context, walkableHeight, walkableClimb, compactHeightfield);
+
+	return true;
+}
+
+bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                               const rcColumnHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+
+	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
+	if (!initCompactHeightfield(context, walkableHeight, walkableClimb, heightfield, spanCount, compactHeightfield))
+	{
+		return false;
+	}
+
+	const int MAX_HEIGHT = 0xffff;
+
+	// Fill in cells and spans.
+	int currentCellIndex = 0;
+	const int numColumns = heightfield.width * heightfield.height;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const rcHeightfieldColumn& column = heightfield.columns[columnIndex];
+
+		// If there are no spans at this cell, just leave the data to index=0, count=0.
+		if (column.count == 0)
+		{
+			continue;
+		}
+
+		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+		cell.index = currentCellIndex;
+		cell.count = 0;
+
+		const rcColumnSpan* spans = &heightfield.spans[column.index];
+		const int count = (int)column.count;
+		for (int i = 0; i < count; ++i)
+		{
+			if (spans[i].area != RC_NULL_AREA)
+			{
+				const int bot = (int)spans[i].smax;
+				const int top = i + 1 < count ? (int)spans[i + 1].smin : MAX_HEIGHT;
+				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+				compactHeightfield.areas[currentCellIndex] = spans[i].area;
+				currentCellIndex++;
+				cell.count++;
+			}
+		}
+	}
+
+	connectCompactSpans(context, walkableHeight, walkableClimb, compactHeightfield);
+
+	return true;
+}
+
+/// The number of rows of the heightfield rasterized at a time by #rcRasterizeCompactHeightfield.
+static const int RASTER_BAND_HEIGHT = 32;
+
+/// Grows the span arrays of the compact heightfield to the specified number of spans,
+/// keeping the spans already in them.
+static bool growCompactSpans(rcCompactHeightfield& compactHeightfield, const int maxSpans)
+{
+	rcCompactSpan* spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * maxSpans, RC_ALLOC_PERM);
+	unsigned char* areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * maxSpans, RC_ALLOC_PERM);
+	if (!spans || !areas)
+	{
+		rcFree(spans);
+		rcFree(areas);
+		return false;
+	}
+	if (compactHeightfield.spanCount > 0)
+	{
+		memcpy(spans, compactHeightfield.spans, sizeof(rcCompactSpan) * compactHeightfield.spanCount);
+		memcpy(areas, compactHeightfield.areas, sizeof(unsigned char) * compactHeightfield.spanCount);
+	}
+
+	rcFree(compactHeightfield.spans);
+	rcFree(compactHeightfield.areas);
+	rcFree(compactHeightfield.dist);
+	compactHeightfield.spans = spans;
+	compactHeightfield.areas = areas;
+	compactHeightfield.dist = 0;
+	compactHeightfield.maxSpans = maxSpans;
+	return true;
+}
+
+/// @par
+///
+/// The heightfield is processed in bands of rows. Each band is rasterized together with the rows next to it,
+/// which the ledge filter reads, filtered, and its walkable spans are appended to the compact heightfield.
+/// Only the spans of a single band are kept in memory at a time, and the spans are not copied between
+/// heightfield representations. The result is the same as calling #rcRasterizeTriangles, #rcFilterHeightfield
+/// and #rcBuildCompactHeightfield in turn, with @p config.walkableClimb as the flag merge threshold.
+///
+/// @see rcAllocCompactHeightfield, rcCompactHeightfield, rcConfig
+bool rcRasterizeCompactHeightfield(rcContext* context, const rcConfig& config,
+                                   const float* verts, const int numVerts,
+                                   const int* tris, const unsigned char* triAreaIDs, const int numTris,
+                                   rcCompactHeightfield& compactHeightfield, const int filterFlags)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+	rcTempArenaScope tempScope(context->getTempArena());
+
+	const int xSize = config.width;
+	const int zSize = config.height;
+	const int walkableHeight = config.walkableHeight;
+	const int walkableClimb = config.walkableClimb;
+
+	if (!initCompactHeightfield(context, walkableHeight, walkableClimb, config, 0, compactHeightfield))
+	{
+		return false;
+	}
+
+	// Sort the triangles into the bands of rows they touch, including the rows next to the bands.
+	const int bandCount = (zSize + RASTER_BAND_HEIGHT - 1) / RASTER_BAND_HEIGHT;
+	const float inverseCellSize = 1.0f / config.cs;
+	rcTempVector<int> bandFirstTri(bandCount + 1, 0);
+	rcTempVector<int> triRows(numTris * 2);
+	if ((int)bandFirstTri.size() != bandCount + 1 || (int)triRows.size() != numTris * 2)
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeCompactHeightfield: Out of memory 'triRows' (%d)", numTris);
+		return false;
+	}
+	for (int i = 0; i < numTris; ++i)
+	{
+		const float* v0 = &verts[tris[i * 3 + 0] * 3];
+		const float* v1 = &verts[tris[i * 3 + 1] * 3];
+		const float* v2 = &verts[tris[i * 3 + 2] * 3];
+		const float minZ = rcMin(v0[2], rcMin(v1[2], v2[2]));
+		const float maxZ = rcMax(v0[2], rcMax(v1[2], v2[2]));
+		const int z0 = rcClamp((int)((minZ - config.bmin[2]) * inverseCellSize) - 1, 0, zSize - 1);
+		const int z1 = rcClamp((int)((maxZ - config.bmin[2]) * inverseCellSize) + 1, 0, zSize - 1);
+		triRows[i * 2 + 0] = z0 / RASTER_BAND_HEIGHT;
+		triRows[i * 2 + 1] = z1 / RASTER_BAND_HEIGHT;
+		for (int b = triRows[i * 2 + 0]; b <= triRows[i * 2 + 1]; ++b)
+		{
+			bandFirstTri[b + 1]++;
+		}
+	}
+	for (int b = 0; b < bandCount; ++b)
+	{
+		bandFirstTri[b + 1] += bandFirstTri[b];
+	}
+
+	const int bandTriCount = bandFirstTri[bandCount];
+	rcTempVector<int> bandTris(bandTriCount * 3);
+	rcTempVector<unsigned char> bandAreas(bandTriCount);
+	rcTempVector<int> bandFill(bandFirstTri.data(), bandFirstTri.data() + bandCount);
+	if ((int)bandTris.size() != bandTriCount * 3 || (int)bandAreas.size() != bandTriCount || (int)bandFill.size() != bandCount)
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeCompactHeightfield: Out of memory 'bandTris' (%d)", bandTriCount);
+		return false;
+	}
+	for (int i = 0; i < numTris; ++i)
+	{
+		for (int b = triRows[i * 2 + 0]; b <= triRows[i * 2 + 1]; ++b)
+		{
+			const int index = bandFill[b]++;
+			bandTris[index * 3 + 0] = tris[i * 3 + 0];
+			bandTris[index * 3 + 1] = tris[i * 3 + 1];
+			bandTris[index * 3 + 2] = tris[i * 3 + 2];
+			bandAreas[index] = triAreaIDs[i];
+		}
+	}
+
+	const int MAX_HEIGHT = 0xffff;
+
+	rcColumnHeightfield band;
+	for (int b = 0; b < bandCount; ++b)
+	{
+		const int z0 = b * RASTER_BAND_HEIGHT;
+		const int z1 = rcMin(z0 + RASTER_BAND_HEIGHT, zSize) - 1;
+		const int first = bandFirstTri[b];
+		const int count = bandFirstTri[b + 1] - first;
+
+		// The band heightfield also holds the rows next to the band, which the ledge filter reads.
+		const int firstRow = rcMax(z0 - 1, 0);
+		const int lastRow = rcMin(z1 + 1, zSize - 1);
+		if (!rcCreateHeightfield(context, band, xSize, lastRow - firstRow + 1, config.bmin, config.bmax, config.cs, config.ch))
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizeCompactHeightfield: Out of memory 'band' (%d)", xSize * (lastRow - firstRow + 1));
+			return false;
+		}
+		if (count > 0 &&
+			!rcRasterizeTriangleBand(context, verts, numVerts, &bandTris[first * 3], &bandAreas[first], count,
+									 band, firstRow, zSize, walkableClimb))
+		{
+			return false;
+		}
+		rcFilterHeightfield(context, walkableHeight, walkableClimb, band, 0, z0 - firstRow, xSize - 1, z1 - firstRow, filterFlags);
+
+		// Append the walkable spans of the band.
+		const int bandOffset = firstRow * xSize;
+		int spanCount = compactHeightfield.spanCount;
+		for (int columnIndex = z0 * xSize; columnIndex < (z1 + 1) * xSize; ++columnIndex)
+		{
+			const rcHeightfieldColumn& column = band.columns[columnIndex - bandOffset];
+			const rcColumnSpan* spans = &band.spans[column.index];
+			for (int i = 0; i < (int)column.count; ++i)
+			{
+				if (spans[i].area != RC_NULL_AREA)
+				{
+					spanCount++;
+				}
+			}
+		}
+		if (spanCount > compactHeightfield.maxSpans)
+		{
+			// Size the arrays for the span density seen so far, to avoid growing them again.
+			const int estimate = (int)((long long)spanCount * zSize / (z1 + 1));
+			const int maxSpans = rcMax(estimate + estimate / 8, compactHeightfield.maxSpans + compactHeightfield.maxSpans / 2);
+			if (!growCompactSpans(compactHeightfield, rcMax(spanCount, maxSpans)))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
+				return false;
+			}
+		}
+
+		int currentCellIndex = compactHeightfield.spanCount;
+		for (int columnIndex = z0 * xSize; columnIndex < (z1 + 1) * xSize; ++columnIndex)
+		{
+			const rcHeightfieldColumn& column = band.columns[columnIndex - bandOffset];
+
+			// If there are no spans at this cell, just leave the data to index=0, count=0.
+			if (column.count == 0)
+			{
+				continue;
+			}
+
+			rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+			cell.index = currentCellIndex;
+			cell.count = 0;
+
+			const rcColumnSpan* spans = &band.spans[column.index];
+			const int columnSpanCount = (int)column.count;
+			for (int i = 0; i < columnSpanCount; ++i)
+			{
+				if (spans[i].area != RC_NULL_AREA)
+				{
+					const int bot = (int)spans[i].smax;
+					const int top = i + 1 < columnSpanCount ? (int)spans[i + 1].smin : MAX_HEIGHT;
+					rcCompactSpan& span = compactHeightfield.spans[currentCellIndex];
+					memset(&span, 0, sizeof(span));
+					span.y = (unsigned short)rcClamp(bot, 0, 0xffff);
+					span.h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+					compactHeightfield.areas[currentCellIndex] = (unsigned char)spans[i].area;
+					currentCellIndex++;
+					cell.count++;
+				}
+			}
+		}
+		compactHeightfield.spanCount = currentCellIndex;
+	}
+
+	connectCompactSpans(context, walkableHeight, walkableClimb, compactHeightfield);
 
 	return true;
 }
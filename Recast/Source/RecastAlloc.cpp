@@ -37,8 +37,23 @@ void rcAllocSetCustom(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
 	sRecastFreeFunc = freeFunc ? freeFunc : rcFreeDefault;
 }
 
+// The arena the temporary allocations of the thread are routed to.
+#if defined(_MSC_VER)
+static __declspec(thread) rcTempArena* sCurrentTempArena = NULL;
+#else
+static __thread rcTempArena* sCurrentTempArena = NULL;
+#endif
+
 void* rcAlloc(size_t size, rcAllocHint hint)
 {
+	if (hint == RC_ALLOC_TEMP && sCurrentTempArena != NULL)
+	{
+		void* ptr = sCurrentTempArena->alloc(size);
+		if (ptr != NULL)
+		{
+			return ptr;
+		}
+	}
 	return sRecastAllocFunc(size, hint);
 }
 
@@ -46,6 +61,167 @@ void rcFree(void* ptr)
 {
 	if (ptr != NULL)
 	{
+		if (sCurrentTempArena != NULL && sCurrentTempArena->owns(ptr))
+		{
+			sCurrentTempArena->free(ptr);
+			return;
+		}
 		sRecastFreeFunc(ptr);
 	}
 }
+
+static const size_t RC_TEMP_ARENA_ALIGN = 16;
+
+static size_t alignTempArenaSize(size_t size)
+{
+	return (size + (RC_TEMP_ARENA_ALIGN - 1)) & ~(RC_TEMP_ARENA_ALIGN - 1);
+}
+
+struct rcTempArenaBlock
+{
+	rcTempArenaBlock* next;
+	size_t size;		///< The number of bytes available in the block.
+};
+
+static unsigned char* getBlockData(rcTempArenaBlock* block)
+{
+	return (unsigned char*)block + alignTempArenaSize(sizeof(rcTempArenaBlock));
+}
+
+rcTempArena::rcTempArena(size_t blockSize) :
+	m_blockSize(alignTempArenaSize(blockSize)),
+	m_first(0),
+	m_current(0),
+	m_offset(0),
+	m_used(0),
+	m_peak(0),
+	m_reserved(0),
+	m_last(0),
+	m_lastSize(0)
+{
+}
+
+rcTempArena::~rcTempArena()
+{
+	purge();
+}
+
+void* rcTempArena::alloc(size_t size)
+{
+	size = alignTempArenaSize(size > 0 ? size : 1);
+
+	if (!m_current || m_offset + size > m_current->size)
+	{
+		// Move on to the next block, replacing it if it is too small.
+		rcTempArenaBlock** link = m_current ? &m_current->next : &m_first;
+		rcTempArenaBlock* next = *link;
+		if (next && next->size < size)
+		{
+			*link = next->next;
+			m_reserved -= next->size;
+			sRecastFreeFunc(next);
+			next = 0;
+		}
+		if (!next)
+		{
+			const size_t blockSize = size > m_blockSize ? size : m_blockSize;
+			next = (rcTempArenaBlock*)sRecastAllocFunc(alignTempArenaSize(sizeof(rcTempArenaBlock)) + blockSize, RC_ALLOC_PERM);
+			if (!next)
+				return 0;
+			next->size = blockSize;
+			next->next = *link;
+			*link = next;
+			m_reserved += blockSize;
+		}
+		m_current = next;
+		m_offset = 0;
+	}
+
+	void* ptr = getBlockData(m_current) + m_offset;
+	m_offset += size;
+	m_used += size;
+	if (m_used > m_peak)
+		m_peak = m_used;
+	m_last = ptr;
+	m_lastSize = size;
+	return ptr;
+}
+
+void rcTempArena::free(void* ptr)
+{
+	if (ptr && ptr == m_last)
+	{
+		m_offset -= m_lastSize;
+		m_used -= m_lastSize;
+		m_last = 0;
+	}
+}
+
+bool rcTempArena::owns(const void* ptr) const
+{
+	for (rcTempArenaBlock* block = m_first; block; block = block->next)
+	{
+		const unsigned char* data = getBlockData(block);
+		if ((const unsigned char*)ptr >= data && (const unsigned char*)ptr < data + block->size)
+			return true;
+	}
+	return false;
+}
+
+rcTempArenaMark rcTempArena::mark() const
+{
+	rcTempArenaMark mark;
+	mark.block = m_current;
+	mark.offset = m_offset;
+	mark.used = m_used;
+	return mark;
+}
+
+void rcTempArena::release(const rcTempArenaMark& mark)
+{
+	m_current = mark.block;
+	m_offset = mark.offset;
+	m_used = mark.used;
+	m_last = 0;
+}
+
+void rcTempArena::reset()
+{
+	m_current = 0;
+	m_offset = 0;
+	m_used = 0;
+	m_last = 0;
+}
+
+void rcTempArena::purge()
+{
+	reset();
+	while (m_first)
+	{
+		rcTempArenaBlock* next = m_first->next;
+		sRecastFreeFunc(m_first);
+		m_first = next;
+	}
+	m_reserved = 0;
+}
+
+rcTempArenaScope::rcTempArenaScope(rcTempArena* arena) :
+	m_arena(arena),
+	m_prev(sCurrentTempArena),
+	m_mark()
+{
+	if (m_arena)
+	{
+		m_mark = m_arena->mark();
+		sCurrentTempArena = m_arena;
+	}
+}
+
+rcTempArenaScope::~rcTempArenaScope()
+{
+	if (m_arena)
+	{
+		m_arena->release(m_mark);
+		sCurrentTempArena = m_prev;
+	}
+}
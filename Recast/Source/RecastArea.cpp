@@ -41,6 +41,7 @@ bool rcErodeWalkableArea(rcContext* ctx, int radius, rcCompactHeightfield& chf)
 	const int h = chf.height;
 	
 	rcScopedTimer timer(ctx, RC_TIMER_ERODE_AREA);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	unsigned char* dist = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP);
 	if (!dist)
@@ -243,6 +244,7 @@ bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf)
 	const int h = chf.height;
 	
 	rcScopedTimer timer(ctx, RC_TIMER_MEDIAN_AREA);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	unsigned char* areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP);
 	if (!areas)
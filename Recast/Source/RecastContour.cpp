@@ -541,26 +541,6 @@ static bool vequal(const int* a, const int* b)
 	return a[0] == b[0] && a[2] == b[2];
 }
 
-static bool intersectSegContour(const int* d0, const int* d1, int i, int n, const int* verts)
-{
-	// For each edge (k,k+1) of P
-	for (int k = 0; k < n; k++)
-	{
-		int k1 = next(k, n);
-		// Skip edges incident to i.
-		if (i == k || i == k1)
-			continue;
-		const int* p0 = &verts[k * 4];
-		const int* p1 = &verts[k1 * 4];
-		if (vequal(d0, p0) || vequal(d1, p0) || vequal(d0, p1) || vequal(d1, p1))
-			continue;
-		
-		if (intersect(d0, d1, p0, p1))
-			return true;
-	}
-	return false;
-}
-
 static bool	inCone(int i, int n, const int* verts, const int* pj)
 {
 	const int* pi = &verts[i * 4];
@@ -638,10 +618,50 @@ static bool mergeContours(rcContour& ca, rcContour& cb, int ia, int ib)
 	rcFree(ca.verts);
 	ca.verts = verts;
 	ca.nverts = nv;
+	ca.maxverts = maxVerts;
 	
 	rcFree(cb.verts);
 	cb.verts = 0;
 	cb.nverts = 0;
+	cb.maxverts = 0;
+	
+	return true;
+}
+
+/// Grows the contour array of the set to hold at least @p maxContours contours.
+/// The contours past rcContourSet::nconts are moved too, so their vertex arrays can be reused.
+static bool reserveContours(rcContourSet& cset, int maxContours)
+{
+	if (cset.maxconts >= maxContours)
+		return true;
+	
+	const int oldCount = rcMax(cset.nconts, cset.maxconts);
+	maxContours = rcMax(maxContours, oldCount);
+	rcContour* conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
+	if (!conts)
+		return false;
+	memset(conts, 0, sizeof(rcContour)*maxContours);
+	if (oldCount > 0)
+		memcpy(conts, cset.conts, sizeof(rcContour)*oldCount);
+	rcFree(cset.conts);
+	cset.conts = conts;
+	cset.maxconts = maxContours;
+	
+	return true;
+}
+
+/// Makes sure a contour vertex array can hold @p nverts vertices, reusing it when it is large enough.
+static bool reserveContourVerts(int*& verts, int& maxVerts, const int nverts)
+{
+	if (verts && maxVerts >= nverts)
+		return true;
+	
+	rcFree(verts);
+	maxVerts = 0;
+	verts = (int*)rcAlloc(sizeof(int)*nverts*4, RC_ALLOC_PERM);
+	if (!verts)
+		return false;
+	maxVerts = nverts;
 	
 	return true;
 }
@@ -665,6 +685,154 @@ struct rcPotentialDiagonal
 	int dist;
 };
 
+/// A segment of the outline or the holes of a region.
+struct rcContourSegment
+{
+	int p0[3];
+	int p1[3];
+	int hole;	///< The hole the segment belongs to, or -1 for the outline.
+};
+
+/// The segments of a region, bucketed in a grid of cells to find the segments a diagonal may intersect.
+struct rcContourSegmentGrid
+{
+	rcTempVector<rcContourSegment> segments;
+	rcTempVector<int> stamps;				///< The last query each segment was tested by.
+	rcTempVector<unsigned char> removed;	///< True for the holes which could not be merged.
+	rcTempVector<int> cellFirst;			///< The first item of each cell, or -1.
+	rcTempVector<int> itemSegment;			///< The segment of each item.
+	rcTempVector<int> itemNext;				///< The next item in the same cell, or -1.
+	int minx, minz;
+	int cellSize;
+	int width, height;
+	int stamp;
+};
+
+template <class T>
+static bool appendItem(rcTempVector<T>& items, const T& item)
+{
+	if (items.size() == items.capacity() && !items.reserve(rcMax((int)items.capacity() * 2, 64)))
+		return false;
+	items.push_back(item);
+	return true;
+}
+
+static void getSegmentCells(const rcContourSegmentGrid& grid, const int* p0, const int* p1,
+							int& x0, int& z0, int& x1, int& z1)
+{
+	x0 = rcClamp((rcMin(p0[0], p1[0]) - grid.minx) / grid.cellSize, 0, grid.width-1);
+	z0 = rcClamp((rcMin(p0[2], p1[2]) - grid.minz) / grid.cellSize, 0, grid.height-1);
+	x1 = rcClamp((rcMax(p0[0], p1[0]) - grid.minx) / grid.cellSize, 0, grid.width-1);
+	z1 = rcClamp((rcMax(p0[2], p1[2]) - grid.minz) / grid.cellSize, 0, grid.height-1);
+}
+
+static bool addContourSegment(rcContourSegmentGrid& grid, const int* p0, const int* p1, const int hole)
+{
+	rcContourSegment segment;
+	memcpy(segment.p0, p0, sizeof(segment.p0));
+	memcpy(segment.p1, p1, sizeof(segment.p1));
+	segment.hole = hole;
+	const int index = grid.segments.size();
+	if (!appendItem(grid.segments, segment) || !appendItem(grid.stamps, 0))
+		return false;
+	
+	int x0, z0, x1, z1;
+	getSegmentCells(grid, p0, p1, x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			const int cell = x + z*grid.width;
+			if (!appendItem(grid.itemSegment, index) || !appendItem(grid.itemNext, grid.cellFirst[cell]))
+				return false;
+			grid.cellFirst[cell] = grid.itemSegment.size()-1;
+		}
+	}
+	return true;
+}
+
+static bool initContourSegmentGrid(rcContourSegmentGrid& grid, const rcContourRegion& region)
+{
+	// Size the cells so that there is about one segment per cell.
+	const rcContour* outline = region.outline;
+	int nsegments = outline->nverts;
+	int minx = outline->verts[0], minz = outline->verts[2];
+	int maxx = minx, maxz = minz;
+	for (int i = -1; i < region.nholes; ++i)
+	{
+		const rcContour* cont = i == -1 ? outline : region.holes[i].contour;
+		if (i >= 0)
+			nsegments += cont->nverts;
+		for (int j = 0; j < cont->nverts; ++j)
+		{
+			minx = rcMin(minx, cont->verts[j*4+0]);
+			minz = rcMin(minz, cont->verts[j*4+2]);
+			maxx = rcMax(maxx, cont->verts[j*4+0]);
+			maxz = rcMax(maxz, cont->verts[j*4+2]);
+		}
+	}
+	const int sizeX = maxx - minx + 1;
+	const int sizeZ = maxz - minz + 1;
+	grid.minx = minx;
+	grid.minz = minz;
+	grid.cellSize = rcMax(1, (int)ceilf(sqrtf((float)sizeX * (float)sizeZ / (float)nsegments)));
+	grid.width = (sizeX + grid.cellSize-1) / grid.cellSize;
+	grid.height = (sizeZ + grid.cellSize-1) / grid.cellSize;
+	grid.stamp = 0;
+	
+	grid.cellFirst.resize(grid.width*grid.height, -1);
+	grid.removed.resize(region.nholes, 0);
+	if (grid.cellFirst.size() != grid.width*grid.height || grid.removed.size() != region.nholes ||
+		!grid.segments.reserve(nsegments + region.nholes) || !grid.stamps.reserve(nsegments + region.nholes))
+		return false;
+	
+	for (int i = -1; i < region.nholes; ++i)
+	{
+		const rcContour* cont = i == -1 ? outline : region.holes[i].contour;
+		for (int j = 0, k = cont->nverts-1; j < cont->nverts; k = j++)
+		{
+			if (!addContourSegment(grid, &cont->verts[k*4], &cont->verts[j*4], i))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Returns true if the diagonal d0-d1 intersects a segment of the outline or of the holes not merged yet.
+// Segments touching the end points of the diagonal are skipped.
+static bool intersectSegGrid(rcContourSegmentGrid& grid, const int* d0, const int* d1)
+{
+	grid.stamp++;
+	
+	int x0, z0, x1, z1;
+	getSegmentCells(grid, d0, d1, x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			for (int item = grid.cellFirst[x + z*grid.width]; item != -1; item = grid.itemNext[item])
+			{
+				const int index = grid.itemSegment[item];
+				if (grid.stamps[index] == grid.stamp)
+					continue;
+				grid.stamps[index] = grid.stamp;
+				
+				const rcContourSegment& segment = grid.segments[index];
+				if (segment.hole != -1 && grid.removed[segment.hole])
+					continue;
+				const int* p0 = segment.p0;
+				const int* p1 = segment.p1;
+				if (vequal(d0, p0) || vequal(d1, p0) || vequal(d0, p1) || vequal(d1, p1))
+					continue;
+				
+				if (intersect(d0, d1, p0, p1))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
 // Finds the lowest leftmost vertex of a contour.
 static void findLeftMostVertex(rcContour* contour, int* minx, int* minz, int* leftmost)
 {
@@ -706,17 +874,29 @@ static int compareHoles(const void* va, const void* vb)
 }
 
 
-static int compareDiagDist(const void* va, const void* vb)
+/// Returns true if diagonal @p a is shorter than diagonal @p b, or as long and to an earlier vertex.
+inline bool diagBefore(const rcPotentialDiagonal& a, const rcPotentialDiagonal& b)
 {
-	const rcPotentialDiagonal* a = (const rcPotentialDiagonal*)va;
-	const rcPotentialDiagonal* b = (const rcPotentialDiagonal*)vb;
-	if (a->dist < b->dist)
-		return -1;
-	if (a->dist > b->dist)
-		return 1;
-	return 0;
+	return a.dist < b.dist || (a.dist == b.dist && a.vert < b.vert);
 }
 
+static void siftDownDiag(rcPotentialDiagonal* diags, const int ndiags, int i)
+{
+	for (;;)
+	{
+		const int left = i*2 + 1;
+		const int right = left + 1;
+		int best = i;
+		if (left < ndiags && diagBefore(diags[left], diags[best]))
+			best = left;
+		if (right < ndiags && diagBefore(diags[right], diags[best]))
+			best = right;
+		if (best == i)
+			return;
+		rcSwap(diags[i], diags[best]);
+		i = best;
+	}
+}
 
 static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 {
@@ -737,6 +917,14 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 		return;
 	}
 	
+	// The segments of the outline and the holes, to test the diagonals against.
+	rcContourSegmentGrid grid;
+	if (!initContourSegmentGrid(grid, region))
+	{
+		ctx->log(RC_LOG_WARNING, "mergeRegionHoles: Failed to allocate segment grid %d.", maxVerts);
+		return;
+	}
+	
 	rcContour* outline = region.outline;
 	
 	// Merge holes into the outline one by one.
@@ -769,20 +957,23 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 					ndiags++;
 				}
 			}
-			// Sort potential diagonals by distance, we want to make the connection as short as possible.
-			qsort(diags, ndiags, sizeof(rcPotentialDiagonal), compareDiagDist);
+			// Try the potential diagonals from the shortest, we want to make the connection as short as possible.
+			// Usually one of the first is used, so they are kept in a heap instead of being sorted.
+			for (int j = ndiags/2 - 1; j >= 0; j--)
+				siftDownDiag(diags, ndiags, j);
 			
 			// Find a diagonal that is not intersecting the outline not the remaining holes.
 			index = -1;
-			for (int j = 0; j < ndiags; j++)
+			while (ndiags > 0)
 			{
-				const int* pt = &outline->verts[diags[j].vert*4];
-				bool intersect = intersectSegContour(pt, corner, diags[i].vert, outline->nverts, outline->verts);
-				for (int k = i; k < region.nholes && !intersect; k++)
-					intersect |= intersectSegContour(pt, corner, -1, region.holes[k].contour->nverts, region.holes[k].contour->verts);
-				if (!intersect)
+				const rcPotentialDiagonal diag = diags[0];
+				diags[0] = diags[--ndiags];
+				siftDownDiag(diags, ndiags, 0);
+				
+				const int* pt = &outline->verts[diag.vert*4];
+				if (!intersectSegGrid(grid, pt, corner))
 				{
-					index = diags[j].vert;
+					index = diag.vert;
 					break;
 				}
 			}
@@ -796,13 +987,25 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 		if (index == -1)
 		{
 			ctx->log(RC_LOG_WARNING, "mergeHoles: Failed to find merge points for %p and %p.", region.outline, hole);
+			grid.removed[i] = 1;
 			continue;
 		}
+		
+		// The segments of the hole become part of the outline, joined by the diagonal.
+		int diagonal[6];
+		memcpy(&diagonal[0], &outline->verts[index*4], sizeof(int)*3);
+		memcpy(&diagonal[3], &hole->verts[bestVertex*4], sizeof(int)*3);
 		if (!mergeContours(*region.outline, *hole, index, bestVertex))
 		{
 			ctx->log(RC_LOG_WARNING, "mergeHoles: Failed to merge contours %p and %p.", region.outline, hole);
+			grid.removed[i] = 1;
 			continue;
 		}
+		if (!addContourSegment(grid, &diagonal[0], &diagonal[3], -1))
+		{
+			ctx->log(RC_LOG_WARNING, "mergeRegionHoles: Failed to allocate segment grid %d.", maxVerts);
+			return;
+		}
 	}
 }
 
@@ -817,9 +1020,11 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 ///
 /// Setting @p maxEdgeLength to zero will disabled the edge length feature.
 ///
+/// The contour set may have been built before, in which case the memory of its contours is reused.
+///
 /// See the #rcConfig documentation for more information on the configuration parameters.
 ///
-/// @see rcAllocContourSet, rcCompactHeightfield, rcContourSet, rcConfig
+/// @see rcAllocContourSet, rcResetContourSet, rcCompactHeightfield, rcContourSet, rcConfig
 bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					 const float maxError, const int maxEdgeLen,
 					 rcContourSet& cset, const int buildFlags)
@@ -831,6 +1036,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	const int borderSize = chf.borderSize;
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_CONTOURS);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	rcVcopy(cset.bmin, chf.bmin);
 	rcVcopy(cset.bmax, chf.bmax);
@@ -850,11 +1056,10 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	cset.borderSize = chf.borderSize;
 	cset.maxError = maxError;
 	
-	int maxContours = rcMax((int)chf.maxRegions, 8);
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-	if (!cset.conts)
+	// The contours and their vertex arrays of a previous build are reused.
+	if (!reserveContours(cset, rcMax((int)chf.maxRegions, 8)))
 		return false;
-	cset.nconts = 0;
+	rcResetContourSet(cset);
 	
 	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
 	if (!flags)
@@ -937,31 +1142,24 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 				// Create contour.
 				if (simplified.size()/4 >= 3)
 				{
-					if (cset.nconts >= maxContours)
+					if (cset.nconts >= cset.maxconts)
 					{
 						// Allocate more contours.
 						// This happens when a region has holes.
-						const int oldMax = maxContours;
-						maxContours *= 2;
-						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-						for (int j = 0; j < cset.nconts; ++j)
+						const int oldMax = cset.maxconts;
+						if (!reserveContours(cset, oldMax*2))
 						{
-							newConts[j] = cset.conts[j];
-							// Reset source pointers to prevent data deletion.
-							cset.conts[j].verts = 0;
-							cset.conts[j].rverts = 0;
+							ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'conts' (%d).", oldMax*2);
+							return false;
 						}
-						rcFree(cset.conts);
-						cset.conts = newConts;
 						
-						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
+						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, cset.maxconts);
 					}
 					
 					rcContour* cont = &cset.conts[cset.nconts++];
 					
 					cont->nverts = simplified.size()/4;
-					cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM);
-					if (!cont->verts)
+					if (!reserveContourVerts(cont->verts, cont->maxverts, cont->nverts))
 					{
 						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
 						return false;
@@ -979,8 +1177,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					}
 					
 					cont->nrverts = verts.size()/4;
-					cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM);
-					if (!cont->rverts)
+					if (!reserveContourVerts(cont->rverts, cont->maxrverts, cont->nrverts))
 					{
 						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
 						return false;
@@ -18,134 +18,345 @@
 
 #include "Recast.h"
 #include "RecastAssert.h"
+#include "RecastParallel.h"
 
 #include <stdlib.h>
 
-void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield)
+namespace
 {
-	rcAssert(context);
+const int MAX_HEIGHT = 0xffff; // TODO (graham): Move this to a more visible constant and update usages.
 
-	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+/// The number of rows filtered by a task of the threaded fused filter.
+const int FILTER_BAND_HEIGHT = 16;
+
+/// Marks non-walkable spans of a column walkable if they are within walkableClimb of a walkable span below.
+void filterLowHangingWalkableObstaclesColumn(rcSpan* spans, const int walkableClimb)
+{
+	rcSpan* previousSpan = NULL;
+	bool previousWasWalkable = false;
+	unsigned char previousArea = RC_NULL_AREA;
+
+	for (rcSpan* span = spans; span != NULL; previousSpan = span, span = span->next)
+	{
+		const bool walkable = span->area != RC_NULL_AREA;
+		// If current span is not walkable, but there is walkable
+		// span just below it, mark the span above it walkable too.
+		if (!walkable && previousWasWalkable)
+		{
+			if (rcAbs((int)span->smax - (int)previousSpan->smax) <= walkableClimb)
+			{
+				span->area = previousArea;
+			}
+		}
+		// Copy walkable flag so that it cannot propagate
+		// past multiple non-walkable objects.
+		previousWasWalkable = walkable;
+		previousArea = span->area;
+	}
+}
 
+/// Returns true if the span does not have enough clearance above it.
+inline bool isLowHeightSpan(const rcSpan* span, const int walkableHeight)
+{
+	const int bot = (int)(span->smax);
+	const int top = span->next ? (int)(span->next->smin) : MAX_HEIGHT;
+	return (top - bot) < walkableHeight;
+}
+
+/// Returns true if the span at column (x, z) is a ledge. Only the geometry of the neighbour columns is read.
+bool isLedgeSpan(const rcHeightfield& heightfield, const int x, const int z, const rcSpan* span,
+                 const int walkableHeight, const int walkableClimb)
+{
 	const int xSize = heightfield.width;
 	const int zSize = heightfield.height;
 
-	for (int z = 0; z < zSize; ++z)
+	const int bot = (int)(span->smax);
+	const int top = span->next ? (int)(span->next->smin) : MAX_HEIGHT;
+
+	// Find neighbours minimum height.
+	int minNeighborHeight = MAX_HEIGHT;
+
+	// Min and max height of accessible neighbours.
+	int accessibleNeighborMinHeight = span->smax;
+	int accessibleNeighborMaxHeight = span->smax;
+
+	for (int direction = 0; direction < 4; ++direction)
 	{
-		for (int x = 0; x < xSize; ++x)
+		int dx = x + rcGetDirOffsetX(direction);
+		int dy = z + rcGetDirOffsetY(direction);
+		// Skip neighbours which are out of bounds.
+		if (dx < 0 || dy < 0 || dx >= xSize || dy >= zSize)
+		{
+			minNeighborHeight = rcMin(minNeighborHeight, -walkableClimb - bot);
+		}
+		else
 		{
-			rcSpan* previousSpan = NULL;
-			bool previousWasWalkable = false;
-			unsigned char previousArea = RC_NULL_AREA;
+			// From minus infinity to the first span.
+			const rcSpan* neighborSpan = heightfield.spans[dx + dy * xSize];
+			int neighborBot = -walkableClimb;
+			int neighborTop = neighborSpan ? (int)neighborSpan->smin : MAX_HEIGHT;
+
+			// Skip neighbour if the gap between the spans is too small.
+			if (rcMin(top, neighborTop) - rcMax(bot, neighborBot) > walkableHeight)
+			{
+				minNeighborHeight = rcMin(minNeighborHeight, neighborBot - bot);
+			}
 
-			for (rcSpan* span = heightfield.spans[x + z * xSize]; span != NULL; previousSpan = span, span = span->next)
+			// Rest of the spans.
+			for (; neighborSpan; neighborSpan = neighborSpan->next)
 			{
-				const bool walkable = span->area != RC_NULL_AREA;
-				// If current span is not walkable, but there is walkable
-				// span just below it, mark the span above it walkable too.
-				if (!walkable && previousWasWalkable)
+				neighborBot = (int)neighborSpan->smax;
+
+				// The spans are sorted, so once a span starts too close to the top of the current span,
+				// the gaps of the remaining spans are too small too.
+				if (top - neighborBot <= walkableHeight)
 				{
-					if (rcAbs((int)span->smax - (int)previousSpan->smax) <= walkableClimb)
+					break;
+				}
+
+				neighborTop = neighborSpan->next ? (int)neighborSpan->next->smin : MAX_HEIGHT;
+
+				// Skip neighbour if the gap between the spans is too small.
+				if (rcMin(top, neighborTop) - rcMax(bot, neighborBot) > walkableHeight)
+				{
+					minNeighborHeight = rcMin(minNeighborHeight, neighborBot - bot);
+
+					// Find min/max accessible neighbour height. 
+					if (rcAbs(neighborBot - bot) <= walkableClimb)
 					{
-						span->area = previousArea;
+						if (neighborBot < accessibleNeighborMinHeight) accessibleNeighborMinHeight = neighborBot;
+						if (neighborBot > accessibleNeighborMaxHeight) accessibleNeighborMaxHeight = neighborBot;
 					}
 				}
-				// Copy walkable flag so that it cannot propagate
-				// past multiple non-walkable objects.
-				previousWasWalkable = walkable;
-				previousArea = span->area;
 			}
 		}
+
+		// The current span is close to a ledge if the drop to any
+		// neighbour span is less than the walkableClimb.
+		if (minNeighborHeight < -walkableClimb)
+		{
+			return true;
+		}
 	}
+
+	// If the difference between all neighbours is too large,
+	// we are at steep slope, mark the span as ledge.
+	return (accessibleNeighborMaxHeight - accessibleNeighborMinHeight) > walkableClimb;
 }
 
-void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int walkableClimb,
-                        rcHeightfield& heightfield)
+/// Applies the filters selected by filterFlags to the columns in the range, one column at a time.
+void filterHeightfieldRange(rcHeightfield& heightfield, const int walkableHeight, const int walkableClimb,
+                            const int x0, const int z0, const int x1, const int z1, const int filterFlags)
 {
-	rcAssert(context);
-	
-	rcScopedTimer timer(context, RC_TIMER_FILTER_BORDER);
-
 	const int xSize = heightfield.width;
-	const int zSize = heightfield.height;
-	const int MAX_HEIGHT = 0xffff; // TODO (graham): Move this to a more visible constant and update usages.
-	
-	// Mark border spans.
-	for (int z = 0; z < zSize; ++z)
+
+	for (int z = z0; z <= z1; ++z)
 	{
-		for (int x = 0; x < xSize; ++x)
+		for (int x = x0; x <= x1; ++x)
 		{
-			for (rcSpan* span = heightfield.spans[x + z * xSize]; span; span = span->next)
+			rcSpan* spans = heightfield.spans[x + z * xSize];
+			if (!spans)
+			{
+				continue;
+			}
+
+			// The obstacle filter only changes the column itself, and the other filters only read the
+			// geometry of the neighbours, so the filters can be applied to each column in turn.
+			if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+			{
+				filterLowHangingWalkableObstaclesColumn(spans, walkableClimb);
+			}
+
+			for (rcSpan* span = spans; span; span = span->next)
 			{
-				// Skip non walkable spans.
 				if (span->area == RC_NULL_AREA)
 				{
 					continue;
 				}
+				if ((filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS) && isLowHeightSpan(span, walkableHeight))
+				{
+					span->area = RC_NULL_AREA;
+				}
+				else if ((filterFlags & RC_FILTER_LEDGE_SPANS) &&
+				         isLedgeSpan(heightfield, x, z, span, walkableHeight, walkableClimb))
+				{
+					span->area = RC_NULL_AREA;
+				}
+			}
+		}
+	}
+}
 
-				const int bot = (int)(span->smax);
-				const int top = span->next ? (int)(span->next->smin) : MAX_HEIGHT;
+/// Marks non-walkable spans of a column of a column heightfield walkable if they are within walkableClimb of a walkable span below.
+void filterLowHangingWalkableObstaclesColumn(rcColumnSpan* spans, const int count, const int walkableClimb)
+{
+	bool previousWasWalkable = false;
+	unsigned char previousArea = RC_NULL_AREA;
 
-				// Find neighbours minimum height.
-				int minNeighborHeight = MAX_HEIGHT;
+	for (int i = 0; i < count; ++i)
+	{
+		rcColumnSpan& span = spans[i];
+		const bool walkable = span.area != RC_NULL_AREA;
+		if (!walkable && previousWasWalkable)
+		{
+			if (rcAbs((int)span.smax - (int)spans[i - 1].smax) <= walkableClimb)
+			{
+				span.area = previousArea;
+			}
+		}
+		previousWasWalkable = walkable;
+		previousArea = (unsigned char)span.area;
+	}
+}
 
-				// Min and max height of accessible neighbours.
-				int accessibleNeighborMinHeight = span->smax;
-				int accessibleNeighborMaxHeight = span->smax;
+/// Returns true if the span at index i of column (x, z) of a column heightfield is a ledge. (See: #isLedgeSpan)
+bool isLedgeSpan(const rcColumnHeightfield& heightfield, const int x, const int z, const rcColumnSpan* spans,
+                 const int count, const int i, const int walkableHeight, const int walkableClimb)
+{
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
 
-				for (int direction = 0; direction < 4; ++direction)
-				{
-					int dx = x + rcGetDirOffsetX(direction);
-					int dy = z + rcGetDirOffsetY(direction);
-					// Skip neighbours which are out of bounds.
-					if (dx < 0 || dy < 0 || dx >= xSize || dy >= zSize)
-					{
-						minNeighborHeight = rcMin(minNeighborHeight, -walkableClimb - bot);
-						continue;
-					}
+	const int bot = (int)(spans[i].smax);
+	const int top = i + 1 < count ? (int)(spans[i + 1].smin) : MAX_HEIGHT;
 
-					// From minus infinity to the first span.
-					const rcSpan* neighborSpan = heightfield.spans[dx + dy * xSize];
-					int neighborBot = -walkableClimb;
-					int neighborTop = neighborSpan ? (int)neighborSpan->smin : MAX_HEIGHT;
-					
-					// Skip neighbour if the gap between the spans is too small.
-					if (rcMin(top, neighborTop) - rcMax(bot, neighborBot) > walkableHeight)
-					{
-						minNeighborHeight = rcMin(minNeighborHeight, neighborBot - bot);
-					}
+	int minNeighborHeight = MAX_HEIGHT;
+	int accessibleNeighborMinHeight = bot;
+	int accessibleNeighborMaxHeight = bot;
+
+	for (int direction = 0; direction < 4; ++direction)
+	{
+		const int dx = x + rcGetDirOffsetX(direction);
+		const int dy = z + rcGetDirOffsetY(direction);
+		if (dx < 0 || dy < 0 || dx >= xSize || dy >= zSize)
+		{
+			minNeighborHeight = rcMin(minNeighborHeight, -walkableClimb - bot);
+		}
+		else
+		{
+			const rcHeightfieldColumn& neighborColumn = heightfield.columns[dx + dy * xSize];
+			const rcColumnSpan* neighborSpans = &heightfield.spans[neighborColumn.index];
+			const int neighborCount = (int)neighborColumn.count;
+
+			// From minus infinity to the first span.
+			int neighborBot = -walkableClimb;
+			int neighborTop = neighborCount ? (int)neighborSpans[0].smin : MAX_HEIGHT;
+			if (rcMin(top, neighborTop) - rcMax(bot, neighborBot) > walkableHeight)
+			{
+				minNeighborHeight = rcMin(minNeighborHeight, neighborBot - bot);
+			}
 
-					// Rest of the spans.
-					for (neighborSpan = heightfield.spans[dx + dy * xSize]; neighborSpan; neighborSpan = neighborSpan->next)
+			// Rest of the spans.
+			for (int k = 0; k < neighborCount; ++k)
+			{
+				neighborBot = (int)neighborSpans[k].smax;
+				if (top - neighborBot <= walkableHeight)
+				{
+					break;
+				}
+
+				neighborTop = k + 1 < neighborCount ? (int)neighborSpans[k + 1].smin : MAX_HEIGHT;
+				if (rcMin(top, neighborTop) - rcMax(bot, neighborBot) > walkableHeight)
+				{
+					minNeighborHeight = rcMin(minNeighborHeight, neighborBot - bot);
+					if (rcAbs(neighborBot - bot) <= walkableClimb)
 					{
-						neighborBot = (int)neighborSpan->smax;
-						neighborTop = neighborSpan->next ? (int)neighborSpan->next->smin : MAX_HEIGHT;
-						
-						// Skip neighbour if the gap between the spans is too small.
-						if (rcMin(top, neighborTop) - rcMax(bot, neighborBot) > walkableHeight)
-						{
-							minNeighborHeight = rcMin(minNeighborHeight, neighborBot - bot);
-
-							// Find min/max accessible neighbour height. 
-							if (rcAbs(neighborBot - bot) <= walkableClimb)
-							{
-								if (neighborBot < accessibleNeighborMinHeight) accessibleNeighborMinHeight = neighborBot;
-								if (neighborBot > accessibleNeighborMaxHeight) accessibleNeighborMaxHeight = neighborBot;
-							}
-
-						}
+						if (neighborBot < accessibleNeighborMinHeight) accessibleNeighborMinHeight = neighborBot;
+						if (neighborBot > accessibleNeighborMaxHeight) accessibleNeighborMaxHeight = neighborBot;
 					}
 				}
+			}
+		}
+
+		if (minNeighborHeight < -walkableClimb)
+		{
+			return true;
+		}
+	}
+
+	return (accessibleNeighborMaxHeight - accessibleNeighborMinHeight) > walkableClimb;
+}
+
+struct FilterJob
+{
+	rcHeightfield* heightfield;
+	int walkableHeight;
+	int walkableClimb;
+	int filterFlags;
+	int firstBand;
+};
+
+void filterBandTask(int index, int /*worker*/, void* userData)
+{
+	const FilterJob* job = (const FilterJob*)userData;
+	rcHeightfield& heightfield = *job->heightfield;
+	const int z0 = (job->firstBand + index * 2) * FILTER_BAND_HEIGHT;
+	const int z1 = rcMin(z0 + FILTER_BAND_HEIGHT, heightfield.height) - 1;
+	filterHeightfieldRange(heightfield, job->walkableHeight, job->walkableClimb,
+	                       0, z0, heightfield.width - 1, z1, job->filterFlags);
+}
+}  // namespace
+
+void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield)
+{
+	rcFilterLowHangingWalkableObstacles(context, walkableClimb, heightfield, 0, 0, heightfield.width - 1, heightfield.height - 1);
+}
+
+void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield,
+                                         const int minX, const int minZ, const int maxX, const int maxZ)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+
+	const int xSize = heightfield.width;
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, heightfield.width - 1);
+	const int z1 = rcMin(maxZ, heightfield.height - 1);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			filterLowHangingWalkableObstaclesColumn(heightfield.spans[x + z * xSize], walkableClimb);
+		}
+	}
+}
+
+void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int walkableClimb,
+                        rcHeightfield& heightfield)
+{
+	rcFilterLedgeSpans(context, walkableHeight, walkableClimb, heightfield, 0, 0, heightfield.width - 1, heightfield.height - 1);
+}
 
-				// The current span is close to a ledge if the drop to any
-				// neighbour span is less than the walkableClimb.
-				if (minNeighborHeight < -walkableClimb)
+void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int walkableClimb,
+                        rcHeightfield& heightfield, const int minX, const int minZ, const int maxX, const int maxZ)
+{
+	rcAssert(context);
+	
+	rcScopedTimer timer(context, RC_TIMER_FILTER_BORDER);
+
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, xSize - 1);
+	const int z1 = rcMin(maxZ, zSize - 1);
+	
+	// Mark border spans.
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			for (rcSpan* span = heightfield.spans[x + z * xSize]; span; span = span->next)
+			{
+				// Skip non walkable spans.
+				if (span->area == RC_NULL_AREA)
 				{
-					span->area = RC_NULL_AREA;
+					continue;
 				}
-				// If the difference between all neighbours is too large,
-				// we are at steep slope, mark the span as ledge.
-				else if ((accessibleNeighborMaxHeight - accessibleNeighborMinHeight) > walkableClimb)
+
+				if (isLedgeSpan(heightfield, x, z, span, walkableHeight, walkableClimb))
 				{
 					span->area = RC_NULL_AREA;
 				}
@@ -155,26 +366,32 @@ void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int
 }
 
 void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight, rcHeightfield& heightfield)
+{
+	rcFilterWalkableLowHeightSpans(context, walkableHeight, heightfield, 0, 0, heightfield.width - 1, heightfield.height - 1);
+}
+
+void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight, rcHeightfield& heightfield,
+                                    const int minX, const int minZ, const int maxX, const int maxZ)
 {
 	rcAssert(context);
 	
 	rcScopedTimer timer(context, RC_TIMER_FILTER_WALKABLE);
 	
 	const int xSize = heightfield.width;
-	const int zSize = heightfield.height;
-	const int MAX_HEIGHT = 0xffff;
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, heightfield.width - 1);
+	const int z1 = rcMin(maxZ, heightfield.height - 1);
 	
 	// Remove walkable flag from spans which do not have enough
 	// space above them for the agent to stand there.
-	for (int z = 0; z < zSize; ++z)
+	for (int z = z0; z <= z1; ++z)
 	{
-		for (int x = 0; x < xSize; ++x)
+		for (int x = x0; x <= x1; ++x)
 		{
 			for (rcSpan* span = heightfield.spans[x + z*xSize]; span; span = span->next)
 			{
-				const int bot = (int)(span->smax);
-				const int top = span->next ? (int)(span->next->smin) : MAX_HEIGHT;
-				if ((top - bot) < walkableHeight)
+				if (isLowHeightSpan(span, walkableHeight))
 				{
 					span->area = RC_NULL_AREA;
 				}
@@ -182,3 +399,111 @@ void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight
 		}
 	}
 }
+
+void rcFilterHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                         rcHeightfield& heightfield, const int filterFlags)
+{
+	rcFilterHeightfield(context, walkableHeight, walkableClimb, heightfield,
+	                    0, 0, heightfield.width - 1, heightfield.height - 1, filterFlags);
+}
+
+void rcFilterHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                         rcHeightfield& heightfield, const int minX, const int minZ, const int maxX, const int maxZ,
+                         const int filterFlags)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_HEIGHTFIELD);
+
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, heightfield.width - 1);
+	const int z1 = rcMin(maxZ, heightfield.height - 1);
+
+	filterHeightfieldRange(heightfield, walkableHeight, walkableClimb, x0, z0, x1, z1, filterFlags);
+}
+
+/// @par
+///
+/// The heightfield is split into bands of rows. The even bands are filtered first, and the odd bands after
+/// them, so a band is never filtered while a neighbouring band whose spans it reads is being modified.
+void rcFilterHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                         rcHeightfield& heightfield, const int filterFlags, rcThreadPool* pool)
+{
+	rcAssert(context);
+
+	const int bandCount = (heightfield.height + FILTER_BAND_HEIGHT - 1) / FILTER_BAND_HEIGHT;
+	if (!pool || pool->getWorkerCount() < 2 || bandCount < 2)
+	{
+		rcFilterHeightfield(context, walkableHeight, walkableClimb, heightfield, filterFlags);
+		return;
+	}
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_HEIGHTFIELD);
+
+	FilterJob job;
+	job.heightfield = &heightfield;
+	job.walkableHeight = walkableHeight;
+	job.walkableClimb = walkableClimb;
+	job.filterFlags = filterFlags;
+
+	job.firstBand = 0;
+	pool->parallelFor((bandCount + 1) / 2, filterBandTask, &job);
+	job.firstBand = 1;
+	pool->parallelFor(bandCount / 2, filterBandTask, &job);
+}
+
+void rcFilterHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                         rcColumnHeightfield& heightfield, const int filterFlags)
+{
+	rcFilterHeightfield(context, walkableHeight, walkableClimb, heightfield,
+	                    0, 0, heightfield.width - 1, heightfield.height - 1, filterFlags);
+}
+
+void rcFilterHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                         rcColumnHeightfield& heightfield, const int minX, const int minZ, const int maxX, const int maxZ,
+                         const int filterFlags)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_HEIGHTFIELD);
+
+	const int xSize = heightfield.width;
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, heightfield.width - 1);
+	const int z1 = rcMin(maxZ, heightfield.height - 1);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			const rcHeightfieldColumn& column = heightfield.columns[x + z * xSize];
+			rcColumnSpan* spans = &heightfield.spans[column.index];
+			const int count = (int)column.count;
+
+			if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+			{
+				filterLowHangingWalkableObstaclesColumn(spans, count, walkableClimb);
+			}
+
+			for (int i = 0; i < count; ++i)
+			{
+				if (spans[i].area == RC_NULL_AREA)
+				{
+					continue;
+				}
+				const int clearance = (i + 1 < count ? (int)spans[i + 1].smin : MAX_HEIGHT) - (int)spans[i].smax;
+				if ((filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS) && clearance < walkableHeight)
+				{
+					spans[i].area = RC_NULL_AREA;
+				}
+				else if ((filterFlags & RC_FILTER_LEDGE_SPANS) &&
+				         isLedgeSpan(heightfield, x, z, spans, count, i, walkableHeight, walkableClimb))
+				{
+					spans[i].area = RC_NULL_AREA;
+				}
+			}
+		}
+	}
+}
@@ -108,6 +108,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_LAYERS);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	const int w = chf.width;
 	const int h = chf.height;
@@ -547,6 +547,266 @@ static void mergePolyVerts(unsigned short* pa, unsigned short* pb, int ea, int e
 }
 
 
+/// A pair of polygons which can be merged.
+struct rcPolyMergeCandidate
+{
+	int value;		///< The merge value, the squared length of the shared edge.
+	int posA;		///< The position of the first polygon in the polygon list.
+	int posB;		///< The position of the second polygon in the polygon list. (posA < posB)
+	int polyA;		///< The first polygon.
+	int polyB;		///< The second polygon.
+	int versionA;	///< The version of the first polygon when the candidate was found.
+	int versionB;	///< The version of the second polygon when the candidate was found.
+	int ea;			///< The shared edge in the first polygon.
+	int eb;			///< The shared edge in the second polygon.
+};
+
+/// Returns true if candidate @p a is merged before candidate @p b.
+/// The longest edge is merged first, ties go to the polygons earliest in the list.
+inline bool mergesBefore(const rcPolyMergeCandidate& a, const rcPolyMergeCandidate& b)
+{
+	if (a.value != b.value)
+		return a.value > b.value;
+	if (a.posA != b.posA)
+		return a.posA < b.posA;
+	return a.posB < b.posB;
+}
+
+static bool pushMergeCandidate(rcTempVector<rcPolyMergeCandidate>& heap, const rcPolyMergeCandidate& candidate)
+{
+	if (heap.size() == heap.capacity() && !heap.reserve(rcMax((int)heap.capacity() * 2, 64)))
+		return false;
+	heap.push_back(candidate);
+	
+	int i = (int)heap.size() - 1;
+	while (i > 0)
+	{
+		const int parent = (i - 1) / 2;
+		if (!mergesBefore(heap[i], heap[parent]))
+			break;
+		rcSwap(heap[i], heap[parent]);
+		i = parent;
+	}
+	return true;
+}
+
+static void popMergeCandidate(rcTempVector<rcPolyMergeCandidate>& heap)
+{
+	heap[0] = heap.back();
+	heap.pop_back();
+	
+	const int n = (int)heap.size();
+	int i = 0;
+	for (;;)
+	{
+		const int left = i * 2 + 1;
+		const int right = left + 1;
+		int best = i;
+		if (left < n && mergesBefore(heap[left], heap[best]))
+			best = left;
+		if (right < n && mergesBefore(heap[right], heap[best]))
+			best = right;
+		if (best == i)
+			break;
+		rcSwap(heap[i], heap[best]);
+		i = best;
+	}
+}
+
+/// The edges of a set of polygons, hashed by their vertices.
+/// Edge @e i of polygon @e p is stored at index p * nvp + i.
+struct rcPolyEdgeHash
+{
+	int* first;			///< The first edge of each bucket, or -1. [Size: bucketCount]
+	int* next;			///< The next edge in the bucket of each edge, or -1.
+	unsigned int* keys;	///< The vertices of each edge, smaller one first.
+	int bucketCount;	///< The number of buckets. (Power of two.)
+};
+
+inline int polyEdgeBucket(const rcPolyEdgeHash& hash, const unsigned int key)
+{
+	return (int)((key * 2654435761u) >> 8) & (hash.bucketCount - 1);
+}
+
+static void addPolyEdges(rcPolyEdgeHash& hash, const unsigned short* p, const int poly, const int nvp)
+{
+	const int nv = countPolyVerts(p, nvp);
+	for (int i = 0; i < nv; ++i)
+	{
+		unsigned short va = p[i];
+		unsigned short vb = p[(i+1) % nv];
+		if (va > vb)
+			rcSwap(va, vb);
+		const int edge = poly*nvp + i;
+		const unsigned int key = ((unsigned int)va << 16) | vb;
+		const int bucket = polyEdgeBucket(hash, key);
+		hash.keys[edge] = key;
+		hash.next[edge] = hash.first[bucket];
+		hash.first[bucket] = edge;
+	}
+}
+
+static void removePolyEdges(rcPolyEdgeHash& hash, const unsigned short* p, const int poly, const int nvp)
+{
+	const int nv = countPolyVerts(p, nvp);
+	for (int i = 0; i < nv; ++i)
+	{
+		const int edge = poly*nvp + i;
+		int* link = &hash.first[polyEdgeBucket(hash, hash.keys[edge])];
+		while (*link != edge)
+			link = &hash.next[*link];
+		*link = hash.next[edge];
+	}
+}
+
+/// Adds the merge candidates of a polygon and the polygons sharing an edge with it to the heap.
+static bool pushMergeCandidates(const rcPolyEdgeHash& hash, const int poly, unsigned short* polys,
+								const unsigned short* verts, const int nvp, const int* position, const int* version,
+								rcTempVector<rcPolyMergeCandidate>& heap)
+{
+	const int nv = countPolyVerts(&polys[poly*nvp], nvp);
+	for (int i = 0; i < nv; ++i)
+	{
+		const unsigned int key = hash.keys[poly*nvp + i];
+		for (int edge = hash.first[polyEdgeBucket(hash, key)]; edge != -1; edge = hash.next[edge])
+		{
+			const int nei = edge / nvp;
+			if (nei == poly || hash.keys[edge] != key)
+				continue;
+			
+			rcPolyMergeCandidate candidate;
+			candidate.polyA = position[poly] < position[nei] ? poly : nei;
+			candidate.polyB = position[poly] < position[nei] ? nei : poly;
+			candidate.value = getPolyMergeValue(&polys[candidate.polyA*nvp], &polys[candidate.polyB*nvp],
+												verts, candidate.ea, candidate.eb, nvp);
+			if (candidate.value <= 0)
+				continue;
+			candidate.posA = position[candidate.polyA];
+			candidate.posB = position[candidate.polyB];
+			candidate.versionA = version[candidate.polyA];
+			candidate.versionB = version[candidate.polyB];
+			if (!pushMergeCandidate(heap, candidate))
+				return false;
+		}
+	}
+	return true;
+}
+
+/// Merges a list of polygons into convex polygons of at most @p nvp vertices.
+///
+/// Repeatedly merges the two polygons sharing the longest edge, until no more polygons can be merged.
+/// The merged polygon takes the position of the first polygon in the list, and the last polygon of the
+/// list takes the position of the second one. The merge candidates are kept in a heap, and only the
+/// candidates of the polygons changed by a merge are searched again, which gives the same polygons as
+/// searching all pairs of polygons for each merge.
+///
+/// @param[in,out]	polys	The polygons. [Size: @p npolys * @p nvp]
+/// @param[in,out]	regs	The regions of the polygons, or null. Merging polygons of different regions
+///							gives #RC_MULTIPLE_REGS. [Size: @p npolys]
+/// @param[in,out]	areas	The areas of the polygons, or null. [Size: @p npolys]
+/// @returns The number of polygons after merging, or -1 if out of memory.
+static int mergePolys(rcContext* ctx, unsigned short* polys, unsigned short* regs, unsigned char* areas,
+					  const int npolys, const unsigned short* verts, const int nvp, unsigned short* tmpPoly)
+{
+	rcTempArenaScope tempScope(ctx->getTempArena());
+	
+	// The polygons stay in their slots while merging, their positions in the list are tracked separately.
+	// The version of a polygon changes when it is merged or moved, which invalidates its candidates.
+	rcTempVector<int> order(npolys);
+	rcTempVector<int> position(npolys);
+	rcTempVector<int> version(npolys, 0);
+	
+	int bucketCount = 1;
+	while (bucketCount < npolys*nvp)
+		bucketCount *= 2;
+	rcTempVector<int> firstEdge(bucketCount, -1);
+	rcTempVector<int> nextEdge(npolys*nvp);
+	rcTempVector<unsigned int> edgeKeys(npolys*nvp);
+	
+	rcTempVector<rcPolyMergeCandidate> heap;
+	if (order.size() != npolys || position.size() != npolys || version.size() != npolys ||
+		firstEdge.size() != bucketCount || nextEdge.size() != npolys*nvp || edgeKeys.size() != npolys*nvp ||
+		!heap.reserve(npolys*2))
+		return -1;
+	
+	rcPolyEdgeHash hash;
+	hash.first = &firstEdge[0];
+	hash.next = &nextEdge[0];
+	hash.keys = &edgeKeys[0];
+	hash.bucketCount = bucketCount;
+	
+	for (int i = 0; i < npolys; ++i)
+	{
+		order[i] = i;
+		position[i] = i;
+		addPolyEdges(hash, &polys[i*nvp], i, nvp);
+	}
+	for (int i = 0; i < npolys; ++i)
+	{
+		if (!pushMergeCandidates(hash, i, polys, verts, nvp, &position[0], &version[0], heap))
+			return -1;
+	}
+	
+	int count = npolys;
+	while (!heap.empty())
+	{
+		const rcPolyMergeCandidate best = heap[0];
+		popMergeCandidate(heap);
+		
+		// Skip the candidates of polygons which changed since they were found.
+		if (best.versionA != version[best.polyA] || best.versionB != version[best.polyB])
+			continue;
+		
+		// Found best, merge.
+		unsigned short* pa = &polys[best.polyA*nvp];
+		unsigned short* pb = &polys[best.polyB*nvp];
+		removePolyEdges(hash, pa, best.polyA, nvp);
+		removePolyEdges(hash, pb, best.polyB, nvp);
+		mergePolyVerts(pa, pb, best.ea, best.eb, tmpPoly, nvp);
+		addPolyEdges(hash, pa, best.polyA, nvp);
+		if (regs && regs[best.polyA] != regs[best.polyB])
+			regs[best.polyA] = RC_MULTIPLE_REGS;
+		version[best.polyA]++;
+		version[best.polyB]++;
+		if (!pushMergeCandidates(hash, best.polyA, polys, verts, nvp, &position[0], &version[0], heap))
+			return -1;
+		
+		// The last polygon takes the position of the removed one.
+		const int last = order[count-1];
+		count--;
+		if (last != best.polyB)
+		{
+			order[best.posB] = last;
+			position[last] = best.posB;
+			version[last]++;
+			if (!pushMergeCandidates(hash, last, polys, verts, nvp, &position[0], &version[0], heap))
+				return -1;
+		}
+	}
+	
+	// Store the polygons in the order of the list.
+	rcTempVector<unsigned short> sortedPolys(count*nvp);
+	rcTempVector<unsigned short> sortedRegs(count);
+	rcTempVector<unsigned char> sortedAreas(count);
+	if (sortedPolys.size() != count*nvp || sortedRegs.size() != count || sortedAreas.size() != count)
+		return -1;
+	for (int i = 0; i < count; ++i)
+	{
+		memcpy(&sortedPolys[i*nvp], &polys[order[i]*nvp], sizeof(unsigned short)*nvp);
+		if (regs)
+			sortedRegs[i] = regs[order[i]];
+		if (areas)
+			sortedAreas[i] = areas[order[i]];
+	}
+	memcpy(polys, &sortedPolys[0], sizeof(unsigned short)*count*nvp);
+	if (regs)
+		memcpy(regs, &sortedRegs[0], sizeof(unsigned short)*count);
+	if (areas)
+		memcpy(areas, &sortedAreas[0], sizeof(unsigned char)*count);
+	
+	return count;
+}
+
 static void pushFront(int v, int* arr, int& an)
 {
 	an++;
@@ -910,52 +1170,11 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	// Merge polygons.
 	if (nvp > 3)
 	{
-		for (;;)
+		npolys = mergePolys(ctx, polys, pregs, pareas, npolys, mesh.verts, nvp, tmpPoly);
+		if (npolys < 0)
 		{
-			// Find best polygons to merge.
-			int bestMergeVal = 0;
-			int bestPa = 0, bestPb = 0, bestEa = 0, bestEb = 0;
-			
-			for (int j = 0; j < npolys-1; ++j)
-			{
-				unsigned short* pj = &polys[j*nvp];
-				for (int k = j+1; k < npolys; ++k)
-				{
-					unsigned short* pk = &polys[k*nvp];
-					int ea, eb;
-					int v = getPolyMergeValue(pj, pk, mesh.verts, ea, eb, nvp);
-					if (v > bestMergeVal)
-					{
-						bestMergeVal = v;
-						bestPa = j;
-						bestPb = k;
-						bestEa = ea;
-						bestEb = eb;
-					}
-				}
-			}
-			
-			if (bestMergeVal > 0)
-			{
-				// Found best, merge.
-				unsigned short* pa = &polys[bestPa*nvp];
-				unsigned short* pb = &polys[bestPb*nvp];
-				mergePolyVerts(pa, pb, bestEa, bestEb, tmpPoly, nvp);
-				if (pregs[bestPa] != pregs[bestPb])
-					pregs[bestPa] = RC_MULTIPLE_REGS;
-
-				unsigned short* last = &polys[(npolys-1)*nvp];
-				if (pb != last)
-					memcpy(pb, last, sizeof(unsigned short)*nvp);
-				pregs[bestPb] = pregs[npolys-1];
-				pareas[bestPb] = pareas[npolys-1];
-				npolys--;
-			}
-			else
-			{
-				// Could not merge any polygons, stop.
-				break;
-			}
+			ctx->log(RC_LOG_ERROR, "removeVertex: Out of memory 'mergePolys' (%d).", ntris);
+			return false;
 		}
 	}
 	
@@ -985,12 +1204,15 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 /// @note If the mesh data is to be used to construct a Detour navigation mesh, then the upper 
 /// limit must be retricted to <= #DT_VERTS_PER_POLYGON.
 ///
-/// @see rcAllocPolyMesh, rcContourSet, rcPolyMesh, rcConfig
+/// The mesh may have been built before, in which case its arrays are reused when they are large enough.
+///
+/// @see rcAllocPolyMesh, rcResetPolyMesh, rcContourSet, rcPolyMesh, rcConfig
 bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh)
 {
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 
 	rcVcopy(mesh.bmin, cset.bmin);
 	rcVcopy(mesh.bmax, cset.bmax);
@@ -1025,35 +1247,60 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	}
 	memset(vflags, 0, maxVertices);
 	
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
-	if (!mesh.verts)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
-		return false;
-	}
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
-	if (!mesh.polys)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
-		return false;
-	}
-	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
-	if (!mesh.regs)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
-		return false;
-	}
-	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
-	if (!mesh.areas)
+	// Reuse the arrays of a previous build when they are large enough.
+	if (!mesh.verts || mesh.maxverts < maxVertices)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
-		return false;
+		rcFree(mesh.verts);
+		mesh.maxverts = 0;
+		mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
+		if (!mesh.verts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
+			return false;
+		}
+		mesh.maxverts = maxVertices;
+	}
+	if (!mesh.polys || mesh.maxpolys < maxTris || mesh.nvp < nvp)
+	{
+		rcFree(mesh.polys);
+		rcFree(mesh.regs);
+		rcFree(mesh.areas);
+		rcFree(mesh.flags);
+		mesh.regs = 0;
+		mesh.areas = 0;
+		mesh.flags = 0;
+		mesh.maxpolys = 0;
+		mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
+		if (!mesh.polys)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
+			return false;
+		}
+		mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.regs)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
+			return false;
+		}
+		mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.areas)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
+			return false;
+		}
+		// Just allocate the mesh flags array. The user is resposible to fill it.
+		mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.flags)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", maxTris);
+			return false;
+		}
+		mesh.maxpolys = maxTris;
 	}
 	
 	mesh.nverts = 0;
 	mesh.npolys = 0;
 	mesh.nvp = nvp;
-	mesh.maxpolys = maxTris;
 	
 	memset(mesh.verts, 0, sizeof(unsigned short)*maxVertices*3);
 	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxTris*nvp*2);
@@ -1160,47 +1407,11 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		// Merge polygons.
 		if (nvp > 3)
 		{
-			for(;;)
+			npolys = mergePolys(ctx, polys, 0, 0, npolys, mesh.verts, nvp, tmpPoly);
+			if (npolys < 0)
 			{
-				// Find best polygons to merge.
-				int bestMergeVal = 0;
-				int bestPa = 0, bestPb = 0, bestEa = 0, bestEb = 0;
-				
-				for (int j = 0; j < npolys-1; ++j)
-				{
-					unsigned short* pj = &polys[j*nvp];
-					for (int k = j+1; k < npolys; ++k)
-					{
-						unsigned short* pk = &polys[k*nvp];
-						int ea, eb;
-						int v = getPolyMergeValue(pj, pk, mesh.verts, ea, eb, nvp);
-						if (v > bestMergeVal)
-						{
-							bestMergeVal = v;
-							bestPa = j;
-							bestPb = k;
-							bestEa = ea;
-							bestEb = eb;
-						}
-					}
-				}
-				
-				if (bestMergeVal > 0)
-				{
-					// Found best, merge.
-					unsigned short* pa = &polys[bestPa*nvp];
-					unsigned short* pb = &polys[bestPb*nvp];
-					mergePolyVerts(pa, pb, bestEa, bestEb, tmpPoly, nvp);
-					unsigned short* lastPoly = &polys[(npolys-1)*nvp];
-					if (pb != lastPoly)
-						memcpy(pb, lastPoly, sizeof(unsigned short)*nvp);
-					npolys--;
-				}
-				else
-				{
-					// Could not merge any polygons, stop.
-					break;
-				}
+				ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mergePolys' (%d).", ntris);
+				return false;
 			}
 		}
 		
@@ -1283,13 +1494,7 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		}
 	}
 
-	// Just allocate the mesh flags array. The user is resposible to fill it.
-	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*mesh.npolys, RC_ALLOC_PERM);
-	if (!mesh.flags)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", mesh.npolys);
-		return false;
-	}
+	// The user is resposible to fill the flags.
 	memset(mesh.flags, 0, sizeof(unsigned short) * mesh.npolys);
 	
 	if (mesh.nverts > 0xffff)
@@ -1313,6 +1518,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		return true;
 
 	rcScopedTimer timer(ctx, RC_TIMER_MERGE_POLYMESH);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 
 	mesh.nvp = meshes[0]->nvp;
 	mesh.cs = meshes[0]->cs;
@@ -1339,6 +1545,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.verts' (%d).", maxVerts*3);
 		return false;
 	}
+	mesh.maxverts = maxVerts;
 
 	mesh.npolys = 0;
 	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM);
@@ -1497,6 +1704,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	dst.nverts = src.nverts;
 	dst.npolys = src.npolys;
 	dst.maxpolys = src.npolys;
+	dst.maxverts = src.nverts;
 	dst.nvp = src.nvp;
 	rcVcopy(dst.bmin, src.bmin);
 	rcVcopy(dst.bmax, src.bmax);
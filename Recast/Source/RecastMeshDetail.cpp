@@ -165,22 +165,6 @@ static float distancePtSeg2d(const float* pt, const float* p, const float* q)
 	return dx*dx + dz*dz;
 }
 
-static float distToTriMesh(const float* p, const float* verts, const int /*nverts*/, const int* tris, const int ntris)
-{
-	float dmin = FLT_MAX;
-	for (int i = 0; i < ntris; ++i)
-	{
-		const float* va = &verts[tris[i*4+0]*3];
-		const float* vb = &verts[tris[i*4+1]*3];
-		const float* vc = &verts[tris[i*4+2]*3];
-		float d = distPtTri(p, va,vb,vc);
-		if (d < dmin)
-			dmin = d;
-	}
-	if (dmin == FLT_MAX) return -1;
-	return dmin;
-}
-
 static float distToPoly(int nvert, const float* verts, const float* p)
 {
 	
@@ -280,255 +264,278 @@ static unsigned short getHeight(const float fx, const float fy, const float fz,
 }
 
 
-enum EdgeValues
-{
-	EV_UNDEF = -1,
-	EV_HULL = -2
-};
+static const int MAX_DETAIL_VERTS = 127;
+static const int MAX_DETAIL_TRIS = 255;	// Max tris for delaunay is 2n-2-k (n=num verts, k=num hull verts).
 
-static int findEdge(const int* edges, int nedges, int s, int t)
-{
-	for (int i = 0; i < nedges; i++)
-	{
-		const int* e = &edges[i*4];
-		if ((e[0] == s && e[1] == t) || (e[0] == t && e[1] == s))
-			return i;
-	}
-	return EV_UNDEF;
-}
+// The neighbour of a triangle edge which is on the hull of the triangulation.
+static const int HULL_EDGE = -1;
 
-static int addEdge(rcContext* ctx, int* edges, int& nedges, const int maxEdges, int s, int t, int l, int r)
+// Finds the neighbours of the triangle edges. The triangles must all have the same winding,
+// in which case the edge a->b of a triangle is the edge b->a of its neighbour.
+static void buildTriAdjacency(const rcIntArray& tris, const int nverts, int* adj)
 {
-	if (nedges >= maxEdges)
-	{
-		ctx->log(RC_LOG_ERROR, "addEdge: Too many edges (%d/%d).", nedges, maxEdges);
-		return EV_UNDEF;
-	}
+	int firstEdge[MAX_DETAIL_VERTS];
+	int nextEdge[MAX_DETAIL_TRIS*3];
+	const int ntris = tris.size()/4;
 	
-	// Add edge if not already in the triangulation.
-	int e = findEdge(edges, nedges, s, t);
-	if (e == EV_UNDEF)
+	for (int i = 0; i < nverts; ++i)
+		firstEdge[i] = -1;
+	for (int i = 0; i < ntris*3; ++i)
 	{
-		int* edge = &edges[nedges*4];
-		edge[0] = s;
-		edge[1] = t;
-		edge[2] = l;
-		edge[3] = r;
-		return nedges++;
+		const int a = tris[(i/3)*4 + i%3];
+		nextEdge[i] = firstEdge[a];
+		firstEdge[a] = i;
+		adj[i] = HULL_EDGE;
 	}
-	else
+	
+	for (int i = 0; i < ntris*3; ++i)
 	{
-		return EV_UNDEF;
+		const int a = tris[(i/3)*4 + i%3];
+		const int b = tris[(i/3)*4 + (i+1)%3];
+		for (int e = firstEdge[b]; e != -1; e = nextEdge[e])
+		{
+			if (tris[(e/3)*4 + (e+1)%3] == a)
+			{
+				adj[i] = e/3;
+				break;
+			}
+		}
 	}
 }
 
-static void updateLeftFace(int* e, int s, int t, int f)
+// Checks that the triangle has the winding of the triangulation, and is not degenerate.
+inline bool isValidTri(const float* a, const float* b, const float* c, const float dir)
 {
-	if (e[0] == s && e[1] == t && e[2] == EV_UNDEF)
-		e[2] = f;
-	else if (e[1] == s && e[0] == t && e[3] == EV_UNDEF)
-		e[3] = f;
+	static const float EPS = 1e-4f;
+	return vcross2(a, b, c)*dir > EPS*(vdist2(a, b) + vdist2(b, c) + vdist2(c, a));
 }
 
-static int overlapSegSeg2d(const float* a, const float* b, const float* c, const float* d)
+static void replaceNeighbour(int* adj, const int t, const int oldNei, const int newNei)
 {
-	const float a1 = vcross2(a, b, d);
-	const float a2 = vcross2(a, b, c);
-	if (a1*a2 < 0.0f)
+	if (t == HULL_EDGE)
+		return;
+	for (int k = 0; k < 3; ++k)
 	{
-		float a3 = vcross2(c, d, a);
-		float a4 = a3 + a2 - a1;
-		if (a3 * a4 < 0.0f)
-			return 1;
+		if (adj[t*3+k] == oldNei)
+		{
+			adj[t*3+k] = newNei;
+			return;
+		}
 	}
-	return 0;
 }
 
-static bool overlapEdges(const float* pts, const int* edges, int nedges, int s1, int t1)
+// Flips the edge k of triangle t if the point opposite to it in the neighbour triangle
+// is inside the circumcircle of t, or if either triangle is degenerate.
+// Returns the neighbour triangle if the edge was flipped, -1 otherwise.
+// After a flip t is (p,a,q) and the neighbour is (q,b,p), where a->b was the flipped edge
+// and p and q the opposite points.
+static int flipEdge(const float* verts, rcIntArray& tris, int* adj, const int t, const int k, const float dir)
 {
-	for (int i = 0; i < nedges; ++i)
+	const int u = adj[t*3+k];
+	if (u == HULL_EDGE)
+		return -1;
+	int m = 0;
+	while (adj[u*3+m] != t)
+		m++;
+	
+	const int a = tris[t*4+k];
+	const int b = tris[t*4+(k+1)%3];
+	const int p = tris[t*4+(k+2)%3];
+	const int q = tris[u*4+(m+2)%3];
+	const float* va = &verts[a*3];
+	const float* vb = &verts[b*3];
+	const float* vp = &verts[p*3];
+	const float* vq = &verts[q*3];
+	
+	// The new triangles must be valid.
+	if (!isValidTri(vp, va, vq, dir) || !isValidTri(vq, vb, vp, dir))
+		return -1;
+	
+	// Degenerate triangles are always flipped.
+	if (isValidTri(va, vb, vp, dir) && isValidTri(vb, va, vq, dir))
 	{
-		const int s0 = edges[i*4+0];
-		const int t0 = edges[i*4+1];
-		// Same or connected edges do not overlap.
-		if (s0 == s1 || s0 == t1 || t0 == s1 || t0 == t1)
-			continue;
-		if (overlapSegSeg2d(&pts[s0*3],&pts[t0*3], &pts[s1*3],&pts[t1*3]))
-			return true;
+		float c[3], r;
+		circumCircle(va, vb, vp, c, r);
+		// The tolerance is capped, as nearly degenerate triangles have huge circles.
+		const float tol = rcMin(r*0.001f, 0.001f);
+		if (vdist2(c, vq) >= r - tol)
+			return -1;
 	}
-	return false;
+	
+	const int nbp = adj[t*3+(k+1)%3];
+	const int npa = adj[t*3+(k+2)%3];
+	const int naq = adj[u*3+(m+1)%3];
+	const int nqb = adj[u*3+(m+2)%3];
+	
+	tris[t*4+0] = p; tris[t*4+1] = a; tris[t*4+2] = q;
+	adj[t*3+0] = npa; adj[t*3+1] = naq; adj[t*3+2] = u;
+	tris[u*4+0] = q; tris[u*4+1] = b; tris[u*4+2] = p;
+	adj[u*3+0] = nqb; adj[u*3+1] = nbp; adj[u*3+2] = t;
+	replaceNeighbour(adj, naq, u, t);
+	replaceNeighbour(adj, nbp, t, u);
+	
+	return u;
 }
 
-static void completeFacet(rcContext* ctx, const float* pts, int npts, int* edges, int& nedges, const int maxEdges, int& nfaces, int e)
+// Flips the edges on the stack until the triangles around them are Delaunay.
+// The triangles which change are marked with the stamp.
+static void legalizeEdges(const float* verts, rcIntArray& tris, int* adj, rcIntArray& stack,
+						  const float dir, int* triStamp, const int stamp)
 {
-	static const float EPS = 1e-5f;
-	
-	int* edge = &edges[e*4];
-	
-	// Cache s and t.
-	int s,t;
-	if (edge[2] == EV_UNDEF)
+	// Guards against cycling because of numerical issues.
+	int maxFlips = tris.size()*8;
+	while (stack.size() > 0)
 	{
-		s = edge[0];
-		t = edge[1];
-	}
-	else if (edge[3] == EV_UNDEF)
-	{
-		s = edge[1];
-		t = edge[0];
-	}
-	else
-	{
-	    // Edge already completed.
-	    return;
+		const int k = stack.pop();
+		const int t = stack.pop();
+		const int u = flipEdge(verts, tris, adj, t, k, dir);
+		if (u == -1)
+			continue;
+		triStamp[t] = stamp;
+		triStamp[u] = stamp;
+		if (--maxFlips <= 0)
+		{
+			stack.clear();
+			break;
+		}
+		stack.push(t); stack.push(0);
+		stack.push(t); stack.push(1);
+		stack.push(u); stack.push(0);
+		stack.push(u); stack.push(1);
 	}
-    
-	// Find best point on left of edge.
-	int pt = npts;
-	float c[3] = {0,0,0};
-	float r = -1;
-	for (int u = 0; u < npts; ++u)
+}
+
+// Inserts a point into the triangulation, starting the search for the triangle containing it from t.
+// The triangles which change are marked with the stamp.
+static void insertPoint(const float* verts, const int pt, rcIntArray& tris, int* adj, int t,
+						rcIntArray& stack, const float dir, int* triStamp, const int stamp)
+{
+	static const float EDGE_EPS = 1e-3f;
+	const float* p = &verts[pt*3];
+	const int ntris = tris.size()/4;
+	
+	// Walk towards the point.
+	float dist[3];
+	for (int iter = 0; ; ++iter)
 	{
-		if (u == s || u == t) continue;
-		if (vcross2(&pts[s*3], &pts[t*3], &pts[u*3]) > EPS)
+		int out = -1;
+		float outDist = 0;
+		for (int k = 0; k < 3; ++k)
 		{
-			if (r < 0)
+			const float* va = &verts[tris[t*4+k]*3];
+			const float* vb = &verts[tris[t*4+(k+1)%3]*3];
+			dist[k] = vcross2(va, vb, p)*dir / rcMax(vdist2(va, vb), EDGE_EPS);
+			if (dist[k] < outDist && adj[t*3+k] != HULL_EDGE)
 			{
-				// The circle is not updated yet, do it now.
-				pt = u;
-				circumCircle(&pts[s*3], &pts[t*3], &pts[u*3], c, r);
-				continue;
-			}
-			const float d = vdist2(c, &pts[u*3]);
-			const float tol = 0.001f;
-			if (d > r*(1+tol))
-			{
-				// Outside current circumcircle, skip.
-				continue;
-			}
-			else if (d < r*(1-tol))
-			{
-				// Inside safe circumcircle, update circle.
-				pt = u;
-				circumCircle(&pts[s*3], &pts[t*3], &pts[u*3], c, r);
-			}
-			else
-			{
-				// Inside epsilon circum circle, do extra tests to make sure the edge is valid.
-				// s-u and t-u cannot overlap with s-pt nor t-pt if they exists.
-				if (overlapEdges(pts, edges, nedges, s,u))
-					continue;
-				if (overlapEdges(pts, edges, nedges, t,u))
-					continue;
-				// Edge is valid.
-				pt = u;
-				circumCircle(&pts[s*3], &pts[t*3], &pts[u*3], c, r);
+				out = k;
+				outDist = dist[k];
 			}
 		}
+		if (out == -1 || outDist > -EDGE_EPS || iter >= ntris)
+			break;
+		t = adj[t*3+out];
 	}
 	
-	// Add new triangle or update edge info if s-t is on hull.
-	if (pt < npts)
-	{
-		// Update face information of edge being completed.
-		updateLeftFace(&edges[e*4], s, t, nfaces);
-		
-		// Add new edge or update face info of old edge.
-		e = findEdge(edges, nedges, pt, s);
-		if (e == EV_UNDEF)
-		    addEdge(ctx, edges, nedges, maxEdges, pt, s, nfaces, EV_UNDEF);
-		else
-		    updateLeftFace(&edges[e*4], pt, s, nfaces);
-		
-		// Add new edge or update face info of old edge.
-		e = findEdge(edges, nedges, t, pt);
-		if (e == EV_UNDEF)
-		    addEdge(ctx, edges, nedges, maxEdges, t, pt, nfaces, EV_UNDEF);
-		else
-		    updateLeftFace(&edges[e*4], t, pt, nfaces);
-		
-		nfaces++;
-	}
-	else
+	// Points on an edge split both triangles sharing it.
+	int edge = -1;
+	for (int k = 0; k < 3; ++k)
 	{
-		updateLeftFace(&edges[e*4], s, t, EV_HULL);
+		if (dist[k] < EDGE_EPS && (edge == -1 || dist[k] < dist[edge]))
+			edge = k;
 	}
-}
-
-static void delaunayHull(rcContext* ctx, const int npts, const float* pts,
-						 const int nhull, const int* hull,
-						 rcIntArray& tris, rcIntArray& edges)
-{
-	int nfaces = 0;
-	int nedges = 0;
-	const int maxEdges = npts*10;
-	edges.resize(maxEdges*4);
 	
-	for (int i = 0, j = nhull-1; i < nhull; j=i++)
-		addEdge(ctx, &edges[0], nedges, maxEdges, hull[j],hull[i], EV_HULL, EV_UNDEF);
-	
-	int currentEdge = 0;
-	while (currentEdge < nedges)
+	// Collect the edges around the cavity the point is inserted into, in order.
+	int cavA[4], cavB[4], cavNei[4], cavOwner[4];
+	int ncav = 0;
+	bool closed = true;
+	const int k0 = edge == -1 ? 0 : (edge+1)%3;
+	const int nedges = edge == -1 ? 3 : 2;
+	for (int i = 0; i < nedges; ++i)
 	{
-		if (edges[currentEdge*4+2] == EV_UNDEF)
-			completeFacet(ctx, pts, npts, &edges[0], nedges, maxEdges, nfaces, currentEdge);
-		if (edges[currentEdge*4+3] == EV_UNDEF)
-			completeFacet(ctx, pts, npts, &edges[0], nedges, maxEdges, nfaces, currentEdge);
-		currentEdge++;
+		const int k = (k0+i)%3;
+		cavA[ncav] = tris[t*4+k];
+		cavB[ncav] = tris[t*4+(k+1)%3];
+		cavNei[ncav] = adj[t*3+k];
+		cavOwner[ncav] = t;
+		ncav++;
 	}
-	
-	// Create tris
-	tris.resize(nfaces*4);
-	for (int i = 0; i < nfaces*4; ++i)
-		tris[i] = -1;
-	
-	for (int i = 0; i < nedges; ++i)
+	int u = -1;
+	if (edge != -1)
 	{
-		const int* e = &edges[i*4];
-		if (e[3] >= 0)
+		u = adj[t*3+edge];
+		if (u == HULL_EDGE)
 		{
-			// Left face
-			int* t = &tris[e[3]*4];
-			if (t[0] == -1)
-			{
-				t[0] = e[0];
-				t[1] = e[1];
-			}
-			else if (t[0] == e[1])
-				t[2] = e[0];
-			else if (t[1] == e[0])
-				t[2] = e[1];
+			closed = false;
 		}
-		if (e[2] >= 0)
+		else
 		{
-			// Right
-			int* t = &tris[e[2]*4];
-			if (t[0] == -1)
+			int m = 0;
+			while (adj[u*3+m] != t)
+				m++;
+			for (int i = 1; i < 3; ++i)
 			{
-				t[0] = e[1];
-				t[1] = e[0];
+				const int k = (m+i)%3;
+				cavA[ncav] = tris[u*4+k];
+				cavB[ncav] = tris[u*4+(k+1)%3];
+				cavNei[ncav] = adj[u*3+k];
+				cavOwner[ncav] = u;
+				ncav++;
 			}
-			else if (t[0] == e[0])
-				t[2] = e[1];
-			else if (t[1] == e[1])
-				t[2] = e[0];
 		}
 	}
 	
-	for (int i = 0; i < tris.size()/4; ++i)
+	// Fill the cavity with a fan of triangles around the point, reusing the removed triangles.
+	int slots[4];
+	slots[0] = t;
+	for (int i = 1; i < ncav; ++i)
+	{
+		if (i == 2 && u >= 0)
+		{
+			slots[i] = u;
+		}
+		else
+		{
+			slots[i] = tris.size()/4;
+			tris.push(0); tris.push(0); tris.push(0); tris.push(0);
+		}
+	}
+	for (int i = 0; i < ncav; ++i)
+	{
+		const int s = slots[i];
+		tris[s*4+0] = cavA[i];
+		tris[s*4+1] = cavB[i];
+		tris[s*4+2] = pt;
+		tris[s*4+3] = 0;
+		adj[s*3+0] = cavNei[i];
+		adj[s*3+1] = (i+1 < ncav) ? slots[i+1] : (closed ? slots[0] : HULL_EDGE);
+		adj[s*3+2] = (i > 0) ? slots[i-1] : (closed ? slots[ncav-1] : HULL_EDGE);
+		replaceNeighbour(adj, cavNei[i], cavOwner[i], s);
+		triStamp[s] = stamp;
+		stack.push(s);
+		stack.push(0);
+	}
+	
+	legalizeEdges(verts, tris, adj, stack, dir, triStamp, stamp);
+}
+
+// Finds the triangle closest in height to the point, returns -1 if the point is outside the triangles.
+static int findSampleTri(const float* p, const float* verts, const rcIntArray& tris,
+						 const int* candidates, const int ncandidates, float& dmin)
+{
+	int best = -1;
+	dmin = FLT_MAX;
+	const int ntris = candidates ? ncandidates : tris.size()/4;
+	for (int i = 0; i < ntris; ++i)
 	{
-		int* t = &tris[i*4];
-		if (t[0] == -1 || t[1] == -1 || t[2] == -1)
+		const int t = candidates ? candidates[i] : i;
+		const float d = distPtTri(p, &verts[tris[t*4+0]*3], &verts[tris[t*4+1]*3], &verts[tris[t*4+2]*3]);
+		if (d < dmin)
 		{
-			ctx->log(RC_LOG_WARNING, "delaunayHull: Removing dangling face %d [%d,%d,%d].", i, t[0],t[1],t[2]);
-			t[0] = tris[tris.size()-4];
-			t[1] = tris[tris.size()-3];
-			t[2] = tris[tris.size()-2];
-			t[3] = tris[tris.size()-1];
-			tris.resize(tris.size()-4);
-			--i;
+			dmin = d;
+			best = t;
 		}
 	}
+	return best;
 }
 
 // Calculate minimum extend of the polygon.
@@ -634,14 +641,25 @@ inline float getJitterY(const int i)
 	return (((i * 0xd8163841) & 0xffff) / 65535.0f * 2.0f) - 1.0f;
 }
 
+// The sample location is jittered to get rid of some bad triangulations
+// which are cause by symmetrical data from the grid structure.
+static void getSamplePos(const rcIntArray& samples, const int i, const float sampleDist,
+						 const float cs, const float ch, float* pt)
+{
+	pt[0] = samples[i*4+0]*sampleDist + getJitterX(i)*cs*0.1f;
+	pt[1] = samples[i*4+1]*ch;
+	pt[2] = samples[i*4+2]*sampleDist + getJitterY(i)*cs*0.1f;
+}
+
 static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 							const float sampleDist, const float sampleMaxError,
 							const int heightSearchRadius, const rcCompactHeightfield& chf,
 							const rcHeightPatch& hp, float* verts, int& nverts,
-							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples)
+							rcIntArray& tris, rcIntArray& stack, rcIntArray& samples,
+							rcTempVector<float>& sampleErrors)
 {
-	static const int MAX_VERTS = 127;
-	static const int MAX_TRIS = 255;	// Max tris for delaunay is 2n-2-k (n=num verts, k=num hull verts).
+	static const int MAX_VERTS = MAX_DETAIL_VERTS;
+	static const int MAX_TRIS = MAX_DETAIL_TRIS;
 	static const int MAX_VERTS_PER_EDGE = 32;
 	float edge[(MAX_VERTS_PER_EDGE+1)*3];
 	int hull[MAX_VERTS];
@@ -652,7 +670,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 	for (int i = 0; i < nin; ++i)
 		rcVcopy(&verts[i*3], &in[i*3]);
 	
-	edges.clear();
+	stack.clear();
 	tris.clear();
 	
 	const float cs = chf.cs;
@@ -775,7 +793,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 	}
 	
 	// Tessellate the base mesh.
-	// We're using the triangulateHull instead of delaunayHull as it tends to
+	// We're using the triangulateHull instead of a Delaunay triangulation as it tends to
 	// create a bit better triangulation for long thin triangles when there
 	// are no internal points.
 	triangulateHull(nverts, verts, nhull, hull, nin, tris);
@@ -816,56 +834,110 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 				samples.push(x);
 				samples.push(getHeight(pt[0], pt[1], pt[2], cs, ics, chf.ch, heightSearchRadius, hp));
 				samples.push(z);
-				samples.push(0); // Not added
+				samples.push(0); // Triangle of the sample, set below.
 			}
 		}
 		
 		// Add the samples starting from the one that has the most
 		// error. The procedure stops when all samples are added
 		// or when the max error is within treshold.
+		// Each sample keeps the triangle it is in and its error, which
+		// only need to be updated when the triangle changes.
 		const int nsamples = samples.size()/4;
+		sampleErrors.resize(nsamples);
+		for (int i = 0; i < nsamples; ++i)
+		{
+			float pt[3];
+			getSamplePos(samples, i, sampleDist, cs, chf.ch, pt);
+			samples[i*4+3] = findSampleTri(pt, verts, tris, 0, 0, sampleErrors[i]);
+		}
+		
+		int adj[MAX_TRIS*3];
+		int triStamp[MAX_TRIS];
+		int changed[MAX_TRIS];
+		float dir = 1.0f;
 		for (int iter = 0; iter < nsamples; ++iter)
 		{
 			if (nverts >= MAX_VERTS)
 				break;
 			
 			// Find sample with most error.
-			float bestpt[3] = {0,0,0};
 			float bestd = 0;
 			int besti = -1;
 			for (int i = 0; i < nsamples; ++i)
 			{
-				const int* s = &samples[i*4];
-				if (s[3]) continue; // skip added.
-				float pt[3];
-				// The sample location is jittered to get rid of some bad triangulations
-				// which are cause by symmetrical data from the grid structure.
-				pt[0] = s[0]*sampleDist + getJitterX(i)*cs*0.1f;
-				pt[1] = s[1]*chf.ch;
-				pt[2] = s[2]*sampleDist + getJitterY(i)*cs*0.1f;
-				float d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4);
-				if (d < 0) continue; // did not hit the mesh.
-				if (d > bestd)
+				if (samples[i*4+3] < 0) continue; // skip added, or did not hit the mesh.
+				if (sampleErrors[i] > bestd)
 				{
-					bestd = d;
+					bestd = sampleErrors[i];
 					besti = i;
-					rcVcopy(bestpt,pt);
 				}
 			}
 			// If the max error is within accepted threshold, stop tesselating.
 			if (bestd <= sampleMaxError || besti == -1)
 				break;
-			// Mark sample as added.
-			samples[besti*4+3] = 1;
-			// Add the new sample point.
-			rcVcopy(&verts[nverts*3],bestpt);
+			
+			if (iter == 0)
+			{
+				// Make the hull triangulation Delaunay before the first sample is added to it.
+				float area = 0;
+				for (int i = 2; i < nhull; ++i)
+					area += vcross2(&verts[hull[0]*3], &verts[hull[i-1]*3], &verts[hull[i]*3]);
+				dir = area < 0 ? -1.0f : 1.0f;
+				
+				buildTriAdjacency(tris, nverts, adj);
+				const int ntris = tris.size()/4;
+				for (int i = 0; i < ntris; ++i)
+				{
+					triStamp[i] = 0;
+					for (int k = 0; k < 3; ++k)
+					{
+						if (adj[i*3+k] > i)
+						{
+							stack.push(i);
+							stack.push(k);
+						}
+					}
+				}
+				legalizeEdges(verts, tris, adj, stack, dir, triStamp, 1);
+				
+				for (int i = 0; i < nsamples; ++i)
+				{
+					if (samples[i*4+3] < 0) continue;
+					float pt[3];
+					getSamplePos(samples, i, sampleDist, cs, chf.ch, pt);
+					samples[i*4+3] = findSampleTri(pt, verts, tris, 0, 0, sampleErrors[i]);
+				}
+				if (samples[besti*4+3] < 0)
+					continue;
+			}
+			
+			// Add the new sample point, and mark the sample as added.
+			const int t = samples[besti*4+3];
+			samples[besti*4+3] = -1;
+			getSamplePos(samples, besti, sampleDist, cs, chf.ch, &verts[nverts*3]);
+			const int stamp = iter + 2;
+			insertPoint(verts, nverts, tris, adj, t, stack, dir, triStamp, stamp);
 			nverts++;
 			
-			// Create new triangulation.
-			// TODO: Incremental add instead of full rebuild.
-			edges.clear();
-			tris.clear();
-			delaunayHull(ctx, nverts, verts, nhull, hull, tris, edges);
+			// Update the samples in the triangles that changed.
+			int nchanged = 0;
+			for (int i = 0; i < tris.size()/4; ++i)
+			{
+				if (triStamp[i] == stamp)
+					changed[nchanged++] = i;
+			}
+			for (int i = 0; i < nsamples; ++i)
+			{
+				const int st = samples[i*4+3];
+				if (st < 0 || triStamp[st] != stamp) continue;
+				float pt[3];
+				getSamplePos(samples, i, sampleDist, cs, chf.ch, pt);
+				int nt = findSampleTri(pt, verts, tris, changed, nchanged, sampleErrors[i]);
+				if (nt == -1)
+					nt = findSampleTri(pt, verts, tris, 0, 0, sampleErrors[i]);
+				samples[i*4+3] = nt;
+			}
 		}
 	}
 	
@@ -1174,6 +1246,7 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESHDETAIL);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	if (mesh.nverts == 0 || mesh.npolys == 0)
 		return true;
@@ -1185,10 +1258,11 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 	const int borderSize = mesh.borderSize;
 	const int heightSearchRadius = rcMax(1, (int)ceilf(mesh.maxEdgeError));
 	
-	rcIntArray edges(64);
+	rcIntArray stack(64);
 	rcIntArray tris(512);
 	rcIntArray arr(512);
 	rcIntArray samples(512);
+	rcTempVector<float> sampleErrors;
 	float verts[256*3];
 	rcHeightPatch hp;
 	int nPolyVerts = 0;
@@ -1302,7 +1376,7 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 							 sampleDist, sampleMaxError,
 							 heightSearchRadius, chf, hp,
 							 verts, nverts, tris,
-							 edges, samples))
+							 stack, samples, sampleErrors))
 		{
 			return false;
 		}
@@ -1391,6 +1465,7 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_MERGE_POLYMESHDETAIL);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	int maxVerts = 0;
 	int maxTris = 0;
@@ -0,0 +1,623 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "RecastParallel.h"
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastAssert.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace
+{
+// Minimal platform layer. Recast is compiled as C++98, so std::thread & co. are not available.
+#ifdef _WIN32
+typedef CRITICAL_SECTION rcMutexHandle;
+typedef CONDITION_VARIABLE rcCondHandle;
+typedef HANDLE rcThreadHandle;
+typedef DWORD rcThreadId;
+
+void mutexInit(rcMutexHandle* m) { InitializeCriticalSection(m); }
+void mutexDestroy(rcMutexHandle* m) { DeleteCriticalSection(m); }
+void mutexLock(rcMutexHandle* m) { EnterCriticalSection(m); }
+void mutexUnlock(rcMutexHandle* m) { LeaveCriticalSection(m); }
+
+void condInit(rcCondHandle* c) { InitializeConditionVariable(c); }
+void condDestroy(rcCondHandle*) {}
+void condWait(rcCondHandle* c, rcMutexHandle* m) { SleepConditionVariableCS(c, m, INFINITE); }
+void condBroadcast(rcCondHandle* c) { WakeAllConditionVariable(c); }
+
+rcThreadId currentThreadId() { return GetCurrentThreadId(); }
+bool threadIdEqual(rcThreadId a, rcThreadId b) { return a == b; }
+
+double getTimeUsec()
+{
+	LARGE_INTEGER count, freq;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	return (double)count.QuadPart * 1000000.0 / (double)freq.QuadPart;
+}
+#else
+typedef pthread_mutex_t rcMutexHandle;
+typedef pthread_cond_t rcCondHandle;
+typedef pthread_t rcThreadHandle;
+typedef pthread_t rcThreadId;
+
+void mutexInit(rcMutexHandle* m) { pthread_mutex_init(m, 0); }
+void mutexDestroy(rcMutexHandle* m) { pthread_mutex_destroy(m); }
+void mutexLock(rcMutexHandle* m) { pthread_mutex_lock(m); }
+void mutexUnlock(rcMutexHandle* m) { pthread_mutex_unlock(m); }
+
+void condInit(rcCondHandle* c) { pthread_cond_init(c, 0); }
+void condDestroy(rcCondHandle* c) { pthread_cond_destroy(c); }
+void condWait(rcCondHandle* c, rcMutexHandle* m) { pthread_cond_wait(c, m); }
+void condBroadcast(rcCondHandle* c) { pthread_cond_broadcast(c); }
+
+rcThreadId currentThreadId() { return pthread_self(); }
+bool threadIdEqual(rcThreadId a, rcThreadId b) { return pthread_equal(a, b) != 0; }
+
+double getTimeUsec()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000000.0 + (double)now.tv_nsec / 1000.0;
+}
+#endif
+} // namespace
+
+/// The range of task indices [begin, end) owned by a worker.
+struct rcWorkRange
+{
+	rcMutexHandle lock;
+	int begin;
+	int end;
+};
+
+struct rcThreadPoolImpl;
+
+struct rcWorkerStartInfo
+{
+	rcThreadPoolImpl* pool;
+	int worker;
+};
+
+struct rcThreadPoolImpl
+{
+	int workerCount;
+	int threadCount;
+	rcThreadHandle* threads;
+	rcThreadId* threadIds;		// Index 0 is only valid while 'running' is set.
+	rcWorkerStartInfo* startInfos;
+	rcWorkRange* ranges;
+
+	// Serializes calls to parallelFor.
+	rcMutexHandle callLock;
+
+	// Protects the fields below.
+	rcMutexHandle lock;
+	rcCondHandle workCond;
+	rcCondHandle doneCond;
+	unsigned int generation;
+	int activeWorkers;
+	bool running;
+	bool quit;
+	rcParallelTaskFunc* func;
+	void* userData;
+};
+
+static bool popTask(rcWorkRange& range, int& index)
+{
+	bool found = false;
+	mutexLock(&range.lock);
+	if (range.begin < range.end)
+	{
+		index = range.begin++;
+		found = true;
+	}
+	mutexUnlock(&range.lock);
+	return found;
+}
+
+// Moves the back half of the largest remaining range of another worker into the range of the given worker.
+static bool stealTasks(rcThreadPoolImpl* pool, const int worker)
+{
+	for (;;)
+	{
+		int victim = -1;
+		int victimSize = 0;
+		for (int i = 0; i < pool->workerCount; ++i)
+		{
+			if (i == worker)
+				continue;
+			rcWorkRange& range = pool->ranges[i];
+			mutexLock(&range.lock);
+			const int size = range.end - range.begin;
+			mutexUnlock(&range.lock);
+			if (size > victimSize)
+			{
+				victim = i;
+				victimSize = size;
+			}
+		}
+		if (victim == -1)
+			return false;
+
+		rcWorkRange& from = pool->ranges[victim];
+		int begin = 0;
+		int end = 0;
+		mutexLock(&from.lock);
+		const int size = from.end - from.begin;
+		if (size > 0)
+		{
+			end = from.end;
+			begin = from.end - (size + 1) / 2;
+			from.end = begin;
+		}
+		mutexUnlock(&from.lock);
+
+		if (begin < end)
+		{
+			rcWorkRange& to = pool->ranges[worker];
+			mutexLock(&to.lock);
+			to.begin = begin;
+			to.end = end;
+			mutexUnlock(&to.lock);
+			return true;
+		}
+		// The victim finished its work in the meantime, look again.
+	}
+}
+
+static void runTasks(rcThreadPoolImpl* pool, const int worker)
+{
+	rcParallelTaskFunc* func = pool->func;
+	void* userData = pool->userData;
+	for (;;)
+	{
+		int index;
+		while (popTask(pool->ranges[worker], index))
+			func(index, worker, userData);
+		if (!stealTasks(pool, worker))
+			break;
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI workerMain(LPVOID param)
+#else
+static void* workerMain(void* param)
+#endif
+{
+	rcWorkerStartInfo* info = (rcWorkerStartInfo*)param;
+	rcThreadPoolImpl* pool = info->pool;
+	const int worker = info->worker;
+
+	// The pool may already have been given work before this thread got to run,
+	// so start from the initial generation instead of the current one.
+	unsigned int seen = 0;
+	mutexLock(&pool->lock);
+	for (;;)
+	{
+		while (!pool->quit && pool->generation == seen)
+			condWait(&pool->workCond, &pool->lock);
+		if (pool->quit)
+			break;
+		seen = pool->generation;
+		mutexUnlock(&pool->lock);
+
+		runTasks(pool, worker);
+
+		mutexLock(&pool->lock);
+		pool->activeWorkers--;
+		if (pool->activeWorkers == 0)
+			condBroadcast(&pool->doneCond);
+	}
+	mutexUnlock(&pool->lock);
+
+	return 0;
+}
+
+rcThreadPool::rcThreadPool() :
+	m_impl(0)
+{
+}
+
+rcThreadPool::~rcThreadPool()
+{
+	shutdown();
+}
+
+/// @par
+///
+/// Calling #init on an already initialized pool shuts down the current workers first.
+/// If the threads cannot be created, the pool stays uninitialized and #parallelFor
+/// runs all tasks on the calling thread.
+bool rcThreadPool::init(int workerCount)
+{
+	shutdown();
+
+	if (workerCount < 1)
+		return false;
+
+	rcThreadPoolImpl* pool = (rcThreadPoolImpl*)rcAlloc(sizeof(rcThreadPoolImpl), RC_ALLOC_PERM);
+	if (!pool)
+		return false;
+	memset(pool, 0, sizeof(rcThreadPoolImpl));
+
+	pool->workerCount = workerCount;
+	pool->threads = (rcThreadHandle*)rcAlloc(sizeof(rcThreadHandle) * workerCount, RC_ALLOC_PERM);
+	pool->threadIds = (rcThreadId*)rcAlloc(sizeof(rcThreadId) * workerCount, RC_ALLOC_PERM);
+	pool->startInfos = (rcWorkerStartInfo*)rcAlloc(sizeof(rcWorkerStartInfo) * workerCount, RC_ALLOC_PERM);
+	pool->ranges = (rcWorkRange*)rcAlloc(sizeof(rcWorkRange) * workerCount, RC_ALLOC_PERM);
+	if (!pool->threads || !pool->threadIds || !pool->startInfos || !pool->ranges)
+	{
+		rcFree(pool->threads);
+		rcFree(pool->threadIds);
+		rcFree(pool->startInfos);
+		rcFree(pool->ranges);
+		rcFree(pool);
+		return false;
+	}
+
+	mutexInit(&pool->callLock);
+	mutexInit(&pool->lock);
+	condInit(&pool->workCond);
+	condInit(&pool->doneCond);
+	for (int i = 0; i < workerCount; ++i)
+	{
+		mutexInit(&pool->ranges[i].lock);
+		pool->ranges[i].begin = 0;
+		pool->ranges[i].end = 0;
+		pool->startInfos[i].pool = pool;
+		pool->startInfos[i].worker = i;
+	}
+	m_impl = pool;
+
+	// Worker 0 is the thread calling parallelFor.
+	pool->threadCount = 1;
+	for (int i = 1; i < workerCount; ++i)
+	{
+#ifdef _WIN32
+		DWORD threadId = 0;
+		pool->threads[i] = CreateThread(0, 0, workerMain, &pool->startInfos[i], 0, &threadId);
+		const bool created = pool->threads[i] != 0;
+		pool->threadIds[i] = threadId;
+#else
+		const bool created = pthread_create(&pool->threads[i], 0, workerMain, &pool->startInfos[i]) == 0;
+		pool->threadIds[i] = pool->threads[i];
+#endif
+		if (!created)
+		{
+			shutdown();
+			return false;
+		}
+		pool->threadCount++;
+	}
+
+	return true;
+}
+
+void rcThreadPool::shutdown()
+{
+	rcThreadPoolImpl* pool = m_impl;
+	if (!pool)
+		return;
+
+	mutexLock(&pool->lock);
+	pool->quit = true;
+	condBroadcast(&pool->workCond);
+	mutexUnlock(&pool->lock);
+
+	for (int i = 1; i < pool->threadCount; ++i)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(pool->threads[i], INFINITE);
+		CloseHandle(pool->threads[i]);
+#else
+		pthread_join(pool->threads[i], 0);
+#endif
+	}
+
+	for (int i = 0; i < pool->workerCount; ++i)
+		mutexDestroy(&pool->ranges[i].lock);
+	condDestroy(&pool->doneCond);
+	condDestroy(&pool->workCond);
+	mutexDestroy(&pool->lock);
+	mutexDestroy(&pool->callLock);
+
+	rcFree(pool->threads);
+	rcFree(pool->threadIds);
+	rcFree(pool->startInfos);
+	rcFree(pool->ranges);
+	rcFree(pool);
+	m_impl = 0;
+}
+
+int rcThreadPool::getWorkerCount() const
+{
+	return m_impl ? m_impl->workerCount : 1;
+}
+
+void rcThreadPool::parallelFor(int count, rcParallelTaskFunc* func, void* userData)
+{
+	rcAssert(func);
+	if (count <= 0)
+		return;
+
+	rcThreadPoolImpl* pool = m_impl;
+	if (!pool || pool->workerCount == 1)
+	{
+		for (int i = 0; i < count; ++i)
+			func(i, 0, userData);
+		return;
+	}
+
+	// A task calling back into the pool runs the nested tasks itself. This is checked by thread ID
+	// rather than by failing to take the call lock, as the Win32 critical sections are recursive.
+	const rcThreadId self = currentThreadId();
+	int worker = -1;
+	mutexLock(&pool->lock);
+	for (int w = 0; w < pool->workerCount; ++w)
+	{
+		if ((w > 0 || pool->running) && threadIdEqual(pool->threadIds[w], self))
+		{
+			worker = w;
+			break;
+		}
+	}
+	mutexUnlock(&pool->lock);
+	if (worker != -1)
+	{
+		for (int i = 0; i < count; ++i)
+			func(i, worker, userData);
+		return;
+	}
+
+	// Wait for any other thread using the pool to finish.
+	mutexLock(&pool->callLock);
+
+	// Split the tasks into contiguous ranges, one per worker.
+	const int workerCount = pool->workerCount;
+	for (int w = 0; w < workerCount; ++w)
+	{
+		rcWorkRange& range = pool->ranges[w];
+		mutexLock(&range.lock);
+		range.begin = w * (count / workerCount) + rcMin(w, count % workerCount);
+		range.end = range.begin + count / workerCount + (w < count % workerCount ? 1 : 0);
+		mutexUnlock(&range.lock);
+	}
+
+	mutexLock(&pool->lock);
+	pool->threadIds[0] = currentThreadId();
+	pool->running = true;
+	pool->func = func;
+	pool->userData = userData;
+	pool->activeWorkers = workerCount - 1;
+	pool->generation++;
+	condBroadcast(&pool->workCond);
+	mutexUnlock(&pool->lock);
+
+	runTasks(pool, 0);
+
+	mutexLock(&pool->lock);
+	while (pool->activeWorkers > 0)
+		condWait(&pool->doneCond, &pool->lock);
+	pool->running = false;
+	pool->func = 0;
+	pool->userData = 0;
+	mutexUnlock(&pool->lock);
+
+	mutexUnlock(&pool->callLock);
+}
+
+rcTimerContext::rcTimerContext() : rcContext(true)
+{
+	doResetTimers();
+}
+
+void rcTimerContext::addTimesTo(rcContext* ctx) const
+{
+	if (!ctx)
+		return;
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		if (m_accTime[i] >= 0.0)
+			ctx->addAccumulatedTime((rcTimerLabel)i, (int)m_accTime[i]);
+	}
+}
+
+void rcTimerContext::doResetTimers()
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		m_startTime[i] = 0.0;
+		m_accTime[i] = -1.0;
+	}
+}
+
+void rcTimerContext::doStartTimer(const rcTimerLabel label)
+{
+	m_startTime[label] = getTimeUsec();
+}
+
+void rcTimerContext::doStopTimer(const rcTimerLabel label)
+{
+	const double deltaTime = getTimeUsec() - m_startTime[label];
+	if (m_accTime[label] < 0.0)
+		m_accTime[label] = deltaTime;
+	else
+		m_accTime[label] += deltaTime;
+}
+
+int rcTimerContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+	return m_accTime[label] < 0.0 ? -1 : (int)m_accTime[label];
+}
+
+void rcTimerContext::doAddAccumulatedTime(const rcTimerLabel label, const int time)
+{
+	if (m_accTime[label] < 0.0)
+		m_accTime[label] = (double)time;
+	else
+		m_accTime[label] += (double)time;
+}
+
+namespace
+{
+struct rcBuiltTile
+{
+	unsigned char* data;
+	int dataSize;
+};
+
+struct rcBuildTilesJob
+{
+	rcContext** contexts;
+	int tilesX;
+	const int* tileCoords;
+	rcBuildTileFunc* buildFunc;
+	void* userData;
+	rcBuiltTile* tiles;
+};
+
+void getTileCoords(const rcBuildTilesJob* job, int index, int* tx, int* ty)
+{
+	if (job->tileCoords)
+	{
+		*tx = job->tileCoords[index * 2 + 0];
+		*ty = job->tileCoords[index * 2 + 1];
+	}
+	else
+	{
+		*tx = index % job->tilesX;
+		*ty = index / job->tilesX;
+	}
+}
+
+void buildTileTask(int index, int worker, void* userData)
+{
+	rcBuildTilesJob* job = (rcBuildTilesJob*)userData;
+	int tx, ty;
+	getTileCoords(job, index, &tx, &ty);
+	rcBuiltTile& tile = job->tiles[index];
+	tile.dataSize = 0;
+	tile.data = job->buildFunc(job->contexts[worker], tx, ty, worker, job->userData, &tile.dataSize);
+}
+
+bool buildTiles(rcThreadPool* pool, rcContext** contexts, int tilesX, const int* tileCoords, int tileCount,
+				rcBuildTileFunc* buildFunc, rcAddTileFunc* addFunc, void* userData, bool addEmptyTiles, const char* name)
+{
+	rcAssert(contexts);
+	rcContext* ctx = contexts[0];
+
+	if (!buildFunc || !addFunc)
+	{
+		ctx->log(RC_LOG_ERROR, "%s: Invalid build or add function.", name);
+		return false;
+	}
+	if (tileCount <= 0)
+		return true;
+
+	rcBuiltTile* tiles = (rcBuiltTile*)rcAlloc(sizeof(rcBuiltTile) * tileCount, RC_ALLOC_TEMP);
+	if (!tiles)
+	{
+		ctx->log(RC_LOG_ERROR, "%s: Out of memory 'tiles' (%d).", name, tileCount);
+		return false;
+	}
+
+	rcBuildTilesJob job;
+	job.contexts = contexts;
+	job.tilesX = tilesX;
+	job.tileCoords = tileCoords;
+	job.buildFunc = buildFunc;
+	job.userData = userData;
+	job.tiles = tiles;
+
+	if (pool)
+	{
+		pool->parallelFor(tileCount, buildTileTask, &job);
+	}
+	else
+	{
+		for (int i = 0; i < tileCount; ++i)
+			buildTileTask(i, 0, &job);
+	}
+
+	// Hand over the tiles in a fixed order so that the result does not depend on the scheduling.
+	for (int i = 0; i < tileCount; ++i)
+	{
+		if (tiles[i].data || addEmptyTiles)
+		{
+			int tx, ty;
+			getTileCoords(&job, i, &tx, &ty);
+			addFunc(tx, ty, tiles[i].data, tiles[i].dataSize, userData);
+		}
+	}
+
+	rcFree(tiles);
+
+	return true;
+}
+} // namespace
+
+/// @par
+///
+/// The build function is called concurrently and must only touch state owned by the calling worker,
+/// the read-only input geometry and the context passed to it. The add function is called on the calling
+/// thread after all tiles have been built, so it may freely modify shared state such as a dtNavMesh.
+///
+/// @see rcThreadPool
+bool rcBuildTiles(rcThreadPool* pool, rcContext** contexts, int tilesX, int tilesY,
+				  rcBuildTileFunc* buildFunc, rcAddTileFunc* addFunc, void* userData)
+{
+	const int tileCount = (tilesX > 0 && tilesY > 0) ? tilesX * tilesY : 0;
+	return buildTiles(pool, contexts, tilesX, 0, tileCount, buildFunc, addFunc, userData, false, "rcBuildTiles");
+}
+
+/// @par
+///
+/// Used to update a navigation mesh after its geometry changed, by only rebuilding the tiles
+/// overlapping the changed geometry. The build function can keep the heightfield of each tile,
+/// and update only the changed columns of it before rebuilding the rest of the tile.
+/// (See: #rcCalcColumnRange)
+///
+/// The same rules as for #rcBuildTiles apply to the build and add functions. The add function
+/// is also called for the tiles which become empty, with null data, so that the caller can remove
+/// the previous version of the tile.
+///
+/// @see rcBuildTiles
+bool rcRebuildTiles(rcThreadPool* pool, rcContext** contexts, const int* tiles, int tileCount,
+					rcBuildTileFunc* buildFunc, rcAddTileFunc* addFunc, void* userData)
+{
+	if (tileCount > 0 && !tiles)
+	{
+		contexts[0]->log(RC_LOG_ERROR, "rcRebuildTiles: Invalid tiles.");
+		return false;
+	}
+	return buildTiles(pool, contexts, 0, tiles, tileCount, buildFunc, addFunc, userData, true, "rcRebuildTiles");
+}
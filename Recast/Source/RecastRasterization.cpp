@@ -16,12 +16,31 @@
 // 3. This notice may not be removed or altered from any source distribution.
 //
 
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RC_HAS_SSE2_KERNEL
+#include <emmintrin.h>
+#endif
+
+// The AVX2 kernel is compiled for the target with function attributes, and selected only if the processor supports it.
+#if defined(RC_HAS_SSE2_KERNEL) && (defined(__GNUC__) || (defined(_MSC_VER) && !defined(__clang__)))
+#define RC_HAS_AVX2_KERNEL
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RC_TARGET_AVX2
+#else
+#define RC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 /// Check whether two bounding boxes overlap
 ///
 /// @param[in]	aMin	Min axis extents of bounding box A
@@ -189,6 +208,149 @@ static bool addSpan(rcHeightfield& hf,
 	return true;
 }
 
+/// Doubles the capacity of a column of the column heightfield by moving it to the end of the span buffer.
+/// When the buffer is full, it is reallocated and the columns are packed, which reclaims the room
+/// left behind by moved columns.
+///
+/// @param[in]	hf			The column heightfield
+/// @param[in]	columnIndex	The index of the column to move
+/// @returns false if the span buffer could not be allocated.
+static bool growColumn(rcColumnHeightfield& hf, const int columnIndex)
+{
+	rcHeightfieldColumn& column = hf.columns[columnIndex];
+	const int capacity = column.capacity ? column.capacity * 2 : 2;
+
+	if (hf.usedSpans + capacity > hf.maxSpans)
+	{
+		const int columnCount = hf.width * hf.height;
+		int packedSpans = capacity - column.capacity;
+		for (int i = 0; i < columnCount; ++i)
+		{
+			packedSpans += hf.columns[i].capacity;
+		}
+
+		const int maxSpans = rcMax(packedSpans * 2, columnCount);
+		rcColumnSpan* spans = (rcColumnSpan*)rcAlloc(sizeof(rcColumnSpan) * maxSpans, RC_ALLOC_PERM);
+		if (spans == NULL)
+		{
+			return false;
+		}
+
+		// Pack the columns in grid order, growing the column in place.
+		column.capacity = (unsigned short)capacity;
+		int usedSpans = 0;
+		for (int i = 0; i < columnCount; ++i)
+		{
+			rcHeightfieldColumn& packed = hf.columns[i];
+			if (packed.count)
+			{
+				memcpy(&spans[usedSpans], &hf.spans[packed.index], sizeof(rcColumnSpan) * packed.count);
+			}
+			packed.index = (unsigned int)usedSpans;
+			usedSpans += packed.capacity;
+		}
+
+		rcFree(hf.spans);
+		hf.spans = spans;
+		hf.usedSpans = usedSpans;
+		hf.maxSpans = maxSpans;
+		return true;
+	}
+
+	if (column.count)
+	{
+		memcpy(&hf.spans[hf.usedSpans], &hf.spans[column.index], sizeof(rcColumnSpan) * column.count);
+	}
+	column.index = (unsigned int)hf.usedSpans;
+	column.capacity = (unsigned short)capacity;
+	hf.usedSpans += capacity;
+	return true;
+}
+
+/// Adds a span to the column heightfield.  If the new span overlaps existing spans,
+/// it will merge the new span with the existing ones, the same way as #addSpan does for #rcHeightfield.
+///
+/// @param[in]	hf					Heightfield to add spans to
+/// @param[in]	x					The new span's column cell x index
+/// @param[in]	z					The new span's column cell z index
+/// @param[in]	min					The new span's minimum cell index
+/// @param[in]	max					The new span's maximum cell index
+/// @param[in]	areaID				The new span's area type ID
+/// @param[in]	flagMergeThreshold	How close two spans maximum extents need to be to merge area type IDs
+static bool addSpan(rcColumnHeightfield& hf,
+                    const int x, const int z,
+                    const unsigned short min, const unsigned short max,
+                    const unsigned char areaID, const int flagMergeThreshold)
+{
+	const int columnIndex = x + z * hf.width;
+	const int count = hf.columns[columnIndex].count;
+	const rcColumnSpan* spans = &hf.spans[hf.columns[columnIndex].index];
+
+	int newMin = min;
+	int newMax = max;
+	int newArea = areaID;
+
+	// Skip the spans completely below the new span.
+	int first = 0;
+	while (first < count && (int)spans[first].smax < newMin)
+	{
+		first++;
+	}
+
+	// Merge the new span with the overlapping spans.
+	int last = first;
+	for (; last < count && (int)spans[last].smin <= newMax; ++last)
+	{
+		const rcColumnSpan& span = spans[last];
+		newMin = rcMin(newMin, (int)span.smin);
+		newMax = rcMax(newMax, (int)span.smax);
+
+		// Merge flags.
+		if (rcAbs(newMax - (int)span.smax) <= flagMergeThreshold)
+		{
+			// Higher area ID numbers indicate higher resolution priority.
+			newArea = rcMax(newArea, (int)span.area);
+		}
+	}
+
+	// Replace the merged spans with the new span.
+	const int newCount = count - (last - first) + 1;
+	if (newCount > hf.columns[columnIndex].capacity && !growColumn(hf, columnIndex))
+	{
+		return false;
+	}
+	rcHeightfieldColumn& column = hf.columns[columnIndex];
+	rcColumnSpan* columnSpans = &hf.spans[column.index];
+	if (last != first + 1 && last < count)
+	{
+		memmove(&columnSpans[first + 1], &columnSpans[last], sizeof(rcColumnSpan) * (count - last));
+	}
+	rcColumnSpan& newSpan = columnSpans[first];
+	newSpan.smin = (unsigned int)newMin;
+	newSpan.smax = (unsigned int)newMax;
+	newSpan.area = (unsigned int)newArea;
+	column.count = (unsigned short)newCount;
+
+	return true;
+}
+
+/// A band of rows of a heightfield grid, stored in a column heightfield holding only those rows.
+struct rcHeightfieldBand
+{
+	rcColumnHeightfield* heightfield;
+	int width;		///< The width of the grid.
+	int height;		///< The height of the grid.
+	int firstRow;	///< The row of the grid stored in the first row of the heightfield.
+};
+
+static bool addSpan(rcHeightfieldBand& band,
+                    const int x, const int z,
+                    const unsigned short min, const unsigned short max,
+                    const unsigned char areaID, const int flagMergeThreshold)
+{
+	return addSpan(*band.heightfield, x, z - band.firstRow, min, max, areaID, flagMergeThreshold);
+}
+
 bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
                const int x, const int z,
                const unsigned short spanMin, const unsigned short spanMax,
@@ -205,6 +367,429 @@ bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
 	return true;
 }
 
+bool rcAddSpan(rcContext* context, rcColumnHeightfield& heightfield,
+               const int x, const int z,
+               const unsigned short spanMin, const unsigned short spanMax,
+               const unsigned char areaID, const int flagMergeThreshold)
+{
+	rcAssert(context);
+
+	if (!addSpan(heightfield, x, z, spanMin, spanMax, areaID, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcAddSpan: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+/// Clamps a span to the heightfield bounding box, snaps it to the height grid and adds it to the heightfield.
+///
+/// @param[in]	hf					The heightfield
+/// @param[in]	x					The column x index
+/// @param[in]	z					The column z index
+/// @param[in]	spanMin				The minimum height of the span, relative to the heightfield bounding box
+/// @param[in]	spanMax				The maximum height of the span, relative to the heightfield bounding box
+/// @param[in]	by					The height of the heightfield bounding box
+/// @param[in]	inverseCellHeight	1 / cellHeight
+/// @param[in]	areaID				The area ID to assign to the span
+/// @param[in]	flagMergeThreshold	The threshold in which area flags will be merged
+/// @returns false if the span could not be allocated.
+template <class Heightfield>
+static bool addClampedSpan(Heightfield& hf, const int x, const int z,
+                           float spanMin, float spanMax, const float by, const float inverseCellHeight,
+                           const unsigned char areaID, const int flagMergeThreshold)
+{
+	// Skip the span if it's completely outside the heightfield bounding box
+	if (spanMax < 0.0f)
+	{
+		return true;
+	}
+	if (spanMin > by)
+	{
+		return true;
+	}
+	
+	// Clamp the span to the heightfield bounding box.
+	if (spanMin < 0.0f)
+	{
+		spanMin = 0;
+	}
+	if (spanMax > by)
+	{
+		spanMax = by;
+	}
+
+	// Snap the span to the heightfield height grid.
+	unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+	unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
+
+	return addSpan(hf, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold);
+}
+
+/// An inclusive range of heightfield columns to rasterize into.
+struct rcColumnRange
+{
+	int minX;
+	int minZ;
+	int maxX;
+	int maxZ;
+};
+
+/// The number of cells of a row the batched kernels process at once.
+static const int ROW_BATCH_SIZE = 64;
+
+/// Rows with fewer cells than this are processed without SIMD instructions.
+static const int SMALL_ROW_SIZE = 4;
+
+/// Rows of a triangle touching fewer cells than this are clipped cell by cell like the reference kernel,
+/// even when a batched kernel is selected. Preparing a row for the batched kernels costs more than
+/// clipping a few cells, which made the batched kernels slower on meshes of small triangles.
+static const int MIN_BATCHED_ROW_SIZE = 6;
+
+/// A row of a triangle clipped to the z-extents of a heightfield row, prepared for the batched kernels.
+struct rcRowPolygon
+{
+	float vertX[12];
+	float vertY[12];
+	int vertCount;
+
+	// The edges which are not parallel to the z-axis.
+	float edgeX[12];
+	float edgeY[12];
+	float edgeDeltaX[12];
+	float edgeDeltaY[12];
+	float edgeMinX[12];
+	float edgeMaxX[12];
+	int edgeCount;
+};
+
+/// Finds the height range of the row polygon within a batch of cells.
+///
+/// The range of each cell is found from the polygon vertices within the cell,
+/// and from the points where the polygon edges cross the cell borders.
+/// Cells without any of those get an empty range, where the minimum is above the maximum.
+///
+/// @param[in]	poly		The row polygon
+/// @param[in]	borders		The x-positions of the cell borders, cell i is between borders i and i + 1.
+/// 						[Size: @p count rounded up to the SIMD width, + 1]
+/// @param[in]	count		The number of cells [Limit: <= #ROW_BATCH_SIZE]
+/// @param[out]	outMin		The minimum height in each cell [Size: #ROW_BATCH_SIZE]
+/// @param[out]	outMax		The maximum height in each cell [Size: #ROW_BATCH_SIZE]
+typedef void (rcRowSpanFunc)(const rcRowPolygon& poly, const float* borders, int count, float* outMin, float* outMax);
+
+static void rowSpansBatched(const rcRowPolygon& poly, const float* borders, const int count, float* outMin, float* outMax)
+{
+	for (int cell = 0; cell < count; ++cell)
+	{
+		const float cellMinX = borders[cell];
+		const float cellMaxX = borders[cell + 1];
+		float spanMin = FLT_MAX;
+		float spanMax = -FLT_MAX;
+
+		for (int vert = 0; vert < poly.vertCount; ++vert)
+		{
+			if (poly.vertX[vert] >= cellMinX && poly.vertX[vert] <= cellMaxX)
+			{
+				spanMin = rcMin(spanMin, poly.vertY[vert]);
+				spanMax = rcMax(spanMax, poly.vertY[vert]);
+			}
+		}
+
+		for (int edge = 0; edge < poly.edgeCount; ++edge)
+		{
+			for (int side = 0; side < 2; ++side)
+			{
+				const float borderX = side == 0 ? cellMinX : cellMaxX;
+				if (borderX >= poly.edgeMinX[edge] && borderX <= poly.edgeMaxX[edge])
+				{
+					const float y = poly.edgeY[edge] + poly.edgeDeltaY[edge] * ((borderX - poly.edgeX[edge]) / poly.edgeDeltaX[edge]);
+					spanMin = rcMin(spanMin, y);
+					spanMax = rcMax(spanMax, y);
+				}
+			}
+		}
+
+		outMin[cell] = spanMin;
+		outMax[cell] = spanMax;
+	}
+}
+
+#ifdef RC_HAS_SSE2_KERNEL
+static void rowSpansSSE2(const rcRowPolygon& poly, const float* borders, const int count, float* outMin, float* outMax)
+{
+	const __m128 empty = _mm_set1_ps(FLT_MAX);
+	const __m128 emptyNeg = _mm_set1_ps(-FLT_MAX);
+
+	for (int cell = 0; cell < count; cell += 4)
+	{
+		const __m128 cellBorders[2] = { _mm_loadu_ps(borders + cell), _mm_loadu_ps(borders + cell + 1) };
+		__m128 spanMin = empty;
+		__m128 spanMax = emptyNeg;
+
+		for (int vert = 0; vert < poly.vertCount; ++vert)
+		{
+			const __m128 vertX = _mm_set1_ps(poly.vertX[vert]);
+			const __m128 vertY = _mm_set1_ps(poly.vertY[vert]);
+			const __m128 inside = _mm_and_ps(_mm_cmpge_ps(vertX, cellBorders[0]), _mm_cmple_ps(vertX, cellBorders[1]));
+			spanMin = _mm_min_ps(spanMin, _mm_or_ps(_mm_and_ps(inside, vertY), _mm_andnot_ps(inside, empty)));
+			spanMax = _mm_max_ps(spanMax, _mm_or_ps(_mm_and_ps(inside, vertY), _mm_andnot_ps(inside, emptyNeg)));
+		}
+
+		for (int edge = 0; edge < poly.edgeCount; ++edge)
+		{
+			const __m128 edgeX = _mm_set1_ps(poly.edgeX[edge]);
+			const __m128 edgeY = _mm_set1_ps(poly.edgeY[edge]);
+			const __m128 deltaX = _mm_set1_ps(poly.edgeDeltaX[edge]);
+			const __m128 deltaY = _mm_set1_ps(poly.edgeDeltaY[edge]);
+			const __m128 edgeMinX = _mm_set1_ps(poly.edgeMinX[edge]);
+			const __m128 edgeMaxX = _mm_set1_ps(poly.edgeMaxX[edge]);
+			for (int side = 0; side < 2; ++side)
+			{
+				const __m128 borderX = cellBorders[side];
+				const __m128 crosses = _mm_and_ps(_mm_cmpge_ps(borderX, edgeMinX), _mm_cmple_ps(borderX, edgeMaxX));
+				const __m128 y = _mm_add_ps(edgeY, _mm_mul_ps(deltaY, _mm_div_ps(_mm_sub_ps(borderX, edgeX), deltaX)));
+				spanMin = _mm_min_ps(spanMin, _mm_or_ps(_mm_and_ps(crosses, y), _mm_andnot_ps(crosses, empty)));
+				spanMax = _mm_max_ps(spanMax, _mm_or_ps(_mm_and_ps(crosses, y), _mm_andnot_ps(crosses, emptyNeg)));
+			}
+		}
+
+		_mm_storeu_ps(outMin + cell, spanMin);
+		_mm_storeu_ps(outMax + cell, spanMax);
+	}
+}
+#endif
+
+#ifdef RC_HAS_AVX2_KERNEL
+RC_TARGET_AVX2
+static void rowSpansAVX2(const rcRowPolygon& poly, const float* borders, const int count, float* outMin, float* outMax)
+{
+	const __m256 empty = _mm256_set1_ps(FLT_MAX);
+	const __m256 emptyNeg = _mm256_set1_ps(-FLT_MAX);
+
+	for (int cell = 0; cell < count; cell += 8)
+	{
+		const __m256 cellBorders[2] = { _mm256_loadu_ps(borders + cell), _mm256_loadu_ps(borders + cell + 1) };
+		__m256 spanMin = empty;
+		__m256 spanMax = emptyNeg;
+
+		for (int vert = 0; vert < poly.vertCount; ++vert)
+		{
+			const __m256 vertX = _mm256_set1_ps(poly.vertX[vert]);
+			const __m256 vertY = _mm256_set1_ps(poly.vertY[vert]);
+			const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(vertX, cellBorders[0], _CMP_GE_OQ), _mm256_cmp_ps(vertX, cellBorders[1], _CMP_LE_OQ));
+			spanMin = _mm256_min_ps(spanMin, _mm256_blendv_ps(empty, vertY, inside));
+			spanMax = _mm256_max_ps(spanMax, _mm256_blendv_ps(emptyNeg, vertY, inside));
+		}
+
+		for (int edge = 0; edge < poly.edgeCount; ++edge)
+		{
+			const __m256 edgeX = _mm256_set1_ps(poly.edgeX[edge]);
+			const __m256 edgeY = _mm256_set1_ps(poly.edgeY[edge]);
+			const __m256 deltaX = _mm256_set1_ps(poly.edgeDeltaX[edge]);
+			const __m256 deltaY = _mm256_set1_ps(poly.edgeDeltaY[edge]);
+			const __m256 edgeMinX = _mm256_set1_ps(poly.edgeMinX[edge]);
+			const __m256 edgeMaxX = _mm256_set1_ps(poly.edgeMaxX[edge]);
+			for (int side = 0; side < 2; ++side)
+			{
+				const __m256 borderX = cellBorders[side];
+				const __m256 crosses = _mm256_and_ps(_mm256_cmp_ps(borderX, edgeMinX, _CMP_GE_OQ), _mm256_cmp_ps(borderX, edgeMaxX, _CMP_LE_OQ));
+				const __m256 y = _mm256_add_ps(edgeY, _mm256_mul_ps(deltaY, _mm256_div_ps(_mm256_sub_ps(borderX, edgeX), deltaX)));
+				spanMin = _mm256_min_ps(spanMin, _mm256_blendv_ps(empty, y, crosses));
+				spanMax = _mm256_max_ps(spanMax, _mm256_blendv_ps(emptyNeg, y, crosses));
+			}
+		}
+
+		_mm256_storeu_ps(outMin + cell, spanMin);
+		_mm256_storeu_ps(outMax + cell, spanMax);
+	}
+}
+
+static bool cpuSupportsAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	// The OS must save the AVX registers too.
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+static rcRasterizationKernel s_rasterizationKernel = RC_RASTERIZATION_REFERENCE;
+
+static bool isKernelSupported(const rcRasterizationKernel kernel)
+{
+	switch (kernel)
+	{
+	case RC_RASTERIZATION_REFERENCE:
+	case RC_RASTERIZATION_BATCHED:
+		return true;
+#ifdef RC_HAS_SSE2_KERNEL
+	case RC_RASTERIZATION_SSE2:
+		return true;
+#endif
+#ifdef RC_HAS_AVX2_KERNEL
+	case RC_RASTERIZATION_AVX2:
+		return cpuSupportsAVX2();
+#endif
+	default:
+		return false;
+	}
+}
+
+/// Returns the row function of the selected kernel, or null for the reference kernel.
+static rcRowSpanFunc* getRowSpanFunc()
+{
+	switch (s_rasterizationKernel)
+	{
+	case RC_RASTERIZATION_BATCHED:
+		return rowSpansBatched;
+#ifdef RC_HAS_SSE2_KERNEL
+	case RC_RASTERIZATION_SSE2:
+		return rowSpansSSE2;
+#endif
+#ifdef RC_HAS_AVX2_KERNEL
+	case RC_RASTERIZATION_AVX2:
+		return rowSpansAVX2;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+bool rcSetRasterizationKernel(const rcRasterizationKernel kernel)
+{
+	if (!isKernelSupported(kernel))
+	{
+		return false;
+	}
+	s_rasterizationKernel = kernel;
+	return true;
+}
+
+rcRasterizationKernel rcGetRasterizationKernel()
+{
+	return s_rasterizationKernel;
+}
+
+rcRasterizationKernel rcGetBestRasterizationKernel()
+{
+	if (isKernelSupported(RC_RASTERIZATION_AVX2))
+	{
+		return RC_RASTERIZATION_AVX2;
+	}
+	if (isKernelSupported(RC_RASTERIZATION_SSE2))
+	{
+		return RC_RASTERIZATION_SSE2;
+	}
+	return RC_RASTERIZATION_BATCHED;
+}
+
+/// Adds the spans of a row of a triangle using a batched kernel.
+///
+/// @param[in]	row					The vertices of the triangle clipped to the row
+/// @param[in]	rowVertCount		The number of row vertices
+/// @param[in]	x0					The column x index of the first cell touched by the row [Limit: >= -1]
+/// @param[in]	x1					The column x index of the last cell to rasterize
+/// @param[in]	startX				The column x index of the first cell to rasterize [Limit: >= 0]
+/// @param[in]	z					The row z index
+/// @param[in]	rowFunc				The row function of the batched kernel
+/// @returns false if a span could not be allocated.
+template <class Heightfield>
+static bool rasterizeRowBatched(const float* row, const int rowVertCount, const int x0, const int x1, const int startX, const int z,
+                                rcRowSpanFunc* rowFunc, const unsigned char areaID, Heightfield& hf,
+                                const float* hfBBMin, const float by,
+                                const float cellSize, const float inverseCellHeight,
+                                const int flagMergeThreshold)
+{
+	rcRowPolygon poly;
+	poly.vertCount = rowVertCount;
+	poly.edgeCount = 0;
+	float minX = row[0];
+	float maxX = row[0];
+	for (int vert = 0, prev = rowVertCount - 1; vert < rowVertCount; prev = vert, ++vert)
+	{
+		const float* a = &row[prev * 3];
+		const float* b = &row[vert * 3];
+		poly.vertX[vert] = b[0];
+		poly.vertY[vert] = b[1];
+		minX = rcMin(minX, b[0]);
+		maxX = rcMax(maxX, b[0]);
+
+		// Edges along z only contribute their end points.
+		if (a[0] == b[0])
+		{
+			continue;
+		}
+		const int edge = poly.edgeCount++;
+		poly.edgeX[edge] = a[0];
+		poly.edgeY[edge] = a[1];
+		poly.edgeDeltaX[edge] = b[0] - a[0];
+		poly.edgeDeltaY[edge] = b[1] - a[1];
+		poly.edgeMinX[edge] = rcMin(a[0], b[0]);
+		poly.edgeMaxX[edge] = rcMax(a[0], b[0]);
+	}
+
+	// The batch size is a multiple of the SIMD widths, so the kernels can load and store whole vectors.
+	float borders[ROW_BATCH_SIZE + 1];
+	float spanMins[ROW_BATCH_SIZE];
+	float spanMaxs[ROW_BATCH_SIZE];
+
+	for (int batchX = rcMax(x0, startX); batchX <= x1; batchX += ROW_BATCH_SIZE)
+	{
+		const int count = rcMin(ROW_BATCH_SIZE, x1 - batchX + 1);
+
+		// Place the borders where the reference kernel cuts the row. It keeps everything
+		// left of the first cell in that cell, and cuts each cell at the end of the previous one.
+		const int borderCount = rcMin(ROW_BATCH_SIZE, (count + 7) & ~7) + 1;
+		for (int border = 0; border < borderCount; ++border)
+		{
+			const int x = batchX + border - 1;
+			borders[border] = (x < x0) ? -FLT_MAX : hfBBMin[0] + (float)x * cellSize + cellSize;
+		}
+
+		// Rows of a few cells do not fill a vector, the plain batched kernel gives the same results for those.
+		rcRowSpanFunc* func = count < SMALL_ROW_SIZE ? rowSpansBatched : rowFunc;
+		func(poly, borders, count, spanMins, spanMaxs);
+
+		for (int cell = 0; cell < count; ++cell)
+		{
+			// A cell is covered if the row overlaps it, or touches it when the row has no width.
+			const float cellMinX = borders[cell];
+			const float cellMaxX = borders[cell + 1];
+			const bool covered = minX == maxX ?
+				(minX >= cellMinX && minX <= cellMaxX) :
+				(minX < cellMaxX && maxX > cellMinX);
+			if (!covered || spanMins[cell] > spanMaxs[cell])
+			{
+				continue;
+			}
+
+			if (!addClampedSpan(hf, batchX + cell, z, spanMins[cell] - hfBBMin[1], spanMaxs[cell] - hfBBMin[1],
+			                    by, inverseCellHeight, areaID, flagMergeThreshold))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 enum rcAxis
 {
 	RC_AXIS_X = 0,
@@ -303,12 +888,15 @@ static void dividePoly(const float* inVerts, int inVertsCount,
 /// @param[in] 	inverseCellSize		1 / cellSize
 /// @param[in] 	inverseCellHeight	1 / cellHeight
 /// @param[in] 	flagMergeThreshold	The threshold in which area flags will be merged 
+/// @param[in] 	rowFunc				The row function of the batched kernel, or null to clip cell by cell
+/// @param[in] 	columns				The columns to add spans to. The triangle is clipped the same way regardless of the range.
 /// @returns true if the operation completes successfully.  false if there was an error adding spans to the heightfield.
+template <class Heightfield>
 static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
-                         const unsigned char areaID, rcHeightfield& hf,
+                         const unsigned char areaID, Heightfield& hf,
                          const float* hfBBMin, const float* hfBBMax,
                          const float cellSize, const float inverseCellSize, const float inverseCellHeight,
-                         const int flagMergeThreshold)
+                         const int flagMergeThreshold, rcRowSpanFunc* rowFunc, const rcColumnRange& columns)
 {
 	// Calculate the bounding box of the triangle.
 	float triBBMin[3];
@@ -338,6 +926,11 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 	// use -1 rather than 0 to cut the polygon properly at the start of the tile
 	z0 = rcClamp(z0, -1, h - 1);
 	z1 = rcClamp(z1, 0, h - 1);
+	if (z1 < columns.minZ || z0 > columns.maxZ)
+	{
+		return true;
+	}
+	z1 = rcMin(z1, columns.maxZ);
 
 	// Clip the triangle into all grid cells it touches.
 	float buf[7 * 3 * 4];
@@ -363,7 +956,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 		{
 			continue;
 		}
-		if (z < 0)
+		if (z < columns.minZ)
 		{
 			continue;
 		}
@@ -384,12 +977,21 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 		}
 		int x0 = (int)((minX - hfBBMin[0]) * inverseCellSize);
 		int x1 = (int)((maxX - hfBBMin[0]) * inverseCellSize);
-		if (x1 < 0 || x0 >= w)
+		if (x1 < columns.minX || x0 > columns.maxX)
 		{
 			continue;
 		}
 		x0 = rcClamp(x0, -1, w - 1);
-		x1 = rcClamp(x1, 0, w - 1);
+		x1 = rcClamp(x1, 0, columns.maxX);
+
+		if (rowFunc && x1 - rcMax(x0, columns.minX) + 1 >= MIN_BATCHED_ROW_SIZE)
+		{
+			if (!rasterizeRowBatched(inRow, nvRow, x0, x1, columns.minX, z, rowFunc, areaID, hf, hfBBMin, by, cellSize, inverseCellHeight, flagMergeThreshold))
+			{
+				return false;
+			}
+			continue;
+		}
 
 		int nv;
 		int nv2 = nvRow;
@@ -405,7 +1007,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 			{
 				continue;
 			}
-			if (x < 0)
+			if (x < columns.minX)
 			{
 				continue;
 			}
@@ -421,31 +1023,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 			spanMin -= hfBBMin[1];
 			spanMax -= hfBBMin[1];
 			
-			// Skip the span if it's completely outside the heightfield bounding box
-			if (spanMax < 0.0f)
-			{
-				continue;
-			}
-			if (spanMin > by)
-			{
-				continue;
-			}
-			
-			// Clamp the span to the heightfield bounding box.
-			if (spanMin < 0.0f)
-			{
-				spanMin = 0;
-			}
-			if (spanMax > by)
-			{
-				spanMax = by;
-			}
-
-			// Snap the span to the heightfield height grid.
-			unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
-			unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
-
-			if (!addSpan(hf, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold))
+			if (!addClampedSpan(hf, x, z, spanMin, spanMax, by, inverseCellHeight, areaID, flagMergeThreshold))
 			{
 				return false;
 			}
@@ -466,7 +1044,9 @@ bool rcRasterizeTriangle(rcContext* context,
 	// Rasterize the single triangle.
 	const float inverseCellSize = 1.0f / heightfield.cs;
 	const float inverseCellHeight = 1.0f / heightfield.ch;
-	if (!rasterizeTri(v0, v1, v2, areaID, heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold))
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
+	if (!rasterizeTri(v0, v1, v2, areaID, heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
 	{
 		context->log(RC_LOG_ERROR, "rcRasterizeTriangle: Out of memory.");
 		return false;
@@ -487,12 +1067,14 @@ bool rcRasterizeTriangles(rcContext* context,
 	// Rasterize the triangles.
 	const float inverseCellSize = 1.0f / heightfield.cs;
 	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
 	for (int triIndex = 0; triIndex < numTris; ++triIndex)
 	{
 		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
 		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
 		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
-		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold))
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
 		{
 			context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
 			return false;
@@ -514,12 +1096,14 @@ bool rcRasterizeTriangles(rcContext* context,
 	// Rasterize the triangles.
 	const float inverseCellSize = 1.0f / heightfield.cs;
 	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
 	for (int triIndex = 0; triIndex < numTris; ++triIndex)
 	{
 		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
 		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
 		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
-		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold))
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
 		{
 			context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
 			return false;
@@ -540,12 +1124,159 @@ bool rcRasterizeTriangles(rcContext* context,
 	// Rasterize the triangles.
 	const float inverseCellSize = 1.0f / heightfield.cs;
 	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = &verts[(triIndex * 3 + 0) * 3];
+		const float* v1 = &verts[(triIndex * 3 + 1) * 3];
+		const float* v2 = &verts[(triIndex * 3 + 2) * 3];
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const int /*nv*/,
+                          const int* tris, const unsigned char* triAreaIDs, const int numTris,
+                          rcHeightfield& heightfield,
+                          const int minX, const int minZ, const int maxX, const int maxZ,
+                          const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const rcColumnRange columns = {
+		rcMax(minX, 0), rcMax(minZ, 0),
+		rcMin(maxX, heightfield.width - 1), rcMin(maxZ, heightfield.height - 1)
+	};
+	if (columns.minX > columns.maxX || columns.minZ > columns.maxZ)
+	{
+		return true;
+	}
+
+	// Rasterize the triangles.
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
+		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
+		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Rasterizes indexed triangles into the column heightfield.
+template <class IndexType>
+static bool rasterizeIndexedTriangles(const float* verts, const IndexType* tris, const unsigned char* triAreaIDs, const int numTris,
+                                      rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
+		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
+		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool rcRasterizeTriangle(rcContext* context,
+                         const float* v0, const float* v1, const float* v2,
+                         const unsigned char areaID, rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
+	if (!rasterizeTri(v0, v1, v2, areaID, heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeTriangle: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const int /*nv*/,
+                          const int* tris, const unsigned char* triAreaIDs, const int numTris,
+                          rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	if (!rasterizeIndexedTriangles(verts, tris, triAreaIDs, numTris, heightfield, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const int /*nv*/,
+                          const unsigned short* tris, const unsigned char* triAreaIDs, const int numTris,
+                          rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	if (!rasterizeIndexedTriangles(verts, tris, triAreaIDs, numTris, heightfield, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const unsigned char* triAreaIDs, const int numTris,
+                          rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	const rcColumnRange columns = { 0, 0, heightfield.width - 1, heightfield.height - 1 };
 	for (int triIndex = 0; triIndex < numTris; ++triIndex)
 	{
 		const float* v0 = &verts[(triIndex * 3 + 0) * 3];
 		const float* v1 = &verts[(triIndex * 3 + 1) * 3];
 		const float* v2 = &verts[(triIndex * 3 + 2) * 3];
-		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold))
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
 		{
 			context->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
 			return false;
@@ -554,3 +1285,69 @@ bool rcRasterizeTriangles(rcContext* context,
 
 	return true;
 }
+
+bool rcRasterizeTriangleBand(rcContext* context,
+                             const float* verts, const int /*nv*/,
+                             const int* tris, const unsigned char* triAreaIDs, const int numTris,
+                             rcColumnHeightfield& heightfield, const int firstRow, const int gridHeight,
+                             const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+	rcAssert(firstRow >= 0 && firstRow + heightfield.height <= gridHeight);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	if (heightfield.width <= 0 || heightfield.height <= 0)
+	{
+		return true;
+	}
+
+	// Clip the triangles against the whole grid, and keep the rows of the band.
+	rcHeightfieldBand band = { &heightfield, heightfield.width, gridHeight, firstRow };
+	const rcColumnRange columns = { 0, firstRow, heightfield.width - 1, firstRow + heightfield.height - 1 };
+
+	// Rasterize the triangles.
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	rcRowSpanFunc* rowFunc = getRowSpanFunc();
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
+		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
+		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], band, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, rowFunc, columns))
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizeTriangleBand: Out of memory.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void rcClearSpans(rcContext* context, rcHeightfield& heightfield,
+                  const int minX, const int minZ, const int maxX, const int maxZ)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, heightfield.width - 1);
+	const int z1 = rcMin(maxZ, heightfield.height - 1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			rcSpan* span = heightfield.spans[x + z * heightfield.width];
+			while (span != NULL)
+			{
+				rcSpan* next = span->next;
+				freeSpan(heightfield, span);
+				span = next;
+			}
+			heightfield.spans[x + z * heightfield.width] = NULL;
+		}
+	}
+}
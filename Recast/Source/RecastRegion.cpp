@@ -24,6 +24,7 @@
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
+#include "RecastParallel.h"
 
 namespace
 {
@@ -36,17 +37,12 @@ struct LevelStackEntry
 };
 }  // namespace
 
-static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* src, unsigned short& maxDist)
+/// Marks the spans at the boundary of their area with zero distance, and all other spans of rows [y0, y1) as unvisited.
+static void markBoundaryCells(const rcCompactHeightfield& chf, unsigned short* src, const int y0, const int y1)
 {
 	const int w = chf.width;
-	const int h = chf.height;
-	
-	// Init distance and points.
-	for (int i = 0; i < chf.spanCount; ++i)
-		src[i] = 0xffff;
 	
-	// Mark boundary cells.
-	for (int y = 0; y < h; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -68,17 +64,22 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 							nc++;
 					}
 				}
-				if (nc != 4)
-					src[i] = 0;
+				src[i] = nc != 4 ? 0 : 0xffff;
 			}
 		}
 	}
+}
+
+/// Runs the first chamfer pass over the cells [x0, x1) x [y0, y1).
+/// Reads the distances of the cells to the left, above, and above-left and above-right of the block.
+static void distanceFirstPass(const rcCompactHeightfield& chf, unsigned short* src,
+							  const int x0, const int x1, const int y0, const int y1)
+{
+	const int w = chf.width;
 	
-			
-	// Pass 1
-	for (int y = 0; y < h; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = x0; x < x1; ++x)
 		{
 			const rcCompactCell& c = chf.cells[x+y*w];
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
@@ -128,11 +129,18 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 			}
 		}
 	}
+}
+
+/// Runs the second chamfer pass over the cells [x0, x1) x [y0, y1), in reverse order.
+/// Reads the distances of the cells to the right, below, and below-left and below-right of the block.
+static void distanceSecondPass(const rcCompactHeightfield& chf, unsigned short* src,
+							   const int x0, const int x1, const int y0, const int y1)
+{
+	const int w = chf.width;
 	
-	// Pass 2
-	for (int y = h-1; y >= 0; --y)
+	for (int y = y1-1; y >= y0; --y)
 	{
-		for (int x = w-1; x >= 0; --x)
+		for (int x = x1-1; x >= x0; --x)
 		{
 			const rcCompactCell& c = chf.cells[x+y*w];
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
@@ -181,23 +189,43 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 				}
 			}
 		}
-	}	
-	
-	maxDist = 0;
+	}
+}
+
+static unsigned short calculateMaxDistance(const rcCompactHeightfield& chf, const unsigned short* src)
+{
+	unsigned short maxDist = 0;
 	for (int i = 0; i < chf.spanCount; ++i)
 		maxDist = rcMax(src[i], maxDist);
-	
+	return maxDist;
 }
 
-static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
-							   unsigned short* src, unsigned short* dst)
+static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* src, unsigned short& maxDist)
 {
 	const int w = chf.width;
 	const int h = chf.height;
 	
+	// Init distance and mark boundary cells.
+	markBoundaryCells(chf, src, 0, h);
+	
+	// Pass 1
+	distanceFirstPass(chf, src, 0, w, 0, h);
+	
+	// Pass 2
+	distanceSecondPass(chf, src, 0, w, 0, h);
+	
+	maxDist = calculateMaxDistance(chf, src);
+}
+
+/// Blurs the distances of rows [y0, y1).
+static void boxBlur(const rcCompactHeightfield& chf, int thr,
+					const unsigned short* src, unsigned short* dst, const int y0, const int y1)
+{
+	const int w = chf.width;
+	
 	thr *= 2;
 	
-	for (int y = 0; y < h; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -245,15 +273,142 @@ static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
 			}
 		}
 	}
-	return dst;
 }
 
+namespace
+{
+/// The rows per block of the parallel distance field passes.
+const int DISTANCE_BLOCK_HEIGHT = 16;
+
+struct DistanceFieldJob
+{
+	const rcCompactHeightfield* chf;
+	unsigned short* src;
+	unsigned short* dst;
+	int rowsPerTask;
+	int blockWidth;
+	int blocksX;
+	int blocksY;
+	int step;
+	int firstBlockY;
+};
+}  // namespace
+
+static void markBoundaryCellsTask(int index, int /*worker*/, void* userData)
+{
+	DistanceFieldJob* job = (DistanceFieldJob*)userData;
+	const int y0 = index * job->rowsPerTask;
+	const int y1 = rcMin(y0 + job->rowsPerTask, job->chf->height);
+	markBoundaryCells(*job->chf, job->src, y0, y1);
+}
+
+static void boxBlurTask(int index, int /*worker*/, void* userData)
+{
+	DistanceFieldJob* job = (DistanceFieldJob*)userData;
+	const int y0 = index * job->rowsPerTask;
+	const int y1 = rcMin(y0 + job->rowsPerTask, job->chf->height);
+	boxBlur(*job->chf, 1, job->src, job->dst, y0, y1);
+}
+
+/// Gets the cells [x0, x1) of row @p k within block @p bx of a pass.
+/// The blocks are skewed one cell to the left per row, so that every cell a block reads from
+/// the row above is either in the block itself or in a block finished in an earlier step.
+static void getDistanceBlockRow(const DistanceFieldJob& job, const int bx, const int k, int& x0, int& x1)
+{
+	x0 = bx == 0 ? 0 : bx * job.blockWidth - k;
+	x1 = bx == job.blocksX-1 ? job.chf->width : (bx+1) * job.blockWidth - k;
+}
+
+static void distanceFirstPassTask(int index, int /*worker*/, void* userData)
+{
+	DistanceFieldJob* job = (DistanceFieldJob*)userData;
+	const int by = job->firstBlockY + index;
+	const int bx = job->step - 2*by;
+	const int y0 = by * DISTANCE_BLOCK_HEIGHT;
+	const int y1 = rcMin(y0 + DISTANCE_BLOCK_HEIGHT, job->chf->height);
+	for (int y = y0; y < y1; ++y)
+	{
+		int x0, x1;
+		getDistanceBlockRow(*job, bx, y - y0, x0, x1);
+		distanceFirstPass(*job->chf, job->src, x0, x1, y, y+1);
+	}
+}
+
+static void distanceSecondPassTask(int index, int /*worker*/, void* userData)
+{
+	DistanceFieldJob* job = (DistanceFieldJob*)userData;
+	const int w = job->chf->width;
+	const int h = job->chf->height;
+	const int by = job->firstBlockY + index;
+	const int bx = job->step - 2*by;
+	const int y0 = by * DISTANCE_BLOCK_HEIGHT;
+	const int y1 = rcMin(y0 + DISTANCE_BLOCK_HEIGHT, h);
+	// The second pass is the first one mirrored along both axes.
+	for (int y = y0; y < y1; ++y)
+	{
+		int x0, x1;
+		getDistanceBlockRow(*job, bx, y - y0, x0, x1);
+		distanceSecondPass(*job->chf, job->src, w - x1, w - x0, h-1 - y, h - y);
+	}
+}
+
+/// Runs a chamfer pass as a wavefront over the blocks of the heightfield.
+/// Block (bx, by) depends on the block to its left, and the blocks above-left, above and above-right of it,
+/// so all blocks with the same bx + 2*by can be processed concurrently.
+static void runDistancePass(rcThreadPool* pool, DistanceFieldJob& job, rcParallelTaskFunc* func)
+{
+	const int stepCount = (job.blocksX-1) + 2*(job.blocksY-1) + 1;
+	for (int step = 0; step < stepCount; ++step)
+	{
+		const int minY = rcMax(0, (step - (job.blocksX-1) + 1) / 2);
+		const int maxY = rcMin(job.blocksY-1, step / 2);
+		job.step = step;
+		job.firstBlockY = minY;
+		pool->parallelFor(maxY - minY + 1, func, &job);
+	}
+}
+
+static void calculateDistanceFieldParallel(rcThreadPool* pool, rcCompactHeightfield& chf,
+										   unsigned short* src, unsigned short& maxDist)
+{
+	const int workerCount = pool->getWorkerCount();
+	
+	DistanceFieldJob job;
+	memset(&job, 0, sizeof(job));
+	job.chf = &chf;
+	job.src = src;
+	job.rowsPerTask = DISTANCE_BLOCK_HEIGHT;
+	// The blocks must be wider than they are tall, so the skewed blocks never overlap.
+	job.blockWidth = rcMax(2*DISTANCE_BLOCK_HEIGHT, (chf.width + 2*workerCount-1) / (2*workerCount));
+	job.blocksX = (chf.width + job.blockWidth-1) / job.blockWidth;
+	job.blocksY = (chf.height + DISTANCE_BLOCK_HEIGHT-1) / DISTANCE_BLOCK_HEIGHT;
+	
+	pool->parallelFor(job.blocksY, markBoundaryCellsTask, &job);
+	runDistancePass(pool, job, distanceFirstPassTask);
+	runDistancePass(pool, job, distanceSecondPassTask);
+	
+	maxDist = calculateMaxDistance(chf, src);
+}
 
+static void boxBlurParallel(rcThreadPool* pool, const rcCompactHeightfield& chf,
+							const unsigned short* src, unsigned short* dst)
+{
+	DistanceFieldJob job;
+	memset(&job, 0, sizeof(job));
+	job.chf = &chf;
+	job.src = (unsigned short*)src;
+	job.dst = dst;
+	job.rowsPerTask = DISTANCE_BLOCK_HEIGHT;
+	pool->parallelFor((chf.height + DISTANCE_BLOCK_HEIGHT-1) / DISTANCE_BLOCK_HEIGHT, boxBlurTask, &job);
+}
+
+/// Floods a new region from the specified span. Only spans in rows [minY, maxY) are visited.
 static bool floodRegion(int x, int y, int i,
 						unsigned short level, unsigned short r,
 						rcCompactHeightfield& chf,
 						unsigned short* srcReg, unsigned short* srcDist,
-						rcTempVector<LevelStackEntry>& stack)
+						rcTempVector<LevelStackEntry>& stack,
+						const int minY, const int maxY)
 {
 	const int w = chf.width;
 	
@@ -287,6 +442,8 @@ static bool floodRegion(int x, int y, int i,
 			{
 				const int ax = cx + rcGetDirOffsetX(dir);
 				const int ay = cy + rcGetDirOffsetY(dir);
+				if (ay < minY || ay >= maxY)
+					continue;
 				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
 				if (chf.areas[ai] != area)
 					continue;
@@ -306,6 +463,8 @@ static bool floodRegion(int x, int y, int i,
 				{
 					const int ax2 = ax + rcGetDirOffsetX(dir2);
 					const int ay2 = ay + rcGetDirOffsetY(dir2);
+					if (ay2 < minY || ay2 >= maxY)
+						continue;
 					const int ai2 = (int)chf.cells[ax2+ay2*w].index + rcGetCon(as, dir2);
 					if (chf.areas[ai2] != area)
 						continue;
@@ -333,6 +492,8 @@ static bool floodRegion(int x, int y, int i,
 			{
 				const int ax = cx + rcGetDirOffsetX(dir);
 				const int ay = cy + rcGetDirOffsetY(dir);
+				if (ay < minY || ay >= maxY)
+					continue;
 				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
 				if (chf.areas[ai] != area)
 					continue;
@@ -358,20 +519,20 @@ struct DirtyEntry
 	unsigned short region;
 	unsigned short distance2;
 };
+/// Expands the regions into the unassigned spans of the stack. Only spans in rows [minY, maxY) are visited.
 static void expandRegions(int maxIter, unsigned short level,
 					      rcCompactHeightfield& chf,
 					      unsigned short* srcReg, unsigned short* srcDist,
 					      rcTempVector<LevelStackEntry>& stack,
-					      bool fillStack)
+					      bool fillStack, const int minY, const int maxY)
 {
 	const int w = chf.width;
-	const int h = chf.height;
 
 	if (fillStack)
 	{
 		// Find cells revealed by the raised level.
 		stack.clear();
-		for (int y = 0; y < h; ++y)
+		for (int y = minY; y < maxY; ++y)
 		{
 			for (int x = 0; x < w; ++x)
 			{
@@ -424,6 +585,7 @@ static void expandRegions(int maxIter, unsigned short level,
 				if (rcGetCon(s, dir) == RC_NOT_CONNECTED) continue;
 				const int ax = x + rcGetDirOffsetX(dir);
 				const int ay = y + rcGetDirOffsetY(dir);
+				if (ay < minY || ay >= maxY) continue;
 				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
 				if (chf.areas[ai] != area) continue;
 				if (srcReg[ai] > 0 && (srcReg[ai] & RC_BORDER_REG) == 0)
@@ -471,17 +633,17 @@ static void sortCellsByLevel(unsigned short startLevel,
 							  rcCompactHeightfield& chf,
 							  const unsigned short* srcReg,
 							  unsigned int nbStacks, rcTempVector<LevelStackEntry>* stacks,
-							  unsigned short loglevelsPerStack) // the levels per stack (2 in our case) as a bit shift
+							  unsigned short loglevelsPerStack, // the levels per stack (2 in our case) as a bit shift
+							  const int minY, const int maxY)
 {
 	const int w = chf.width;
-	const int h = chf.height;
 	startLevel = startLevel >> loglevelsPerStack;
 
 	for (unsigned int j=0; j<nbStacks; ++j)
 		stacks[j].clear();
 
 	// put all cells in the level range into the appropriate stacks
-	for (int y = 0; y < h; ++y)
+	for (int y = minY; y < maxY; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -1251,37 +1413,60 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 ///
 /// @see rcCompactHeightfield, rcBuildRegions, rcBuildRegionsMonotone
 bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
+{
+	return rcBuildDistanceField(ctx, chf, 0);
+}
+
+/// @par
+///
+/// The chamfer passes are processed as a wavefront of blocks, and the blur as bands of rows, on the
+/// workers of @p pool. The resulting distances are identical to the ones built on a single thread.
+///
+/// @see rcBuildDistanceField
+bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcThreadPool* pool)
 {
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_DISTANCEFIELD);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
-	if (chf.dist)
+	// The blurred distances are written to the distance array of a previous build when it is large enough.
+	unsigned short* dst = chf.dist;
+	chf.dist = 0;
+	if (dst && chf.maxSpans < chf.spanCount)
 	{
-		rcFree(chf.dist);
-		chf.dist = 0;
+		rcFree(dst);
+		dst = 0;
+	}
+	if (!dst)
+	{
+		dst = (unsigned short*)rcAlloc(sizeof(unsigned short)*rcMax(chf.maxSpans, chf.spanCount), RC_ALLOC_PERM);
+		if (!dst)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'dst' (%d).", chf.spanCount);
+			return false;
+		}
 	}
-	
 	unsigned short* src = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
 	if (!src)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'src' (%d).", chf.spanCount);
+		rcFree(dst);
 		return false;
 	}
-	unsigned short* dst = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
-	if (!dst)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'dst' (%d).", chf.spanCount);
-		rcFree(src);
-		return false;
-	}
+	
+	if (pool && pool->getWorkerCount() < 2)
+		pool = 0;
 	
 	unsigned short maxDist = 0;
 
 	{
 		rcScopedTimer timerDist(ctx, RC_TIMER_BUILD_DISTANCEFIELD_DIST);
 
-		calculateDistanceField(chf, src, maxDist);
+		if (pool)
+			calculateDistanceFieldParallel(pool, chf, src, maxDist);
+		else
+			calculateDistanceField(chf, src, maxDist);
 		chf.maxDistance = maxDist;
 	}
 
@@ -1289,14 +1474,16 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
 		rcScopedTimer timerBlur(ctx, RC_TIMER_BUILD_DISTANCEFIELD_BLUR);
 
 		// Blur
-		if (boxBlur(chf, 1, src, dst) != src)
-			rcSwap(src, dst);
+		if (pool)
+			boxBlurParallel(pool, chf, src, dst);
+		else
+			boxBlur(chf, 1, src, dst, 0, chf.height);
 
 		// Store distance.
-		chf.dist = src;
+		chf.dist = dst;
 	}
 	
-	rcFree(dst);
+	rcFree(src);
 	
 	return true;
 }
@@ -1355,6 +1542,7 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	const int w = chf.width;
 	const int h = chf.height;
@@ -1503,68 +1691,12 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 	return true;
 }
 
-/// @par
-/// 
-/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
-/// Contours will form simple polygons.
-/// 
-/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
-/// re-assigned to the zero (null) region.
-/// 
-/// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors. 
-/// @p mergeRegionArea helps reduce unecessarily small regions.
-/// 
-/// See the #rcConfig documentation for more information on the configuration parameters.
-/// 
-/// The region data will be available via the rcCompactHeightfield::maxRegions
-/// and rcCompactSpan::reg fields.
-/// 
-/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
-/// 
-/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
-bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
-					const int borderSize, const int minRegionArea, const int mergeRegionArea)
+static void paintBorderRegions(rcCompactHeightfield& chf, const int borderSize,
+							   unsigned short* srcReg, unsigned short& regionId)
 {
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
-	
 	const int w = chf.width;
 	const int h = chf.height;
 	
-	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP));
-	if (!buf)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
-		return false;
-	}
-	
-	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
-
-	const int LOG_NB_STACKS = 3;
-	const int NB_STACKS = 1 << LOG_NB_STACKS;
-	rcTempVector<LevelStackEntry> lvlStacks[NB_STACKS];
-	for (int i=0; i<NB_STACKS; ++i)
-		lvlStacks[i].reserve(256);
-
-	rcTempVector<LevelStackEntry> stack;
-	stack.reserve(256);
-	
-	unsigned short* srcReg = buf;
-	unsigned short* srcDist = buf+chf.spanCount;
-	
-	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
-	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
-	
-	unsigned short regionId = 1;
-	unsigned short level = (chf.maxDistance+1) & ~1;
-
-	// TODO: Figure better formula, expandIters defines how much the 
-	// watershed "overflows" and simplifies the regions. Tying it to
-	// agent radius was usually good indication how greedy it could be.
-//	const int expandIters = 4 + walkableRadius * 2;
-	const int expandIters = 8;
-
 	if (borderSize > 0)
 	{
 		// Make sure border will not overflow.
@@ -1579,6 +1711,33 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	}
 
 	chf.borderSize = borderSize;
+}
+
+// TODO: Figure better formula, expandIters defines how much the 
+// watershed "overflows" and simplifies the regions. Tying it to
+// agent radius was usually good indication how greedy it could be.
+//	const int expandIters = 4 + walkableRadius * 2;
+static const int RC_WATERSHED_EXPAND_ITERS = 8;
+
+/// Partitions the spans of rows [minY, maxY) into regions, assigning new region IDs starting at @p regionId.
+/// Spans outside the rows are neither read nor written. The timers are only updated if @p ctx is not null.
+/// Returns false if the region IDs overflow.
+static bool watershedRegions(rcContext* ctx, rcCompactHeightfield& chf,
+							 unsigned short* srcReg, unsigned short* srcDist,
+							 unsigned short& regionId, const int minY, const int maxY)
+{
+	const int LOG_NB_STACKS = 3;
+	const int NB_STACKS = 1 << LOG_NB_STACKS;
+	rcTempVector<LevelStackEntry> lvlStacks[NB_STACKS];
+	for (int i=0; i<NB_STACKS; ++i)
+		lvlStacks[i].reserve(256);
+
+	rcTempVector<LevelStackEntry> stack;
+	stack.reserve(256);
+	
+	unsigned short level = (chf.maxDistance+1) & ~1;
+	
+	const int expandIters = RC_WATERSHED_EXPAND_ITERS;
 	
 	int sId = -1;
 	while (level > 0)
@@ -1589,21 +1748,23 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 //		ctx->startTimer(RC_TIMER_DIVIDE_TO_LEVELS);
 
 		if (sId == 0)
-			sortCellsByLevel(level, chf, srcReg, NB_STACKS, lvlStacks, 1);
+			sortCellsByLevel(level, chf, srcReg, NB_STACKS, lvlStacks, 1, minY, maxY);
 		else 
 			appendStacks(lvlStacks[sId-1], lvlStacks[sId], srcReg); // copy left overs from last level
 
 //		ctx->stopTimer(RC_TIMER_DIVIDE_TO_LEVELS);
 
 		{
-			rcScopedTimer timerExpand(ctx, RC_TIMER_BUILD_REGIONS_EXPAND);
+			if (ctx) ctx->startTimer(RC_TIMER_BUILD_REGIONS_EXPAND);
 
 			// Expand current regions until no empty connected cells found.
-			expandRegions(expandIters, level, chf, srcReg, srcDist, lvlStacks[sId], false);
+			expandRegions(expandIters, level, chf, srcReg, srcDist, lvlStacks[sId], false, minY, maxY);
+
+			if (ctx) ctx->stopTimer(RC_TIMER_BUILD_REGIONS_EXPAND);
 		}
 		
 		{
-			rcScopedTimer timerFloor(ctx, RC_TIMER_BUILD_REGIONS_FLOOD);
+			if (ctx) ctx->startTimer(RC_TIMER_BUILD_REGIONS_FLOOD);
 
 			// Mark new regions with IDs.
 			for (int j = 0; j<lvlStacks[sId].size(); j++)
@@ -1614,11 +1775,11 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 				int i = current.index;
 				if (i >= 0 && srcReg[i] == 0)
 				{
-					if (floodRegion(x, y, i, level, regionId, chf, srcReg, srcDist, stack))
+					if (floodRegion(x, y, i, level, regionId, chf, srcReg, srcDist, stack, minY, maxY))
 					{
 						if (regionId == 0xFFFF)
 						{
-							ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
+							if (ctx) ctx->stopTimer(RC_TIMER_BUILD_REGIONS_FLOOD);
 							return false;
 						}
 						
@@ -1626,37 +1787,413 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 					}
 				}
 			}
+
+			if (ctx) ctx->stopTimer(RC_TIMER_BUILD_REGIONS_FLOOD);
 		}
 	}
 	
 	// Expand current regions until no empty connected cells found.
-	expandRegions(expandIters*8, 0, chf, srcReg, srcDist, stack, true);
+	expandRegions(expandIters*8, 0, chf, srcReg, srcDist, stack, true, minY, maxY);
 	
-	ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+	return true;
+}
+
+static bool filterAndStoreRegions(rcContext* ctx, rcCompactHeightfield& chf,
+								  const int minRegionArea, const int mergeRegionArea,
+								  unsigned short regionId, unsigned short* srcReg)
+{
+	rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
+
+	// Merge regions and filter out smalle regions.
+	rcIntArray overlaps;
+	chf.maxRegions = regionId;
+	if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
+		return false;
+
+	// If overlapping regions were found during merging, split those regions.
+	if (overlaps.size() > 0)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: %d overlapping regions.", overlaps.size());
+	}
+		
+	// Write the result out.
+	for (int i = 0; i < chf.spanCount; ++i)
+		chf.spans[i].reg = srcReg[i];
+	
+	return true;
+}
+
+/// @par
+/// 
+/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
+/// Contours will form simple polygons.
+/// 
+/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
+/// re-assigned to the zero (null) region.
+/// 
+/// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors. 
+/// @p mergeRegionArea helps reduce unecessarily small regions.
+/// 
+/// See the #rcConfig documentation for more information on the configuration parameters.
+/// 
+/// The region data will be available via the rcCompactHeightfield::maxRegions
+/// and rcCompactSpan::reg fields.
+/// 
+/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
+/// 
+/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					const int borderSize, const int minRegionArea, const int mergeRegionArea)
+{
+	rcAssert(ctx);
 	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+	rcTempArenaScope tempScope(ctx->getTempArena());
+	
+	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP));
+	if (!buf)
 	{
-		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
+		return false;
+	}
+	
+	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
 
-		// Merge regions and filter out smalle regions.
-		rcIntArray overlaps;
-		chf.maxRegions = regionId;
-		if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
-			return false;
+	unsigned short* srcReg = buf;
+	unsigned short* srcDist = buf+chf.spanCount;
+	
+	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
+	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
+	
+	unsigned short regionId = 1;
+	
+	paintBorderRegions(chf, borderSize, srcReg, regionId);
+	
+	if (!watershedRegions(ctx, chf, srcReg, srcDist, regionId, 0, chf.height))
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
+		ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+		return false;
+	}
+	
+	ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+	
+	return filterAndStoreRegions(ctx, chf, minRegionArea, mergeRegionArea, regionId, srcReg);
+}
+
+namespace
+{
+/// The rows per strip of the parallel watershed partitioning.
+const int REGION_STRIP_HEIGHT = 64;
+
+struct WatershedStrip
+{
+	unsigned short regionCount;
+	bool overflow;
+};
+
+struct WatershedJob
+{
+	rcCompactHeightfield* chf;
+	unsigned short* srcReg;
+	unsigned short* srcDist;
+	WatershedStrip* strips;
+	unsigned short* baseIds;
+	rcTimerContext* timers;
+};
+}  // namespace
+
+static void watershedStripTask(int index, int worker, void* userData)
+{
+	WatershedJob* job = (WatershedJob*)userData;
+	const int minY = index * REGION_STRIP_HEIGHT;
+	const int maxY = rcMin(minY + REGION_STRIP_HEIGHT, job->chf->height);
+	
+	// Every strip numbers its regions from 1, they are offset once all strips are done.
+	unsigned short regionId = 1;
+	WatershedStrip& strip = job->strips[index];
+	strip.overflow = !watershedRegions(&job->timers[worker], *job->chf, job->srcReg, job->srcDist, regionId, minY, maxY);
+	strip.regionCount = (unsigned short)(regionId - 1);
+}
 
-		// If overlapping regions were found during merging, split those regions.
-		if (overlaps.size() > 0)
+static void offsetStripRegionsTask(int index, int /*worker*/, void* userData)
+{
+	WatershedJob* job = (WatershedJob*)userData;
+	const rcCompactHeightfield& chf = *job->chf;
+	const int w = chf.width;
+	const int minY = index * REGION_STRIP_HEIGHT;
+	const int maxY = rcMin(minY + REGION_STRIP_HEIGHT, chf.height);
+	const unsigned short offset = (unsigned short)(job->baseIds[index] - 1);
+	
+	for (int y = minY; y < maxY; ++y)
+	{
+		for (int x = 0; x < w; ++x)
 		{
-			ctx->log(RC_LOG_ERROR, "rcBuildRegions: %d overlapping regions.", overlaps.size());
+			const rcCompactCell& c = chf.cells[x+y*w];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				const unsigned short r = job->srcReg[i];
+				if (r != 0 && (r & RC_BORDER_REG) == 0)
+					job->srcReg[i] = (unsigned short)(r + offset);
+			}
 		}
 	}
+}
+
+static unsigned short findRegionRoot(unsigned short* parents, unsigned short r)
+{
+	while (parents[r] != r)
+	{
+		parents[r] = parents[parents[r]];
+		r = parents[r];
+	}
+	return r;
+}
+
+namespace
+{
+struct SeamContact
+{
+	unsigned short above;
+	unsigned short below;
+	int count;
+};
+}  // namespace
+
+static int compareSeamContacts(const void* va, const void* vb)
+{
+	const SeamContact* a = (const SeamContact*)va;
+	const SeamContact* b = (const SeamContact*)vb;
+	if (a->above != b->above)
+		return a->above < b->above ? -1 : 1;
+	if (a->below != b->below)
+		return a->below < b->below ? -1 : 1;
+	return 0;
+}
+
+/// Joins the regions which were split by the seams between the strips.
+/// Two regions on opposite sides of a seam are joined when each is the region the other shares the
+/// longest stretch of the seam with, which restores the regions of open areas without joining every
+/// region touching the seam into one. The IDs from @p firstId on are renumbered and @p regionCount is updated.
+static bool stitchRegionSeams(rcContext* ctx, const rcCompactHeightfield& chf,
+							  unsigned short* srcReg, const unsigned short firstId, unsigned short& regionCount)
+{
+	const int w = chf.width;
+	const int h = chf.height;
+	
+	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*regionCount*3, RC_ALLOC_TEMP));
+	rcScopedDelete<int> counts((int*)rcAlloc(sizeof(int)*regionCount*2, RC_ALLOC_TEMP));
+	if (!buf || !counts)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'seams' (%d).", regionCount*3);
+		return false;
+	}
+	unsigned short* parents = buf;
+	unsigned short* bestBelow = buf + regionCount;
+	unsigned short* bestAbove = buf + regionCount*2;
+	int* bestBelowCount = counts;
+	int* bestAboveCount = counts + regionCount;
+	
+	for (int r = 0; r < regionCount; ++r)
+		parents[r] = (unsigned short)r;
+	
+	rcTempVector<SeamContact> contacts;
+	
+	for (int seamY = REGION_STRIP_HEIGHT; seamY < h; seamY += REGION_STRIP_HEIGHT)
+	{
+		// Collect the stretches of the seam where two regions touch.
+		contacts.clear();
+		const int y = seamY - 1;
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*w];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				const rcCompactSpan& s = chf.spans[i];
+				if (rcGetCon(s, 1) == RC_NOT_CONNECTED)
+					continue;
+				const int ai = (int)chf.cells[x+(y+1)*w].index + rcGetCon(s, 1);
+				const unsigned short ra = srcReg[i];
+				const unsigned short rb = srcReg[ai];
+				if (ra == 0 || rb == 0 || ((ra | rb) & RC_BORDER_REG) || chf.areas[i] != chf.areas[ai])
+					continue;
+				if (contacts.size() > 0 && contacts.back().above == ra && contacts.back().below == rb)
+				{
+					contacts.back().count++;
+				}
+				else
+				{
+					SeamContact contact;
+					contact.above = ra;
+					contact.below = rb;
+					contact.count = 1;
+					contacts.push_back(contact);
+				}
+			}
+		}
+		if (contacts.size() == 0)
+			continue;
 		
-	// Write the result out.
+		qsort(&contacts[0], contacts.size(), sizeof(SeamContact), compareSeamContacts);
+		
+		for (int j = 0; j < contacts.size(); ++j)
+		{
+			bestBelow[contacts[j].above] = 0;
+			bestBelowCount[contacts[j].above] = 0;
+			bestAbove[contacts[j].below] = 0;
+			bestAboveCount[contacts[j].below] = 0;
+		}
+		
+		// Find the region each region shares the most of the seam with. Ties keep the smaller ID.
+		for (int j = 0; j < contacts.size(); )
+		{
+			const unsigned short ra = contacts[j].above;
+			const unsigned short rb = contacts[j].below;
+			int count = 0;
+			for (; j < contacts.size() && contacts[j].above == ra && contacts[j].below == rb; ++j)
+				count += contacts[j].count;
+			if (count > bestBelowCount[ra])
+			{
+				bestBelow[ra] = rb;
+				bestBelowCount[ra] = count;
+			}
+			if (count > bestAboveCount[rb])
+			{
+				bestAbove[rb] = ra;
+				bestAboveCount[rb] = count;
+			}
+		}
+		
+		for (int j = 0; j < contacts.size(); ++j)
+		{
+			const unsigned short ra = contacts[j].above;
+			const unsigned short rb = contacts[j].below;
+			if (bestBelow[ra] != rb || bestAbove[rb] != ra)
+				continue;
+			const unsigned short rootA = findRegionRoot(parents, ra);
+			const unsigned short rootB = findRegionRoot(parents, rb);
+			// Keep the smallest ID as the root, so the result does not depend on the order of the joins.
+			if (rootA < rootB)
+				parents[rootB] = rootA;
+			else
+				parents[rootA] = rootB;
+		}
+	}
+	
+	// Number the joined regions consecutively, empty region IDs would be kept by mergeAndFilterRegions.
+	unsigned short* remap = bestBelow;
+	unsigned short nextId = firstId;
+	for (int r = 0; r < regionCount; ++r)
+	{
+		if (r >= firstId && findRegionRoot(parents, (unsigned short)r) == r)
+			remap[r] = nextId++;
+	}
 	for (int i = 0; i < chf.spanCount; ++i)
-		chf.spans[i].reg = srcReg[i];
+	{
+		const unsigned short r = srcReg[i];
+		if (r != 0 && (r & RC_BORDER_REG) == 0)
+			srcReg[i] = remap[findRegionRoot(parents, r)];
+	}
+	regionCount = nextId;
 	
 	return true;
 }
 
+/// @par
+///
+/// The heightfield is split into strips of rows which are partitioned concurrently on the workers of @p pool.
+/// The regions split by the seams between the strips are joined again before the regions are merged and filtered.
+/// The regions depend on the size of the heightfield but not on the number of workers, but can differ from
+/// the regions built by the serial #rcBuildRegions.
+///
+/// The workers time the stages of the watershed partitioning with their own contexts. Their times are
+/// summed and added to @p ctx with rcContext::addAccumulatedTime, so they can exceed the time of the
+/// #RC_TIMER_BUILD_REGIONS_WATERSHED stage which contains them.
+///
+/// @see rcBuildRegions
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					const int borderSize, const int minRegionArea, const int mergeRegionArea,
+					rcThreadPool* pool)
+{
+	rcAssert(ctx);
+	
+	const int stripCount = (chf.height + REGION_STRIP_HEIGHT-1) / REGION_STRIP_HEIGHT;
+	if (!pool || stripCount < 2)
+		return rcBuildRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+	rcTempArenaScope tempScope(ctx->getTempArena());
+	
+	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP));
+	if (!buf)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
+		return false;
+	}
+	rcScopedDelete<WatershedStrip> strips((WatershedStrip*)rcAlloc(sizeof(WatershedStrip)*stripCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> baseIds((unsigned short*)rcAlloc(sizeof(unsigned short)*stripCount, RC_ALLOC_TEMP));
+	if (!strips || !baseIds)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'strips' (%d).", stripCount);
+		return false;
+	}
+	rcTempVector<rcTimerContext> timers;
+	timers.resize(pool->getWorkerCount());
+	
+	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+	
+	unsigned short* srcReg = buf;
+	unsigned short* srcDist = buf+chf.spanCount;
+	
+	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
+	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
+	
+	unsigned short regionId = 1;
+	
+	paintBorderRegions(chf, borderSize, srcReg, regionId);
+	
+	WatershedJob job;
+	job.chf = &chf;
+	job.srcReg = srcReg;
+	job.srcDist = srcDist;
+	job.strips = strips;
+	job.baseIds = baseIds;
+	job.timers = &timers[0];
+	pool->parallelFor(stripCount, watershedStripTask, &job);
+	for (int i = 0; i < timers.size(); ++i)
+		timers[i].addTimesTo(ctx);
+	
+	// Assign the strips consecutive ranges of region IDs.
+	int nextId = regionId;
+	for (int i = 0; i < stripCount; ++i)
+	{
+		if (strips[i].overflow || nextId + strips[i].regionCount >= 0xFFFF)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
+			ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+			return false;
+		}
+		baseIds[i] = (unsigned short)nextId;
+		nextId += strips[i].regionCount;
+	}
+	regionId = (unsigned short)nextId;
+	pool->parallelFor(stripCount, offsetStripRegionsTask, &job);
+	
+	if (!stitchRegionSeams(ctx, chf, srcReg, baseIds[0], regionId))
+	{
+		ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+		return false;
+	}
+	
+	// Expand into the spans which could only be reached across the seams.
+	rcTempVector<LevelStackEntry> stack;
+	expandRegions(RC_WATERSHED_EXPAND_ITERS*8, 0, chf, srcReg, srcDist, stack, true, 0, chf.height);
+	
+	ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+	
+	return filterAndStoreRegions(ctx, chf, minRegionArea, mergeRegionArea, regionId, srcReg);
+}
+
 
 bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 						 const int borderSize, const int minRegionArea)
@@ -1664,6 +2201,7 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+	rcTempArenaScope tempScope(ctx->getTempArena());
 	
 	const int w = chf.width;
 	const int h = chf.height;
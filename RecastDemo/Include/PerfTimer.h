@@ -28,6 +28,7 @@ typedef __int64 TimeVal;
 
 TimeVal getPerfTime();
 int getPerfTimeUsec(const TimeVal duration);
+TimeVal getPerfTimeFromUsec(const int usec);
 
 #endif // PERFTIMER_H
 
@@ -19,6 +19,8 @@
 #ifndef RECASTSAMPLE_H
 #define RECASTSAMPLE_H
 
+#include <stddef.h>
+
 #include "Recast.h"
 #include "SampleInterfaces.h"
 
@@ -131,9 +133,14 @@ protected:
 	BuildContext* m_ctx;
 
 	SampleDebugDraw m_dd;
+
+	/// The memory mapped navmesh set the tiles of the loaded navmesh point into.
+	unsigned char* m_navMeshSetData;
+	size_t m_navMeshSetSize;
 	
 	dtNavMesh* loadAll(const char* path);
 	void saveAll(const char* path, const dtNavMesh* mesh);
+	void unmapNavMeshSet();
 
 public:
 	Sample();
@@ -58,6 +58,7 @@ protected:
 	virtual void doStartTimer(const rcTimerLabel label);
 	virtual void doStopTimer(const rcTimerLabel label);
 	virtual int doGetAccumulatedTime(const rcTimerLabel label) const;
+	virtual void doAddAccumulatedTime(const rcTimerLabel label, const int time);
 	///@}
 };
 
@@ -38,6 +38,14 @@ int getPerfTimeUsec(const TimeVal duration)
 	return (int)(duration*1000000 / freq);
 }
 
+TimeVal getPerfTimeFromUsec(const int usec)
+{
+	static __int64 freq = 0;
+	if (freq == 0)
+		QueryPerformanceFrequency((LARGE_INTEGER*)&freq);
+	return (TimeVal)usec * freq / 1000000;
+}
+
 #else
 
 // Linux, BSD, OSX
@@ -56,4 +64,9 @@ int getPerfTimeUsec(const TimeVal duration)
 	return (int)duration;
 }
 
+TimeVal getPerfTimeFromUsec(const int usec)
+{
+	return (TimeVal)usec;
+}
+
 #endif
@@ -18,6 +18,7 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "Sample.h"
 #include "InputGeom.h"
 #include "Recast.h"
@@ -25,6 +26,7 @@
 #include "DetourDebugDraw.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
+#include "DetourNavMeshSet.h"
 #include "DetourCrowd.h"
 #include "imgui.h"
 #include "SDL.h"
@@ -32,6 +34,14 @@
 
 #ifdef WIN32
 #	define snprintf _snprintf
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
 #endif
 
 SampleTool::~SampleTool()
@@ -75,7 +85,9 @@ Sample::Sample() :
 	m_filterLedgeSpans(true),
 	m_filterWalkableLowHeightSpans(true),
 	m_tool(0),
-	m_ctx(0)
+	m_ctx(0),
+	m_navMeshSetData(0),
+	m_navMeshSetSize(0)
 {
 	resetCommonSettings();
 	m_navQuery = dtAllocNavMeshQuery();
@@ -90,6 +102,7 @@ Sample::~Sample()
 	dtFreeNavMeshQuery(m_navQuery);
 	dtFreeNavMesh(m_navMesh);
 	dtFreeCrowd(m_crowd);
+	unmapNavMeshSet();
 	delete m_tool;
 	for (int i = 0; i < MAX_TOOLS; i++)
 		delete m_toolStates[i];
@@ -331,8 +344,8 @@ void Sample::renderOverlayToolStates(double* proj, double* model, int* view)
 	}
 }
 
-static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
-static const int NAVMESHSET_VERSION = 1;
+// The unaligned version 1 of the set format, where each tile was read separately.
+static const int NAVMESHSET_VERSION_STREAMED = 1;
 
 struct NavMeshSetHeader
 {
@@ -348,40 +361,21 @@ struct NavMeshTileHeader
 	int dataSize;
 };
 
-dtNavMesh* Sample::loadAll(const char* path)
+static dtNavMesh* loadStreamedNavMeshSet(FILE* fp)
 {
-	FILE* fp = fopen(path, "rb");
-	if (!fp) return 0;
-
 	// Read header.
 	NavMeshSetHeader header;
 	size_t readLen = fread(&header, sizeof(NavMeshSetHeader), 1, fp);
 	if (readLen != 1)
-	{
-		fclose(fp);
-		return 0;
-	}
-	if (header.magic != NAVMESHSET_MAGIC)
-	{
-		fclose(fp);
-		return 0;
-	}
-	if (header.version != NAVMESHSET_VERSION)
-	{
-		fclose(fp);
 		return 0;
-	}
 
 	dtNavMesh* mesh = dtAllocNavMesh();
 	if (!mesh)
-	{
-		fclose(fp);
 		return 0;
-	}
 	dtStatus status = mesh->init(&header.params);
 	if (dtStatusFailed(status))
 	{
-		fclose(fp);
+		dtFreeNavMesh(mesh);
 		return 0;
 	}
 
@@ -392,7 +386,7 @@ dtNavMesh* Sample::loadAll(const char* path)
 		readLen = fread(&tileHeader, sizeof(tileHeader), 1, fp);
 		if (readLen != 1)
 		{
-			fclose(fp);
+			dtFreeNavMesh(mesh);
 			return 0;
 		}
 
@@ -406,14 +400,122 @@ dtNavMesh* Sample::loadAll(const char* path)
 		if (readLen != 1)
 		{
 			dtFree(data);
-			fclose(fp);
+			dtFreeNavMesh(mesh);
 			return 0;
 		}
 
 		mesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, 0);
 	}
 
+	return mesh;
+}
+
+// Maps the whole file copy-on-write, so that the navmesh can write the tile links
+// without changing the file, and the untouched pages stay shared between processes.
+static unsigned char* mapFile(const char* path, size_t* size)
+{
+#ifdef WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+	CloseHandle(file);
+	if (!mapping)
+		return 0;
+	void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	// The view keeps the mapping alive.
+	CloseHandle(mapping);
+	if (!data)
+		return 0;
+	*size = (size_t)fileSize.QuadPart;
+	return (unsigned char*)data;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return 0;
+	}
+	void* data = mmap(0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file open.
+	close(fd);
+	if (data == MAP_FAILED)
+		return 0;
+	*size = (size_t)st.st_size;
+	return (unsigned char*)data;
+#endif
+}
+
+static void unmapFile(unsigned char* data, size_t size)
+{
+#ifdef WIN32
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+void Sample::unmapNavMeshSet()
+{
+	if (m_navMeshSetData)
+		unmapFile(m_navMeshSetData, m_navMeshSetSize);
+	m_navMeshSetData = 0;
+	m_navMeshSetSize = 0;
+}
+
+dtNavMesh* Sample::loadAll(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	if (!fp) return 0;
+
+	// Check the format.
+	int magicAndVersion[2];
+	size_t readLen = fread(magicAndVersion, sizeof(magicAndVersion), 1, fp);
+	if (readLen != 1 || magicAndVersion[0] != DT_NAVMESH_SET_MAGIC)
+	{
+		fclose(fp);
+		return 0;
+	}
+	if (magicAndVersion[1] == NAVMESHSET_VERSION_STREAMED)
+	{
+		rewind(fp);
+		dtNavMesh* mesh = loadStreamedNavMeshSet(fp);
+		fclose(fp);
+		return mesh;
+	}
 	fclose(fp);
+	if (magicAndVersion[1] != DT_NAVMESH_SET_VERSION)
+		return 0;
+
+	// The previous set is not used anymore, the navmesh using it has been freed.
+	unmapNavMeshSet();
+
+	size_t size = 0;
+	unsigned char* data = mapFile(path, &size);
+	if (!data)
+		return 0;
+
+	dtNavMesh* mesh = dtAllocNavMesh();
+	if (!mesh || dtStatusFailed(dtLoadNavMeshSet(mesh, data, size)))
+	{
+		dtFreeNavMesh(mesh);
+		unmapFile(data, size);
+		return 0;
+	}
+
+	// The tiles point into the mapping, keep it until the next set is loaded.
+	m_navMeshSetData = data;
+	m_navMeshSetSize = size;
 
 	return mesh;
 }
@@ -422,37 +524,48 @@ void Sample::saveAll(const char* path, const dtNavMesh* mesh)
 {
 	if (!mesh) return;
 
-	FILE* fp = fopen(path, "wb");
-	if (!fp)
+	const size_t size = dtGetNavMeshSetSize(mesh, DT_NAVMESH_SET_ALIGNMENT);
+	unsigned char* data = (unsigned char*)dtAlloc(size, DT_ALLOC_TEMP);
+	if (!data)
+	{
+		m_ctx->log(RC_LOG_ERROR, "saveAll: Out of memory 'data' (%d).", (int)size);
 		return;
-
-	// Store header.
-	NavMeshSetHeader header;
-	header.magic = NAVMESHSET_MAGIC;
-	header.version = NAVMESHSET_VERSION;
-	header.numTiles = 0;
-	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	}
+	if (dtStatusFailed(dtStoreNavMeshSet(mesh, DT_NAVMESH_SET_ALIGNMENT, data, size)))
 	{
-		const dtMeshTile* tile = mesh->getTile(i);
-		if (!tile || !tile->header || !tile->dataSize) continue;
-		header.numTiles++;
+		m_ctx->log(RC_LOG_ERROR, "saveAll: Could not store the navmesh.");
+		dtFree(data);
+		return;
 	}
-	memcpy(&header.params, mesh->getParams(), sizeof(dtNavMeshParams));
-	fwrite(&header, sizeof(NavMeshSetHeader), 1, fp);
 
-	// Store tiles.
-	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	// Write to a temporary file first, overwriting the file in place would change
+	// the pages of a navmesh loaded from it.
+	char tmpPath[1024];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	FILE* fp = fopen(tmpPath, "wb");
+	if (!fp)
 	{
-		const dtMeshTile* tile = mesh->getTile(i);
-		if (!tile || !tile->header || !tile->dataSize) continue;
-
-		NavMeshTileHeader tileHeader;
-		tileHeader.tileRef = mesh->getTileRef(tile);
-		tileHeader.dataSize = tile->dataSize;
-		fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
-
-		fwrite(tile->data, tile->dataSize, 1, fp);
+		m_ctx->log(RC_LOG_ERROR, "saveAll: Could not open '%s' for writing.", tmpPath);
+		dtFree(data);
+		return;
 	}
-
+	const bool written = fwrite(data, size, 1, fp) == 1;
 	fclose(fp);
+	dtFree(data);
+	if (!written)
+	{
+		m_ctx->log(RC_LOG_ERROR, "saveAll: Could not write '%s'.", tmpPath);
+		remove(tmpPath);
+		return;
+	}
+
+#ifdef WIN32
+	// Rename does not replace existing files on Windows. The replace fails while
+	// the file is mapped by the loaded navmesh, the data is kept in the temporary file then.
+	const bool replaced = MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	const bool replaced = rename(tmpPath, path) == 0;
+#endif
+	if (!replaced)
+		m_ctx->log(RC_LOG_ERROR, "saveAll: Could not replace '%s', the navmesh is saved in '%s'.", path, tmpPath);
 }
@@ -79,6 +79,15 @@ int BuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
 	return getPerfTimeUsec(m_accTime[label]);
 }
 
+void BuildContext::doAddAccumulatedTime(const rcTimerLabel label, const int time)
+{
+	const TimeVal deltaTime = getPerfTimeFromUsec(time);
+	if (m_accTime[label] == -1)
+		m_accTime[label] = deltaTime;
+	else
+		m_accTime[label] += deltaTime;
+}
+
 void BuildContext::dumpLog(const char* format, ...)
 {
 	// Print header.
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <string.h>
+#include <vector>
+
+#include "Recast.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+/// Builds small tiled navigation meshes for the Detour tests.
+/// The geometry is a flat floor with a few box shaped walls on it.
+struct TestNavMesh
+{
+	static const int TILE_SIZE = 32;
+
+	std::vector<float> verts;
+	std::vector<int> tris;
+	std::vector<float> offMeshConVerts;
+	std::vector<float> offMeshConRads;
+	std::vector<unsigned char> offMeshConDirs;
+	rcConfig cfg;
+	int tilesX;
+	int tilesY;
+	bool buildBvTree;
+	bool buildWideBvTree;
+
+	TestNavMesh(int tilesX_, int tilesY_, bool walls = true)
+		: tilesX(tilesX_), tilesY(tilesY_), buildBvTree(true), buildWideBvTree(false)
+	{
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.cs = 0.3f;
+		cfg.ch = 0.2f;
+		cfg.walkableSlopeAngle = 45.0f;
+		cfg.walkableHeight = 10;
+		cfg.walkableClimb = 4;
+		cfg.walkableRadius = 2;
+		cfg.maxEdgeLen = 40;
+		cfg.maxSimplificationError = 1.3f;
+		cfg.minRegionArea = 8 * 8;
+		cfg.mergeRegionArea = 20 * 20;
+		cfg.maxVertsPerPoly = 6;
+		cfg.tileSize = TILE_SIZE;
+		cfg.borderSize = cfg.walkableRadius + 3;
+		cfg.width = cfg.tileSize + cfg.borderSize * 2;
+		cfg.height = cfg.tileSize + cfg.borderSize * 2;
+		cfg.detailSampleDist = cfg.cs * 6.0f;
+		cfg.detailSampleMaxError = cfg.ch * 1.0f;
+
+		const float sizeX = getTileWorldSize() * tilesX;
+		const float sizeZ = getTileWorldSize() * tilesY;
+		addBox(0.0f, -1.0f, 0.0f, sizeX, 0.0f, sizeZ);
+		if (walls)
+		{
+			// Walls along z with gaps at alternating ends, so that paths have to wind around them.
+			const int wallCount = tilesX * 2 - 1;
+			for (int i = 0; i < wallCount; ++i)
+			{
+				const float x = sizeX * (i + 1) / (wallCount + 1);
+				const float gap = sizeZ * 0.2f;
+				if (i & 1)
+					addBox(x - 0.3f, 0.0f, gap, x + 0.3f, 3.0f, sizeZ);
+				else
+					addBox(x - 0.3f, 0.0f, 0.0f, x + 0.3f, 3.0f, sizeZ - gap);
+			}
+		}
+	}
+
+	float getTileWorldSize() const { return cfg.tileSize * cfg.cs; }
+
+	void getBounds(float* bmin, float* bmax) const
+	{
+		rcCalcBounds(&verts[0], (int)verts.size() / 3, bmin, bmax);
+	}
+
+	void addBox(float x0, float y0, float z0, float x1, float y1, float z1)
+	{
+		const int base = (int)verts.size() / 3;
+		const float v[8][3] = {
+			{ x0, y0, z0 }, { x1, y0, z0 }, { x1, y0, z1 }, { x0, y0, z1 },
+			{ x0, y1, z0 }, { x1, y1, z0 }, { x1, y1, z1 }, { x0, y1, z1 },
+		};
+		for (int i = 0; i < 8; ++i)
+			verts.insert(verts.end(), v[i], v[i] + 3);
+		// Counter-clockwise seen from outside, so that the top faces are walkable.
+		const int faces[12][3] = {
+			{ 4, 7, 6 }, { 4, 6, 5 }, // top
+			{ 0, 1, 2 }, { 0, 2, 3 }, // bottom
+			{ 0, 4, 5 }, { 0, 5, 1 },
+			{ 1, 5, 6 }, { 1, 6, 2 },
+			{ 2, 6, 7 }, { 2, 7, 3 },
+			{ 3, 7, 4 }, { 3, 4, 0 },
+		};
+		for (int i = 0; i < 12; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+				tris.push_back(base + faces[i][j]);
+		}
+	}
+
+	/// Adds an off-mesh connection from @p start to @p end, which can be travelled both ways if @p bidir is set.
+	void addOffMeshConnection(const float* start, const float* end, bool bidir)
+	{
+		offMeshConVerts.insert(offMeshConVerts.end(), start, start + 3);
+		offMeshConVerts.insert(offMeshConVerts.end(), end, end + 3);
+		offMeshConRads.push_back(cfg.cs * cfg.walkableRadius * 2.0f);
+		offMeshConDirs.push_back(bidir ? DT_OFFMESH_CON_BIDIR : 0);
+	}
+
+	/// Creates the data of the specified tile, or returns null if the tile is empty.
+	unsigned char* buildTile(rcContext* ctx, int tx, int ty, int* dataSize) const
+	{
+		*dataSize = 0;
+
+		rcConfig tcfg = cfg;
+		float bmin[3], bmax[3];
+		getBounds(bmin, bmax);
+		const float tcs = getTileWorldSize();
+		tcfg.bmin[0] = bmin[0] + tx * tcs - cfg.borderSize * cfg.cs;
+		tcfg.bmin[1] = bmin[1];
+		tcfg.bmin[2] = bmin[2] + ty * tcs - cfg.borderSize * cfg.cs;
+		tcfg.bmax[0] = bmin[0] + (tx + 1) * tcs + cfg.borderSize * cfg.cs;
+		tcfg.bmax[1] = bmax[1];
+		tcfg.bmax[2] = bmin[2] + (ty + 1) * tcs + cfg.borderSize * cfg.cs;
+
+		const int nverts = (int)verts.size() / 3;
+		const int ntris = (int)tris.size() / 3;
+		std::vector<unsigned char> areas(ntris, 0);
+		rcMarkWalkableTriangles(ctx, tcfg.walkableSlopeAngle, &verts[0], nverts, &tris[0], ntris, &areas[0]);
+
+		unsigned char* navData = 0;
+		rcHeightfield* solid = rcAllocHeightfield();
+		rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+		rcContourSet* cset = rcAllocContourSet();
+		rcPolyMesh* pmesh = rcAllocPolyMesh();
+		rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+
+		bool ok = rcCreateHeightfield(ctx, *solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch) &&
+			rcRasterizeTriangles(ctx, &verts[0], nverts, &tris[0], &areas[0], ntris, *solid, tcfg.walkableClimb);
+		if (ok)
+		{
+			rcFilterLowHangingWalkableObstacles(ctx, tcfg.walkableClimb, *solid);
+			rcFilterLedgeSpans(ctx, tcfg.walkableHeight, tcfg.walkableClimb, *solid);
+			rcFilterWalkableLowHeightSpans(ctx, tcfg.walkableHeight, *solid);
+			ok = rcBuildCompactHeightfield(ctx, tcfg.walkableHeight, tcfg.walkableClimb, *solid, *chf) &&
+				rcErodeWalkableArea(ctx, tcfg.walkableRadius, *chf) &&
+				rcBuildDistanceField(ctx, *chf) &&
+				rcBuildRegions(ctx, *chf, tcfg.borderSize, tcfg.minRegionArea, tcfg.mergeRegionArea) &&
+				rcBuildContours(ctx, *chf, tcfg.maxSimplificationError, tcfg.maxEdgeLen, *cset) &&
+				rcBuildPolyMesh(ctx, *cset, tcfg.maxVertsPerPoly, *pmesh) &&
+				rcBuildPolyMeshDetail(ctx, *pmesh, *chf, tcfg.detailSampleDist, tcfg.detailSampleMaxError, *dmesh);
+		}
+
+		if (ok && pmesh->npolys > 0)
+		{
+			for (int i = 0; i < pmesh->npolys; ++i)
+				pmesh->flags[i] = 1;
+
+			dtNavMeshCreateParams params;
+			memset(&params, 0, sizeof(params));
+			params.verts = pmesh->verts;
+			params.vertCount = pmesh->nverts;
+			params.polys = pmesh->polys;
+			params.polyAreas = pmesh->areas;
+			params.polyFlags = pmesh->flags;
+			params.polyCount = pmesh->npolys;
+			params.nvp = pmesh->nvp;
+			params.detailMeshes = dmesh->meshes;
+			params.detailVerts = dmesh->verts;
+			params.detailVertsCount = dmesh->nverts;
+			params.detailTris = dmesh->tris;
+			params.detailTriCount = dmesh->ntris;
+			params.walkableHeight = tcfg.walkableHeight * tcfg.ch;
+			params.walkableRadius = tcfg.walkableRadius * tcfg.cs;
+			params.walkableClimb = tcfg.walkableClimb * tcfg.ch;
+			params.tileX = tx;
+			params.tileY = ty;
+			params.tileLayer = 0;
+			rcVcopy(params.bmin, pmesh->bmin);
+			rcVcopy(params.bmax, pmesh->bmax);
+			params.cs = tcfg.cs;
+			params.ch = tcfg.ch;
+			params.buildBvTree = buildBvTree;
+			params.buildWideBvTree = buildWideBvTree;
+			const int offMeshConCount = (int)offMeshConRads.size();
+			std::vector<unsigned short> offMeshConFlags(offMeshConCount, 1);
+			std::vector<unsigned char> offMeshConAreas(offMeshConCount, 0);
+			std::vector<unsigned int> offMeshConUserIDs(offMeshConCount, 0);
+			if (offMeshConCount > 0)
+			{
+				params.offMeshConVerts = &offMeshConVerts[0];
+				params.offMeshConRad = &offMeshConRads[0];
+				params.offMeshConDir = &offMeshConDirs[0];
+				params.offMeshConFlags = &offMeshConFlags[0];
+				params.offMeshConAreas = &offMeshConAreas[0];
+				params.offMeshConUserID = &offMeshConUserIDs[0];
+				params.offMeshConCount = offMeshConCount;
+			}
+			if (!dtCreateNavMeshData(&params, &navData, dataSize))
+				navData = 0;
+		}
+
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+
+		return navData;
+	}
+
+	/// Initializes a navigation mesh for the tile grid, without adding any tiles.
+	bool initNavMesh(dtNavMesh* navMesh) const
+	{
+		float bmin[3], bmax[3];
+		getBounds(bmin, bmax);
+		dtNavMeshParams params;
+		memset(&params, 0, sizeof(params));
+		rcVcopy(params.orig, bmin);
+		params.tileWidth = getTileWorldSize();
+		params.tileHeight = getTileWorldSize();
+		params.maxTiles = tilesX * tilesY;
+		params.maxPolys = 1 << 10;
+		return dtStatusSucceed(navMesh->init(&params));
+	}
+
+	/// Creates a navigation mesh containing all tiles.
+	dtNavMesh* createNavMesh() const
+	{
+		dtNavMesh* navMesh = dtAllocNavMesh();
+		if (!navMesh || !initNavMesh(navMesh))
+		{
+			dtFreeNavMesh(navMesh);
+			return 0;
+		}
+
+		rcContext ctx(false);
+		for (int ty = 0; ty < tilesY; ++ty)
+		{
+			for (int tx = 0; tx < tilesX; ++tx)
+			{
+				int dataSize = 0;
+				unsigned char* data = buildTile(&ctx, tx, ty, &dataSize);
+				if (data && dtStatusFailed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)))
+					dtFree(data);
+			}
+		}
+		return navMesh;
+	}
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "DetourNavMeshQuery.h"
+
+/// Runs the tasks on a thread per worker, handing out the indices dynamically.
+class TestTaskDispatcher : public dtTaskDispatcher
+{
+public:
+	explicit TestTaskDispatcher(int workerCount) : m_workerCount(workerCount) {}
+
+	int getWorkerCount() const override { return m_workerCount; }
+
+	void parallelFor(int count, dtTaskFunc* func, void* userData) override
+	{
+		std::atomic<int> next(0);
+		std::vector<std::thread> threads;
+		for (int w = 0; w < m_workerCount; ++w)
+		{
+			threads.emplace_back([&, w]()
+			{
+				for (int i = next++; i < count; i = next++)
+					func(i, w, userData);
+			});
+		}
+		for (size_t i = 0; i < threads.size(); ++i)
+			threads[i].join();
+	}
+
+private:
+	int m_workerCount;
+};
@@ -0,0 +1,247 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "TestNavMesh.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+float frand()
+{
+	return (float)(rand() % 10000) / 10000.0f;
+}
+
+float straightPathLength(dtNavMeshQuery* query, const float* startPos, const float* endPos, const dtPolyRef* path, int pathCount)
+{
+	static const int MAX_POINTS = 512;
+	float points[MAX_POINTS * 3];
+	int pointCount = 0;
+	query->findStraightPath(startPos, endPos, path, pathCount, points, 0, 0, &pointCount, MAX_POINTS);
+	float length = 0;
+	for (int i = 1; i < pointCount; ++i)
+		length += dtVdist(&points[(i - 1) * 3], &points[i * 3]);
+	return length;
+}
+
+bool isLinked(const dtNavMesh* navMesh, dtPolyRef from, dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(navMesh->getTileAndPolyByRef(from, &tile, &poly)))
+		return false;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+bool isValidPath(const dtNavMesh* navMesh, const dtPolyRef* path, int pathCount)
+{
+	for (int i = 1; i < pathCount; ++i)
+	{
+		if (!isLinked(navMesh, path[i - 1], path[i]))
+			return false;
+	}
+	return true;
+}
+
+bool usesOffMeshConnection(const dtNavMesh* navMesh, const dtPolyRef* path, int pathCount)
+{
+	for (int i = 0; i < pathCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		navMesh->getTileAndPolyByRefUnsafe(path[i], &tile, &poly);
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			return true;
+	}
+	return false;
+}
+}
+
+TEST_CASE("Bidirectional findPath")
+{
+	TestNavMesh geom(6, 6);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 4096)));
+
+	static const int MAX_PATH = 1024;
+	dtQueryFilter filter;
+	srand(3);
+
+	SECTION("Paths are as short as the paths of the unidirectional search")
+	{
+		int nodeCount = 0;
+		int bidirNodeCount = 0;
+		for (int iter = 0; iter < 100; ++iter)
+		{
+			dtPolyRef startRef = 0, endRef = 0;
+			float startPos[3], endPos[3];
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &startRef, startPos)));
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &endRef, endPos)));
+
+			dtPolyRef path[MAX_PATH], bidirPath[MAX_PATH];
+			int pathCount = 0, bidirPathCount = 0;
+			const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH);
+			nodeCount += query->getNodePool()->getNodeCount();
+			const dtStatus bidirStatus = query->findPath(startRef, endRef, startPos, endPos, &filter, bidirPath, &bidirPathCount, MAX_PATH,
+														 DT_FINDPATH_BIDIRECTIONAL);
+			bidirNodeCount += query->getNodePool()->getNodeCount();
+
+			REQUIRE(status == DT_SUCCESS);
+			REQUIRE(bidirStatus == DT_SUCCESS);
+			REQUIRE(bidirPathCount > 0);
+			REQUIRE(bidirPath[0] == startRef);
+			REQUIRE(bidirPath[bidirPathCount - 1] == endRef);
+			REQUIRE(isValidPath(navMesh, bidirPath, bidirPathCount));
+
+			const float length = straightPathLength(query, startPos, endPos, path, pathCount);
+			const float bidirLength = straightPathLength(query, startPos, endPos, bidirPath, bidirPathCount);
+			REQUIRE(bidirLength <= length * 1.01f + 0.01f);
+		}
+		// The walls make the distance a poor estimate, so searching from both ends visits fewer polygons.
+		REQUIRE(bidirNodeCount < nodeCount);
+	}
+
+	SECTION("The sliced query finds the same path")
+	{
+		for (int iter = 0; iter < 20; ++iter)
+		{
+			dtPolyRef startRef = 0, endRef = 0;
+			float startPos[3], endPos[3];
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &startRef, startPos)));
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &endRef, endPos)));
+
+			dtPolyRef path[MAX_PATH], slicedPath[MAX_PATH];
+			int pathCount = 0, slicedPathCount = 0;
+			REQUIRE(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH,
+									DT_FINDPATH_BIDIRECTIONAL) == DT_SUCCESS);
+
+			dtStatus status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter, DT_FINDPATH_BIDIRECTIONAL);
+			while (dtStatusInProgress(status))
+				status = query->updateSlicedFindPath(8, 0);
+			REQUIRE(status == DT_SUCCESS);
+			REQUIRE(query->finalizeSlicedFindPath(slicedPath, &slicedPathCount, MAX_PATH) == DT_SUCCESS);
+			REQUIRE(slicedPathCount == pathCount);
+			REQUIRE(memcmp(slicedPath, path, sizeof(dtPolyRef) * pathCount) == 0);
+		}
+	}
+
+	SECTION("An unreachable end polygon gives a partial path")
+	{
+		dtPolyRef startRef = 0, endRef = 0;
+		float startPos[3], endPos[3];
+		REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &startRef, startPos)));
+		REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &endRef, endPos)));
+		REQUIRE(startRef != endRef);
+		REQUIRE(dtStatusSucceed(navMesh->setPolyFlags(endRef, 2)));
+		filter.setExcludeFlags(2);
+
+		dtPolyRef path[MAX_PATH], bidirPath[MAX_PATH];
+		int pathCount = 0, bidirPathCount = 0;
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH);
+		const dtStatus bidirStatus = query->findPath(startRef, endRef, startPos, endPos, &filter, bidirPath, &bidirPathCount, MAX_PATH,
+													 DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(status == (DT_SUCCESS | DT_PARTIAL_RESULT));
+		REQUIRE(bidirStatus == (DT_SUCCESS | DT_PARTIAL_RESULT));
+		REQUIRE(bidirPath[0] == startRef);
+		REQUIRE(bidirPath[bidirPathCount - 1] == path[pathCount - 1]);
+		REQUIRE(isValidPath(navMesh, bidirPath, bidirPathCount));
+	}
+
+	SECTION("A too small path buffer is reported")
+	{
+		dtPolyRef startRef = 0, endRef = 0;
+		float startPos[3], endPos[3];
+		const float halfExtents[3] = { 1.0f, 2.0f, 1.0f };
+		const float start[3] = { 1.0f, 0.0f, 1.0f };
+		const float end[3] = { geom.getTileWorldSize() * 6.0f - 1.0f, 0.0f, 1.0f };
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(start, halfExtents, &filter, &startRef, startPos)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(end, halfExtents, &filter, &endRef, endPos)));
+
+		dtPolyRef path[MAX_PATH], shortPath[MAX_PATH];
+		int pathCount = 0, shortPathCount = 0;
+		REQUIRE(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH,
+								DT_FINDPATH_BIDIRECTIONAL) == DT_SUCCESS);
+		REQUIRE(pathCount > 3);
+		REQUIRE(query->findPath(startRef, endRef, startPos, endPos, &filter, shortPath, &shortPathCount, 3,
+								DT_FINDPATH_BIDIRECTIONAL) == (DT_SUCCESS | DT_BUFFER_TOO_SMALL));
+		REQUIRE(shortPathCount == 3);
+		REQUIRE(memcmp(shortPath, path, sizeof(dtPolyRef) * 3) == 0);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("Bidirectional findPath with off-mesh connections")
+{
+	// A single tile with one wall in the middle, the gap is at the far end along z.
+	TestNavMesh geom(1, 1);
+	const float size = geom.getTileWorldSize();
+	const float left[3] = { size * 0.5f - 1.2f, 0.0f, 1.5f };
+	const float right[3] = { size * 0.5f + 1.2f, 0.0f, 1.5f };
+	const bool bidir = GENERATE(false, true);
+	// More one-way connections ending at the same point than the backward search looks up at once.
+	const int otherCount = GENERATE(0, 40);
+	for (int i = 0; i < otherCount; ++i)
+	{
+		const float other[3] = { right[0] + 1.5f, 0.0f, right[2] + 0.5f + i * 0.1f };
+		geom.addOffMeshConnection(other, right, false);
+	}
+	geom.addOffMeshConnection(left, right, bidir);
+
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	// The other connections are excluded, so that they only take up space in the lookup.
+	const dtMeshTile* tile = ((const dtNavMesh*)navMesh)->getTile(0);
+	for (int i = 0; i < tile->header->offMeshConCount; ++i)
+	{
+		if (tile->offMeshCons[i].pos[0] > size * 0.5f)
+			REQUIRE(dtStatusSucceed(navMesh->setPolyFlags(navMesh->getPolyRefBase(tile) | tile->offMeshCons[i].poly, 2)));
+	}
+
+	dtQueryFilter filter;
+	filter.setExcludeFlags(2);
+	const float halfExtents[3] = { 1.0f, 2.0f, 1.0f };
+	const float leftCorner[3] = { 1.0f, 0.0f, 1.0f };
+	const float rightCorner[3] = { size - 1.0f, 0.0f, 1.0f };
+	dtPolyRef leftRef = 0, rightRef = 0;
+	float leftPos[3], rightPos[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(leftCorner, halfExtents, &filter, &leftRef, leftPos)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(rightCorner, halfExtents, &filter, &rightRef, rightPos)));
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH];
+	int pathCount = 0;
+
+	// The connection is the short way across the wall.
+	REQUIRE(query->findPath(leftRef, rightRef, leftPos, rightPos, &filter, path, &pathCount, MAX_PATH,
+							DT_FINDPATH_BIDIRECTIONAL) == DT_SUCCESS);
+	REQUIRE(path[pathCount - 1] == rightRef);
+	REQUIRE(isValidPath(navMesh, path, pathCount));
+	REQUIRE(usesOffMeshConnection(navMesh, path, pathCount));
+
+	// The backward search must not follow the connection against its direction.
+	REQUIRE(query->findPath(rightRef, leftRef, rightPos, leftPos, &filter, path, &pathCount, MAX_PATH,
+							DT_FINDPATH_BIDIRECTIONAL) == DT_SUCCESS);
+	REQUIRE(path[pathCount - 1] == leftRef);
+	REQUIRE(isValidPath(navMesh, path, pathCount));
+	REQUIRE(usesOffMeshConnection(navMesh, path, pathCount) == bidir);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
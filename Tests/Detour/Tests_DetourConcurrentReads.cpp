@@ -0,0 +1,154 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "TestNavMesh.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("dtNavMesh concurrent reads")
+{
+	TestNavMesh geom(3, 3);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	SECTION("Concurrent reads must be enabled explicitly")
+	{
+		REQUIRE(navMesh->getMaxReaders() == 0);
+		REQUIRE(dtStatusFailed(navMesh->initConcurrentReads(0)));
+		REQUIRE(dtStatusSucceed(navMesh->initConcurrentReads(2)));
+		REQUIRE(navMesh->getMaxReaders() == 2);
+	}
+
+	SECTION("Removed tiles are kept until the read sections have ended")
+	{
+		REQUIRE(dtStatusSucceed(navMesh->initConcurrentReads(2)));
+
+		const dtTileRef tileRef = navMesh->getTileRefAt(1, 1, 0);
+		REQUIRE(tileRef != 0);
+		const dtMeshTile* tile = navMesh->getTileByRef(tileRef);
+		const dtPolyRef polyRef = navMesh->getPolyRefBase(tile);
+		REQUIRE(navMesh->isValidPolyRef(polyRef));
+
+		navMesh->beginRead(0);
+		REQUIRE(dtStatusSucceed(navMesh->removeTile(tileRef, nullptr, nullptr)));
+
+		// The tile cannot be found anymore, but its data is still intact.
+		REQUIRE(navMesh->getTileAt(1, 1, 0) == nullptr);
+		REQUIRE_FALSE(navMesh->isValidPolyRef(polyRef));
+		REQUIRE(tile->header != nullptr);
+		REQUIRE(tile->polys != nullptr);
+		REQUIRE(navMesh->reclaimRemovedTiles() > 0);
+
+		// A reader which started after the removal does not hold the tile back.
+		navMesh->beginRead(1);
+		navMesh->endRead(0);
+		REQUIRE(navMesh->reclaimRemovedTiles() == 0);
+		REQUIRE(tile->header == nullptr);
+		navMesh->endRead(1);
+
+		// The tile can be added again.
+		rcContext ctx(false);
+		int dataSize = 0;
+		unsigned char* data = geom.buildTile(&ctx, 1, 1, &dataSize);
+		REQUIRE(data != nullptr);
+		REQUIRE(dtStatusSucceed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, nullptr)));
+		REQUIRE(navMesh->getTileAt(1, 1, 0) != nullptr);
+	}
+
+	SECTION("Queries run while tiles are streamed in and out")
+	{
+		const int readerCount = 3;
+		REQUIRE(dtStatusSucceed(navMesh->initConcurrentReads(readerCount)));
+
+		// Keep the tile data around, so that the streamed tiles do not have to be rebuilt.
+		rcContext ctx(false);
+		std::vector<unsigned char*> tileData(geom.tilesX * geom.tilesY);
+		std::vector<int> tileDataSize(geom.tilesX * geom.tilesY);
+		for (int ty = 0; ty < geom.tilesY; ++ty)
+		{
+			for (int tx = 0; tx < geom.tilesX; ++tx)
+			{
+				const int i = tx + ty * geom.tilesX;
+				tileData[i] = geom.buildTile(&ctx, tx, ty, &tileDataSize[i]);
+				REQUIRE(tileData[i] != nullptr);
+			}
+		}
+
+		float bmin[3], bmax[3];
+		geom.getBounds(bmin, bmax);
+
+		std::atomic<bool> done(false);
+		std::atomic<int> foundPaths(0);
+		std::vector<std::thread> readers;
+		for (int r = 0; r < readerCount; ++r)
+		{
+			readers.emplace_back([&, r]()
+			{
+				dtNavMeshQuery* query = dtAllocNavMeshQuery();
+				query->init(navMesh, 2048);
+				dtQueryFilter filter;
+				const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+				const float startPos[3] = { bmin[0] + 1.0f, 0.0f, bmin[2] + 1.0f };
+				const float endPos[3] = { bmax[0] - 1.0f, 0.0f, bmax[2] - 1.0f };
+				dtPolyRef path[256];
+				while (!done)
+				{
+					navMesh->beginRead(r);
+					dtPolyRef startRef = 0, endRef = 0;
+					float nearest[3];
+					query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest);
+					query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest);
+					int pathCount = 0;
+					if (startRef && endRef &&
+						dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)) &&
+						pathCount > 0)
+					{
+						foundPaths++;
+					}
+					navMesh->endRead(r);
+				}
+				dtFreeNavMeshQuery(query);
+			});
+		}
+
+		// Replace the centre tiles over and over again, until the readers have found some paths.
+		for (int iter = 0; iter < 200 || (foundPaths == 0 && iter < 100000); ++iter)
+		{
+			const int tx = 1;
+			const int ty = iter % geom.tilesY;
+			const int i = tx + ty * geom.tilesX;
+			const dtTileRef ref = navMesh->getTileRefAt(tx, ty, 0);
+			if (ref)
+			{
+				unsigned char* data = nullptr;
+				int dataSize = 0;
+				REQUIRE(dtStatusSucceed(navMesh->removeTile(ref, &data, &dataSize)));
+				REQUIRE(data == nullptr);
+			}
+			unsigned char* data = (unsigned char*)dtAlloc(tileDataSize[i], DT_ALLOC_PERM);
+			memcpy(data, tileData[i], tileDataSize[i]);
+			dtStatus status = navMesh->addTile(data, tileDataSize[i], DT_TILE_FREE_DATA, 0, nullptr);
+			while (dtStatusFailed(status))
+			{
+				// The removed tiles are still being read.
+				std::this_thread::yield();
+				navMesh->reclaimRemovedTiles();
+				status = navMesh->addTile(data, tileDataSize[i], DT_TILE_FREE_DATA, 0, nullptr);
+			}
+		}
+
+		done = true;
+		for (size_t r = 0; r < readers.size(); ++r)
+			readers[r].join();
+
+		REQUIRE(navMesh->reclaimRemovedTiles() == 0);
+		REQUIRE(foundPaths > 0);
+		for (size_t i = 0; i < tileData.size(); ++i)
+			dtFree(tileData[i]);
+	}
+
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,189 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "TestNavMesh.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+float randomFloat(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)(rand() % 10001) / 10000.0f;
+}
+
+void requireSameAsFindNearestPoly(dtNavMeshQuery* query, const std::vector<dtNearestPolyRequest>& requests,
+								  const float* halfExtents)
+{
+	dtQueryFilter filter;
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		const dtNearestPolyRequest& req = requests[i];
+		dtPolyRef nearestRef = 0;
+		float nearestPt[3] = { 0, 0, 0 };
+		bool isOverPoly = false;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(req.center, halfExtents, &filter, &nearestRef, nearestPt, &isOverPoly)));
+		REQUIRE(req.status == DT_SUCCESS);
+		REQUIRE(req.nearestRef == nearestRef);
+		if (nearestRef)
+		{
+			REQUIRE(req.nearestPt[0] == nearestPt[0]);
+			REQUIRE(req.nearestPt[1] == nearestPt[1]);
+			REQUIRE(req.nearestPt[2] == nearestPt[2]);
+			REQUIRE(req.isOverPoly == isOverPoly);
+		}
+	}
+}
+
+void testFindNearestPolys(const TestNavMesh& geom)
+{
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 256)));
+
+	float bmin[3], bmax[3];
+	geom.getBounds(bmin, bmax);
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1.0f, 2.0f, 1.0f };
+
+	// Scattered points, clusters of points sharing polygons, and points beside and outside the mesh.
+	srand(5);
+	std::vector<dtNearestPolyRequest> requests(1000);
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		dtNearestPolyRequest& req = requests[i];
+		memset(&req, 0, sizeof(req));
+		if (i % 2 == 0 || i < 10)
+		{
+			req.center[0] = randomFloat(bmin[0] - 2.0f, bmax[0] + 2.0f);
+			req.center[1] = randomFloat(-2.0f, 3.0f);
+			req.center[2] = randomFloat(bmin[2] - 2.0f, bmax[2] + 2.0f);
+		}
+		else
+		{
+			const float* prev = requests[i - 1].center;
+			req.center[0] = prev[0] + randomFloat(-0.5f, 0.5f);
+			req.center[1] = prev[1] + randomFloat(-0.5f, 0.5f);
+			req.center[2] = prev[2] + randomFloat(-0.5f, 0.5f);
+		}
+	}
+
+	SECTION("The results are the same as finding the polygons one by one")
+	{
+		REQUIRE(query->findNearestPolys(&requests[0], (int)requests.size(), halfExtents, &filter) == DT_SUCCESS);
+		requireSameAsFindNearestPoly(query, requests, halfExtents);
+
+		int found = 0;
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			if (requests[i].nearestRef)
+				found++;
+		}
+		REQUIRE(found > (int)requests.size() / 2);
+		REQUIRE(found < (int)requests.size());
+	}
+
+	SECTION("Invalid requests fail on their own")
+	{
+		requests[3].center[1] = FLT_MAX * 2.0f;
+		REQUIRE(query->findNearestPolys(&requests[0], (int)requests.size(), halfExtents, &filter) == DT_SUCCESS);
+		REQUIRE(requests[3].status == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(requests[3].nearestRef == 0);
+		requests.erase(requests.begin() + 3);
+		requireSameAsFindNearestPoly(query, requests, halfExtents);
+	}
+
+	SECTION("Invalid batches fail")
+	{
+		const float badExtents[3] = { 1.0f, FLT_MAX * 2.0f, 1.0f };
+		REQUIRE(query->findNearestPolys(&requests[0], -1, halfExtents, &filter) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->findNearestPolys(&requests[0], 1, badExtents, &filter) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->findNearestPolys(&requests[0], 1, halfExtents, nullptr) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->findNearestPolys(nullptr, 0, halfExtents, &filter) == DT_SUCCESS);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+}
+
+TEST_CASE("Point tests on four points at a time")
+{
+	const float verts[5 * 3] = {
+		0.0f, 0.0f, 0.0f,
+		2.0f, 1.0f, -0.5f,
+		3.0f, 2.0f, 1.5f,
+		1.0f, 0.5f, 3.0f,
+		-0.5f, 0.0f, 1.0f,
+	};
+
+	srand(3);
+	for (int iter = 0; iter < 1000; ++iter)
+	{
+		float px[4], pz[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			// Include points exactly on the vertices and edges.
+			if (iter % 4 == 0)
+			{
+				const int v = rand() % 5;
+				px[i] = verts[v * 3 + 0];
+				pz[i] = verts[v * 3 + 2];
+			}
+			else
+			{
+				px[i] = randomFloat(-1.0f, 4.0f);
+				pz[i] = randomFloat(-1.0f, 4.0f);
+			}
+		}
+
+		const unsigned int inside = dtPointInPolygon4(px, pz, verts, 5);
+		float h[4];
+		const unsigned int overTri = dtClosestHeightPointTriangle4(px, pz, &verts[0], &verts[6], &verts[3], h);
+		float dist[4], t[4];
+		dtDistancePtSegSqr2D4(px, pz, &verts[3], &verts[9], dist, t);
+
+		for (int i = 0; i < 4; ++i)
+		{
+			const float pt[3] = { px[i], 0.0f, pz[i] };
+			REQUIRE(((inside >> i) & 1) == (unsigned int)dtPointInPolygon(pt, verts, 5));
+
+			float height = 0.0f;
+			const bool hit = dtClosestHeightPointTriangle(pt, &verts[0], &verts[6], &verts[3], height);
+			REQUIRE(((overTri >> i) & 1) == (unsigned int)hit);
+			if (hit)
+				REQUIRE(h[i] == height);
+
+			float s = 0.0f;
+			REQUIRE(dist[i] == dtDistancePtSegSqr2D(pt, &verts[3], &verts[9], s));
+			REQUIRE(t[i] == s);
+		}
+	}
+}
+
+TEST_CASE("dtNavMeshQuery::findNearestPolys")
+{
+	TestNavMesh geom(3, 2);
+
+	SECTION("Binary bounding volume tree")
+	{
+		testFindNearestPolys(geom);
+	}
+
+	SECTION("Wide bounding volume tree")
+	{
+		geom.buildWideBvTree = true;
+		testFindNearestPolys(geom);
+	}
+
+	SECTION("No bounding volume tree")
+	{
+		geom.buildBvTree = false;
+		testFindNearestPolys(geom);
+	}
+}
@@ -0,0 +1,136 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "TestNavMesh.h"
+#include "TestTaskDispatcher.h"
+
+#include <vector>
+
+namespace
+{
+struct PathRequests
+{
+	std::vector<dtPathRequest> requests;
+	std::vector<dtPolyRef> paths;
+
+	PathRequests(dtNavMeshQuery* query, const TestNavMesh& geom, int count, int maxPath)
+		: requests(count), paths(count * maxPath)
+	{
+		float bmin[3], bmax[3];
+		geom.getBounds(bmin, bmax);
+		const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+		dtQueryFilter filter;
+
+		for (int i = 0; i < count; ++i)
+		{
+			dtPathRequest& req = requests[i];
+			memset(&req, 0, sizeof(req));
+			// Every fourth request repeats the previous one, and a few end at the same point.
+			const int k = (i % 4) == 3 ? i - 1 : i;
+			const float u = (float)((k * 37) % 101) / 100.0f;
+			const float v = (float)((k * 61) % 97) / 96.0f;
+			const float startPos[3] = { bmin[0] + 1.0f + u * (bmax[0] - bmin[0] - 2.0f), 0.0f, bmin[2] + 1.0f + v * (bmax[2] - bmin[2] - 2.0f) };
+			const float endPos[3] = { bmax[0] - 1.0f - (k % 3) * 2.0f, 0.0f, bmax[2] - 1.0f };
+			float nearest[3];
+			query->findNearestPoly(startPos, halfExtents, &filter, &req.startRef, nearest);
+			query->findNearestPoly(endPos, halfExtents, &filter, &req.endRef, nearest);
+			dtVcopy(req.startPos, startPos);
+			dtVcopy(req.endPos, endPos);
+			req.path = &paths[i * maxPath];
+			// Some of the requests are too small to hold the whole path.
+			req.maxPath = (i % 5) == 4 ? 3 : maxPath;
+		}
+	}
+};
+
+void requireSameAsFindPath(dtNavMeshQuery* query, const std::vector<dtPathRequest>& requests)
+{
+	dtQueryFilter filter;
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		const dtPathRequest& req = requests[i];
+		std::vector<dtPolyRef> path(req.maxPath);
+		int pathCount = 0;
+		const dtStatus status = query->findPath(req.startRef, req.endRef, req.startPos, req.endPos, &filter,
+												&path[0], &pathCount, req.maxPath);
+		REQUIRE(req.status == status);
+		REQUIRE(req.pathCount == pathCount);
+		for (int j = 0; j < pathCount; ++j)
+		{
+			REQUIRE(req.path[j] == path[j]);
+		}
+	}
+}
+}
+
+TEST_CASE("dtNavMeshQuery::findPaths")
+{
+	TestNavMesh geom(3, 3);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+	dtQueryFilter filter;
+
+	SECTION("Results match findPath")
+	{
+		PathRequests batch(query, geom, 64, 128);
+		REQUIRE(dtStatusSucceed(query->findPaths(&batch.requests[0], (int)batch.requests.size(), &filter)));
+		requireSameAsFindPath(query, batch.requests);
+
+		int buffersTooSmall = 0;
+		for (size_t i = 0; i < batch.requests.size(); ++i)
+		{
+			if (batch.requests[i].status & DT_BUFFER_TOO_SMALL)
+				buffersTooSmall++;
+		}
+		REQUIRE(buffersTooSmall > 0);
+	}
+
+	SECTION("Invalid requests fail individually")
+	{
+		PathRequests batch(query, geom, 4, 128);
+		batch.requests[1].startRef = 0;
+		REQUIRE(dtStatusSucceed(query->findPaths(&batch.requests[0], (int)batch.requests.size(), &filter)));
+		REQUIRE(dtStatusFailed(batch.requests[1].status));
+		REQUIRE(batch.requests[1].pathCount == 0);
+		REQUIRE(dtStatusSucceed(batch.requests[0].status));
+	}
+
+	SECTION("Invalid batch")
+	{
+		PathRequests batch(query, geom, 4, 128);
+		REQUIRE(dtStatusFailed(query->findPaths(&batch.requests[0], (int)batch.requests.size(), nullptr)));
+		REQUIRE(dtStatusFailed(query->findPaths(nullptr, 4, &filter)));
+		REQUIRE(dtStatusSucceed(query->findPaths(nullptr, 0, &filter)));
+	}
+
+	SECTION("Parallel batches match findPath")
+	{
+		const int workerCount = 4;
+		TestTaskDispatcher dispatcher(workerCount);
+		dtNavMeshQuery* queries[workerCount];
+		for (int i = 0; i < workerCount; ++i)
+		{
+			queries[i] = dtAllocNavMeshQuery();
+			REQUIRE(dtStatusSucceed(queries[i]->init(navMesh, 2048)));
+		}
+
+		PathRequests batch(query, geom, 100, 128);
+		REQUIRE(dtStatusSucceed(dtFindPaths(queries, &dispatcher, &batch.requests[0], (int)batch.requests.size(), &filter)));
+		requireSameAsFindPath(query, batch.requests);
+
+		// Every batch fails, the failure is reported once.
+		REQUIRE(dtFindPaths(queries, &dispatcher, &batch.requests[0], (int)batch.requests.size(), nullptr) ==
+				(DT_FAILURE | DT_INVALID_PARAM));
+
+		for (int i = 0; i < workerCount; ++i)
+			dtFreeNavMeshQuery(queries[i]);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
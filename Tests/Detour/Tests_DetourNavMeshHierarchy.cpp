@@ -0,0 +1,340 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshHierarchy.h"
+#include "DetourNavMeshQuery.h"
+#include "TestNavMesh.h"
+
+#include <string.h>
+#include <vector>
+
+namespace
+{
+bool isLinked(const dtNavMesh* navMesh, dtPolyRef from, dtPolyRef to)
+{
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	if (dtStatusFailed(navMesh->getTileAndPolyByRef(from, &tile, &poly)))
+		return false;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+void requireConnectedPath(const dtNavMesh* navMesh, const std::vector<dtPolyRef>& path, dtPolyRef startRef, dtPolyRef endRef)
+{
+	REQUIRE(!path.empty());
+	REQUIRE(path.front() == startRef);
+	REQUIRE(path.back() == endRef);
+	for (size_t i = 0; i + 1 < path.size(); ++i)
+	{
+		REQUIRE(isLinked(navMesh, path[i], path[i + 1]));
+	}
+}
+
+float getPathLength(dtNavMeshQuery* query, const float* startPos, const float* endPos, const std::vector<dtPolyRef>& path)
+{
+	std::vector<float> straightPath(3 * 256);
+	int straightPathCount = 0;
+	query->findStraightPath(startPos, endPos, &path[0], (int)path.size(), &straightPath[0], nullptr, nullptr,
+							&straightPathCount, 256);
+	float length = 0;
+	for (int i = 0; i + 1 < straightPathCount; ++i)
+		length += dtVdist(&straightPath[i * 3], &straightPath[(i + 1) * 3]);
+	return length;
+}
+
+bool hasPortalTo(const dtNavMesh* navMesh, const dtHierarchyCluster* cluster, dtTileRef tileRef)
+{
+	for (int i = 0; i < cluster->portalCount; ++i)
+	{
+		if (navMesh->decodePolyIdTile(cluster->portals[i].neiRef) == navMesh->decodePolyIdTile(tileRef))
+			return true;
+	}
+	return false;
+}
+
+/// Adds a tile of separate strips along x to @p navMesh, every strip ends in its own portal
+/// on the sides shared with the neighbour tiles.
+bool addStripTile(dtNavMesh* navMesh, int tx, int stripCount, int tileSize)
+{
+	std::vector<unsigned short> verts;
+	std::vector<unsigned short> polys;
+	for (int i = 0; i < stripCount; ++i)
+	{
+		const unsigned short z0 = (unsigned short)(i * 2);
+		const unsigned short z1 = (unsigned short)(i * 2 + 1);
+		const unsigned short x1 = (unsigned short)tileSize;
+		const unsigned short v[12] = { 0, 0, z0, 0, 0, z1, x1, 0, z1, x1, 0, z0 };
+		verts.insert(verts.end(), v, v + 12);
+		const unsigned short base = (unsigned short)(i * 4);
+		// Edge 0 is on the x- side and edge 2 on the x+ side of the tile.
+		const unsigned short poly[12] = {
+			base, (unsigned short)(base + 1), (unsigned short)(base + 2), (unsigned short)(base + 3), 0xffff, 0xffff,
+			(unsigned short)(tx > 0 ? 0x8000 : 0xffff), 0xffff, (unsigned short)(0x8000 | 2), 0xffff, 0xffff, 0xffff,
+		};
+		polys.insert(polys.end(), poly, poly + 12);
+	}
+	std::vector<unsigned short> flags(stripCount, 1);
+	std::vector<unsigned char> areas(stripCount, 0);
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = &verts[0];
+	params.vertCount = (int)verts.size() / 3;
+	params.polys = &polys[0];
+	params.polyFlags = &flags[0];
+	params.polyAreas = &areas[0];
+	params.polyCount = stripCount;
+	params.nvp = 6;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.6f;
+	params.walkableClimb = 0.9f;
+	params.tileX = tx;
+	params.bmin[0] = (float)(tx * tileSize);
+	params.bmax[0] = (float)((tx + 1) * tileSize);
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = (float)(stripCount * 2);
+	params.cs = 1.0f;
+	params.ch = 1.0f;
+	params.buildBvTree = true;
+
+	unsigned char* data = nullptr;
+	int dataSize = 0;
+	if (!dtCreateNavMeshData(&params, &data, &dataSize))
+		return false;
+	if (dtStatusFailed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+	{
+		dtFree(data);
+		return false;
+	}
+	return true;
+}
+}
+
+TEST_CASE("dtNavMeshHierarchy")
+{
+	TestNavMesh geom(4, 4);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	dtQueryFilter filter;
+	dtNavMeshHierarchy* hierarchy = dtAllocNavMeshHierarchy();
+	REQUIRE(dtStatusSucceed(hierarchy->init(navMesh, &filter, 512)));
+
+	float bmin[3], bmax[3];
+	geom.getBounds(bmin, bmax);
+	const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+	const float startPos[3] = { bmin[0] + 1.0f, 0.0f, bmin[2] + 1.0f };
+	const float endPos[3] = { bmax[0] - 1.0f, 0.0f, bmax[2] - 1.0f };
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	SECTION("Every tile has portals to its neighbours")
+	{
+		for (int ty = 0; ty < geom.tilesY; ++ty)
+		{
+			for (int tx = 0; tx < geom.tilesX; ++tx)
+			{
+				const dtHierarchyCluster* cluster = hierarchy->getCluster(navMesh->getTileRefAt(tx, ty, 0));
+				REQUIRE(cluster != nullptr);
+				REQUIRE(cluster->portalCount > 0);
+				// The walls are along z, so the tiles are always connected along z.
+				if (ty > 0)
+					REQUIRE(hasPortalTo(navMesh, cluster, navMesh->getTileRefAt(tx, ty - 1, 0)));
+			}
+		}
+	}
+
+	SECTION("Path is connected and close to the shortest path")
+	{
+		std::vector<dtPolyRef> path(256);
+		int pathCount = 0;
+		const dtStatus status = hierarchy->findPath(query, startRef, endRef, startPos, endPos, &path[0], &pathCount, 256);
+		REQUIRE(status == DT_SUCCESS);
+		path.resize(pathCount);
+		requireConnectedPath(navMesh, path, startRef, endRef);
+
+		std::vector<dtPolyRef> shortestPath(256);
+		int shortestPathCount = 0;
+		REQUIRE(query->findPath(startRef, endRef, startPos, endPos, &filter, &shortestPath[0], &shortestPathCount, 256) == DT_SUCCESS);
+		shortestPath.resize(shortestPathCount);
+
+		const float length = getPathLength(query, startPos, endPos, path);
+		const float shortestLength = getPathLength(query, startPos, endPos, shortestPath);
+		REQUIRE(length >= shortestLength * 0.999f);
+		REQUIRE(length <= shortestLength * 1.25f);
+	}
+
+	SECTION("Long paths fit a small node pool")
+	{
+		dtNavMeshQuery* smallQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(smallQuery->init(navMesh, 16)));
+
+		std::vector<dtPolyRef> path(256);
+		int pathCount = 0;
+		const dtStatus directStatus = smallQuery->findPath(startRef, endRef, startPos, endPos, &filter, &path[0], &pathCount, 256);
+		REQUIRE(dtStatusDetail(directStatus, DT_PARTIAL_RESULT));
+
+		REQUIRE(hierarchy->findPath(smallQuery, startRef, endRef, startPos, endPos, &path[0], &pathCount, 256) == DT_SUCCESS);
+		path.resize(pathCount);
+		requireConnectedPath(navMesh, path, startRef, endRef);
+
+		dtFreeNavMeshQuery(smallQuery);
+	}
+
+	SECTION("Path buffer too small")
+	{
+		std::vector<dtPolyRef> path(5);
+		int pathCount = 0;
+		const dtStatus status = hierarchy->findPath(query, startRef, endRef, startPos, endPos, &path[0], &pathCount, 5);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		REQUIRE(pathCount == 5);
+		path.resize(pathCount);
+		REQUIRE(path.front() == startRef);
+		for (size_t i = 0; i + 1 < path.size(); ++i)
+		{
+			REQUIRE(isLinked(navMesh, path[i], path[i + 1]));
+		}
+	}
+
+	SECTION("Invalid arguments")
+	{
+		dtPolyRef path[16];
+		int pathCount = 0;
+		REQUIRE(dtStatusFailed(hierarchy->findPath(nullptr, startRef, endRef, startPos, endPos, path, &pathCount, 16)));
+		REQUIRE(dtStatusFailed(hierarchy->findPath(query, 0, endRef, startPos, endPos, path, &pathCount, 16)));
+		REQUIRE(dtStatusFailed(hierarchy->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, 0)));
+		REQUIRE(dtStatusFailed(hierarchy->addTile(0)));
+
+		dtNavMeshHierarchy* other = dtAllocNavMeshHierarchy();
+		REQUIRE(dtStatusFailed(other->init(navMesh, nullptr, 512)));
+		REQUIRE(dtStatusFailed(other->init(navMesh, &filter, 0)));
+		dtFreeNavMeshHierarchy(other);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMeshHierarchy(hierarchy);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtNavMeshHierarchy tile streaming")
+{
+	TestNavMesh geom(4, 4, false);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	dtQueryFilter filter;
+	dtNavMeshHierarchy* hierarchy = dtAllocNavMeshHierarchy();
+	REQUIRE(dtStatusSucceed(hierarchy->init(navMesh, &filter, 512)));
+
+	float bmin[3], bmax[3];
+	geom.getBounds(bmin, bmax);
+	const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+	const float startPos[3] = { bmin[0] + 1.0f, 0.0f, bmin[2] + 1.0f };
+	const float endPos[3] = { bmax[0] - 1.0f, 0.0f, bmax[2] - 1.0f };
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	SECTION("Clusters follow added and removed tiles")
+	{
+		const dtTileRef tileRef = navMesh->getTileRefAt(1, 1, 0);
+		const dtTileRef neighbourRef = navMesh->getTileRefAt(2, 1, 0);
+		REQUIRE(dtStatusSucceed(navMesh->removeTile(tileRef, nullptr, nullptr)));
+		REQUIRE(dtStatusSucceed(hierarchy->removeTile(tileRef)));
+		REQUIRE(hierarchy->getCluster(tileRef) == nullptr);
+		REQUIRE_FALSE(hasPortalTo(navMesh, hierarchy->getCluster(neighbourRef), tileRef));
+		REQUIRE(dtStatusFailed(hierarchy->removeTile(tileRef)));
+
+		// The path goes around the hole.
+		std::vector<dtPolyRef> path(256);
+		int pathCount = 0;
+		REQUIRE(hierarchy->findPath(query, startRef, endRef, startPos, endPos, &path[0], &pathCount, 256) == DT_SUCCESS);
+		path.resize(pathCount);
+		requireConnectedPath(navMesh, path, startRef, endRef);
+		for (size_t i = 0; i < path.size(); ++i)
+		{
+			REQUIRE(navMesh->decodePolyIdTile(path[i]) != navMesh->decodePolyIdTile(tileRef));
+		}
+
+		rcContext ctx(false);
+		int dataSize = 0;
+		unsigned char* data = geom.buildTile(&ctx, 1, 1, &dataSize);
+		REQUIRE(data != nullptr);
+		dtTileRef newRef = 0;
+		REQUIRE(dtStatusSucceed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &newRef)));
+		REQUIRE(dtStatusSucceed(hierarchy->addTile(newRef)));
+		REQUIRE(hierarchy->getCluster(newRef) != nullptr);
+		REQUIRE(hasPortalTo(navMesh, hierarchy->getCluster(newRef), neighbourRef));
+		REQUIRE(hasPortalTo(navMesh, hierarchy->getCluster(neighbourRef), newRef));
+	}
+
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMeshHierarchy(hierarchy);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtNavMeshHierarchy with many portals per tile")
+{
+	static const int STRIP_COUNT = 300;
+	static const int TILE_SIZE = 4;
+
+	dtNavMesh* navMesh = dtAllocNavMesh();
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = (float)TILE_SIZE;
+	params.tileHeight = (float)(STRIP_COUNT * 2);
+	params.maxTiles = 2;
+	params.maxPolys = 512;
+	REQUIRE(dtStatusSucceed(navMesh->init(&params)));
+	REQUIRE(addStripTile(navMesh, 0, STRIP_COUNT, TILE_SIZE));
+	REQUIRE(addStripTile(navMesh, 1, STRIP_COUNT, TILE_SIZE));
+
+	dtQueryFilter filter;
+	dtNavMeshHierarchy* hierarchy = dtAllocNavMeshHierarchy();
+	REQUIRE(dtStatusSucceed(hierarchy->init(navMesh, &filter, 512)));
+	const dtHierarchyCluster* cluster = hierarchy->getCluster(navMesh->getTileRefAt(0, 0, 0));
+	REQUIRE(cluster != nullptr);
+	REQUIRE(cluster->portalCount == STRIP_COUNT);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	// The last strip is only reachable through the last portal.
+	const float halfExtents[3] = { 0.2f, 1.0f, 0.2f };
+	const float startPos[3] = { 1.0f, 0.0f, STRIP_COUNT * 2 - 1.5f };
+	const float endPos[3] = { TILE_SIZE * 2 - 1.0f, 0.0f, STRIP_COUNT * 2 - 1.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+	REQUIRE(navMesh->decodePolyIdTile(startRef) != navMesh->decodePolyIdTile(endRef));
+
+	std::vector<dtPolyRef> path(16);
+	int pathCount = 0;
+	REQUIRE(hierarchy->findPath(query, startRef, endRef, startPos, endPos, &path[0], &pathCount, 16) == DT_SUCCESS);
+	path.resize(pathCount);
+	requireConnectedPath(navMesh, path, startRef, endRef);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMeshHierarchy(hierarchy);
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,100 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMeshSet.h"
+#include "TestNavMesh.h"
+
+#include <string.h>
+#include <vector>
+
+TEST_CASE("dtStoreNavMeshSet and dtLoadNavMeshSet")
+{
+	TestNavMesh geom(3, 3);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	const int alignment = DT_NAVMESH_SET_ALIGNMENT;
+	const size_t size = dtGetNavMeshSetSize(navMesh, alignment);
+	REQUIRE(size > 0);
+	REQUIRE(size % alignment == 0);
+
+	// Over-allocate, so that the set can start at an aligned address like a memory mapped file.
+	std::vector<unsigned char> buffer(size + alignment);
+	unsigned char* data = &buffer[0] + (alignment - (size_t)&buffer[0] % alignment) % alignment;
+	REQUIRE(dtStatusSucceed(dtStoreNavMeshSet(navMesh, alignment, data, size)));
+
+	const dtNavMeshSetHeader* header = (const dtNavMeshSetHeader*)data;
+	REQUIRE(header->magic == DT_NAVMESH_SET_MAGIC);
+	REQUIRE(header->version == DT_NAVMESH_SET_VERSION);
+	REQUIRE(header->tileCount == geom.tilesX * geom.tilesY);
+
+	SECTION("Loaded tiles use the set data in place")
+	{
+		dtNavMesh* loaded = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(dtLoadNavMeshSet(loaded, data, size)));
+
+		const dtNavMeshSetTile* entries = (const dtNavMeshSetTile*)(data + sizeof(dtNavMeshSetHeader));
+		for (int i = 0; i < header->tileCount; ++i)
+		{
+			const dtMeshTile* tile = loaded->getTileByRef(entries[i].tileRef);
+			REQUIRE(tile != nullptr);
+			REQUIRE(tile->data == data + (size_t)entries[i].dataPage * alignment);
+			REQUIRE(tile->flags == 0);
+			REQUIRE(navMesh->getTileByRef(entries[i].tileRef)->header->polyCount == tile->header->polyCount);
+		}
+
+		// Paths are the same as on the original navmesh.
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		dtNavMeshQuery* loadedQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+		REQUIRE(dtStatusSucceed(loadedQuery->init(loaded, 2048)));
+
+		float bmin[3], bmax[3];
+		geom.getBounds(bmin, bmax);
+		const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+		const float startPos[3] = { bmin[0] + 1.0f, 0.0f, bmin[2] + 1.0f };
+		const float endPos[3] = { bmax[0] - 1.0f, 0.0f, bmax[2] - 1.0f };
+		dtQueryFilter filter;
+		dtPolyRef startRef = 0, endRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+		dtPolyRef path[256];
+		dtPolyRef loadedPath[256];
+		int pathCount = 0;
+		int loadedPathCount = 0;
+		REQUIRE(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256) == DT_SUCCESS);
+		REQUIRE(loadedQuery->findPath(startRef, endRef, startPos, endPos, &filter, loadedPath, &loadedPathCount, 256) == DT_SUCCESS);
+		REQUIRE(pathCount == loadedPathCount);
+		REQUIRE(memcmp(path, loadedPath, sizeof(dtPolyRef) * pathCount) == 0);
+
+		dtFreeNavMeshQuery(loadedQuery);
+		dtFreeNavMeshQuery(query);
+		// The set data is not freed by the navmesh.
+		dtFreeNavMesh(loaded);
+	}
+
+	SECTION("Invalid sets are rejected")
+	{
+		dtNavMesh* loaded = dtAllocNavMesh();
+		REQUIRE(dtStatusFailed(dtLoadNavMeshSet(loaded, data, sizeof(dtNavMeshSetHeader) - 1)));
+		REQUIRE(dtStatusFailed(dtLoadNavMeshSet(loaded, data, size - alignment)));
+		REQUIRE(dtStatusFailed(dtLoadNavMeshSet(loaded, data + 1, size - 1)));
+		dtFreeNavMesh(loaded);
+
+		dtNavMeshSetHeader* editableHeader = (dtNavMeshSetHeader*)data;
+		editableHeader->version = 1;
+		loaded = dtAllocNavMesh();
+		REQUIRE(dtLoadNavMeshSet(loaded, data, size) == (DT_FAILURE | DT_WRONG_VERSION));
+		dtFreeNavMesh(loaded);
+
+		REQUIRE(dtStatusFailed(dtStoreNavMeshSet(navMesh, alignment, data, size - 1)));
+		REQUIRE(dtStatusFailed(dtStoreNavMeshSet(navMesh, 100, data, size)));
+		REQUIRE(dtGetNavMeshSetSize(navMesh, 100) == 0);
+	}
+
+	dtFreeNavMesh(navMesh);
+}
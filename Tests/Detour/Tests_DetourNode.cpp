@@ -0,0 +1,86 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNode.h"
+
+TEST_CASE("dtNodePool")
+{
+	const int maxNodes = 1024;
+	dtNodePool pool(maxNodes, dtNextPow2(maxNodes / 4));
+
+	SECTION("Nodes are found by reference and state")
+	{
+		dtNode* a = pool.getNode(100, 0);
+		dtNode* b = pool.getNode(100, 1);
+		dtNode* c = pool.getNode(200);
+		REQUIRE(a != nullptr);
+		REQUIRE(b != nullptr);
+		REQUIRE(c != nullptr);
+		REQUIRE(a != b);
+		REQUIRE(a->id == 100);
+		REQUIRE(b->state == 1);
+		REQUIRE(pool.getNodeCount() == 3);
+
+		REQUIRE(pool.getNode(100, 0) == a);
+		REQUIRE(pool.findNode(100, 1) == b);
+		REQUIRE(pool.findNode(200, 0) == c);
+		REQUIRE(pool.findNode(200, 1) == nullptr);
+		REQUIRE(pool.findNode(300, 0) == nullptr);
+
+		dtNode* nodes[DT_MAX_STATES_PER_NODE];
+		REQUIRE(pool.findNodes(100, nodes, DT_MAX_STATES_PER_NODE) == 2);
+		REQUIRE(((nodes[0] == a && nodes[1] == b) || (nodes[0] == b && nodes[1] == a)));
+		REQUIRE(pool.findNodes(100, nodes, 1) == 1);
+
+		REQUIRE(pool.getNodeAtIdx(pool.getNodeIdx(b)) == b);
+		REQUIRE(pool.getNodeAtIdx(0) == nullptr);
+	}
+
+	SECTION("Pool is full")
+	{
+		for (int i = 0; i < maxNodes; ++i)
+			REQUIRE(pool.getNode((dtPolyRef)(i * 7 + 1)) != nullptr);
+		REQUIRE(pool.getNode(3) == nullptr);
+		REQUIRE(pool.getNode(8) != nullptr);
+		for (int i = 0; i < maxNodes; ++i)
+			REQUIRE(pool.findNode((dtPolyRef)(i * 7 + 1), 0)->id == (dtPolyRef)(i * 7 + 1));
+	}
+
+	SECTION("Cleared pool is empty")
+	{
+		// Both small and large searches.
+		const int counts[] = { 5, maxNodes };
+		for (int c = 0; c < 2; ++c)
+		{
+			for (int i = 0; i < counts[c]; ++i)
+				pool.getNode((dtPolyRef)(i * 13 + 1), (unsigned char)(i & 3));
+			pool.clear();
+			REQUIRE(pool.getNodeCount() == 0);
+			for (int i = 0; i < counts[c]; ++i)
+				REQUIRE(pool.findNode((dtPolyRef)(i * 13 + 1), (unsigned char)(i & 3)) == nullptr);
+
+			dtNode* node = pool.getNode(1, 0);
+			REQUIRE(node == pool.getNodeAtIdx(1));
+			REQUIRE(pool.findNode(1, 0) == node);
+			pool.clear();
+		}
+	}
+}
+
+#ifdef DT_OPEN_ADDRESSING_NODE_POOL
+TEST_CASE("dtNodePool with more than 65535 nodes")
+{
+	const int maxNodes = 100000;
+	dtNodePool pool(maxNodes, dtNextPow2(maxNodes / 4));
+	for (int i = 0; i < maxNodes; ++i)
+	{
+		dtNode* node = pool.getNode((dtPolyRef)(i + 1));
+		REQUIRE(node != nullptr);
+		node->pidx = pool.getNodeIdx(node);
+	}
+	REQUIRE(pool.getNode((dtPolyRef)(maxNodes + 1)) == nullptr);
+	const dtNode* last = pool.findNode((dtPolyRef)maxNodes, 0);
+	REQUIRE(last != nullptr);
+	REQUIRE(pool.getNodeAtIdx(last->pidx) == last);
+}
+#endif
@@ -0,0 +1,190 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "TestNavMesh.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+float frand()
+{
+	return (float)(rand() % 10000) / 10000.0f;
+}
+
+/// The default filter logic, in a class which does not derive from dtQueryFilter.
+struct AreaCostFilter
+{
+	float areaCost[DT_MAX_AREAS];
+	unsigned short includeFlags;
+	unsigned short excludeFlags;
+
+	AreaCostFilter() : includeFlags(0xffff), excludeFlags(0)
+	{
+		for (int i = 0; i < DT_MAX_AREAS; ++i)
+			areaCost[i] = 1.0f;
+	}
+
+	bool passFilter(const dtPolyRef, const dtMeshTile*, const dtPoly* poly) const
+	{
+		return (poly->flags & includeFlags) != 0 && (poly->flags & excludeFlags) == 0;
+	}
+
+	float getCost(const float* pa, const float* pb,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly* curPoly,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*) const
+	{
+		return dtVdist(pa, pb) * areaCost[curPoly->getArea()];
+	}
+};
+
+/// Blocks a single polygon. Only overrides passFilter of dtQueryFilter when DT_VIRTUAL_QUERYFILTER is defined,
+/// otherwise it hides it, and the queries use the functions of dtQueryFilter.
+struct BlockingFilter : public dtQueryFilter
+{
+	dtPolyRef blocked;
+
+	explicit BlockingFilter(dtPolyRef blocked_) : blocked(blocked_) {}
+
+	bool passFilter(const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly) const
+	{
+		return ref != blocked && dtQueryFilter::passFilter(ref, tile, poly);
+	}
+};
+
+bool contains(const dtPolyRef* refs, int count, dtPolyRef ref)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (refs[i] == ref)
+			return true;
+	}
+	return false;
+}
+}
+
+TEST_CASE("Templated queries with a custom filter")
+{
+	TestNavMesh geom(3, 2);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	static const int MAX_PATH = 256;
+	dtQueryFilter filter;
+	filter.setAreaCost(0, 1.5f);
+	AreaCostFilter areaFilter;
+	areaFilter.areaCost[0] = 1.5f;
+	srand(5);
+
+	SECTION("A filter with the default logic gives the same results")
+	{
+		for (int iter = 0; iter < 100; ++iter)
+		{
+			dtPolyRef startRef = 0, endRef = 0;
+			float startPos[3], endPos[3];
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &startRef, startPos)));
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &endRef, endPos)));
+
+			dtPolyRef path[MAX_PATH], customPath[MAX_PATH];
+			int pathCount = 0, customPathCount = 0;
+			const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH);
+			const dtStatus customStatus = query->findPath(startRef, endRef, startPos, endPos, &areaFilter, customPath, &customPathCount, MAX_PATH);
+			REQUIRE(status == customStatus);
+			REQUIRE(pathCount == customPathCount);
+			REQUIRE(memcmp(path, customPath, sizeof(dtPolyRef) * pathCount) == 0);
+
+			dtPolyRef refs[MAX_PATH], customRefs[MAX_PATH];
+			dtPolyRef parents[MAX_PATH], customParents[MAX_PATH];
+			float costs[MAX_PATH], customCosts[MAX_PATH];
+			int count = 0, customCount = 0;
+			const float radius = 2.0f + frand() * 8.0f;
+			REQUIRE(query->findPolysAroundCircle(startRef, startPos, radius, &filter, refs, parents, costs, &count, MAX_PATH) ==
+					query->findPolysAroundCircle(startRef, startPos, radius, &areaFilter, customRefs, customParents, customCosts, &customCount, MAX_PATH));
+			REQUIRE(count == customCount);
+			REQUIRE(memcmp(refs, customRefs, sizeof(dtPolyRef) * count) == 0);
+			REQUIRE(memcmp(parents, customParents, sizeof(dtPolyRef) * count) == 0);
+			REQUIRE(memcmp(costs, customCosts, sizeof(float) * count) == 0);
+
+			dtRaycastHit hit, customHit;
+			memset(&hit, 0, sizeof(hit));
+			memset(&customHit, 0, sizeof(customHit));
+			hit.path = path;
+			hit.maxPath = MAX_PATH;
+			customHit.path = customPath;
+			customHit.maxPath = MAX_PATH;
+			REQUIRE(query->raycast(startRef, startPos, endPos, &filter, DT_RAYCAST_USE_COSTS, &hit) ==
+					query->raycast(startRef, startPos, endPos, &areaFilter, DT_RAYCAST_USE_COSTS, &customHit));
+			REQUIRE(hit.t == customHit.t);
+			REQUIRE(hit.pathCost == customHit.pathCost);
+			REQUIRE(hit.hitEdgeIndex == customHit.hitEdgeIndex);
+			REQUIRE(hit.pathCount == customHit.pathCount);
+			REQUIRE(memcmp(path, customPath, sizeof(dtPolyRef) * hit.pathCount) == 0);
+		}
+	}
+
+	SECTION("All queries use the same functions of a derived filter")
+	{
+#ifdef DT_VIRTUAL_QUERYFILTER
+		const bool blocks = true;
+#else
+		const bool blocks = false;
+#endif
+		STATIC_REQUIRE(dtHidesQueryFilter<BlockingFilter>::value == !blocks);
+		STATIC_REQUIRE(dtHidesQueryFilter<AreaCostFilter>::value == 0);
+		STATIC_REQUIRE(dtHidesQueryFilter<dtQueryFilter>::value == 0);
+
+		int checked = 0;
+		for (int iter = 0; iter < 1000 && checked < 20; ++iter)
+		{
+			dtPolyRef startRef = 0, endRef = 0;
+			float startPos[3], endPos[3];
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &startRef, startPos)));
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, frand, &endRef, endPos)));
+			dtVlerp(endPos, startPos, endPos, 0.2f);
+
+			// Find a short ray crossing a few polygons, and block the second one.
+			dtPolyRef path[MAX_PATH];
+			dtRaycastHit hit;
+			memset(&hit, 0, sizeof(hit));
+			hit.path = path;
+			hit.maxPath = MAX_PATH;
+			REQUIRE(dtStatusSucceed(query->raycast(startRef, startPos, endPos, &filter, 0, &hit)));
+			if (hit.t != FLT_MAX || hit.pathCount < 3)
+				continue;
+			endRef = path[hit.pathCount - 1];
+			const BlockingFilter blockingFilter(path[1]);
+			++checked;
+
+			// The templated and the dtQueryFilter overloads agree.
+			const dtQueryFilter* baseFilter = &blockingFilter;
+			dtRaycastHit baseHit;
+			memset(&baseHit, 0, sizeof(baseHit));
+			REQUIRE(dtStatusSucceed(query->raycast(startRef, startPos, endPos, &blockingFilter, 0, &hit)));
+			REQUIRE(dtStatusSucceed(query->raycast(startRef, startPos, endPos, baseFilter, 0, &baseHit)));
+			REQUIRE((hit.t < 1.0f) == blocks);
+			REQUIRE(hit.t == baseHit.t);
+
+			int pathCount = 0;
+			REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &blockingFilter, path, &pathCount, MAX_PATH)));
+			REQUIRE(pathCount > 0);
+			REQUIRE(contains(path, pathCount, blockingFilter.blocked) == !blocks);
+
+			int count = 0;
+			REQUIRE(dtStatusSucceed(query->findPolysAroundCircle(startRef, startPos, 5.0f, &blockingFilter, path, 0, 0, &count, MAX_PATH)));
+			REQUIRE(contains(path, count, blockingFilter.blocked) == !blocks);
+		}
+		REQUIRE(checked > 0);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,188 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "TestNavMesh.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+float frand()
+{
+	return (float)(rand() % 10000) / 10000.0f;
+}
+
+struct RaycastRequests
+{
+	static const int MAX_PATH = 16;
+
+	std::vector<dtRaycastRequest> requests;
+	std::vector<dtPolyRef> paths;
+
+	RaycastRequests(dtNavMeshQuery* query, int count) : requests(count), paths(count * MAX_PATH)
+	{
+		dtQueryFilter filter;
+		srand(9);
+		for (int i = 0; i < count; ++i)
+		{
+			dtRaycastRequest& req = requests[i];
+			memset(&req, 0, sizeof(req));
+			// Fans of rays from the same start, like visibility checks from an agent to its neighbours.
+			if (i % 8 == 0)
+			{
+				query->findRandomPoint(&filter, frand, &req.startRef, req.startPos);
+			}
+			else
+			{
+				req.startRef = requests[i - 1].startRef;
+				dtVcopy(req.startPos, requests[i - 1].startPos);
+			}
+			dtPolyRef endRef = 0;
+			query->findRandomPoint(&filter, frand, &endRef, req.endPos);
+			// Some of the rays are short and end inside the polygons.
+			if (i % 3 == 0)
+				dtVlerp(req.endPos, req.startPos, req.endPos, 0.05f);
+			req.hit.path = &paths[i * MAX_PATH];
+			// Some of the paths are too small.
+			req.hit.maxPath = (i % 5) == 4 ? 2 : MAX_PATH;
+		}
+	}
+};
+
+void requireSameAsRaycast(dtNavMeshQuery* query, const std::vector<dtRaycastRequest>& requests, const unsigned int options)
+{
+	dtQueryFilter filter;
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		const dtRaycastRequest& req = requests[i];
+		std::vector<dtPolyRef> path(req.hit.maxPath);
+		dtRaycastHit hit;
+		memset(&hit, 0, sizeof(hit));
+		hit.path = &path[0];
+		hit.maxPath = req.hit.maxPath;
+		const dtStatus status = query->raycast(req.startRef, req.startPos, req.endPos, &filter, options, &hit, req.prevRef);
+		REQUIRE(req.status == status);
+		REQUIRE(req.hit.t == hit.t);
+		REQUIRE(req.hit.pathCount == hit.pathCount);
+		REQUIRE(req.hit.pathCost == hit.pathCost);
+		for (int j = 0; j < hit.pathCount; ++j)
+			REQUIRE(req.hit.path[j] == path[j]);
+		if (dtStatusSucceed(status) && hit.pathCount > 0)
+		{
+			REQUIRE(req.hit.hitEdgeIndex == hit.hitEdgeIndex);
+			REQUIRE(dtVequal(req.hit.hitNormal, hit.hitNormal));
+		}
+	}
+}
+}
+
+TEST_CASE("dtIntersectSegmentPoly2D4")
+{
+	const float verts[6 * 3] = {
+		0.0f, 0.0f, 0.0f,
+		2.0f, 0.0f, -1.0f,
+		4.0f, 0.0f, 0.0f,
+		4.0f, 0.0f, 2.0f,
+		2.0f, 0.0f, 3.0f,
+		0.0f, 0.0f, 2.0f,
+	};
+
+	srand(13);
+	for (int iter = 0; iter < 2000; ++iter)
+	{
+		float p0x[4], p0z[4], p1x[4], p1z[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			p0x[i] = (float)(rand() % 70) / 10.0f - 1.5f;
+			p0z[i] = (float)(rand() % 60) / 10.0f - 1.5f;
+			p1x[i] = (float)(rand() % 70) / 10.0f - 1.5f;
+			p1z[i] = (float)(rand() % 60) / 10.0f - 1.5f;
+			// Include segments parallel to the edges and degenerate segments.
+			if (iter % 5 == 0)
+				p1x[i] = p0x[i];
+			if (iter % 7 == 0)
+				p1z[i] = p0z[i];
+		}
+
+		float tmin[4], tmax[4];
+		int segMin[4], segMax[4];
+		const unsigned int mask = dtIntersectSegmentPoly2D4(p0x, p0z, p1x, p1z, verts, 6, tmin, tmax, segMin, segMax);
+		for (int i = 0; i < 4; ++i)
+		{
+			const float p0[3] = { p0x[i], 0.0f, p0z[i] };
+			const float p1[3] = { p1x[i], 0.0f, p1z[i] };
+			float t0, t1;
+			int s0, s1;
+			const bool hit = dtIntersectSegmentPoly2D(p0, p1, verts, 6, t0, t1, s0, s1);
+			REQUIRE(((mask >> i) & 1) == (unsigned int)hit);
+			if (hit)
+			{
+				REQUIRE(tmin[i] == t0);
+				REQUIRE(tmax[i] == t1);
+				REQUIRE(segMin[i] == s0);
+				REQUIRE(segMax[i] == s1);
+			}
+		}
+	}
+}
+
+TEST_CASE("dtNavMeshQuery::raycasts")
+{
+	TestNavMesh geom(3, 2);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 256)));
+	dtQueryFilter filter;
+
+	RaycastRequests batch(query, 400);
+
+	SECTION("The results are the same as casting the rays one by one")
+	{
+		REQUIRE(query->raycasts(&batch.requests[0], (int)batch.requests.size(), &filter, 0) == DT_SUCCESS);
+		requireSameAsRaycast(query, batch.requests, 0);
+
+		int walls = 0;
+		for (size_t i = 0; i < batch.requests.size(); ++i)
+		{
+			if (batch.requests[i].hit.t < 1.0f)
+				walls++;
+		}
+		REQUIRE(walls > 0);
+		REQUIRE(walls < (int)batch.requests.size());
+	}
+
+	SECTION("The costs are the same as casting the rays one by one")
+	{
+		// The parent polygon only affects the cost, so any polygon will do.
+		for (size_t i = 1; i < batch.requests.size(); i += 2)
+			batch.requests[i].prevRef = batch.requests[i - 1].startRef;
+		REQUIRE(query->raycasts(&batch.requests[0], (int)batch.requests.size(), &filter, DT_RAYCAST_USE_COSTS) == DT_SUCCESS);
+		requireSameAsRaycast(query, batch.requests, DT_RAYCAST_USE_COSTS);
+	}
+
+	SECTION("Invalid requests fail on their own")
+	{
+		batch.requests[5].startRef = 0;
+		batch.requests[6].endPos[0] = FLT_MAX * 2.0f;
+		REQUIRE(query->raycasts(&batch.requests[0], (int)batch.requests.size(), &filter, 0) == DT_SUCCESS);
+		REQUIRE(batch.requests[5].status == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(batch.requests[6].status == (DT_FAILURE | DT_INVALID_PARAM));
+		requireSameAsRaycast(query, batch.requests, 0);
+	}
+
+	SECTION("Invalid batches fail")
+	{
+		REQUIRE(query->raycasts(&batch.requests[0], -1, &filter, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->raycasts(&batch.requests[0], 1, nullptr, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->raycasts(nullptr, 0, &filter, 0) == DT_SUCCESS);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,227 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+/// A single tile of quads on a grid, with bumps so that the polygons have different heights.
+struct GridTile
+{
+	static const int SIZE = 40;
+
+	std::vector<unsigned short> verts;
+	std::vector<unsigned short> polys;
+	std::vector<unsigned short> flags;
+	std::vector<unsigned char> areas;
+
+	GridTile()
+	{
+		for (int z = 0; z <= SIZE; ++z)
+		{
+			for (int x = 0; x <= SIZE; ++x)
+			{
+				verts.push_back((unsigned short)x);
+				verts.push_back((unsigned short)((x * 7 + z * 3) % 5));
+				verts.push_back((unsigned short)z);
+			}
+		}
+		for (int z = 0; z < SIZE; ++z)
+		{
+			for (int x = 0; x < SIZE; ++x)
+			{
+				const unsigned short v = (unsigned short)(z * (SIZE + 1) + x);
+				const unsigned short poly[12] = {
+					v, (unsigned short)(v + SIZE + 1), (unsigned short)(v + SIZE + 2), (unsigned short)(v + 1), 0xffff, 0xffff,
+					0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+				};
+				polys.insert(polys.end(), poly, poly + 12);
+				flags.push_back(1);
+				areas.push_back(0);
+			}
+		}
+	}
+
+	dtNavMesh* createNavMesh(bool wideBvTree) const
+	{
+		dtNavMeshCreateParams params;
+		memset(&params, 0, sizeof(params));
+		params.verts = &verts[0];
+		params.vertCount = (int)verts.size() / 3;
+		params.polys = &polys[0];
+		params.polyFlags = &flags[0];
+		params.polyAreas = &areas[0];
+		params.polyCount = (int)flags.size();
+		params.nvp = 6;
+		params.walkableHeight = 2.0f;
+		params.walkableRadius = 0.6f;
+		params.walkableClimb = 0.9f;
+		params.bmax[0] = (float)SIZE;
+		params.bmax[1] = 5.0f;
+		params.bmax[2] = (float)SIZE;
+		params.cs = 1.0f;
+		params.ch = 1.0f;
+		params.buildBvTree = true;
+		params.buildWideBvTree = wideBvTree;
+
+		unsigned char* data = 0;
+		int dataSize = 0;
+		if (!dtCreateNavMeshData(&params, &data, &dataSize))
+			return 0;
+		dtNavMesh* navMesh = dtAllocNavMesh();
+		if (!navMesh || dtStatusFailed(navMesh->init(data, dataSize, DT_TILE_FREE_DATA)))
+		{
+			dtFree(data);
+			dtFreeNavMesh(navMesh);
+			return 0;
+		}
+		return navMesh;
+	}
+};
+
+unsigned short randomQuant(int range)
+{
+	return (unsigned short)(rand() % range);
+}
+}
+
+TEST_CASE("dtOverlapQuantBounds4")
+{
+	srand(7);
+	for (int iter = 0; iter < 1000; ++iter)
+	{
+		// Use the full range, as the SIMD test compares the values as unsigned.
+		const int range = iter % 2 ? 0x10000 : 16;
+		unsigned short amin[3], amax[3];
+		unsigned short bmin[3][4], bmax[3][4];
+		for (int k = 0; k < 3; ++k)
+		{
+			amin[k] = randomQuant(range);
+			amax[k] = (unsigned short)dtMin(amin[k] + randomQuant(range), range - 1);
+			for (int j = 0; j < 4; ++j)
+			{
+				bmin[k][j] = randomQuant(range);
+				bmax[k][j] = (unsigned short)dtMin(bmin[k][j] + randomQuant(range), range - 1);
+			}
+		}
+
+		const unsigned int mask = dtOverlapQuantBounds4(amin, amax, bmin, bmax);
+		for (int j = 0; j < 4; ++j)
+		{
+			const unsigned short boxMin[3] = { bmin[0][j], bmin[1][j], bmin[2][j] };
+			const unsigned short boxMax[3] = { bmax[0][j], bmax[1][j], bmax[2][j] };
+			REQUIRE(((mask >> j) & 1) == (unsigned int)dtOverlapQuantBounds(amin, amax, boxMin, boxMax));
+		}
+	}
+}
+
+TEST_CASE("Wide bounding volume trees")
+{
+	GridTile grid;
+	dtNavMesh* binaryMesh = grid.createNavMesh(false);
+	dtNavMesh* wideMesh = grid.createNavMesh(true);
+	REQUIRE(binaryMesh != nullptr);
+	REQUIRE(wideMesh != nullptr);
+
+	const dtMeshTile* binaryTile = ((const dtNavMesh*)binaryMesh)->getTile(0);
+	const dtMeshTile* wideTile = ((const dtNavMesh*)wideMesh)->getTile(0);
+
+	SECTION("The tile stores four-wide nodes")
+	{
+		REQUIRE(binaryTile->header->flags == 0);
+		REQUIRE(binaryTile->bvTree != nullptr);
+		REQUIRE(binaryTile->bvWideTree == nullptr);
+
+		REQUIRE(wideTile->header->flags == DT_MESH_HEADER_WIDE_BVTREE);
+		REQUIRE(wideTile->bvTree == nullptr);
+		REQUIRE(wideTile->bvWideTree != nullptr);
+		REQUIRE(wideTile->header->bvNodeCount > 0);
+		REQUIRE(wideTile->header->bvNodeCount < binaryTile->header->polyCount / 2);
+
+		// Every polygon is a leaf of the tree exactly once.
+		std::vector<int> leafCount(wideTile->header->polyCount, 0);
+		for (int i = 0; i < wideTile->header->bvNodeCount; ++i)
+		{
+			const dtBVWideNode& node = wideTile->bvWideTree[i];
+			for (int j = 0; j < 4; ++j)
+			{
+				if (node.child[j] < 0)
+					leafCount[-1 - node.child[j]]++;
+				else
+					REQUIRE(node.child[j] < wideTile->header->bvNodeCount);
+			}
+		}
+		for (int i = 0; i < wideTile->header->polyCount; ++i)
+			REQUIRE(leafCount[i] == 1);
+	}
+
+	SECTION("Queries find the same polygons in the same order")
+	{
+		dtNavMeshQuery* binaryQuery = dtAllocNavMeshQuery();
+		dtNavMeshQuery* wideQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(binaryQuery->init(binaryMesh, 256)));
+		REQUIRE(dtStatusSucceed(wideQuery->init(wideMesh, 256)));
+
+		dtQueryFilter filter;
+		srand(11);
+		for (int iter = 0; iter < 500; ++iter)
+		{
+			const float center[3] = {
+				(float)(rand() % 4400) / 100.0f - 2.0f,
+				(float)(rand() % 700) / 100.0f - 1.0f,
+				(float)(rand() % 4400) / 100.0f - 2.0f,
+			};
+			const float halfExtents[3] = {
+				(float)(rand() % 600) / 100.0f,
+				(float)(rand() % 300) / 100.0f,
+				(float)(rand() % 600) / 100.0f,
+			};
+
+			static const int MAX_POLYS = 256;
+			dtPolyRef binaryPolys[MAX_POLYS];
+			dtPolyRef widePolys[MAX_POLYS];
+			int binaryCount = 0;
+			int wideCount = 0;
+			REQUIRE(dtStatusSucceed(binaryQuery->queryPolygons(center, halfExtents, &filter, binaryPolys, &binaryCount, MAX_POLYS)));
+			REQUIRE(dtStatusSucceed(wideQuery->queryPolygons(center, halfExtents, &filter, widePolys, &wideCount, MAX_POLYS)));
+			// The binary tree stores one node more than it uses, which repeats the first polygon near the tile origin.
+			if (binaryCount == wideCount + 1 && binaryPolys[binaryCount - 1] == binaryMesh->getPolyRefBase(binaryTile))
+				binaryCount--;
+			REQUIRE(binaryCount == wideCount);
+			REQUIRE(memcmp(binaryPolys, widePolys, sizeof(dtPolyRef) * binaryCount) == 0);
+
+			dtPolyRef binaryNearest = 0;
+			dtPolyRef wideNearest = 0;
+			float binaryPt[3], widePt[3];
+			REQUIRE(dtStatusSucceed(binaryQuery->findNearestPoly(center, halfExtents, &filter, &binaryNearest, binaryPt)));
+			REQUIRE(dtStatusSucceed(wideQuery->findNearestPoly(center, halfExtents, &filter, &wideNearest, widePt)));
+			REQUIRE(binaryNearest == wideNearest);
+			if (binaryNearest)
+				REQUIRE(dtVequal(binaryPt, widePt));
+		}
+
+		dtFreeNavMeshQuery(binaryQuery);
+		dtFreeNavMeshQuery(wideQuery);
+	}
+
+	SECTION("Swapping the endianess twice restores the tile data")
+	{
+		std::vector<unsigned char> data(wideTile->data, wideTile->data + wideTile->dataSize);
+		REQUIRE(dtNavMeshDataSwapEndian(&data[0], (int)data.size()));
+		REQUIRE(dtNavMeshHeaderSwapEndian(&data[0], (int)data.size()));
+		REQUIRE(memcmp(&data[0], wideTile->data, data.size()) != 0);
+		REQUIRE(dtNavMeshHeaderSwapEndian(&data[0], (int)data.size()));
+		REQUIRE(dtNavMeshDataSwapEndian(&data[0], (int)data.size()));
+		REQUIRE(memcmp(&data[0], wideTile->data, data.size()) == 0);
+	}
+
+	dtFreeNavMesh(binaryMesh);
+	dtFreeNavMesh(wideMesh);
+}
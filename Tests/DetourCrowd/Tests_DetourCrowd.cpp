@@ -0,0 +1,133 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourCrowd.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "../Detour/TestNavMesh.h"
+#include "../Detour/TestTaskDispatcher.h"
+
+#include <string.h>
+#include <vector>
+
+namespace
+{
+/// Adds agents on a grid over the navmesh, walking to the opposite side.
+void addAgents(dtCrowd* crowd, const TestNavMesh& geom, const int count)
+{
+	float bmin[3], bmax[3];
+	geom.getBounds(bmin, bmax);
+	const dtNavMeshQuery* query = crowd->getNavMeshQuery();
+	const dtQueryFilter* filter = crowd->getFilter(0);
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.6f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = params.radius * 12.0f;
+	params.pathOptimizationRange = params.radius * 30.0f;
+	params.separationWeight = 2.0f;
+	params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OBSTACLE_AVOIDANCE | DT_CROWD_SEPARATION |
+						 DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO;
+	params.obstacleAvoidanceType = 3;
+
+	const int side = 16;
+	for (int i = 0; i < count; ++i)
+	{
+		const float u = ((i % side) + 0.5f) / side;
+		const float v = ((i / side % side) + 0.5f) / side;
+		const float pos[3] = { bmin[0] + 1.0f + u * (bmax[0] - bmin[0] - 2.0f), 0.0f, bmin[2] + 1.0f + v * (bmax[2] - bmin[2] - 2.0f) };
+		const float target[3] = { bmax[0] + bmin[0] - pos[0], 0.0f, bmax[2] + bmin[2] - pos[2] };
+
+		const int idx = crowd->addAgent(pos, &params);
+		REQUIRE(idx >= 0);
+
+		dtPolyRef targetRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(target, crowd->getQueryHalfExtents(), filter, &targetRef, nearest)));
+		REQUIRE(crowd->requestMoveTarget(idx, targetRef, nearest));
+	}
+}
+
+void requireSameAgents(dtCrowd* a, dtCrowd* b)
+{
+	REQUIRE(a->getAgentCount() == b->getAgentCount());
+	for (int i = 0; i < a->getAgentCount(); ++i)
+	{
+		const dtCrowdAgent* agentA = a->getAgent(i);
+		const dtCrowdAgent* agentB = b->getAgent(i);
+		REQUIRE(agentA->active == agentB->active);
+		if (!agentA->active)
+			continue;
+		REQUIRE(agentA->state == agentB->state);
+		REQUIRE(memcmp(agentA->npos, agentB->npos, sizeof(agentA->npos)) == 0);
+		REQUIRE(memcmp(agentA->vel, agentB->vel, sizeof(agentA->vel)) == 0);
+		REQUIRE(memcmp(agentA->nvel, agentB->nvel, sizeof(agentA->nvel)) == 0);
+		REQUIRE(memcmp(agentA->dvel, agentB->dvel, sizeof(agentA->dvel)) == 0);
+		REQUIRE(agentA->nneis == agentB->nneis);
+		REQUIRE(agentA->ncorners == agentB->ncorners);
+		REQUIRE(agentA->corridor.getPathCount() == agentB->corridor.getPathCount());
+		REQUIRE(memcmp(agentA->corridor.getPath(), agentB->corridor.getPath(),
+					   sizeof(dtPolyRef) * agentA->corridor.getPathCount()) == 0);
+	}
+}
+}
+
+TEST_CASE("dtCrowd::setTaskDispatcher")
+{
+	TestNavMesh geom(3, 3);
+	dtNavMesh* navMesh = geom.createNavMesh();
+	REQUIRE(navMesh != nullptr);
+
+	const int agentCount = 200;
+	dtCrowd* serial = dtAllocCrowd();
+	dtCrowd* parallel = dtAllocCrowd();
+	REQUIRE(serial->init(agentCount, 0.6f, navMesh));
+	REQUIRE(parallel->init(agentCount, 0.6f, navMesh));
+
+	TestTaskDispatcher dispatcher(4);
+	REQUIRE(parallel->setTaskDispatcher(&dispatcher));
+
+	addAgents(serial, geom, agentCount);
+	addAgents(parallel, geom, agentCount);
+
+	SECTION("Parallel updates match serial updates")
+	{
+		for (int frame = 0; frame < 60; ++frame)
+		{
+			serial->update(0.1f, nullptr);
+			parallel->update(0.1f, nullptr);
+			REQUIRE(serial->getVelocitySampleCount() == parallel->getVelocitySampleCount());
+		}
+		REQUIRE(serial->getVelocitySampleCount() > 0);
+		requireSameAgents(serial, parallel);
+
+		// The agents have moved.
+		float bmin[3], bmax[3];
+		geom.getBounds(bmin, bmax);
+		const dtCrowdAgent* agent = parallel->getAgent(0);
+		REQUIRE(dtVdist2D(agent->npos, bmin) > 5.0f);
+	}
+
+	SECTION("Dispatcher can be removed")
+	{
+		for (int frame = 0; frame < 10; ++frame)
+		{
+			serial->update(0.1f, nullptr);
+			parallel->update(0.1f, nullptr);
+		}
+		REQUIRE(parallel->setTaskDispatcher(nullptr));
+		for (int frame = 0; frame < 10; ++frame)
+		{
+			serial->update(0.1f, nullptr);
+			parallel->update(0.1f, nullptr);
+		}
+		requireSameAgents(serial, parallel);
+	}
+
+	dtFreeCrowd(parallel);
+	dtFreeCrowd(serial);
+	dtFreeNavMesh(navMesh);
+}
@@ -941,6 +941,1078 @@ TEST_CASE("rcRasterizeTriangles")
 	}
 }
 
+namespace
+{
+// Rasterizes a sloped grid of triangles, with a few triangles sticking out of the bounds.
+// The spacing of the grid sets the size of the triangles, the grid covers about the same area.
+template <class Heightfield>
+void rasterizeSlopedGrid(rcContext& ctx, Heightfield& solid, const float spacing = 1.3f)
+{
+	const int gridSize = (int)(20.8f / spacing);
+	std::vector<float> verts;
+	for (int z = 0; z <= gridSize; ++z)
+	{
+		for (int x = 0; x <= gridSize; ++x)
+		{
+			verts.push_back(-1.0f + x * spacing);
+			verts.push_back(2.0f + 0.37f * x - 0.21f * z + 0.5f * ((x * 7 + z * 3) % 5));
+			verts.push_back(-1.0f + z * spacing);
+		}
+	}
+	std::vector<int> tris;
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			const int v = z * (gridSize + 1) + x;
+			tris.push_back(v);
+			tris.push_back(v + gridSize + 1);
+			tris.push_back(v + 1);
+			tris.push_back(v + 1);
+			tris.push_back(v + gridSize + 1);
+			tris.push_back(v + gridSize + 2);
+		}
+	}
+	const int numTris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(numTris, RC_WALKABLE_AREA);
+
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { 16.0f, 20.0f, 16.0f };
+	const float cellSize = 0.3f;
+	int width = 0;
+	int height = 0;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+	REQUIRE(rcCreateHeightfield(&ctx, solid, width, height, bmin, bmax, cellSize, 0.2f));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], numTris, solid, 1));
+}
+
+int countDifferentSpans(const rcHeightfield& a, const rcHeightfield& b, const int tolerance)
+{
+	int differences = 0;
+	for (int i = 0; i < a.width * a.height; ++i)
+	{
+		const rcSpan* spanA = a.spans[i];
+		const rcSpan* spanB = b.spans[i];
+		for (; spanA && spanB; spanA = spanA->next, spanB = spanB->next)
+		{
+			if (rcAbs((int)spanA->smin - (int)spanB->smin) > tolerance ||
+				rcAbs((int)spanA->smax - (int)spanB->smax) > tolerance ||
+				spanA->area != spanB->area)
+			{
+				differences++;
+			}
+		}
+		if (spanA || spanB)
+		{
+			differences++;
+		}
+	}
+	return differences;
+}
+}
+
+TEST_CASE("rcSetRasterizationKernel")
+{
+	rcContext ctx;
+	REQUIRE(rcGetRasterizationKernel() == RC_RASTERIZATION_REFERENCE);
+
+	const rcRasterizationKernel kernels[] = {
+		RC_RASTERIZATION_BATCHED,
+		RC_RASTERIZATION_SSE2,
+		RC_RASTERIZATION_AVX2
+	};
+
+	SECTION("Unsupported kernels are not selected")
+	{
+		REQUIRE(rcSetRasterizationKernel(RC_RASTERIZATION_BATCHED));
+		REQUIRE(rcGetRasterizationKernel() == RC_RASTERIZATION_BATCHED);
+		for (int i = 0; i < 3; ++i)
+		{
+			if (!rcSetRasterizationKernel(kernels[i]))
+			{
+				REQUIRE(rcGetRasterizationKernel() != kernels[i]);
+			}
+		}
+		REQUIRE(rcSetRasterizationKernel(rcGetBestRasterizationKernel()));
+		REQUIRE(rcGetRasterizationKernel() == rcGetBestRasterizationKernel());
+	}
+
+	SECTION("Kernels rasterize a single triangle the same")
+	{
+		const float verts[] = {
+			0, 0, 0,
+			1, 0, 0,
+			0, 0, -1
+		};
+		const float bmin[3] = { -5, -5, -5 };
+		const float bmax[3] = { 5, 5, 5 };
+		rcHeightfield reference;
+		REQUIRE(rcCreateHeightfield(&ctx, reference, 20, 20, bmin, bmax, 0.5f, 0.5f));
+		REQUIRE(rcRasterizeTriangle(&ctx, &verts[0], &verts[3], &verts[6], RC_WALKABLE_AREA, reference));
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (!rcSetRasterizationKernel(kernels[i]))
+			{
+				continue;
+			}
+			rcHeightfield solid;
+			REQUIRE(rcCreateHeightfield(&ctx, solid, 20, 20, bmin, bmax, 0.5f, 0.5f));
+			REQUIRE(rcRasterizeTriangle(&ctx, &verts[0], &verts[3], &verts[6], RC_WALKABLE_AREA, solid));
+			REQUIRE(countDifferentSpans(reference, solid, 0) == 0);
+		}
+	}
+
+	SECTION("Batched kernels match each other and stay close to the reference")
+	{
+		// Rows of small triangles are clipped like in the reference kernel, the large ones use the batched kernels.
+		const float spacing = GENERATE(1.3f, 3.5f);
+		rcHeightfield reference;
+		rasterizeSlopedGrid(ctx, reference, spacing);
+
+		REQUIRE(rcSetRasterizationKernel(RC_RASTERIZATION_BATCHED));
+		rcHeightfield batched;
+		rasterizeSlopedGrid(ctx, batched, spacing);
+		REQUIRE(countDifferentSpans(reference, batched, 1) == 0);
+
+		for (int i = 1; i < 3; ++i)
+		{
+			if (!rcSetRasterizationKernel(kernels[i]))
+			{
+				continue;
+			}
+			rcHeightfield solid;
+			rasterizeSlopedGrid(ctx, solid, spacing);
+			REQUIRE(countDifferentSpans(batched, solid, 0) == 0);
+		}
+	}
+
+	rcSetRasterizationKernel(RC_RASTERIZATION_REFERENCE);
+}
+
+namespace
+{
+// Appends a flat grid of ground triangles and a box standing on it.
+void makeGroundWithBox(const float boxX, const float boxZ, std::vector<float>& verts, std::vector<int>& tris)
+{
+	const int gridSize = 8;
+	const float spacing = 2.0f;
+	for (int z = 0; z <= gridSize; ++z)
+	{
+		for (int x = 0; x <= gridSize; ++x)
+		{
+			verts.push_back(x * spacing);
+			verts.push_back(1.0f + 0.1f * ((x + z) % 3));
+			verts.push_back(z * spacing);
+		}
+	}
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			const int v = z * (gridSize + 1) + x;
+			const int quad[6] = { v, v + gridSize + 1, v + 1, v + 1, v + gridSize + 1, v + gridSize + 2 };
+			tris.insert(tris.end(), quad, quad + 6);
+		}
+	}
+
+	// Only the top of the box is needed to block the ground below it.
+	const float size = 2.5f;
+	const int first = (int)verts.size() / 3;
+	const float box[12] = {
+		boxX, 2.0f, boxZ,
+		boxX, 2.0f, boxZ + size,
+		boxX + size, 2.0f, boxZ + size,
+		boxX + size, 2.0f, boxZ,
+	};
+	verts.insert(verts.end(), box, box + 12);
+	const int top[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+	tris.insert(tris.end(), top, top + 6);
+}
+
+void buildFilteredHeightfield(rcContext& ctx, const std::vector<float>& verts, const std::vector<int>& tris, rcHeightfield& solid)
+{
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { 16.0f, 10.0f, 16.0f };
+	int width = 0;
+	int height = 0;
+	rcCalcGridSize(bmin, bmax, 0.3f, &width, &height);
+	REQUIRE(rcCreateHeightfield(&ctx, solid, width, height, bmin, bmax, 0.3f, 0.2f));
+
+	const int numTris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(numTris, RC_NULL_AREA);
+	rcMarkWalkableTriangles(&ctx, 45.0f, &verts[0], (int)verts.size() / 3, &tris[0], numTris, &areas[0]);
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], numTris, solid, 1));
+	rcFilterLowHangingWalkableObstacles(&ctx, 4, solid);
+	rcFilterLedgeSpans(&ctx, 10, 4, solid);
+	rcFilterWalkableLowHeightSpans(&ctx, 10, solid);
+}
+
+int countSpansInRange(const rcHeightfield& solid, const int minX, const int minZ, const int maxX, const int maxZ)
+{
+	int count = 0;
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			for (const rcSpan* span = solid.spans[x + z * solid.width]; span; span = span->next)
+				count++;
+		}
+	}
+	return count;
+}
+}
+
+TEST_CASE("Incremental heightfield update")
+{
+	rcContext ctx;
+
+	std::vector<float> oldVerts, newVerts;
+	std::vector<int> oldTris, newTris;
+	makeGroundWithBox(3.1f, 4.3f, oldVerts, oldTris);
+	makeGroundWithBox(6.7f, 5.2f, newVerts, newTris);
+
+	// The changed columns are the ones covered by the box before and after moving it.
+	float changedMin[3], changedMax[3];
+	rcCalcBounds(&oldVerts[oldVerts.size() - 12], 4, changedMin, changedMax);
+	float newMin[3], newMax[3];
+	rcCalcBounds(&newVerts[newVerts.size() - 12], 4, newMin, newMax);
+	rcVmin(changedMin, newMin);
+	rcVmax(changedMax, newMax);
+
+	const rcRasterizationKernel kernels[] = {
+		RC_RASTERIZATION_REFERENCE,
+		RC_RASTERIZATION_BATCHED,
+		RC_RASTERIZATION_SSE2,
+		RC_RASTERIZATION_AVX2
+	};
+
+	for (int k = 0; k < 4; ++k)
+	{
+		if (!rcSetRasterizationKernel(kernels[k]))
+		{
+			continue;
+		}
+
+		rcHeightfield reference;
+		buildFilteredHeightfield(ctx, newVerts, newTris, reference);
+
+		rcHeightfield solid;
+		buildFilteredHeightfield(ctx, oldVerts, oldTris, solid);
+		REQUIRE(countDifferentSpans(reference, solid, 0) > 0);
+
+		int minX, minZ, maxX, maxZ;
+		REQUIRE(rcCalcColumnRange(solid, changedMin, changedMax, &minX, &minZ, &maxX, &maxZ));
+		REQUIRE(minX > 0);
+		REQUIRE(maxX < solid.width - 1);
+
+		rcClearSpans(&ctx, solid, minX, minZ, maxX, maxZ);
+		REQUIRE(countSpansInRange(solid, minX, minZ, maxX, maxZ) == 0);
+
+		const int numTris = (int)newTris.size() / 3;
+		std::vector<unsigned char> areas(numTris, RC_NULL_AREA);
+		rcMarkWalkableTriangles(&ctx, 45.0f, &newVerts[0], (int)newVerts.size() / 3, &newTris[0], numTris, &areas[0]);
+		REQUIRE(rcRasterizeTriangles(&ctx, &newVerts[0], (int)newVerts.size() / 3, &newTris[0], &areas[0], numTris, solid,
+									 minX, minZ, maxX, maxZ, 1));
+		rcFilterLowHangingWalkableObstacles(&ctx, 4, solid, minX, minZ, maxX, maxZ);
+		rcFilterLedgeSpans(&ctx, 10, 4, solid, minX, minZ, maxX, maxZ);
+		rcFilterWalkableLowHeightSpans(&ctx, 10, solid, minX, minZ, maxX, maxZ);
+
+		REQUIRE(countDifferentSpans(reference, solid, 0) == 0);
+	}
+
+	SECTION("Bounds outside the heightfield")
+	{
+		rcHeightfield solid;
+		buildFilteredHeightfield(ctx, oldVerts, oldTris, solid);
+		const float outsideMin[3] = { 20.0f, 0.0f, 2.0f };
+		const float outsideMax[3] = { 22.0f, 1.0f, 4.0f };
+		int minX, minZ, maxX, maxZ;
+		REQUIRE_FALSE(rcCalcColumnRange(solid, outsideMin, outsideMax, &minX, &minZ, &maxX, &maxZ));
+	}
+
+	rcSetRasterizationKernel(RC_RASTERIZATION_REFERENCE);
+}
+
+namespace
+{
+// Fills a heightfield with stacks of spans of random heights and areas.
+template <class Heightfield>
+void buildRandomHeightfield(rcContext& ctx, Heightfield& solid, const int width, const int height, unsigned int seed)
+{
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { width * 0.3f, 20.0f, height * 0.3f };
+	REQUIRE(rcCreateHeightfield(&ctx, solid, width, height, bmin, bmax, 0.3f, 0.2f));
+
+	for (int z = 0; z < height; ++z)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			int y = 0;
+			const int spanCount = (int)((seed >> 16) % 4);
+			seed = seed * 1103515245 + 12345;
+			for (int i = 0; i < spanCount; ++i)
+			{
+				const int smin = y + (int)((seed >> 16) % 12);
+				seed = seed * 1103515245 + 12345;
+				const int smax = smin + 1 + (int)((seed >> 16) % 6);
+				seed = seed * 1103515245 + 12345;
+				const unsigned char area = (seed >> 16) % 3 == 0 ? RC_NULL_AREA : (unsigned char)(1 + (seed >> 20) % 2);
+				seed = seed * 1103515245 + 12345;
+				REQUIRE(rcAddSpan(&ctx, solid, x, z, (unsigned short)smin, (unsigned short)smax, area, 1));
+				y = smax + 1;
+			}
+		}
+	}
+}
+
+void filterSeparately(rcContext& ctx, const int walkableHeight, const int walkableClimb, rcHeightfield& solid,
+					  const int minX, const int minZ, const int maxX, const int maxZ, const int filterFlags)
+{
+	if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+		rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, solid, minX, minZ, maxX, maxZ);
+	if (filterFlags & RC_FILTER_LEDGE_SPANS)
+		rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, solid, minX, minZ, maxX, maxZ);
+	if (filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS)
+		rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, solid, minX, minZ, maxX, maxZ);
+}
+}
+
+TEST_CASE("rcFilterHeightfield")
+{
+	rcContext ctx;
+	const int walkableHeight = GENERATE(3, 6);
+	const int walkableClimb = GENERATE(0, 2, 5);
+	const unsigned int seed = GENERATE(1u, 12345u);
+
+	SECTION("Matches the separate filters")
+	{
+		for (int filterFlags = 0; filterFlags <= RC_FILTER_ALL; ++filterFlags)
+		{
+			rcHeightfield expected;
+			buildRandomHeightfield(ctx, expected, 23, 17, seed);
+			filterSeparately(ctx, walkableHeight, walkableClimb, expected, 0, 0, 22, 16, filterFlags);
+
+			rcHeightfield solid;
+			buildRandomHeightfield(ctx, solid, 23, 17, seed);
+			rcFilterHeightfield(&ctx, walkableHeight, walkableClimb, solid, filterFlags);
+
+			REQUIRE(countDifferentSpans(expected, solid, 0) == 0);
+		}
+	}
+
+	SECTION("Filters only the column range")
+	{
+		rcHeightfield unfiltered;
+		buildRandomHeightfield(ctx, unfiltered, 23, 17, seed);
+
+		rcHeightfield expected;
+		buildRandomHeightfield(ctx, expected, 23, 17, seed);
+		filterSeparately(ctx, walkableHeight, walkableClimb, expected, 4, -3, 15, 9, RC_FILTER_ALL);
+		REQUIRE(countDifferentSpans(unfiltered, expected, 0) > 0);
+
+		rcHeightfield solid;
+		buildRandomHeightfield(ctx, solid, 23, 17, seed);
+		rcFilterHeightfield(&ctx, walkableHeight, walkableClimb, solid, 4, -3, 15, 9);
+
+		REQUIRE(countDifferentSpans(expected, solid, 0) == 0);
+	}
+}
+
+namespace
+{
+void requireSameSpans(const rcHeightfield& expected, const rcColumnHeightfield& solid)
+{
+	REQUIRE(expected.width == solid.width);
+	REQUIRE(expected.height == solid.height);
+	for (int i = 0; i < expected.width * expected.height; ++i)
+	{
+		const rcHeightfieldColumn& column = solid.columns[i];
+		int count = 0;
+		for (const rcSpan* span = expected.spans[i]; span; span = span->next, ++count)
+		{
+			REQUIRE(count < (int)column.count);
+			const rcColumnSpan& columnSpan = solid.spans[column.index + count];
+			REQUIRE(columnSpan.smin == span->smin);
+			REQUIRE(columnSpan.smax == span->smax);
+			REQUIRE(columnSpan.area == span->area);
+		}
+		REQUIRE(count == (int)column.count);
+		REQUIRE(column.count <= column.capacity);
+		REQUIRE((int)(column.index + column.capacity) <= solid.usedSpans);
+	}
+	REQUIRE(solid.usedSpans <= solid.maxSpans);
+}
+
+void requireSameCompactHeightfield(const rcCompactHeightfield& a, const rcCompactHeightfield& b)
+{
+	REQUIRE(a.width == b.width);
+	REQUIRE(a.height == b.height);
+	REQUIRE(a.spanCount == b.spanCount);
+	REQUIRE(memcmp(a.cells, b.cells, sizeof(rcCompactCell) * a.width * a.height) == 0);
+	REQUIRE(memcmp(a.spans, b.spans, sizeof(rcCompactSpan) * a.spanCount) == 0);
+	REQUIRE(memcmp(a.areas, b.areas, sizeof(unsigned char) * a.spanCount) == 0);
+}
+}
+
+TEST_CASE("rcColumnHeightfield")
+{
+	rcContext ctx;
+
+	SECTION("Added spans are merged like in rcHeightfield")
+	{
+		const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+		const float bmax[3] = { 3.0f, 20.0f, 3.0f };
+		rcHeightfield expected;
+		REQUIRE(rcCreateHeightfield(&ctx, expected, 10, 10, bmin, bmax, 0.3f, 0.2f));
+		rcColumnHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, 10, 10, bmin, bmax, 0.3f, 0.2f));
+
+		unsigned int seed = 7;
+		for (int i = 0; i < 5000; ++i)
+		{
+			const int x = (int)((seed >> 16) % 10);
+			seed = seed * 1103515245 + 12345;
+			const int z = (int)((seed >> 16) % 10);
+			seed = seed * 1103515245 + 12345;
+			const unsigned short smin = (unsigned short)((seed >> 16) % 400);
+			seed = seed * 1103515245 + 12345;
+			const unsigned short smax = (unsigned short)(smin + 1 + (seed >> 16) % 3);
+			seed = seed * 1103515245 + 12345;
+			const unsigned char area = (unsigned char)((seed >> 16) % 4);
+			seed = seed * 1103515245 + 12345;
+			REQUIRE(rcAddSpan(&ctx, expected, x, z, smin, smax, area, 2));
+			REQUIRE(rcAddSpan(&ctx, solid, x, z, smin, smax, area, 2));
+		}
+		requireSameSpans(expected, solid);
+
+		SECTION("Creating the heightfield again removes the spans")
+		{
+			const int maxSpans = solid.maxSpans;
+			REQUIRE(rcCreateHeightfield(&ctx, solid, 10, 10, bmin, bmax, 0.3f, 0.2f));
+			REQUIRE(solid.maxSpans == maxSpans);
+			REQUIRE(solid.usedSpans == 0);
+			for (int i = 0; i < 100; ++i)
+			{
+				REQUIRE(solid.columns[i].count == 0);
+			}
+		}
+	}
+
+	SECTION("Building matches rcHeightfield")
+	{
+		rcHeightfield expected;
+		rasterizeSlopedGrid(ctx, expected);
+		rcColumnHeightfield solid;
+		rasterizeSlopedGrid(ctx, solid);
+		requireSameSpans(expected, solid);
+
+		rcFilterHeightfield(&ctx, 10, 4, expected);
+		rcFilterHeightfield(&ctx, 10, 4, solid);
+		requireSameSpans(expected, solid);
+		REQUIRE(rcGetHeightFieldSpanCount(&ctx, solid) == rcGetHeightFieldSpanCount(&ctx, expected));
+
+		rcCompactHeightfield expectedChf;
+		REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 4, expected, expectedChf));
+		rcCompactHeightfield chf;
+		REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 4, solid, chf));
+		REQUIRE(chf.spanCount > 0);
+		requireSameCompactHeightfield(expectedChf, chf);
+	}
+
+	SECTION("Filtering matches rcHeightfield")
+	{
+		const int walkableHeight = GENERATE(3, 6);
+		const int walkableClimb = GENERATE(0, 2, 5);
+		const unsigned int seed = GENERATE(1u, 12345u);
+
+		rcHeightfield expected;
+		buildRandomHeightfield(ctx, expected, 23, 17, seed);
+		rcColumnHeightfield solid;
+		buildRandomHeightfield(ctx, solid, 23, 17, seed);
+		requireSameSpans(expected, solid);
+
+		for (int filterFlags = 0; filterFlags <= RC_FILTER_ALL; ++filterFlags)
+		{
+			rcFilterHeightfield(&ctx, walkableHeight, walkableClimb, expected, filterFlags);
+			rcFilterHeightfield(&ctx, walkableHeight, walkableClimb, solid, filterFlags);
+			requireSameSpans(expected, solid);
+		}
+
+		rcCompactHeightfield expectedChf;
+		REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, expected, expectedChf));
+		rcCompactHeightfield chf;
+		REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, solid, chf));
+		requireSameCompactHeightfield(expectedChf, chf);
+	}
+}
+
+TEST_CASE("rcRasterizeCompactHeightfield")
+{
+	rcContext ctx;
+
+	std::vector<float> verts;
+	std::vector<int> tris;
+	makeGroundWithBox(6.7f, 5.2f, verts, tris);
+	const int numVerts = (int)verts.size() / 3;
+	const int numTris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(numTris, RC_NULL_AREA);
+	rcMarkWalkableTriangles(&ctx, 45.0f, &verts[0], numVerts, &tris[0], numTris, &areas[0]);
+
+	rcConfig config;
+	memset(&config, 0, sizeof(config));
+	config.cs = GENERATE(0.3f, 0.07f);
+	config.ch = 0.2f;
+	config.walkableHeight = 10;
+	config.walkableClimb = 4;
+	rcCalcBounds(&verts[0], numVerts, config.bmin, config.bmax);
+	// Leave a margin around the mesh on one side, and cut it on the other.
+	config.bmin[0] -= 1.0f;
+	config.bmax[2] -= 1.5f;
+	rcCalcGridSize(config.bmin, config.bmax, config.cs, &config.width, &config.height);
+	const int filterFlags = GENERATE(RC_FILTER_ALL, RC_FILTER_LEDGE_SPANS);
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, config.width, config.height, config.bmin, config.bmax, config.cs, config.ch));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], numVerts, &tris[0], &areas[0], numTris, solid, config.walkableClimb));
+	rcFilterHeightfield(&ctx, config.walkableHeight, config.walkableClimb, solid, filterFlags);
+	rcCompactHeightfield expected;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, config.walkableHeight, config.walkableClimb, solid, expected));
+	REQUIRE(expected.spanCount > 0);
+
+	rcCompactHeightfield chf;
+	REQUIRE(rcRasterizeCompactHeightfield(&ctx, config, &verts[0], numVerts, &tris[0], &areas[0], numTris, chf, filterFlags));
+	requireSameCompactHeightfield(expected, chf);
+	REQUIRE(memcmp(expected.bmin, chf.bmin, sizeof(expected.bmin)) == 0);
+	REQUIRE(memcmp(expected.bmax, chf.bmax, sizeof(expected.bmax)) == 0);
+
+	SECTION("Building again reuses the compact heightfield")
+	{
+		REQUIRE(rcRasterizeCompactHeightfield(&ctx, config, &verts[0], numVerts, &tris[0], &areas[0], numTris, chf, filterFlags));
+		requireSameCompactHeightfield(expected, chf);
+	}
+}
+
+namespace
+{
+int permAllocCount = 0;
+int tempAllocCount = 0;
+
+void* countingAlloc(size_t size, rcAllocHint hint)
+{
+	if (hint == RC_ALLOC_PERM)
+		permAllocCount++;
+	else
+		tempAllocCount++;
+	return malloc(size);
+}
+
+void countingFree(void* ptr)
+{
+	free(ptr);
+}
+
+void buildPolyMeshFrom(rcContext& ctx, const std::vector<float>& verts, const std::vector<int>& tris,
+					   rcHeightfield& solid, rcCompactHeightfield& chf, rcContourSet& cset, rcPolyMesh& pmesh)
+{
+	buildFilteredHeightfield(ctx, verts, tris, solid);
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 4, solid, chf));
+	REQUIRE(rcErodeWalkableArea(&ctx, 2, chf));
+	REQUIRE(rcBuildDistanceField(&ctx, chf));
+	REQUIRE(rcBuildRegions(&ctx, chf, 0, 8, 20));
+	REQUIRE(rcBuildContours(&ctx, chf, 1.3f, 12, cset));
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, 6, pmesh));
+}
+
+void requireSamePolyMesh(const rcPolyMesh& a, const rcPolyMesh& b)
+{
+	REQUIRE(a.nverts == b.nverts);
+	REQUIRE(a.npolys == b.npolys);
+	REQUIRE(a.nvp == b.nvp);
+	REQUIRE(memcmp(a.verts, b.verts, sizeof(unsigned short) * 3 * a.nverts) == 0);
+	REQUIRE(memcmp(a.polys, b.polys, sizeof(unsigned short) * 2 * a.nvp * a.npolys) == 0);
+	REQUIRE(memcmp(a.regs, b.regs, sizeof(unsigned short) * a.npolys) == 0);
+	REQUIRE(memcmp(a.areas, b.areas, sizeof(unsigned char) * a.npolys) == 0);
+	REQUIRE(memcmp(a.flags, b.flags, sizeof(unsigned short) * a.npolys) == 0);
+}
+}
+
+TEST_CASE("Reusing build objects")
+{
+	rcContext ctx;
+
+	std::vector<float> vertsA, vertsB;
+	std::vector<int> trisA, trisB;
+	makeGroundWithBox(3.1f, 4.3f, vertsA, trisA);
+	makeGroundWithBox(9.7f, 8.2f, vertsB, trisB);
+
+	rcHeightfield solidA, solidB;
+	rcCompactHeightfield chfA, chfB;
+	rcContourSet csetA, csetB;
+	rcPolyMesh expectedA, expectedB;
+	buildPolyMeshFrom(ctx, vertsA, trisA, solidA, chfA, csetA, expectedA);
+	buildPolyMeshFrom(ctx, vertsB, trisB, solidB, chfB, csetB, expectedB);
+
+	rcHeightfield solid;
+	rcCompactHeightfield chf;
+	rcContourSet cset;
+	rcPolyMesh pmesh;
+
+	SECTION("Results match fresh objects")
+	{
+		buildPolyMeshFrom(ctx, vertsA, trisA, solid, chf, cset, pmesh);
+		requireSamePolyMesh(pmesh, expectedA);
+		buildPolyMeshFrom(ctx, vertsB, trisB, solid, chf, cset, pmesh);
+		requireSamePolyMesh(pmesh, expectedB);
+		REQUIRE(cset.nconts == csetB.nconts);
+		REQUIRE(chf.spanCount == chfB.spanCount);
+		REQUIRE(chf.maxRegions == chfB.maxRegions);
+		buildPolyMeshFrom(ctx, vertsA, trisA, solid, chf, cset, pmesh);
+		requireSamePolyMesh(pmesh, expectedA);
+		REQUIRE(cset.nconts == csetA.nconts);
+		REQUIRE(chf.maxDistance == chfA.maxDistance);
+
+		// The distances of the previous build are cleared with the new spans.
+		REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 4, solid, chf));
+		REQUIRE(chf.maxDistance == 0);
+		REQUIRE(chf.dist != nullptr);
+		for (int i = 0; i < chf.spanCount; ++i)
+		{
+			REQUIRE(chf.dist[i] == 0);
+		}
+	}
+
+	SECTION("Rebuilding does not allocate persistent memory")
+	{
+		buildPolyMeshFrom(ctx, vertsA, trisA, solid, chf, cset, pmesh);
+		buildPolyMeshFrom(ctx, vertsB, trisB, solid, chf, cset, pmesh);
+
+		permAllocCount = 0;
+		rcAllocSetCustom(countingAlloc, countingFree);
+		buildPolyMeshFrom(ctx, vertsA, trisA, solid, chf, cset, pmesh);
+		rcAllocSetCustom(NULL, NULL);
+
+		REQUIRE(permAllocCount == 0);
+		requireSamePolyMesh(pmesh, expectedA);
+	}
+
+	SECTION("Reset objects are empty")
+	{
+		buildPolyMeshFrom(ctx, vertsA, trisA, solid, chf, cset, pmesh);
+		rcResetHeightfield(solid);
+		REQUIRE(countSpansInRange(solid, 0, 0, solid.width - 1, solid.height - 1) == 0);
+		rcResetCompactHeightfield(chf);
+		REQUIRE(chf.spanCount == 0);
+		rcResetContourSet(cset);
+		REQUIRE(cset.nconts == 0);
+		rcResetPolyMesh(pmesh);
+		REQUIRE(pmesh.nverts == 0);
+		REQUIRE(pmesh.npolys == 0);
+	}
+}
+
+namespace
+{
+int countPolyVerts(const unsigned short* p, const int nvp)
+{
+	int n = 0;
+	while (n < nvp && p[n] != RC_MESH_NULL_IDX)
+		n++;
+	return n;
+}
+
+// Negative if c is to the left of the line from a to b, in the winding of the polygon mesh.
+int polyTurn(const unsigned short* a, const unsigned short* b, const unsigned short* c)
+{
+	return ((int)b[0] - (int)a[0]) * ((int)c[2] - (int)a[2]) - ((int)c[0] - (int)a[0]) * ((int)b[2] - (int)a[2]);
+}
+}
+
+TEST_CASE("rcBuildPolyMesh merges polygons")
+{
+	rcContext ctx;
+
+	// A disk gives a large region with many contour vertices.
+	std::vector<float> verts;
+	std::vector<int> tris;
+	const int segments = 48;
+	verts.push_back(8.0f);
+	verts.push_back(1.0f);
+	verts.push_back(8.0f);
+	for (int i = 0; i < segments; ++i)
+	{
+		const float angle = (float)i / segments * 2.0f * RC_PI;
+		verts.push_back(8.0f + 7.0f * cosf(angle));
+		verts.push_back(1.0f);
+		verts.push_back(8.0f + 7.0f * sinf(angle));
+		tris.push_back(0);
+		tris.push_back(1 + (i + 1) % segments);
+		tris.push_back(1 + i);
+	}
+
+	rcHeightfield solid;
+	rcCompactHeightfield chf;
+	rcContourSet cset;
+	rcPolyMesh pmesh;
+	buildPolyMeshFrom(ctx, verts, tris, solid, chf, cset, pmesh);
+
+	const int nvp = GENERATE(3, 4, 6, 8);
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, nvp, pmesh));
+	REQUIRE(pmesh.npolys > 0);
+
+	for (int i = 0; i < pmesh.npolys; ++i)
+	{
+		const unsigned short* p = &pmesh.polys[i * nvp * 2];
+		const int n = countPolyVerts(p, nvp);
+		REQUIRE(n >= 3);
+		for (int j = 0; j < n; ++j)
+		{
+			const unsigned short* a = &pmesh.verts[p[j] * 3];
+			const unsigned short* b = &pmesh.verts[p[(j + 1) % n] * 3];
+			const unsigned short* c = &pmesh.verts[p[(j + 2) % n] * 3];
+			REQUIRE(polyTurn(a, b, c) <= 0);
+		}
+	}
+
+	// No two polygons of the same region are left which could be merged into a convex polygon.
+	for (int i = 0; i < pmesh.npolys; ++i)
+	{
+		const unsigned short* p = &pmesh.polys[i * nvp * 2];
+		const int na = countPolyVerts(p, nvp);
+		for (int ea = 0; ea < na; ++ea)
+		{
+			const unsigned short nei = p[nvp + ea];
+			if (nei & 0x8000 || pmesh.regs[nei] != pmesh.regs[i])
+				continue;
+			const unsigned short* q = &pmesh.polys[nei * nvp * 2];
+			const int nb = countPolyVerts(q, nvp);
+			if (na + nb - 2 > nvp)
+				continue;
+			int eb = 0;
+			while (eb < nb && q[nvp + eb] != i)
+				eb++;
+			REQUIRE(eb < nb);
+
+			const bool convexAtA = polyTurn(&pmesh.verts[p[(ea + na - 1) % na] * 3], &pmesh.verts[p[ea] * 3],
+											  &pmesh.verts[q[(eb + 2) % nb] * 3]) < 0;
+			const bool convexAtB = polyTurn(&pmesh.verts[q[(eb + nb - 1) % nb] * 3], &pmesh.verts[q[eb] * 3],
+											  &pmesh.verts[p[(ea + 2) % na] * 3]) < 0;
+			REQUIRE(!(convexAtA && convexAtB));
+		}
+	}
+}
+
+TEST_CASE("rcBuildContours merges region holes")
+{
+	rcContext ctx;
+
+	// Flat ground with a grid of pillars, each of which leaves a hole in the ground region.
+	std::vector<float> verts;
+	std::vector<int> tris;
+	const float ground[12] = { 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 16.0f, 16.0f, 1.0f, 16.0f, 16.0f, 1.0f, 0.0f };
+	verts.insert(verts.end(), ground, ground + 12);
+	const int groundTris[6] = { 0, 1, 2, 0, 2, 3 };
+	tris.insert(tris.end(), groundTris, groundTris + 6);
+	const int pillarsPerSide = 4;
+	const float size = 0.3f;
+	for (int z = 0; z < pillarsPerSide; ++z)
+	{
+		for (int x = 0; x < pillarsPerSide; ++x)
+		{
+			const float px = 3.1f + x * 3.0f;
+			const float pz = 3.4f + z * 3.0f;
+			const int first = (int)verts.size() / 3;
+			const float top[12] = { px, 2.0f, pz, px, 2.0f, pz + size, px + size, 2.0f, pz + size, px + size, 2.0f, pz };
+			verts.insert(verts.end(), top, top + 12);
+			const int topTris[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+			tris.insert(tris.end(), topTris, topTris + 6);
+		}
+	}
+
+	rcHeightfield solid;
+	buildFilteredHeightfield(ctx, verts, tris, solid);
+	rcCompactHeightfield chf;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 4, solid, chf));
+	REQUIRE(rcErodeWalkableArea(&ctx, 2, chf));
+	REQUIRE(rcBuildLayerRegions(&ctx, chf, 0, 8));
+
+	rcContourSet cset;
+	REQUIRE(rcBuildContours(&ctx, chf, 1.3f, 12, cset));
+
+	// Each hole is joined into the outline of the region and left without vertices.
+	REQUIRE(cset.nconts == 1 + pillarsPerSide * pillarsPerSide);
+	int outline = -1;
+	for (int i = 0; i < cset.nconts; ++i)
+	{
+		if (cset.conts[i].nverts == 0)
+			continue;
+		REQUIRE(outline == -1);
+		outline = i;
+	}
+	REQUIRE(outline != -1);
+	const rcContour& cont = cset.conts[outline];
+	REQUIRE(cont.nverts > pillarsPerSide * pillarsPerSide * 4);
+	int area = 0;
+	for (int i = 0, j = cont.nverts - 1; i < cont.nverts; j = i++)
+	{
+		const int* vi = &cont.verts[i * 4];
+		const int* vj = &cont.verts[j * 4];
+		area += vi[0] * vj[2] - vj[0] * vi[2];
+	}
+	REQUIRE(area > 0);
+
+	// The outline is triangulated into polygons covering the walkable spans.
+	rcPolyMesh pmesh;
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, 6, pmesh));
+	int polyArea = 0;
+	for (int i = 0; i < pmesh.npolys; ++i)
+	{
+		const unsigned short* p = &pmesh.polys[i * pmesh.nvp * 2];
+		const int n = countPolyVerts(p, pmesh.nvp);
+		for (int j = 0, k = n - 1; j < n; k = j++)
+		{
+			const unsigned short* vj = &pmesh.verts[p[j] * 3];
+			const unsigned short* vk = &pmesh.verts[p[k] * 3];
+			polyArea += vj[0] * vk[2] - vk[0] * vj[2];
+		}
+	}
+	int walkableSpans = 0;
+	for (int i = 0; i < chf.spanCount; ++i)
+	{
+		if (chf.areas[i] != RC_NULL_AREA)
+			walkableSpans++;
+	}
+	REQUIRE(polyArea > 0);
+	REQUIRE(abs(polyArea / 2 - walkableSpans) < walkableSpans / 10);
+}
+
+TEST_CASE("rcBuildPolyMeshDetail")
+{
+	rcContext ctx;
+
+	std::vector<float> verts;
+	std::vector<int> tris;
+	makeGroundWithBox(3.1f, 4.3f, verts, tris);
+	// Make the bumps of the ground larger than the cell height.
+	for (size_t i = 0; i < verts.size() - 12; i += 3)
+		verts[i+1] = 1.0f + (verts[i+1] - 1.0f) * 4.0f;
+
+	rcHeightfield solid;
+	rcCompactHeightfield chf;
+	rcContourSet cset;
+	rcPolyMesh pmesh;
+	buildPolyMeshFrom(ctx, verts, tris, solid, chf, cset, pmesh);
+	REQUIRE(pmesh.npolys > 0);
+
+	// The bumps of the ground need extra samples inside the polygons.
+	rcPolyMeshDetail* detail = rcAllocPolyMeshDetail();
+	rcPolyMeshDetail& dmesh = *detail;
+	REQUIRE(rcBuildPolyMeshDetail(&ctx, pmesh, chf, 0.6f, 0.05f, dmesh));
+	REQUIRE(dmesh.nmeshes == pmesh.npolys);
+
+	int interiorVerts = 0;
+	for (int i = 0; i < dmesh.nmeshes; ++i)
+	{
+		const unsigned int* m = &dmesh.meshes[i*4];
+		const float* dverts = &dmesh.verts[m[0]*3];
+
+		// The triangles must cover the polygon once, all with the same winding.
+		int nvp = 0;
+		float polyArea = 0;
+		const unsigned short* p = &pmesh.polys[i*pmesh.nvp*2];
+		while (nvp < pmesh.nvp && p[nvp] != RC_MESH_NULL_IDX)
+			nvp++;
+		for (int j = 2; j < nvp; ++j)
+		{
+			const unsigned short* a = &pmesh.verts[p[0]*3];
+			const unsigned short* b = &pmesh.verts[p[j-1]*3];
+			const unsigned short* c = &pmesh.verts[p[j]*3];
+			polyArea += ((b[0]-a[0])*(c[2]-a[2]) - (b[2]-a[2])*(c[0]-a[0])) * pmesh.cs * pmesh.cs;
+		}
+
+		float triArea = 0;
+		float absTriArea = 0;
+		for (unsigned int j = 0; j < m[3]; ++j)
+		{
+			const unsigned char* t = &dmesh.tris[(m[2]+j)*4];
+			const float* a = &dverts[t[0]*3];
+			const float* b = &dverts[t[1]*3];
+			const float* c = &dverts[t[2]*3];
+			const float area = (b[0]-a[0])*(c[2]-a[2]) - (b[2]-a[2])*(c[0]-a[0]);
+			triArea += area;
+			absTriArea += fabsf(area);
+		}
+		REQUIRE(fabsf(triArea) == Catch::Approx(fabsf(polyArea)).epsilon(0.01));
+		REQUIRE(absTriArea == Catch::Approx(fabsf(triArea)).epsilon(0.001));
+
+		// Detail vertices which are not on the polygon edges come from the interior samples.
+		for (unsigned int j = 0; j < m[1]; ++j)
+		{
+			const float* v = &dverts[j*3];
+			bool onEdge = false;
+			for (int k = 0, l = nvp-1; k < nvp; l = k++)
+			{
+				float a[3], b[3];
+				for (int n = 0; n < 3; ++n)
+				{
+					a[n] = pmesh.bmin[n] + pmesh.verts[p[l]*3+n] * (n == 1 ? pmesh.ch : pmesh.cs);
+					b[n] = pmesh.bmin[n] + pmesh.verts[p[k]*3+n] * (n == 1 ? pmesh.ch : pmesh.cs);
+				}
+				const float cross = (b[0]-a[0])*(v[2]-a[2]) - (b[2]-a[2])*(v[0]-a[0]);
+				const float len = sqrtf(rcSqr(b[0]-a[0]) + rcSqr(b[2]-a[2]));
+				if (fabsf(cross) < 0.01f * len)
+					onEdge = true;
+			}
+			if (!onEdge)
+				interiorVerts++;
+		}
+	}
+	REQUIRE(interiorVerts > 0);
+
+	rcFreePolyMeshDetail(detail);
+}
+
+TEST_CASE("rcTempArena")
+{
+	rcTempArena arena(1024);
+	REQUIRE(arena.getReservedSize() == 0);
+
+	SECTION("Allocations are aligned and counted")
+	{
+		void* a = arena.alloc(3);
+		void* b = arena.alloc(20);
+		REQUIRE(a != nullptr);
+		REQUIRE(b != nullptr);
+		REQUIRE(((uintptr_t)a & 15) == 0);
+		REQUIRE(((uintptr_t)b & 15) == 0);
+		REQUIRE(arena.owns(a));
+		REQUIRE(arena.owns((char*)b + 19));
+		REQUIRE(arena.getUsedSize() == 48);
+		REQUIRE(arena.getPeakSize() == 48);
+		REQUIRE(arena.getReservedSize() == 1024);
+
+		int onHeap = 0;
+		REQUIRE_FALSE(arena.owns(&onHeap));
+	}
+
+	SECTION("Freeing the last allocation reclaims it")
+	{
+		void* a = arena.alloc(16);
+		void* b = arena.alloc(16);
+		arena.free(a);
+		REQUIRE(arena.getUsedSize() == 32);
+		arena.free(b);
+		REQUIRE(arena.getUsedSize() == 16);
+		REQUIRE(arena.alloc(16) == b);
+	}
+
+	SECTION("Release frees everything after the mark")
+	{
+		void* a = arena.alloc(100);
+		const rcTempArenaMark mark = arena.mark();
+		void* b = arena.alloc(600);
+		void* c = arena.alloc(600);
+		REQUIRE(arena.getReservedSize() == 2048);
+		REQUIRE(arena.getPeakSize() == 112 + 608 + 608);
+
+		arena.release(mark);
+		REQUIRE(arena.getUsedSize() == 112);
+		REQUIRE(arena.alloc(600) == b);
+		REQUIRE(arena.alloc(600) == c);
+		REQUIRE(arena.getReservedSize() == 2048);
+
+		arena.reset();
+		REQUIRE(arena.getUsedSize() == 0);
+		REQUIRE(arena.alloc(100) == a);
+		REQUIRE(arena.getPeakSize() == 112 + 608 + 608);
+		arena.resetPeakSize();
+		REQUIRE(arena.getPeakSize() == 112);
+	}
+
+	SECTION("Large allocations get a block of their own")
+	{
+		arena.alloc(16);
+		void* big = arena.alloc(4000);
+		REQUIRE(big != nullptr);
+		REQUIRE(arena.getReservedSize() == 1024 + 4000);
+
+		// A reused block that is too small is replaced.
+		arena.reset();
+		arena.alloc(16);
+		arena.alloc(8000);
+		REQUIRE(arena.getReservedSize() == 1024 + 8000);
+
+		arena.purge();
+		REQUIRE(arena.getReservedSize() == 0);
+		REQUIRE_FALSE(arena.owns(big));
+	}
+
+	SECTION("Scopes route temporary allocations")
+	{
+		void* outside = rcAlloc(16, RC_ALLOC_TEMP);
+		REQUIRE_FALSE(arena.owns(outside));
+		{
+			rcTempArenaScope scope(&arena);
+			void* temp = rcAlloc(16, RC_ALLOC_TEMP);
+			void* perm = rcAlloc(16, RC_ALLOC_PERM);
+			REQUIRE(arena.owns(temp));
+			REQUIRE_FALSE(arena.owns(perm));
+			{
+				rcTempArenaScope inner(&arena);
+				rcTempVector<int> vec(100, 1);
+				REQUIRE(arena.owns(&vec[0]));
+				REQUIRE(arena.getUsedSize() > 16);
+			}
+			REQUIRE(arena.getUsedSize() == 16);
+			rcFree(outside);
+			rcFree(perm);
+			rcFree(temp);
+		}
+		REQUIRE(arena.getUsedSize() == 0);
+	}
+}
+
+TEST_CASE("Building with a temp arena")
+{
+	rcContext ctx;
+
+	std::vector<float> verts;
+	std::vector<int> tris;
+	makeGroundWithBox(3.1f, 4.3f, verts, tris);
+
+	rcHeightfield solidRef;
+	rcCompactHeightfield chfRef;
+	rcContourSet csetRef;
+	rcPolyMesh expected;
+	buildPolyMeshFrom(ctx, verts, tris, solidRef, chfRef, csetRef, expected);
+
+	rcTempArena arena;
+	ctx.setTempArena(&arena);
+	REQUIRE(ctx.getTempArena() == &arena);
+
+	rcHeightfield solid;
+	rcCompactHeightfield chf;
+	rcContourSet cset;
+	rcPolyMesh pmesh;
+	buildPolyMeshFrom(ctx, verts, tris, solid, chf, cset, pmesh);
+	requireSamePolyMesh(pmesh, expected);
+	REQUIRE(arena.getUsedSize() == 0);
+	REQUIRE(arena.getPeakSize() > 0);
+	REQUIRE(arena.getPeakSize() <= arena.getReservedSize());
+
+	// Once the objects and the arena have grown to fit, a rebuild does not touch the heap.
+	permAllocCount = 0;
+	tempAllocCount = 0;
+	rcAllocSetCustom(countingAlloc, countingFree);
+	buildPolyMeshFrom(ctx, verts, tris, solid, chf, cset, pmesh);
+	rcAllocSetCustom(NULL, NULL);
+
+	REQUIRE(permAllocCount == 0);
+	REQUIRE(tempAllocCount == 0);
+	requireSamePolyMesh(pmesh, expected);
+	REQUIRE(arena.getUsedSize() == 0);
+}
+
 // Used to verify that rcVector constructs/destroys objects correctly.
 struct Incrementor {
 	static int constructions;
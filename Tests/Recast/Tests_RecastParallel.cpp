@@ -0,0 +1,574 @@
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastParallel.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+void countTask(int index, int worker, void* userData)
+{
+	std::vector<int>* counts = (std::vector<int>*)userData;
+	(void)worker;
+	(*counts)[index]++;
+}
+
+struct NestedJob
+{
+	rcThreadPool* pool;
+	std::vector<int> counts;
+	std::vector<int> mismatches;
+};
+
+struct NestedTask
+{
+	int worker;
+	int mismatches;
+};
+
+void nestedInnerTask(int index, int worker, void* userData)
+{
+	NestedTask* task = (NestedTask*)userData;
+	(void)index;
+	// Nested tasks must run on the worker which issued them.
+	if (worker != task->worker)
+		task->mismatches++;
+}
+
+void nestedOuterTask(int index, int worker, void* userData)
+{
+	NestedJob* job = (NestedJob*)userData;
+	NestedTask task;
+	task.worker = worker;
+	task.mismatches = 0;
+	job->pool->parallelFor(4, nestedInnerTask, &task);
+	job->counts[index]++;
+	job->mismatches[index] = task.mismatches;
+}
+
+struct CallerNestedJob
+{
+	rcThreadPool* pool;
+	std::atomic<bool> callerStarted;
+	std::vector<int> counts;
+	std::vector<int> nestedCounts;
+	std::vector<int> mismatches;
+};
+
+void callerNestedTask(int index, int worker, void* userData)
+{
+	CallerNestedJob* job = (CallerNestedJob*)userData;
+	if (worker == 0)
+	{
+		// Nest a call while the other workers are still busy with the outer tasks.
+		job->callerStarted = true;
+		NestedTask task;
+		task.worker = worker;
+		task.mismatches = 0;
+		job->pool->parallelFor(8, nestedInnerTask, &task);
+		job->nestedCounts[index]++;
+		job->mismatches[index] = task.mismatches;
+	}
+	else
+	{
+		// Keep the worker busy so that the calling thread runs a task before the others steal them.
+		while (!job->callerStarted)
+			std::this_thread::yield();
+	}
+	job->counts[index]++;
+}
+
+struct TileJob
+{
+	int tilesX;
+	std::vector<int> addedTiles;
+};
+
+unsigned char* buildTile(rcContext* ctx, int tx, int ty, int worker, void* userData, int* dataSize)
+{
+	TileJob* job = (TileJob*)userData;
+	(void)worker;
+
+	// Every third tile is empty.
+	const int index = tx + ty * job->tilesX;
+	if ((index % 3) == 2)
+		return 0;
+
+	// Rasterize a triangle into a tile sized heightfield to give the workers something to do.
+	rcHeightfield* hf = rcAllocHeightfield();
+	const float bmin[3] = { (float)tx, 0.0f, (float)ty };
+	const float bmax[3] = { (float)tx + 1.0f, 1.0f, (float)ty + 1.0f };
+	if (!rcCreateHeightfield(ctx, *hf, 10, 10, bmin, bmax, 0.1f, 0.1f))
+	{
+		rcFreeHeightField(hf);
+		return 0;
+	}
+	const float verts[] = {
+		bmin[0], 0.5f, bmin[2],
+		bmin[0], 0.5f, bmax[2],
+		bmax[0], 0.5f, bmin[2],
+	};
+	const unsigned char area = RC_WALKABLE_AREA;
+	rcRasterizeTriangle(ctx, &verts[0], &verts[3], &verts[6], area, *hf);
+
+	int spanCount = 0;
+	for (int i = 0; i < hf->width * hf->height; ++i)
+	{
+		for (rcSpan* s = hf->spans[i]; s; s = s->next)
+			spanCount++;
+	}
+	rcFreeHeightField(hf);
+
+	int* data = (int*)rcAlloc(sizeof(int) * 2, RC_ALLOC_PERM);
+	data[0] = index;
+	data[1] = spanCount;
+	*dataSize = sizeof(int) * 2;
+	return (unsigned char*)data;
+}
+
+void addTile(int tx, int ty, unsigned char* data, int dataSize, void* userData)
+{
+	TileJob* job = (TileJob*)userData;
+	const int* values = (const int*)data;
+	REQUIRE(dataSize == (int)sizeof(int) * 2);
+	REQUIRE(values[0] == tx + ty * job->tilesX);
+	REQUIRE(values[1] > 0);
+	job->addedTiles.push_back(values[0]);
+	rcFree(data);
+}
+
+// Records the empty tiles as -(index + 1).
+void addRebuiltTile(int tx, int ty, unsigned char* data, int dataSize, void* userData)
+{
+	TileJob* job = (TileJob*)userData;
+	if (!data)
+	{
+		REQUIRE(dataSize == 0);
+		job->addedTiles.push_back(-(tx + ty * job->tilesX) - 1);
+		return;
+	}
+	addTile(tx, ty, data, dataSize, userData);
+}
+
+class ErrorCountingContext : public rcContext
+{
+public:
+	int errorCount;
+
+	ErrorCountingContext() : rcContext(true), errorCount(0) {}
+
+protected:
+	virtual void doLog(const rcLogCategory category, const char* /*msg*/, const int /*len*/)
+	{
+		if (category == RC_LOG_ERROR)
+			errorCount++;
+	}
+};
+
+// Builds a compact heightfield of uneven ground with holes, steps and patches of a different area.
+rcCompactHeightfield* buildTestCompactHeightfield(rcContext* ctx, int width, int height)
+{
+	rcHeightfield* hf = rcAllocHeightfield();
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { width * 0.3f, 10.0f, height * 0.3f };
+	REQUIRE(rcCreateHeightfield(ctx, *hf, width, height, bmin, bmax, 0.3f, 0.2f));
+
+	for (int z = 0; z < height; ++z)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const unsigned int hash = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+			if ((x / 7 + z / 5) % 11 == 3 || (hash & 0xff) == 0)
+				continue;
+			const unsigned short floor = (unsigned short)(((x / 13) + (z / 17)) % 4);
+			const unsigned char area = ((x / 23) % 3 == 1 && (z / 19) % 2 == 0) ? 2 : RC_WALKABLE_AREA;
+			REQUIRE(rcAddSpan(ctx, *hf, x, z, 0, floor + 2, area, 1));
+			// A second floor above parts of the ground.
+			if ((x / 31 + z / 29) % 2 == 0)
+				REQUIRE(rcAddSpan(ctx, *hf, x, z, 20, 22, RC_WALKABLE_AREA, 1));
+		}
+	}
+
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	REQUIRE(rcBuildCompactHeightfield(ctx, 10, 2, *hf, *chf));
+	rcFreeHeightField(hf);
+	return chf;
+}
+
+// Builds a heightfield of uneven ground with holes, overhangs and ledges.
+rcHeightfield* buildTestHeightfield(rcContext* ctx, int width, int height)
+{
+	rcHeightfield* hf = rcAllocHeightfield();
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { width * 0.3f, 10.0f, height * 0.3f };
+	REQUIRE(rcCreateHeightfield(ctx, *hf, width, height, bmin, bmax, 0.3f, 0.2f));
+
+	for (int z = 0; z < height; ++z)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const unsigned int hash = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+			if ((hash & 0x3f) == 0)
+				continue;
+			const unsigned short floor = (unsigned short)((hash >> 8) % 6 + (x / 9 + z / 7) % 3);
+			const unsigned char area = ((hash >> 12) % 5 == 0) ? RC_NULL_AREA : RC_WALKABLE_AREA;
+			REQUIRE(rcAddSpan(ctx, *hf, x, z, 0, floor + 2, area, 1));
+			// Obstacles and ceilings of varying clearance above parts of the ground.
+			if ((hash >> 4) % 4 == 0)
+				REQUIRE(rcAddSpan(ctx, *hf, x, z, (unsigned short)(floor + 4 + (hash >> 16) % 8), (unsigned short)(floor + 14), RC_NULL_AREA, 1));
+		}
+	}
+	return hf;
+}
+
+int countDifferentAreas(const rcHeightfield& a, const rcHeightfield& b)
+{
+	int differences = 0;
+	for (int i = 0; i < a.width * a.height; ++i)
+	{
+		const rcSpan* spanA = a.spans[i];
+		const rcSpan* spanB = b.spans[i];
+		for (; spanA && spanB; spanA = spanA->next, spanB = spanB->next)
+		{
+			if (spanA->area != spanB->area)
+				differences++;
+		}
+	}
+	return differences;
+}
+} // namespace
+
+TEST_CASE("rcThreadPool")
+{
+	SECTION("An uninitialized pool runs the tasks on the calling thread")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.getWorkerCount() == 1);
+
+		std::vector<int> counts(100, 0);
+		pool.parallelFor((int)counts.size(), countTask, &counts);
+		for (size_t i = 0; i < counts.size(); ++i)
+		{
+			REQUIRE(counts[i] == 1);
+		}
+	}
+
+	SECTION("Every task runs exactly once")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.init(4));
+		REQUIRE(pool.getWorkerCount() == 4);
+
+		for (int count = 0; count < 64; count += 7)
+		{
+			std::vector<int> counts(count, 0);
+			pool.parallelFor(count, countTask, &counts);
+			for (int i = 0; i < count; ++i)
+			{
+				REQUIRE(counts[i] == 1);
+			}
+		}
+	}
+
+	SECTION("Nested calls run on the calling worker")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.init(3));
+
+		NestedJob job;
+		job.pool = &pool;
+		job.counts.resize(32, 0);
+		job.mismatches.resize(32, 0);
+		pool.parallelFor((int)job.counts.size(), nestedOuterTask, &job);
+		for (size_t i = 0; i < job.counts.size(); ++i)
+		{
+			REQUIRE(job.counts[i] == 1);
+			REQUIRE(job.mismatches[i] == 0);
+		}
+	}
+
+	SECTION("Nested calls from the calling thread run on the calling thread")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.init(4));
+
+		CallerNestedJob job;
+		job.pool = &pool;
+		job.callerStarted = false;
+		job.counts.resize(32, 0);
+		job.nestedCounts.resize(32, 0);
+		job.mismatches.resize(32, 0);
+		pool.parallelFor((int)job.counts.size(), callerNestedTask, &job);
+		REQUIRE(job.callerStarted);
+		int nestedCount = 0;
+		for (size_t i = 0; i < job.counts.size(); ++i)
+		{
+			REQUIRE(job.counts[i] == 1);
+			REQUIRE(job.mismatches[i] == 0);
+			nestedCount += job.nestedCounts[i];
+		}
+		REQUIRE(nestedCount > 0);
+
+		// The pool is still usable after the nested calls.
+		std::vector<int> counts(64, 0);
+		pool.parallelFor((int)counts.size(), countTask, &counts);
+		for (size_t i = 0; i < counts.size(); ++i)
+		{
+			REQUIRE(counts[i] == 1);
+		}
+	}
+
+	SECTION("Invalid worker count")
+	{
+		rcThreadPool pool;
+		REQUIRE_FALSE(pool.init(0));
+		REQUIRE(pool.getWorkerCount() == 1);
+	}
+}
+
+TEST_CASE("rcBuildTiles")
+{
+	const int tilesX = 7;
+	const int tilesY = 5;
+
+	// The tiles are added in the same order, no matter how many workers are used.
+	std::vector<int> expected;
+	for (int i = 0; i < tilesX * tilesY; ++i)
+	{
+		if ((i % 3) != 2)
+			expected.push_back(i);
+	}
+
+	SECTION("Serial build")
+	{
+		rcContext ctx;
+		rcContext* contexts[] = { &ctx };
+
+		TileJob job;
+		job.tilesX = tilesX;
+		REQUIRE(rcBuildTiles(0, contexts, tilesX, tilesY, buildTile, addTile, &job));
+		REQUIRE(job.addedTiles == expected);
+	}
+
+	SECTION("Parallel build")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.init(4));
+
+		rcContext ctx[4];
+		rcContext* contexts[] = { &ctx[0], &ctx[1], &ctx[2], &ctx[3] };
+
+		TileJob job;
+		job.tilesX = tilesX;
+		REQUIRE(rcBuildTiles(&pool, contexts, tilesX, tilesY, buildTile, addTile, &job));
+		REQUIRE(job.addedTiles == expected);
+	}
+
+	SECTION("Missing callbacks")
+	{
+		rcContext ctx;
+		rcContext* contexts[] = { &ctx };
+
+		TileJob job;
+		job.tilesX = tilesX;
+		REQUIRE_FALSE(rcBuildTiles(0, contexts, tilesX, tilesY, 0, addTile, &job));
+		REQUIRE(job.addedTiles.empty());
+	}
+}
+
+TEST_CASE("rcRebuildTiles")
+{
+	const int tilesX = 7;
+	const int tiles[] = { 3, 1, 2, 0, 5, 4 };
+	const int tileCount = 3;
+
+	// The tiles are added in the order of the list, including the empty tile.
+	std::vector<int> expected;
+	expected.push_back(10);
+	expected.push_back(-3);
+	expected.push_back(33);
+
+	SECTION("Serial rebuild")
+	{
+		rcContext ctx;
+		rcContext* contexts[] = { &ctx };
+
+		TileJob job;
+		job.tilesX = tilesX;
+		REQUIRE(rcRebuildTiles(0, contexts, tiles, tileCount, buildTile, addRebuiltTile, &job));
+		REQUIRE(job.addedTiles == expected);
+	}
+
+	SECTION("Parallel rebuild")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.init(4));
+
+		rcContext ctx[4];
+		rcContext* contexts[] = { &ctx[0], &ctx[1], &ctx[2], &ctx[3] };
+
+		TileJob job;
+		job.tilesX = tilesX;
+		REQUIRE(rcRebuildTiles(&pool, contexts, tiles, tileCount, buildTile, addRebuiltTile, &job));
+		REQUIRE(job.addedTiles == expected);
+	}
+
+	SECTION("Missing tiles")
+	{
+		rcContext ctx;
+		rcContext* contexts[] = { &ctx };
+
+		TileJob job;
+		job.tilesX = tilesX;
+		REQUIRE_FALSE(rcRebuildTiles(0, contexts, 0, tileCount, buildTile, addRebuiltTile, &job));
+		REQUIRE(rcRebuildTiles(0, contexts, 0, 0, buildTile, addRebuiltTile, &job));
+		REQUIRE(job.addedTiles.empty());
+	}
+}
+
+TEST_CASE("rcBuildDistanceField with thread pool")
+{
+	rcContext ctx;
+	const int width = GENERATE(1, 37, 300);
+	const int height = GENERATE(1, 45, 211);
+	rcCompactHeightfield* expected = buildTestCompactHeightfield(&ctx, width, height);
+	REQUIRE(rcBuildDistanceField(&ctx, *expected));
+
+	const int workerCount = GENERATE(1, 2, 4);
+	rcThreadPool pool;
+	REQUIRE(pool.init(workerCount));
+
+	rcCompactHeightfield* chf = buildTestCompactHeightfield(&ctx, width, height);
+	REQUIRE(rcBuildDistanceField(&ctx, *chf, &pool));
+
+	REQUIRE(chf->spanCount == expected->spanCount);
+	REQUIRE(chf->maxDistance == expected->maxDistance);
+	for (int i = 0; i < chf->spanCount; ++i)
+	{
+		REQUIRE(chf->dist[i] == expected->dist[i]);
+	}
+
+	rcFreeCompactHeightfield(chf);
+	rcFreeCompactHeightfield(expected);
+}
+
+TEST_CASE("rcBuildRegions with thread pool")
+{
+	ErrorCountingContext ctx;
+	const int width = 300;
+	const int height = 211;
+	const int borderSize = GENERATE(0, 3);
+
+	rcCompactHeightfield* expected = buildTestCompactHeightfield(&ctx, width, height);
+	REQUIRE(rcBuildDistanceField(&ctx, *expected));
+	REQUIRE(rcBuildRegions(&ctx, *expected, borderSize, 8, 20));
+
+	SECTION("Without a pool the regions match the serial build")
+	{
+		rcCompactHeightfield* chf = buildTestCompactHeightfield(&ctx, width, height);
+		REQUIRE(rcBuildDistanceField(&ctx, *chf));
+		REQUIRE(rcBuildRegions(&ctx, *chf, borderSize, 8, 20, nullptr));
+		REQUIRE(chf->maxRegions == expected->maxRegions);
+		for (int i = 0; i < chf->spanCount; ++i)
+		{
+			REQUIRE(chf->spans[i].reg == expected->spans[i].reg);
+		}
+		rcFreeCompactHeightfield(chf);
+	}
+
+	SECTION("Regions do not depend on the number of workers")
+	{
+		rcCompactHeightfield* chfs[2];
+		const int workerCounts[2] = { 1, 4 };
+		for (int k = 0; k < 2; ++k)
+		{
+			rcThreadPool pool;
+			REQUIRE(pool.init(workerCounts[k]));
+			chfs[k] = buildTestCompactHeightfield(&ctx, width, height);
+			REQUIRE(rcBuildDistanceField(&ctx, *chfs[k], &pool));
+			REQUIRE(rcBuildRegions(&ctx, *chfs[k], borderSize, 8, 20, &pool));
+		}
+		REQUIRE(chfs[0]->maxRegions == chfs[1]->maxRegions);
+		for (int i = 0; i < chfs[0]->spanCount; ++i)
+		{
+			REQUIRE(chfs[0]->spans[i].reg == chfs[1]->spans[i].reg);
+		}
+
+		// The regions cover about the same spans as the serial ones, and the seams do not add many regions.
+		int expectedCovered = 0;
+		int covered = 0;
+		for (int i = 0; i < expected->spanCount; ++i)
+		{
+			if (expected->spans[i].reg != 0)
+				expectedCovered++;
+			if (chfs[1]->spans[i].reg != 0)
+				covered++;
+		}
+		REQUIRE(covered >= expectedCovered * 95 / 100);
+		REQUIRE(chfs[1]->maxRegions <= expected->maxRegions * 11 / 10);
+
+		// The regions can be traced into contours and polygons.
+		rcContourSet* cset = rcAllocContourSet();
+		REQUIRE(rcBuildContours(&ctx, *chfs[1], 1.3f, 12, *cset));
+		REQUIRE(cset->nconts > 0);
+		rcPolyMesh* pmesh = rcAllocPolyMesh();
+		REQUIRE(rcBuildPolyMesh(&ctx, *cset, 6, *pmesh));
+		REQUIRE(pmesh->npolys > 0);
+		REQUIRE(ctx.errorCount == 0);
+
+		rcFreePolyMesh(pmesh);
+		rcFreeContourSet(cset);
+		rcFreeCompactHeightfield(chfs[0]);
+		rcFreeCompactHeightfield(chfs[1]);
+	}
+
+	SECTION("The timers of the workers are added to the context")
+	{
+		rcThreadPool pool;
+		REQUIRE(pool.init(4));
+		rcCompactHeightfield* chf = buildTestCompactHeightfield(&ctx, width, height);
+		REQUIRE(rcBuildDistanceField(&ctx, *chf, &pool));
+		rcTimerContext timerCtx;
+		REQUIRE(rcBuildRegions(&timerCtx, *chf, borderSize, 8, 20, &pool));
+		REQUIRE(timerCtx.getAccumulatedTime(RC_TIMER_BUILD_REGIONS_WATERSHED) >= 0);
+		REQUIRE(timerCtx.getAccumulatedTime(RC_TIMER_BUILD_REGIONS_EXPAND) >= 0);
+		REQUIRE(timerCtx.getAccumulatedTime(RC_TIMER_BUILD_REGIONS_FLOOD) >= 0);
+
+		// Disabled timers are not reported.
+		rcTimerContext disabledCtx;
+		disabledCtx.enableTimer(false);
+		REQUIRE(rcBuildRegions(&disabledCtx, *chf, borderSize, 8, 20, &pool));
+		disabledCtx.enableTimer(true);
+		REQUIRE(disabledCtx.getAccumulatedTime(RC_TIMER_BUILD_REGIONS_EXPAND) == -1);
+		rcFreeCompactHeightfield(chf);
+	}
+
+	rcFreeCompactHeightfield(expected);
+}
+
+TEST_CASE("rcFilterHeightfield with thread pool")
+{
+	rcContext ctx;
+	const int width = GENERATE(1, 37, 300);
+	const int height = GENERATE(1, 45, 211);
+	rcHeightfield* expected = buildTestHeightfield(&ctx, width, height);
+	rcFilterLowHangingWalkableObstacles(&ctx, 2, *expected);
+	rcFilterLedgeSpans(&ctx, 6, 2, *expected);
+	rcFilterWalkableLowHeightSpans(&ctx, 6, *expected);
+
+	const int workerCount = GENERATE(1, 2, 4);
+	rcThreadPool pool;
+	REQUIRE(pool.init(workerCount));
+
+	rcHeightfield* hf = buildTestHeightfield(&ctx, width, height);
+	rcFilterHeightfield(&ctx, 6, 2, *hf, RC_FILTER_ALL, &pool);
+
+	REQUIRE(countDifferentAreas(*expected, *hf) == 0);
+
+	rcFreeHeightField(hf);
+	rcFreeHeightField(expected);
+}